@@ -2536,6 +2536,8 @@ int args_verify(char ***pargs, int *pargc,
 		flags |= X509_V_FLAG_SUITEB_192_LOS;
 	else if (!strcmp(arg, "-partial_chain"))
 		flags |= X509_V_FLAG_PARTIAL_CHAIN;
+	else if (!strcmp(arg, "-batch_sigs"))
+		flags |= X509_V_FLAG_BATCH_SIGNATURES;
 	else
 		return 0;
 
@@ -0,0 +1,220 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "apps.h"
+#include <openssl/err.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+
+#undef PROG
+#define PROG	certindex_main
+
+/* -out arg	- output file
+ * -verbose	- print what was indexed
+ * files	- PEM files of certificates and CRLs to index
+ */
+
+int MAIN(int, char **);
+
+int MAIN(int argc, char **argv)
+	{
+	int i,badops=0,verbose=0,ncerts=0,ncrls=0;
+	BIO *in=NULL,*out=NULL;
+	char *outfile=NULL,*newfile=NULL,*prog;
+	size_t len;
+	STACK_OF(X509_INFO) *objs=NULL;
+	X509_INFO *xi;
+	int ret=1;
+
+	apps_startup();
+
+	if (bio_err == NULL)
+		if ((bio_err=BIO_new(BIO_s_file())) != NULL)
+			BIO_set_fp(bio_err,stderr,BIO_NOCLOSE|BIO_FP_TEXT);
+
+	prog=argv[0];
+	argc--;
+	argv++;
+	while (argc >= 1)
+		{
+		if (strcmp(*argv,"-out") == 0)
+			{
+			if (--argc < 1) goto bad;
+			outfile= *(++argv);
+			}
+		else if (strcmp(*argv,"-verbose") == 0)
+			verbose=1;
+		else if (argv[0][0] == '-')
+			{
+			BIO_printf(bio_err,"unknown option %s\n",*argv);
+			badops=1;
+			break;
+			}
+		else
+			break;
+		argc--;
+		argv++;
+		}
+
+	if (badops || outfile == NULL || argc < 1)
+		{
+bad:
+		BIO_printf(bio_err,"%s -out file [options] file...\n",prog);
+		BIO_printf(bio_err,"where options are\n");
+		BIO_printf(bio_err," -out arg       index file to write\n");
+		BIO_printf(bio_err," -verbose       print the number of objects indexed\n");
+		BIO_printf(bio_err,"Each file contains certificates and CRLs in PEM format.\n");
+		goto end;
+		}
+
+	ERR_load_crypto_strings();
+
+	objs=sk_X509_INFO_new_null();
+	if (objs == NULL)
+		{
+		ERR_print_errors(bio_err);
+		goto end;
+		}
+	for (i=0; i < argc; i++)
+		{
+		in=BIO_new_file(argv[i],"r");
+		if (in == NULL)
+			{
+			BIO_printf(bio_err,"error opening the file, %s\n",argv[i]);
+			ERR_print_errors(bio_err);
+			goto end;
+			}
+		/* This appends the x509/crl/pkey sets of the file to objs */
+		if (PEM_X509_INFO_read_bio(in,objs,NULL,NULL) == NULL)
+			{
+			BIO_printf(bio_err,"error reading the file, %s\n",argv[i]);
+			ERR_print_errors(bio_err);
+			/* The entries of objs have been freed on error */
+			sk_X509_INFO_free(objs);
+			objs=NULL;
+			goto end;
+			}
+		BIO_free(in);
+		in=NULL;
+		}
+
+	for (i=0; i < sk_X509_INFO_num(objs); i++)
+		{
+		xi=sk_X509_INFO_value(objs,i);
+		if (xi->x509 != NULL)
+			ncerts++;
+		if (xi->crl != NULL)
+			ncrls++;
+		}
+
+	/* Processes may have the index mapped: write a new file and rename
+	 * it over the old one, so that they keep the old contents instead of
+	 * seeing them change under them. */
+	len=strlen(outfile)+5;
+	newfile=OPENSSL_malloc(len);
+	if (newfile == NULL)
+		{
+		BIO_printf(bio_err,"out of memory\n");
+		goto end;
+		}
+#ifndef OPENSSL_SYS_VMS
+	BIO_snprintf(newfile,len,"%s.new",outfile);
+#else
+	BIO_snprintf(newfile,len,"%s-new",outfile);
+#endif
+	out=BIO_new_file(newfile,"wb");
+	if (out == NULL)
+		{
+		BIO_printf(bio_err,"error opening the file, %s\n",newfile);
+		ERR_print_errors(bio_err);
+		goto end;
+		}
+	if (!X509_LOOKUP_write_index(out,objs) || BIO_flush(out) <= 0)
+		{
+		BIO_printf(bio_err,"unable to write index file %s\n",newfile);
+		ERR_print_errors(bio_err);
+		BIO_free_all(out);
+		out=NULL;
+		remove(newfile);
+		goto end;
+		}
+	BIO_free_all(out);
+	out=NULL;
+#ifdef _WIN32
+	/* rename() does not replace an existing file here */
+	remove(outfile);
+#endif
+	if (rename(newfile,outfile) < 0)
+		{
+		BIO_printf(bio_err,"unable to rename %s to %s\n",
+							newfile,outfile);
+		perror("reason");
+		remove(newfile);
+		goto end;
+		}
+	if (verbose)
+		BIO_printf(bio_err,"%d certificates, %d CRLs indexed\n",
+							ncerts,ncrls);
+	ret=0;
+end:
+	if (in != NULL) BIO_free(in);
+	if (out != NULL) BIO_free_all(out);
+	if (newfile != NULL) OPENSSL_free(newfile);
+	if (objs != NULL) sk_X509_INFO_pop_free(objs,X509_INFO_free);
+
+	apps_shutdown();
+	OPENSSL_EXIT(ret);
+	}
@@ -2122,6 +2122,7 @@ end:
 		OPENSSL_free(next_proto.data);
 #endif
 	if (ctx != NULL) SSL_CTX_free(ctx);
+	SSL_free_thread_buffers();
 	if (cert)
 		X509_free(cert);
 	if (crls)
@@ -2144,6 +2144,7 @@ end:
 	if (alpn_ctx.data)
 		OPENSSL_free(alpn_ctx.data);
 #endif
+	SSL_free_thread_buffers();
 	ssl_excert_free(exc);
 	if (ssl_args)
 		sk_OPENSSL_STRING_free(ssl_args);
@@ -205,6 +205,11 @@
 #define NO_FORK
 #endif
 
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX) && defined(SIGALRM)
+#define SPEED_THREADS
+#include <pthread.h>
+#endif
+
 #undef BUFSIZE
 #define BUFSIZE	(1024*8+1)
 #define MAX_MISALIGNMENT 63
@@ -222,8 +227,13 @@ static void print_result(int alg,int run_no,int count,double time_used);
 #ifndef NO_FORK
 static int do_multi(int multi);
 #endif
+static void rand_speed(int alg, int (*rand_fn)(unsigned char *buf, int num),
+	long *c, int threads);
+#ifdef SPEED_THREADS
+static int speed_threads_setup(void);
+#endif
 
-#define ALGOR_NUM	30
+#define ALGOR_NUM	33
 #define SIZE_NUM	5
 #define PRIME_NUM	3
 #define RSA_NUM		7
@@ -239,7 +249,8 @@ static const char *names[ALGOR_NUM]={
   "aes-128 cbc","aes-192 cbc","aes-256 cbc",
   "camellia-128 cbc","camellia-192 cbc","camellia-256 cbc",
   "evp","sha256","sha512","whirlpool",
-  "aes-128 ige","aes-192 ige","aes-256 ige","ghash" };
+  "aes-128 ige","aes-192 ige","aes-256 ige","ghash",
+  "chacha20-poly1305","rand","rand drbg" };
 static double results[ALGOR_NUM][SIZE_NUM];
 static int lengths[SIZE_NUM]={16,64,256,1024,8*1024};
 #ifndef OPENSSL_NO_RSA
@@ -365,6 +376,11 @@ int MAIN(int argc, char **argv)
 #endif
 #ifndef OPENSSL_NO_RSA
 	unsigned rsa_num;
+	int rsa_batch=0;
+	int *rsa_flens=NULL,*rsa_res=NULL;
+	const unsigned char **rsa_from=NULL;
+	unsigned char **rsa_to=NULL,*rsa_out=NULL;
+	RSA **rsa_keys=NULL;
 #endif
 	unsigned char md[EVP_MAX_MD_SIZE];
 #ifndef OPENSSL_NO_MD2
@@ -424,6 +440,8 @@ int MAIN(int argc, char **argv)
 		{0x12,0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,
 		 0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,0x12,
 		 0x56,0x78,0x9a,0xbc,0xde,0xf0,0x12,0x34};
+#endif
+#if !defined(OPENSSL_NO_AES) || !defined(OPENSSL_NO_CHACHA)
 	static const unsigned char key32[32]=
 		{0x12,0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,
 		 0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0,0x12,
@@ -492,6 +510,9 @@ int MAIN(int argc, char **argv)
 #define D_IGE_192_AES   27
 #define D_IGE_256_AES   28
 #define D_GHASH		29
+#define D_CHACHA20_POLY1305	30
+#define D_RAND		31
+#define D_RAND_DRBG	32
 	double d=0.0;
 	long c[ALGOR_NUM][SIZE_NUM];
 
@@ -633,6 +654,7 @@ int MAIN(int argc, char **argv)
 #endif
 	int multiblock=0;
 	int misalign=MAX_MISALIGNMENT+1;
+	int threads=1;
 
 #ifndef TIMES
 	usertime=-1;
@@ -777,6 +799,25 @@ int MAIN(int argc, char **argv)
 			j--;	/* Otherwise, -mr gets confused with
 				   an algorithm. */
 			}
+#endif
+#ifdef SPEED_THREADS
+		else if	((argc > 0) && (strcmp(*argv,"-threads") == 0))
+			{
+			argc--;
+			argv++;
+			if(argc == 0)
+				{
+				BIO_printf(bio_err,"no thread count given\n");
+				goto end;
+				}
+			threads=atoi(argv[0]);
+			if(threads <= 0)
+				{
+				BIO_printf(bio_err,"bad thread count\n");
+				goto end;
+				}
+			j--;
+			}
 #endif
 		else if (argc > 0 && !strcmp(*argv,"-mr"))
 			{
@@ -808,6 +849,25 @@ int MAIN(int argc, char **argv)
 			buf2=buf2_malloc+misalign;
 			j--;
 			}
+#ifndef OPENSSL_NO_RSA
+		else if (argc > 0 && !strcmp(*argv,"-batch"))
+			{
+			argc--;
+			argv++;
+			if (argc == 0)
+				{
+				BIO_printf(bio_err,"no batch size given\n");
+				goto end;
+				}
+			rsa_batch=atoi(argv[0]);
+			if (rsa_batch <= 0)
+				{
+				BIO_printf(bio_err,"bad batch size\n");
+				goto end;
+				}
+			j--;
+			}
+#endif
 		else
 #ifndef OPENSSL_NO_MD2
 		if	(strcmp(*argv,"md2") == 0) doit[D_MD2]=1;
@@ -963,6 +1023,19 @@ int MAIN(int argc, char **argv)
 			}
 		else
 #endif
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+		     if (strcmp(*argv,"chacha20-poly1305") == 0)
+			doit[D_CHACHA20_POLY1305]=1;
+		else
+#endif
+		     if (strcmp(*argv,"rand") == 0)
+			{
+			doit[D_RAND]=1;
+#ifndef OPENSSL_NO_AES
+			doit[D_RAND_DRBG]=1;
+#endif
+			}
+		else
 #ifndef OPENSSL_NO_CAMELLIA
 			if (strcmp(*argv,"camellia") == 0)
 			{
@@ -1117,6 +1190,10 @@ int MAIN(int argc, char **argv)
 			BIO_printf(bio_err,"rc4");
 #endif
 			BIO_printf(bio_err,"\n");
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+			BIO_printf(bio_err,"chacha20-poly1305\n");
+#endif
+			BIO_printf(bio_err,"rand\n");
 
 #ifndef OPENSSL_NO_RSA
 			BIO_printf(bio_err,"rsa512   rsa1024  rsa2048  rsa3072  rsa4096\n");
@@ -1183,8 +1260,14 @@ int MAIN(int argc, char **argv)
 			BIO_printf(bio_err,"-mr             produce machine readable output.\n");
 			BIO_printf(bio_err,"-mb             perform multi-block benchmark (for specific ciphers)\n");
 			BIO_printf(bio_err,"-misalign n     perform benchmark with misaligned data\n");
+#ifndef OPENSSL_NO_RSA
+			BIO_printf(bio_err,"-batch n        perform RSA public key operations n at a time\n");
+#endif
 #ifndef NO_FORK
 			BIO_printf(bio_err,"-multi n        run n benchmarks in parallel.\n");
+#endif
+#ifdef SPEED_THREADS
+			BIO_printf(bio_err,"-threads n      run the rand benchmarks in n threads.\n");
 #endif
 			goto end;
 			}
@@ -1198,6 +1281,16 @@ int MAIN(int argc, char **argv)
 		goto show_res;
 #endif
 
+#ifdef SPEED_THREADS
+	if (threads > 1)
+		{
+		if (!speed_threads_setup())
+			goto end;
+		/* The CPU time of all threads would be added up */
+		usertime = 0;
+		}
+#endif
+
 	if (j == 0)
 		{
 		for (i=0; i<ALGOR_NUM; i++)
@@ -1205,6 +1298,12 @@ int MAIN(int argc, char **argv)
 			if (i != D_EVP)
 				doit[i]=1;
 			}
+#ifdef OPENSSL_NO_AES
+		doit[D_RAND_DRBG]=0;
+#endif
+#if defined(OPENSSL_NO_CHACHA) || defined(OPENSSL_NO_POLY1305)
+		doit[D_CHACHA20_POLY1305]=0;
+#endif
 		for (i=0; i<RSA_NUM; i++)
 			rsa_doit[i]=1;
 		for (i=0; i<DSA_NUM; i++)
@@ -1338,6 +1437,9 @@ int MAIN(int argc, char **argv)
 	c[D_IGE_192_AES][0]=count;
 	c[D_IGE_256_AES][0]=count;
 	c[D_GHASH][0]=count;
+	c[D_CHACHA20_POLY1305][0]=count;
+	c[D_RAND][0]=count;
+	c[D_RAND_DRBG][0]=count;
 
 	for (i=1; i<SIZE_NUM; i++)
 		{
@@ -1377,6 +1479,9 @@ int MAIN(int argc, char **argv)
 		c[D_IGE_128_AES][i]=c[D_IGE_128_AES][i-1]*l0/l1;
 		c[D_IGE_192_AES][i]=c[D_IGE_192_AES][i-1]*l0/l1;
 		c[D_IGE_256_AES][i]=c[D_IGE_256_AES][i-1]*l0/l1;
+		c[D_CHACHA20_POLY1305][i]=c[D_CHACHA20_POLY1305][i-1]*l0/l1;
+		c[D_RAND][i]=c[D_RAND][i-1]*l0/l1;
+		c[D_RAND_DRBG][i]=c[D_RAND_DRBG][i-1]*l0/l1;
 		}
 
 	
@@ -1853,6 +1958,39 @@ int MAIN(int argc, char **argv)
 		}
 
 #endif
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+	if (doit[D_CHACHA20_POLY1305])
+		{
+		EVP_CIPHER_CTX ctx;
+		int outl;
+
+		/* One sealed message per iteration, as for a TLS record */
+		EVP_CIPHER_CTX_init(&ctx);
+		EVP_EncryptInit_ex(&ctx,EVP_chacha20_poly1305(),NULL,key32,NULL);
+		for (j=0; j<SIZE_NUM; j++)
+			{
+			print_message(names[D_CHACHA20_POLY1305],
+				c[D_CHACHA20_POLY1305][j],lengths[j]);
+			Time_F(START);
+			for (count=0,run=1; COND(c[D_CHACHA20_POLY1305][j]); count++)
+				{
+				EVP_EncryptInit_ex(&ctx,NULL,NULL,NULL,iv);
+				EVP_EncryptUpdate(&ctx,buf,&outl,buf,lengths[j]);
+				EVP_EncryptFinal_ex(&ctx,buf,&outl);
+				}
+			d=Time_F(STOP);
+			print_result(D_CHACHA20_POLY1305,j,count,d);
+			}
+		EVP_CIPHER_CTX_cleanup(&ctx);
+		}
+#endif
+	if (doit[D_RAND])
+		rand_speed(D_RAND,RAND_bytes,c[D_RAND],threads);
+#ifndef OPENSSL_NO_AES
+	if (doit[D_RAND_DRBG])
+		rand_speed(D_RAND_DRBG,RAND_thread_drbg()->bytes,
+			c[D_RAND_DRBG],threads);
+#endif
 #ifndef OPENSSL_NO_CAMELLIA
 	if (doit[D_CBC_128_CML])
 		{
@@ -2063,6 +2201,21 @@ int MAIN(int argc, char **argv)
 #endif
 	RAND_pseudo_bytes(buf,36);
 #ifndef OPENSSL_NO_RSA
+	if (rsa_batch > 0)
+		{
+		rsa_flens=OPENSSL_malloc(rsa_batch*sizeof(int));
+		rsa_res=OPENSSL_malloc(rsa_batch*sizeof(int));
+		rsa_from=OPENSSL_malloc(rsa_batch*sizeof(unsigned char *));
+		rsa_to=OPENSSL_malloc(rsa_batch*sizeof(unsigned char *));
+		rsa_keys=OPENSSL_malloc(rsa_batch*sizeof(RSA *));
+		rsa_out=OPENSSL_malloc(rsa_batch*(rsa_bits[RSA_NUM-1]/8));
+		if (rsa_flens == NULL || rsa_res == NULL || rsa_from == NULL ||
+			rsa_to == NULL || rsa_keys == NULL || rsa_out == NULL)
+			{
+			BIO_printf(bio_err,"out of memory\n");
+			goto end;
+			}
+		}
 	for (j=0; j<RSA_NUM; j++)
 		{
 		int ret;
@@ -2115,7 +2268,40 @@ int MAIN(int argc, char **argv)
 			pkey_print_message("public","rsa",
 				rsa_c[j][1],rsa_bits[j],
 				RSA_SECONDS);
+			for (k=0; k<rsa_batch; k++)
+				{
+				rsa_flens[k]=rsa_num;
+				rsa_from[k]=buf2;
+				rsa_to[k]=rsa_out+k*RSA_size(rsa_key[j]);
+				rsa_keys[k]=rsa_key[j];
+				}
 			Time_F(START);
+			if (rsa_batch > 0)
+				{
+				/* Decrypt the signature rsa_batch times over
+				 * and check each result as RSA_verify() does */
+				for (count=0,run=1; COND(rsa_c[j][1]);
+					count+=rsa_batch)
+					{
+					ret=RSA_public_decrypt_batch(rsa_flens,
+						rsa_from,rsa_to,rsa_keys,
+						RSA_PKCS1_PADDING,rsa_res,
+						rsa_batch);
+					for (k=0; ret && k<rsa_batch; k++)
+						if (rsa_res[k] != 36 ||
+							memcmp(rsa_to[k],buf,36))
+							ret=0;
+					if (!ret)
+						{
+						BIO_printf(bio_err,
+							"RSA verify failure\n");
+						ERR_print_errors(bio_err);
+						count=1;
+						break;
+						}
+					}
+				}
+			else
 			for (count=0,run=1; COND(rsa_c[j][1]); count++)
 				{
 				ret=RSA_verify(NID_md5_sha1, buf,36, buf2,
@@ -2608,6 +2794,12 @@ end:
 	for (i=0; i<RSA_NUM; i++)
 		if (rsa_key[i] != NULL)
 			RSA_free(rsa_key[i]);
+	if (rsa_flens != NULL) OPENSSL_free(rsa_flens);
+	if (rsa_res != NULL) OPENSSL_free(rsa_res);
+	if (rsa_from != NULL) OPENSSL_free(rsa_from);
+	if (rsa_to != NULL) OPENSSL_free(rsa_to);
+	if (rsa_keys != NULL) OPENSSL_free(rsa_keys);
+	if (rsa_out != NULL) OPENSSL_free(rsa_out);
 #endif
 #ifndef OPENSSL_NO_DSA
 	for (i=0; i<DSA_NUM; i++)
@@ -2895,6 +3087,125 @@ static int do_multi(int multi)
 	}
 #endif
 
+#ifdef SPEED_THREADS
+static pthread_mutex_t *speed_locks;
+
+static void speed_locking_cb(int mode, int type, const char *file, int line)
+	{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&speed_locks[type]);
+	else
+		pthread_mutex_unlock(&speed_locks[type]);
+	}
+
+static int speed_threads_setup(void)
+	{
+	int i;
+
+	if (CRYPTO_get_locking_callback() != NULL)
+		return 1;
+	speed_locks=OPENSSL_malloc(CRYPTO_num_locks()*sizeof(pthread_mutex_t));
+	if (speed_locks == NULL)
+		{
+		BIO_printf(bio_err,"out of memory\n");
+		return 0;
+		}
+	for (i=0; i<CRYPTO_num_locks(); i++)
+		pthread_mutex_init(&speed_locks[i],NULL);
+	CRYPTO_set_locking_callback(speed_locking_cb);
+	return 1;
+	}
+
+typedef struct rand_speed_job_st
+	{
+	int (*rand_fn)(unsigned char *buf, int num);
+	unsigned char buf[BUFSIZE];
+	int length;
+	long count;
+	} RAND_SPEED_JOB;
+
+static void *rand_speed_thread(void *arg)
+	{
+	RAND_SPEED_JOB *job=arg;
+	long count;
+
+	for (count=0; run && count<0x7fffffff; count++)
+		job->rand_fn(job->buf,job->length);
+	job->count=count;
+	return NULL;
+	}
+#endif
+
+/* Times rand_fn for each of the lengths; with more than one thread all of
+ * them call it concurrently and the throughput of all threads is reported. */
+static void rand_speed(int alg, int (*rand_fn)(unsigned char *buf, int num),
+	long *c, int threads)
+	{
+	unsigned char buf[BUFSIZE];
+	long count=0;
+	double d;
+	int j;
+#ifdef SPEED_THREADS
+	RAND_SPEED_JOB *jobs=NULL;
+	pthread_t *tids=NULL;
+	int i;
+
+	if (threads > 1)
+		{
+		jobs=OPENSSL_malloc(threads*sizeof(*jobs));
+		tids=OPENSSL_malloc(threads*sizeof(*tids));
+		if (jobs == NULL || tids == NULL)
+			{
+			BIO_printf(bio_err,"out of memory\n");
+			goto end;
+			}
+		}
+#endif
+
+	/* Seed the pool outside the timing */
+	rand_fn(buf,16);
+	for (j=0; j<SIZE_NUM; j++)
+		{
+		print_message(names[alg],c[j],lengths[j]);
+		Time_F(START);
+#ifdef SPEED_THREADS
+		if (threads > 1)
+			{
+			run=1;
+			for (i=0; i<threads; i++)
+				{
+				jobs[i].rand_fn=rand_fn;
+				jobs[i].length=lengths[j];
+				jobs[i].count=0;
+				if (pthread_create(&tids[i],NULL,rand_speed_thread,
+						&jobs[i]) != 0)
+					{
+					BIO_printf(bio_err,"unable to create thread\n");
+					run=0;
+					threads=i;
+					break;
+					}
+				}
+			for (count=0,i=0; i<threads; i++)
+				{
+				pthread_join(tids[i],NULL);
+				count+=jobs[i].count;
+				}
+			}
+		else
+#endif
+		for (count=0,run=1; COND(c[j]); count++)
+			rand_fn(buf,lengths[j]);
+		d=Time_F(STOP);
+		print_result(alg,j,count,d);
+		}
+#ifdef SPEED_THREADS
+end:
+	if (jobs != NULL) OPENSSL_free(jobs);
+	if (tids != NULL) OPENSSL_free(tids);
+#endif
+	}
+
 static void multiblock_speed(const EVP_CIPHER *evp_cipher)
 	{
 	static int mblengths[]={8*1024,2*8*1024,4*8*1024,8*8*1024,8*16*1024};
@@ -81,7 +81,7 @@ int MAIN(int argc, char **argv)
 	{
 	ENGINE *e = NULL;
 	int i,ret=1, badarg = 0;
-	char *CApath=NULL,*CAfile=NULL;
+	char *CApath=NULL,*CAfile=NULL,*CAindex=NULL;
 	char *untfile = NULL, *trustfile = NULL, *crlfile = NULL;
 	STACK_OF(X509) *untrusted = NULL, *trusted = NULL;
 	STACK_OF(X509_CRL) *crls = NULL;
@@ -124,6 +124,11 @@ int MAIN(int argc, char **argv)
 				if (argc-- < 1) goto end;
 				CAfile= *(++argv);
 				}
+			else if (strcmp(*argv,"-CAindex") == 0)
+				{
+				if (argc-- < 1) goto end;
+				CAindex= *(++argv);
+				}
 			else if (args_verify(&argv, &argc, &badarg, bio_err,
 									&vpm))
 				{
@@ -201,6 +206,17 @@ int MAIN(int argc, char **argv)
 		}
 	} else X509_LOOKUP_add_dir(lookup,NULL,X509_FILETYPE_DEFAULT);
 
+	if (CAindex) {
+		lookup=X509_STORE_add_lookup(cert_ctx,X509_LOOKUP_index_file());
+		if (lookup == NULL) abort();
+		i=X509_LOOKUP_load_index(lookup,CAindex);
+		if(!i) {
+			BIO_printf(bio_err, "Error loading index %s\n", CAindex);
+			ERR_print_errors(bio_err);
+			goto end;
+		}
+	}
+
 	ERR_clear_error();
 
 	if(untfile)
@@ -245,7 +261,7 @@ int MAIN(int argc, char **argv)
 
 end:
 	if (ret == 1) {
-		BIO_printf(bio_err,"usage: verify [-verbose] [-CApath path] [-CAfile file] [-trusted_first] [-purpose purpose] [-crl_check]");
+		BIO_printf(bio_err,"usage: verify [-verbose] [-CApath path] [-CAfile file] [-CAindex file] [-trusted_first] [-purpose purpose] [-crl_check]");
 #ifndef OPENSSL_NO_ENGINE
 		BIO_printf(bio_err," [-engine e]");
 #endif
@@ -59,6 +59,7 @@
 #include <stdio.h>
 #include "cryptlib.h"
 #include <openssl/asn1.h>
+#include "asn1_locl.h"
 
 static int asn1_collate_primitive(ASN1_STRING *a, ASN1_const_CTX *c);
 /* type is a 'bitmap' of acceptable string types.
@@ -114,7 +115,7 @@ ASN1_STRING *d2i_ASN1_type_bytes(ASN1_STRING **a, const unsigned char **pp,
 	else
 		s=NULL;
 
-	if (ret->data != NULL) OPENSSL_free(ret->data);
+	asn1_string_free_data(ret);
 	ret->length=(int)len;
 	ret->data=s;
 	ret->type=tag;
@@ -209,7 +210,7 @@ ASN1_STRING *d2i_ASN1_bytes(ASN1_STRING **a, const unsigned char **pp,
 			{
 			if ((ret->length < len) || (ret->data == NULL))
 				{
-				if (ret->data != NULL) OPENSSL_free(ret->data);
+				asn1_string_free_data(ret);
 				s=(unsigned char *)OPENSSL_malloc((int)len + 1);
 				if (s == NULL)
 					{
@@ -226,7 +227,7 @@ ASN1_STRING *d2i_ASN1_bytes(ASN1_STRING **a, const unsigned char **pp,
 		else
 			{
 			s=NULL;
-			if (ret->data != NULL) OPENSSL_free(ret->data);
+			asn1_string_free_data(ret);
 			}
 
 		ret->length=(int)len;
@@ -301,7 +302,7 @@ static int asn1_collate_primitive(ASN1_STRING *a, ASN1_const_CTX *c)
 	if (!asn1_const_Finish(c)) goto err;
 
 	a->length=num;
-	if (a->data != NULL) OPENSSL_free(a->data);
+	asn1_string_free_data(a);
 	a->data=(unsigned char *)b.data;
 	if (os != NULL) ASN1_STRING_free(os);
 	return(1);
@@ -60,6 +60,7 @@
 #include "cryptlib.h"
 #include <openssl/asn1.h>
 #include <openssl/bn.h>
+#include "asn1_locl.h"
 
 /* 
  * Code for ENUMERATED type: identical to INTEGER apart from a different tag.
@@ -74,10 +75,10 @@ int ASN1_ENUMERATED_set(ASN1_ENUMERATED *a, long v)
 	long d;
 
 	a->type=V_ASN1_ENUMERATED;
-	if (a->length < (int)(sizeof(long)+1))
+	if ((a->length < (int)(sizeof(long)+1))
+		|| (a->flags & ASN1_STRING_FLAG_ARENA_DATA))
 		{
-		if (a->data != NULL)
-			OPENSSL_free(a->data);
+		asn1_string_free_data(a);
 		if ((a->data=(unsigned char *)OPENSSL_malloc(sizeof(long)+1)) != NULL)
 			memset((char *)a->data,0,sizeof(long)+1);
 		}
@@ -153,6 +154,11 @@ ASN1_ENUMERATED *BN_to_ASN1_ENUMERATED(BIGNUM *bn, ASN1_ENUMERATED *ai)
 	else ret->type=V_ASN1_ENUMERATED;
 	j=BN_num_bits(bn);
 	len=((j == 0)?0:((j/8)+1));
+	if (!asn1_string_own_data(ret))
+		{
+		ASN1err(ASN1_F_BN_TO_ASN1_ENUMERATED,ERR_R_MALLOC_FAILURE);
+		goto err;
+		}
 	if (ret->length < len+4)
 		{
 		unsigned char *new_data=OPENSSL_realloc(ret->data, len+4);
@@ -294,8 +294,7 @@ ASN1_GENERALIZEDTIME *ASN1_GENERALIZEDTIME_adj(ASN1_GENERALIZEDTIME *s,
 				ERR_R_MALLOC_FAILURE);
 			return(NULL);
 			}
-		if (s->data != NULL)
-			OPENSSL_free(s->data);
+		asn1_string_free_data(s);
 		s->data=(unsigned char *)p;
 		}
 
@@ -60,6 +60,7 @@
 #include "cryptlib.h"
 #include <openssl/asn1.h>
 #include <openssl/bn.h>
+#include "asn1_locl.h"
 
 ASN1_INTEGER *ASN1_INTEGER_dup(const ASN1_INTEGER *x)
 { return M_ASN1_INTEGER_dup(x);}
@@ -249,7 +250,7 @@ ASN1_INTEGER *c2i_ASN1_INTEGER(ASN1_INTEGER **a, const unsigned char **pp,
 		memcpy(s,p,(int)len);
 	}
 
-	if (ret->data != NULL) OPENSSL_free(ret->data);
+	asn1_string_free_data(ret);
 	ret->data=s;
 	ret->length=(int)len;
 	if (a != NULL) (*a)=ret;
@@ -319,7 +320,7 @@ ASN1_INTEGER *d2i_ASN1_UINTEGER(ASN1_INTEGER **a, const unsigned char **pp,
 		p+=len;
 	}
 
-	if (ret->data != NULL) OPENSSL_free(ret->data);
+	asn1_string_free_data(ret);
 	ret->data=s;
 	ret->length=(int)len;
 	if (a != NULL) (*a)=ret;
@@ -338,10 +339,10 @@ int ASN1_INTEGER_set(ASN1_INTEGER *a, long v)
 	unsigned int i;
 	unsigned char buf[sizeof(long)+1];
 
-	if (a->length < (int)(sizeof(long)+1))
+	if ((a->length < (int)(sizeof(long)+1))
+		|| (a->flags & ASN1_STRING_FLAG_ARENA_DATA))
 		{
-		if (a->data != NULL)
-			OPENSSL_free(a->data);
+		asn1_string_free_data(a);
 		if ((a->data=(unsigned char *)OPENSSL_malloc(sizeof(long)+1)) != NULL)
 			memset((char *)a->data,0,sizeof(long)+1);
 		}
@@ -419,6 +420,11 @@ ASN1_INTEGER *BN_to_ASN1_INTEGER(const BIGNUM *bn, ASN1_INTEGER *ai)
 	else ret->type=V_ASN1_INTEGER;
 	j=BN_num_bits(bn);
 	len=((j == 0)?0:((j/8)+1));
+	if (!asn1_string_own_data(ret))
+		{
+		ASN1err(ASN1_F_BN_TO_ASN1_INTEGER,ERR_R_MALLOC_FAILURE);
+		goto err;
+		}
 	if (ret->length < len+4)
 		{
 		unsigned char *new_data=OPENSSL_realloc(ret->data, len+4);
@@ -60,6 +60,7 @@
 #include <ctype.h>
 #include "cryptlib.h"
 #include <openssl/asn1.h>
+#include "asn1_locl.h"
 
 static int traverse_string(const unsigned char *p, int len, int inform,
 		 int (*rfunc)(unsigned long value, void *in), void *arg);
@@ -185,7 +186,7 @@ int ASN1_mbstring_ncopy(ASN1_STRING **out, const unsigned char *in, int len,
 		dest = *out;
 		if(dest->data) {
 			dest->length = 0;
-			OPENSSL_free(dest->data);
+			asn1_string_free_data(dest);
 			dest->data = NULL;
 		}
 		dest->type = str_type;
@@ -63,6 +63,7 @@
 #include <openssl/asn1.h>
 #include <openssl/objects.h>
 #include <openssl/bn.h>
+#include "asn1_locl.h"
 
 int i2d_ASN1_OBJECT(ASN1_OBJECT *a, unsigned char **pp)
 	{
@@ -291,6 +292,17 @@ err:
 ASN1_OBJECT *c2i_ASN1_OBJECT(ASN1_OBJECT **a, const unsigned char **pp,
 	     long len)
 	{
+	return asn1_c2i_object(a, pp, len, NULL);
+	}
+
+/* As c2i_ASN1_OBJECT() but a new object is allocated, together with its
+ * data, from 'arena' if there is room. Such an object is not freed by
+ * ASN1_OBJECT_free().
+ */
+
+ASN1_OBJECT *asn1_c2i_object(ASN1_OBJECT **a, const unsigned char **pp,
+	     long len, ASN1_ARENA *arena)
+	{
 	ASN1_OBJECT *ret=NULL;
 	const unsigned char *p;
 	unsigned char *data;
@@ -323,6 +335,31 @@ ASN1_OBJECT *c2i_ASN1_OBJECT(ASN1_OBJECT **a, const unsigned char **pp,
 	if ((a == NULL) || ((*a) == NULL) ||
 		!((*a)->flags & ASN1_OBJECT_FLAG_DYNAMIC))
 		{
+		if (asn1_arena_refs(arena, *pp, length))
+			{
+			/* Point at the encoding in the input */
+			if ((ret = asn1_arena_alloc(arena,
+						sizeof(ASN1_OBJECT))))
+				data = (unsigned char *)*pp;
+			}
+		else if (arena && (ret = asn1_arena_alloc(arena,
+					sizeof(ASN1_OBJECT) + length)))
+			{
+			data = (unsigned char *)(ret + 1);
+			memcpy(data, *pp, length);
+			}
+		if (ret)
+			{
+			ret->data = data;
+			ret->length = length;
+			ret->nid = 0;
+			ret->sn = NULL;
+			ret->ln = NULL;
+			ret->flags = ASN1_OBJECT_FLAG_ARENA;
+			if (a != NULL) (*a)=ret;
+			*pp += length;
+			return(ret);
+			}
 		if ((ret=ASN1_OBJECT_new()) == NULL) return(NULL);
 		}
 	else	ret=(*a);
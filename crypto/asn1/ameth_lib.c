@@ -69,6 +69,7 @@ extern const EVP_PKEY_ASN1_METHOD dsa_asn1_meths[];
 extern const EVP_PKEY_ASN1_METHOD dh_asn1_meth;
 extern const EVP_PKEY_ASN1_METHOD dhx_asn1_meth;
 extern const EVP_PKEY_ASN1_METHOD eckey_asn1_meth;
+extern const EVP_PKEY_ASN1_METHOD ecx25519_asn1_meth;
 extern const EVP_PKEY_ASN1_METHOD hmac_asn1_meth;
 extern const EVP_PKEY_ASN1_METHOD cmac_asn1_meth;
 
@@ -95,7 +96,10 @@ static const EVP_PKEY_ASN1_METHOD *standard_methods[] =
 	&hmac_asn1_meth,
 	&cmac_asn1_meth,
 #ifndef OPENSSL_NO_DH
-	&dhx_asn1_meth
+	&dhx_asn1_meth,
+#endif
+#ifndef OPENSSL_NO_EC
+	&ecx25519_asn1_meth
 #endif
 	};
 
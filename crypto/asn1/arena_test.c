@@ -0,0 +1,488 @@
+/* crypto/asn1/arena_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Tests for ASN1_item_d2i_arena() and ASN1_item_d2i_buffer(): decoding,
+ * freeing, reference counts and changes to structures decoded into an
+ * arena or referencing their input.
+ *
+ *	arena_test cert.pem
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/asn1.h>
+#include <openssl/asn1t.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+
+static unsigned char *der;
+static int der_len;
+
+/* Check that x encodes to the input and matches a heap decoding of it */
+static int check_cert(const char *test, X509 *x)
+	{
+	const unsigned char *p = der;
+	unsigned char *enc = NULL;
+	X509 *ref;
+	int len, ok = 1;
+
+	ref = d2i_X509(NULL, &p, der_len);
+	len = i2d_X509(x, &enc);
+	if (len != der_len || memcmp(enc, der, len))
+		{
+		fprintf(stderr, "%s: encoding differs\n", test);
+		ok = 0;
+		}
+	if (ref == NULL || X509_cmp(x, ref)
+		|| X509_NAME_cmp(X509_get_subject_name(x),
+					X509_get_subject_name(ref))
+		|| ASN1_INTEGER_cmp(X509_get_serialNumber(x),
+					X509_get_serialNumber(ref)))
+		{
+		fprintf(stderr, "%s: fields differ\n", test);
+		ok = 0;
+		}
+	if (enc)
+		OPENSSL_free(enc);
+	X509_free(ref);
+	return ok;
+	}
+
+static int test_decode(void)
+	{
+	const unsigned char *p = der;
+	X509 *x;
+	int ok = 1;
+
+	x = d2i_X509_arena(NULL, &p, der_len);
+	if (x == NULL || p != der + der_len)
+		{
+		fprintf(stderr, "decode: d2i_X509_arena failed\n");
+		return 0;
+		}
+	/* The root records its arena, its strings are taken from it */
+	if (x->arena == NULL
+		|| !(X509_get_serialNumber(x)->flags & ASN1_STRING_FLAG_ARENA)
+		|| !(X509_get_notBefore(x)->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "decode: not decoded into an arena\n");
+		ok = 0;
+		}
+	if (!check_cert("decode", x))
+		ok = 0;
+	X509_free(x);
+	return ok;
+	}
+
+static int test_refcount(void)
+	{
+	const unsigned char *p = der;
+	X509 *x;
+	int ok = 1;
+
+	x = d2i_X509_arena(NULL, &p, der_len);
+	if (x == NULL)
+		return 0;
+	CRYPTO_add(&x->references, 1, CRYPTO_LOCK_X509);
+	/* The first free only drops a reference */
+	X509_free(x);
+	if (x->references != 1 || !check_cert("refcount", x))
+		ok = 0;
+	X509_free(x);
+	return ok;
+	}
+
+/* Change fields of an arena structure, so that some of it moves to the
+ * heap, then reuse it for an ordinary decode.
+ */
+
+static int test_modify(void)
+	{
+	const unsigned char *p = der;
+	X509 *x;
+	X509_NAME *name;
+	ASN1_INTEGER *serial;
+	int ok = 1;
+
+	x = d2i_X509_arena(NULL, &p, der_len);
+	if (x == NULL)
+		return 0;
+
+	name = X509_NAME_new();
+	if (!X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+				(const unsigned char *)"arena", -1, -1, 0)
+		|| !X509_set_subject_name(x, name))
+		ok = 0;
+	X509_NAME_free(name);
+
+	serial = X509_get_serialNumber(x);
+	if (!ASN1_INTEGER_set(serial, 12345) || ASN1_INTEGER_get(serial) != 12345
+		|| (serial->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "modify: ASN1_INTEGER_set failed\n");
+		ok = 0;
+		}
+	if (!X509_gmtime_adj(X509_get_notBefore(x), 0)
+		|| !X509_set_version(x, 1))
+		ok = 0;
+
+	/* A structure that is not the root can be freed on its own */
+	X509_CINF_free(x->cert_info);
+	x->cert_info = NULL;
+
+	p = der;
+	if (d2i_X509(&x, &p, der_len) == NULL || !check_cert("modify", x))
+		{
+		fprintf(stderr, "modify: reuse failed\n");
+		ok = 0;
+		}
+	X509_free(x);
+	return ok;
+	}
+
+static int test_truncated(void)
+	{
+	const unsigned char *p;
+	unsigned char *buf;
+	X509 *x;
+	int len, ok = 1;
+
+	buf = OPENSSL_malloc(der_len);
+	for (len = 0; len < der_len; len++)
+		{
+		memcpy(buf, der, len);
+		p = buf;
+		x = d2i_X509_arena(NULL, &p, len);
+		if (x != NULL)
+			{
+			fprintf(stderr, "truncated: %d bytes decoded\n", len);
+			X509_free(x);
+			ok = 0;
+			}
+		}
+	/* Corrupt each byte of the encoding in turn */
+	for (len = 0; len < der_len; len++)
+		{
+		memcpy(buf, der, der_len);
+		buf[len] ^= 0x81;
+		p = buf;
+		x = d2i_X509_arena(NULL, &p, der_len);
+		X509_free(x);
+		}
+	OPENSSL_free(buf);
+	ERR_clear_error();
+	return ok;
+	}
+
+/* True if the data of s lies in the n bytes at buf */
+static int in_buffer(const ASN1_STRING *s, const unsigned char *buf, int n)
+	{
+	return s->data >= buf && s->data < buf + n;
+	}
+
+/* Structures decoded with ASN1_item_d2i_buffer() keep the input alive
+ * after the caller has dropped its reference, until the last of them is
+ * freed.
+ */
+
+static int test_buffer(void)
+	{
+	const unsigned char *p;
+	unsigned char *buf;
+	ASN1_BUFFER *b;
+	X509 *x1 = NULL, *x2 = NULL;
+	int ok = 1;
+
+	buf = OPENSSL_malloc(der_len);
+	memcpy(buf, der, der_len);
+	b = ASN1_BUFFER_new(buf, der_len);
+	p = buf;
+	x1 = d2i_X509_buffer(NULL, &p, der_len, b);
+	p = buf;
+	x2 = d2i_X509_buffer(NULL, &p, der_len, b);
+	/* Input outside the buffer is refused */
+	p = der;
+	if (d2i_X509_buffer(NULL, &p, der_len, b) != NULL)
+		{
+		fprintf(stderr, "buffer: input outside the buffer decoded\n");
+		ok = 0;
+		}
+	ERR_clear_error();
+	ASN1_BUFFER_free(b);
+	if (x1 == NULL || x2 == NULL
+		|| !in_buffer(X509_get_serialNumber(x1), buf, der_len)
+		|| !(X509_get_serialNumber(x1)->flags
+					& ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "buffer: not decoded in place\n");
+		ok = 0;
+		goto end;
+		}
+	X509_free(x1);
+	x1 = NULL;
+	/* x2 still holds the buffer */
+	if (!check_cert("buffer", x2))
+		ok = 0;
+end:
+	X509_free(x1);
+	X509_free(x2);
+	return ok;
+	}
+
+/* Functions that change a string referencing the input in place must
+ * copy it, never write to or free the input.
+ */
+
+static int test_buffer_mutators(void)
+	{
+	const unsigned char *p;
+	unsigned char *buf, *save;
+	ASN1_BUFFER *b;
+	ASN1_INTEGER *serial;
+	ASN1_BIT_STRING *sig;
+	ASN1_TIME *t;
+	ASN1_STRING *s;
+	X509 *x;
+	int ok = 1;
+
+	buf = OPENSSL_malloc(der_len);
+	memcpy(buf, der, der_len);
+	save = OPENSSL_malloc(der_len);
+	memcpy(save, der, der_len);
+	b = ASN1_BUFFER_new(buf, der_len);
+	p = buf;
+	x = d2i_X509_buffer(NULL, &p, der_len, b);
+	ASN1_BUFFER_free(b);
+	if (x == NULL)
+		{
+		OPENSSL_free(save);
+		return 0;
+		}
+
+	serial = X509_get_serialNumber(x);
+	if (!in_buffer(serial, buf, der_len) || !ASN1_INTEGER_set(serial, 7)
+		|| ASN1_INTEGER_get(serial) != 7
+		|| in_buffer(serial, buf, der_len)
+		|| (serial->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "mutators: ASN1_INTEGER_set failed\n");
+		ok = 0;
+		}
+	sig = x->signature;
+	if (!in_buffer(sig, buf, der_len)
+		|| !ASN1_BIT_STRING_set_bit(sig, 0, !ASN1_BIT_STRING_get_bit(sig, 0))
+		|| in_buffer(sig, buf, der_len)
+		|| (sig->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "mutators: ASN1_BIT_STRING_set_bit failed\n");
+		ok = 0;
+		}
+	t = X509_get_notBefore(x);
+	if (!ASN1_STRING_set(t, "19700101000000Z", -1)
+		|| (t->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "mutators: ASN1_STRING_set failed\n");
+		ok = 0;
+		}
+	t = X509_get_notAfter(x);
+	if (!X509_gmtime_adj(t, 0) || (t->flags & ASN1_STRING_FLAG_ARENA_DATA))
+		{
+		fprintf(stderr, "mutators: X509_gmtime_adj failed\n");
+		ok = 0;
+		}
+
+	/* A copy or a duplicate owns its data */
+	s = ASN1_STRING_dup(x->signature);
+	if (s == NULL || (s->flags & (ASN1_STRING_FLAG_ARENA
+					| ASN1_STRING_FLAG_ARENA_DATA))
+		|| ASN1_STRING_cmp(s, x->signature))
+		{
+		fprintf(stderr, "mutators: ASN1_STRING_dup failed\n");
+		ok = 0;
+		}
+	ASN1_STRING_free(s);
+
+	/* The input has not been written to */
+	if (memcmp(buf, save, der_len))
+		{
+		fprintf(stderr, "mutators: input changed\n");
+		ok = 0;
+		}
+	OPENSSL_free(save);
+	X509_free(x);
+	return ok;
+	}
+
+/* ASN1_TYPE_set_int_octetstring() builds its INTEGER on the stack */
+
+static int test_int_octetstring(void)
+	{
+	static unsigned char data[] = "octets";
+	unsigned char out[sizeof(data)];
+	ASN1_TYPE *at;
+	long num = 0;
+	int ok;
+
+	at = ASN1_TYPE_new();
+	ok = at != NULL
+		&& ASN1_TYPE_set_int_octetstring(at, 0x12345678L, data,
+							sizeof(data))
+		&& ASN1_TYPE_get_int_octetstring(at, &num, out, sizeof(out))
+			== sizeof(data)
+		&& num == 0x12345678L && !memcmp(out, data, sizeof(data));
+	if (!ok)
+		fprintf(stderr, "int octetstring: round trip failed\n");
+	ASN1_TYPE_free(at);
+	return ok;
+	}
+
+/* Items that cannot record an arena are decoded from the heap */
+
+static int test_other_items(void)
+	{
+	const unsigned char *p = der;
+	X509 *x;
+	X509_ALGOR *alg;
+	X509_NAME *name;
+	unsigned char *enc = NULL;
+	int len, ok = 1;
+
+	x = d2i_X509(NULL, &p, der_len);
+	if (x == NULL)
+		return 0;
+	len = i2d_X509_ALGOR(x->sig_alg, &enc);
+	p = enc;
+	alg = (X509_ALGOR *)ASN1_item_d2i_arena(NULL, &p, len,
+					ASN1_ITEM_rptr(X509_ALGOR));
+	if (alg == NULL || OBJ_cmp(alg->algorithm, x->sig_alg->algorithm))
+		ok = 0;
+	X509_ALGOR_free(alg);
+	OPENSSL_free(enc);
+
+	enc = NULL;
+	len = i2d_X509_NAME(X509_get_issuer_name(x), &enc);
+	p = enc;
+	name = (X509_NAME *)ASN1_item_d2i_arena(NULL, &p, len,
+					ASN1_ITEM_rptr(X509_NAME));
+	if (name == NULL || X509_NAME_cmp(name, X509_get_issuer_name(x)))
+		ok = 0;
+	X509_NAME_free(name);
+	OPENSSL_free(enc);
+	X509_free(x);
+	if (!ok)
+		fprintf(stderr, "other items: decode failed\n");
+	return ok;
+	}
+
+int main(int argc, char *argv[])
+	{
+	BIO *in, *leaks;
+	X509 *x;
+	int ret = 1;
+
+	if (argc != 2)
+		{
+		fprintf(stderr, "usage: arena_test cert.pem\n");
+		return 1;
+		}
+
+	CRYPTO_malloc_debug_init();
+	CRYPTO_dbg_set_options(V_CRYPTO_MDEBUG_ALL);
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+	ERR_load_crypto_strings();
+	OpenSSL_add_all_digests();
+
+	in = BIO_new_file(argv[1], "r");
+	x = in ? PEM_read_bio_X509(in, NULL, NULL, NULL) : NULL;
+	BIO_free(in);
+	der = NULL;
+	if (x == NULL || (der_len = i2d_X509(x, &der)) <= 0)
+		{
+		fprintf(stderr, "cannot read %s\n", argv[1]);
+		ERR_print_errors_fp(stderr);
+		return 1;
+		}
+	X509_free(x);
+
+	if (test_decode() && test_refcount() && test_modify()
+		&& test_truncated() && test_other_items() && test_buffer()
+		&& test_buffer_mutators() && test_int_octetstring())
+		ret = 0;
+	OPENSSL_free(der);
+
+	EVP_cleanup();
+	CRYPTO_cleanup_all_ex_data();
+	ERR_free_strings();
+	ERR_remove_thread_state(NULL);
+
+	/* Everything decoded into an arena must have been freed */
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_OFF);
+	leaks = BIO_new(BIO_s_mem());
+	CRYPTO_mem_leaks(leaks);
+	if (BIO_ctrl_pending(leaks))
+		{
+		fprintf(stderr, "memory leaks:\n");
+		CRYPTO_mem_leaks_fp(stderr);
+		ret = 1;
+		}
+	BIO_free(leaks);
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
@@ -208,6 +208,7 @@ typedef struct asn1_const_ctx_st
 #define ASN1_OBJECT_FLAG_CRITICAL	 0x02	/* critical x509v3 object id */
 #define ASN1_OBJECT_FLAG_DYNAMIC_STRINGS 0x04	/* internal use */
 #define ASN1_OBJECT_FLAG_DYNAMIC_DATA 	 0x08	/* internal use */
+#define ASN1_OBJECT_FLAG_ARENA		 0x10	/* internal use */
 struct asn1_object_st
 	{
 	const char *sn,*ln;
@@ -234,6 +235,16 @@ struct asn1_object_st
  * type.
  */
 #define ASN1_STRING_FLAG_MSTRING 0x040 
+/* These flags are set on strings decoded by ASN1_item_d2i_arena() to
+ * indicate that the structure itself and the data it points to belong to
+ * the decoding arena and must not be freed separately. Data referenced in
+ * place by ASN1_item_d2i_buffer() is marked ASN1_STRING_FLAG_ARENA_DATA
+ * too. Only the decoder sets them: the flags of a string that does not come
+ * from ASN1_STRING_new() or a d2i function must be cleared before it is
+ * passed to functions that change it.
+ */
+#define ASN1_STRING_FLAG_ARENA 0x080
+#define ASN1_STRING_FLAG_ARENA_DATA 0x100
 /* This is the base type that holds just about everything :-) */
 struct asn1_string_st
 	{
@@ -300,6 +311,8 @@ DECLARE_STACK_OF(ASN1_STRING_TABLE)
  */
 typedef struct ASN1_TEMPLATE_st ASN1_TEMPLATE;
 typedef struct ASN1_TLC_st ASN1_TLC;
+typedef struct asn1_arena_st ASN1_ARENA;
+typedef struct asn1_buffer_st ASN1_BUFFER;
 /* This is just an opaque pointer */
 typedef struct ASN1_VALUE_st ASN1_VALUE;
 
@@ -1094,6 +1107,10 @@ void ASN1_STRING_TABLE_cleanup(void);
 ASN1_VALUE *ASN1_item_new(const ASN1_ITEM *it);
 void ASN1_item_free(ASN1_VALUE *val, const ASN1_ITEM *it);
 ASN1_VALUE * ASN1_item_d2i(ASN1_VALUE **val, const unsigned char **in, long len, const ASN1_ITEM *it);
+ASN1_VALUE * ASN1_item_d2i_arena(ASN1_VALUE **val, const unsigned char **in, long len, const ASN1_ITEM *it);
+ASN1_VALUE * ASN1_item_d2i_buffer(ASN1_VALUE **val, const unsigned char **in, long len, const ASN1_ITEM *it, ASN1_BUFFER *buf);
+ASN1_BUFFER *ASN1_BUFFER_new(unsigned char *data, long length);
+void ASN1_BUFFER_free(ASN1_BUFFER *buf);
 int ASN1_item_i2d(ASN1_VALUE *val, unsigned char **out, const ASN1_ITEM *it);
 int ASN1_item_ndef_i2d(ASN1_VALUE *val, unsigned char **out, const ASN1_ITEM *it);
 
@@ -1180,6 +1197,7 @@ void ERR_load_ASN1_strings(void);
 #define ASN1_F_A2I_ASN1_STRING				 103
 #define ASN1_F_APPEND_EXP				 176
 #define ASN1_F_ASN1_BIT_STRING_SET_BIT			 183
+#define ASN1_F_ASN1_BUFFER_NEW				 224
 #define ASN1_F_ASN1_CB					 177
 #define ASN1_F_ASN1_CHECK_TLEN				 104
 #define ASN1_F_ASN1_COLLATE_PRIMITIVE			 105
@@ -1203,6 +1221,7 @@ void ERR_load_ASN1_strings(void);
 #define ASN1_F_ASN1_I2D_FP				 117
 #define ASN1_F_ASN1_INTEGER_SET				 118
 #define ASN1_F_ASN1_INTEGER_TO_BN			 119
+#define ASN1_F_ASN1_ITEM_D2I_BUFFER			 225
 #define ASN1_F_ASN1_ITEM_D2I_FP				 206
 #define ASN1_F_ASN1_ITEM_DUP				 191
 #define ASN1_F_ASN1_ITEM_EX_COMBINE_NEW			 121
@@ -1249,6 +1268,7 @@ void ERR_load_ASN1_strings(void);
 #define ASN1_F_C2I_ASN1_INTEGER				 194
 #define ASN1_F_C2I_ASN1_OBJECT				 196
 #define ASN1_F_COLLECT_DATA				 140
+#define ASN1_F_COMPACT_CRL_LOOKUP			 226
 #define ASN1_F_D2I_ASN1_BIT_STRING			 141
 #define ASN1_F_D2I_ASN1_BOOLEAN				 142
 #define ASN1_F_D2I_ASN1_BYTES				 143
@@ -1269,6 +1289,7 @@ void ERR_load_ASN1_strings(void);
 #define ASN1_F_D2I_RSA_NET_2				 201
 #define ASN1_F_D2I_X509					 156
 #define ASN1_F_D2I_X509_CINF				 157
+#define ASN1_F_D2I_X509_CRL_COMPACT			 227
 #define ASN1_F_D2I_X509_PKEY				 159
 #define ASN1_F_DO_TCREATE				 222
 #define ASN1_F_I2D_ASN1_BIO_STREAM			 211
@@ -1348,6 +1369,7 @@ void ERR_load_ASN1_strings(void);
 #define ASN1_R_ILLEGAL_OPTIONS_ON_ITEM_TEMPLATE		 170
 #define ASN1_R_ILLEGAL_TAGGED_ANY			 127
 #define ASN1_R_ILLEGAL_TIME_VALUE			 184
+#define ASN1_R_INPUT_NOT_IN_BUFFER			 221
 #define ASN1_R_INTEGER_NOT_ASCII_FORMAT			 185
 #define ASN1_R_INTEGER_TOO_LARGE_FOR_LONG		 128
 #define ASN1_R_INVALID_BIT_STRING_BITS_LEFT		 220
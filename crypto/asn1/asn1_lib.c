@@ -61,6 +61,7 @@
 #include "cryptlib.h"
 #include <openssl/asn1.h>
 #include <openssl/asn1_mac.h>
+#include "asn1_locl.h"
 
 static int asn1_get_length(const unsigned char **pp,int *inf,long *rl,int max);
 static void asn1_put_length(unsigned char **pp, int length);
@@ -356,7 +357,11 @@ int ASN1_STRING_copy(ASN1_STRING *dst, const ASN1_STRING *str)
 	dst->type = str->type;
 	if (!ASN1_STRING_set(dst,str->data,str->length))
 		return 0;
-	dst->flags = str->flags;
+	/* Where the memory of dst comes from does not change */
+	dst->flags = (str->flags
+			& ~(ASN1_STRING_FLAG_ARENA|ASN1_STRING_FLAG_ARENA_DATA))
+		| (dst->flags
+			& (ASN1_STRING_FLAG_ARENA|ASN1_STRING_FLAG_ARENA_DATA));
 	return 1;
 	}
 
@@ -388,11 +393,21 @@ int ASN1_STRING_set(ASN1_STRING *str, const void *_data, int len)
 		else
 			len=strlen(data);
 		}
-	if ((str->length < len) || (str->data == NULL))
+	if ((str->length < len) || (str->data == NULL)
+		|| (str->flags & ASN1_STRING_FLAG_ARENA_DATA))
 		{
 		c=str->data;
 		if (c == NULL)
 			str->data=OPENSSL_malloc(len+1);
+		else if (str->flags & ASN1_STRING_FLAG_ARENA_DATA)
+			{
+			/* Data in an arena or the input may be shared and
+			 * can't be realloced: copy it out */
+			str->data=OPENSSL_malloc(len+1);
+			if (str->data != NULL)
+				memcpy(str->data,c,
+					str->length < len ? str->length : len);
+			}
 		else
 			str->data=OPENSSL_realloc(c,len+1);
 
@@ -402,6 +417,7 @@ int ASN1_STRING_set(ASN1_STRING *str, const void *_data, int len)
 			str->data=c;
 			return(0);
 			}
+		str->flags &= ~ASN1_STRING_FLAG_ARENA_DATA;
 		}
 	str->length=len;
 	if (data != NULL)
@@ -415,8 +431,7 @@ int ASN1_STRING_set(ASN1_STRING *str, const void *_data, int len)
 
 void ASN1_STRING_set0(ASN1_STRING *str, void *data, int len)
 	{
-	if (str->data)
-		OPENSSL_free(str->data);
+	asn1_string_free_data(str);
 	str->data = data;
 	str->length = len;
 	}
@@ -447,9 +462,11 @@ ASN1_STRING *ASN1_STRING_type_new(int type)
 void ASN1_STRING_free(ASN1_STRING *a)
 	{
 	if (a == NULL) return;
-	if (a->data && !(a->flags & ASN1_STRING_FLAG_NDEF))
+	if (a->data && !(a->flags & (ASN1_STRING_FLAG_NDEF
+					| ASN1_STRING_FLAG_ARENA_DATA)))
 		OPENSSL_free(a->data);
-	OPENSSL_free(a);
+	if (!(a->flags & ASN1_STRING_FLAG_ARENA))
+		OPENSSL_free(a);
 	}
 
 int ASN1_STRING_cmp(const ASN1_STRING *a, const ASN1_STRING *b)
@@ -61,6 +61,68 @@
 int asn1_utctime_to_tm(struct tm *tm, const ASN1_UTCTIME *d);
 int asn1_generalizedtime_to_tm(struct tm *tm, const ASN1_GENERALIZEDTIME *d);
 
+/* Arena used by ASN1_item_d2i_arena(): a single block that the decoded
+ * structure and most of its contents are carved from. It is freed when
+ * its root structure is.
+ */
+
+struct asn1_arena_st
+	{
+	unsigned char *start;	/* first byte of the block */
+	unsigned char *next;	/* next free byte */
+	unsigned char *end;	/* end of the block */
+	ASN1_VALUE *root;	/* structure owning the arena */
+	ASN1_BUFFER *buf;	/* input referenced by the structure */
+	};
+
+/* Input buffer shared by the structures decoded from it */
+struct asn1_buffer_st
+	{
+	unsigned char *data;
+	long length;
+	int references;
+	};
+
+#define asn1_arena_owns(a, p) ((a) != NULL \
+		&& (const unsigned char *)(p) >= (a)->start \
+		&& (const unsigned char *)(p) < (a)->end)
+
+/* True if the n bytes at p lie in the input buffer of arena a */
+#define asn1_arena_refs(a, p, n) ((a) != NULL && (a)->buf != NULL \
+		&& (const unsigned char *)(p) >= (a)->buf->data \
+		&& (long)(n) <= (a)->buf->data + (a)->buf->length \
+					- (const unsigned char *)(p))
+
+ASN1_ARENA *asn1_arena_new(size_t size);
+void *asn1_arena_alloc(ASN1_ARENA *arena, size_t size);
+void asn1_arena_free(ASN1_ARENA *arena);
+
+int asn1_item_arena_ok(const ASN1_ITEM *it);
+ASN1_ARENA *asn1_enc_arena(ASN1_VALUE **pval, const ASN1_ITEM *it);
+void asn1_enc_set_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+						ASN1_ARENA *arena);
+
+int asn1_item_ex_arena_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
+						ASN1_ARENA *arena);
+ASN1_STRING *asn1_arena_string_new(int type, ASN1_ARENA *arena);
+ASN1_OBJECT *asn1_c2i_object(ASN1_OBJECT **a, const unsigned char **pp,
+						long len, ASN1_ARENA *arena);
+int asn1_enc_set0(ASN1_VALUE **pval, unsigned char *in, int inlen,
+							const ASN1_ITEM *it);
+
+/* Free the data of an ASN1_STRING unless it belongs to an arena */
+#define asn1_string_free_data(s) \
+	do { \
+		if ((s)->data && !((s)->flags & ASN1_STRING_FLAG_ARENA_DATA)) \
+			OPENSSL_free((s)->data); \
+		(s)->flags &= ~ASN1_STRING_FLAG_ARENA_DATA; \
+	} while (0)
+
+/* Give an ASN1_STRING a copy of its data it can change in place */
+#define asn1_string_own_data(s) \
+	(!((s)->flags & ASN1_STRING_FLAG_ARENA_DATA) \
+		|| ASN1_STRING_set((s), NULL, (s)->length))
+
 /* ASN1 print context structure */
 
 struct asn1_pctx_st
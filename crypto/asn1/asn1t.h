@@ -188,6 +188,10 @@ extern "C" {
 	static const ASN1_AUX tname##_aux = {NULL, ASN1_AFLG_ENCODING, 0, 0, cb, offsetof(tname, enc)}; \
 	ASN1_SEQUENCE(tname)
 
+#define ASN1_SEQUENCE_ref_arena(tname, arena, cb, lck) \
+	static const ASN1_AUX tname##_aux = {NULL, ASN1_AFLG_REFCOUNT|ASN1_AFLG_ARENA, offsetof(tname, references), lck, cb, offsetof(tname, arena)}; \
+	ASN1_SEQUENCE(tname)
+
 #define ASN1_NDEF_SEQUENCE_END(tname) \
 	;\
 	ASN1_ITEM_start(tname) \
@@ -647,6 +651,7 @@ struct ASN1_TLC_st{
 	int ptag;	/* class value */
 	int pclass;	/* class value */
 	int hdrlen;	/* header length */
+	ASN1_ARENA *arena;	/* arena to allocate from, if any */
 };
 
 /* Typedefs for ASN1 function pointers */
@@ -753,6 +758,11 @@ typedef struct ASN1_STREAM_ARG_st {
 #define ASN1_AFLG_ENCODING	2
 /* The Sequence length is invalid */
 #define ASN1_AFLG_BROKEN	4
+/* Record the arena of ASN1_item_d2i_arena() in the ASN1_ARENA pointer at
+ * enc_offset, which then holds no ASN1_ENCODING: it can't be combined with
+ * ASN1_AFLG_ENCODING
+ */
+#define ASN1_AFLG_ARENA		8
 
 /* operation values for asn1_cb */
 
@@ -59,6 +59,7 @@
 #include <stdio.h>
 #include "cryptlib.h"
 #include <openssl/asn1.h>
+#include "asn1_locl.h"
 
 #ifndef NO_ASN1_OLD
 
@@ -170,7 +171,7 @@ ASN1_STRING *ASN1_item_pack(void *obj, const ASN1_ITEM *it, ASN1_STRING **oct)
 	} else octmp = *oct;
 
 	if(octmp->data) {
-		OPENSSL_free(octmp->data);
+		asn1_string_free_data(octmp);
 		octmp->data = NULL;
 	}
 		
@@ -108,9 +108,11 @@ int ASN1_TYPE_set_int_octetstring(ASN1_TYPE *a, long num, unsigned char *data,
 				* I'll be in trouble */
 	in.data=buf;
 	in.length=32;
+	in.flags=0;
 	os.data=data;
 	os.type=V_ASN1_OCTET_STRING;
 	os.length=len;
+	os.flags=0;
 	ASN1_INTEGER_set(&in,num);
 	n =  i2d_ASN1_INTEGER(&in,NULL);
 	n+=M_i2d_ASN1_OCTET_STRING(&os,NULL);
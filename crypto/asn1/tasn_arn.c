@@ -0,0 +1,154 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Arenas for ASN1_item_d2i_arena().
+ *
+ * An arena is a single block with a bump allocator: once it is full every
+ * further allocation fails and the decoder falls back to the heap.
+ * Nothing is freed from an arena until the whole of it is, when its root
+ * structure is freed.
+ *
+ * The free functions need to tell arena objects from heap objects, also
+ * for an object freed on its own, so each records where it came from:
+ * strings and objects in their flags. Of the structures only those
+ * declared with ASN1_SEQUENCE_ref_arena(), such as X509 and X509_CRL, are
+ * taken from the arena: they have a field pointing to it. Other
+ * structures are always allocated from the heap, though their contents
+ * may be in the arena.
+ *
+ * An arena may also reference the buffer it was decoded from, for
+ * ASN1_item_d2i_buffer(): contents that can be used as encoded are then
+ * pointed to rather than copied, and the arena holds a reference to the
+ * buffer until it is freed.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "cryptlib.h"
+#include <openssl/asn1.h>
+#include <openssl/asn1t.h>
+#include "asn1_locl.h"
+
+/* Alignment of every allocation: enough for the ASN1 structures, which
+ * only contain pointers, longs and ints.
+ */
+#define ASN1_ARENA_ALIGN	8
+
+ASN1_ARENA *asn1_arena_new(size_t size)
+	{
+	ASN1_ARENA *arena;
+
+	size = (size + ASN1_ARENA_ALIGN - 1) & ~(size_t)(ASN1_ARENA_ALIGN - 1);
+	arena = OPENSSL_malloc(sizeof(ASN1_ARENA) + ASN1_ARENA_ALIGN + size);
+	if (arena == NULL)
+		return NULL;
+	arena->start = (unsigned char *)(arena + 1);
+	arena->start += (ASN1_ARENA_ALIGN
+		- ((size_t)arena->start & (ASN1_ARENA_ALIGN - 1)))
+				& (ASN1_ARENA_ALIGN - 1);
+	arena->next = arena->start;
+	arena->end = arena->start + size;
+	arena->root = NULL;
+	arena->buf = NULL;
+	return arena;
+	}
+
+void *asn1_arena_alloc(ASN1_ARENA *arena, size_t size)
+	{
+	void *ret;
+	size = (size + ASN1_ARENA_ALIGN - 1) & ~(size_t)(ASN1_ARENA_ALIGN - 1);
+	if (size > (size_t)(arena->end - arena->next))
+		{
+		/* Full: see above */
+		arena->next = arena->end;
+		return NULL;
+		}
+	ret = arena->next;
+	arena->next += size;
+	return ret;
+	}
+
+void asn1_arena_free(ASN1_ARENA *arena)
+	{
+	if (arena == NULL)
+		return;
+	ASN1_BUFFER_free(arena->buf);
+	OPENSSL_free(arena);
+	}
+
+ASN1_BUFFER *ASN1_BUFFER_new(unsigned char *data, long length)
+	{
+	ASN1_BUFFER *ret;
+	ret = OPENSSL_malloc(sizeof(ASN1_BUFFER));
+	if (ret == NULL)
+		{
+		ASN1err(ASN1_F_ASN1_BUFFER_NEW, ERR_R_MALLOC_FAILURE);
+		return NULL;
+		}
+	ret->data = data;
+	ret->length = length;
+	ret->references = 1;
+	return ret;
+	}
+
+void ASN1_BUFFER_free(ASN1_BUFFER *buf)
+	{
+	if (buf == NULL)
+		return;
+	if (CRYPTO_add(&buf->references, -1, CRYPTO_LOCK_ASN1_ARENA) > 0)
+		return;
+	if (buf->data)
+		OPENSSL_free(buf->data);
+	OPENSSL_free(buf);
+	}
@@ -64,6 +64,7 @@
 #include <openssl/objects.h>
 #include <openssl/buffer.h>
 #include <openssl/err.h>
+#include "asn1_locl.h"
 
 static int asn1_check_eoc(const unsigned char **in, long len);
 static int asn1_find_end(const unsigned char **in, long len, char inf);
@@ -91,6 +92,11 @@ static int asn1_d2i_ex_primitive(ASN1_VALUE **pval,
 				const unsigned char **in, long len,
 				const ASN1_ITEM *it,
 				int tag, int aclass, char opt, ASN1_TLC *ctx);
+static int asn1_ex_c2i_arena(ASN1_VALUE **pval, const unsigned char *cont,
+				int len, int utype, char *free_cont,
+				const ASN1_ITEM *it, ASN1_ARENA *arena);
+static int asn1_c2i_ref(ASN1_VALUE **pval, const unsigned char *cont,
+				int len, int utype, ASN1_ARENA *arena);
 
 /* Table to convert tags to bit values, used for MSTRING type */
 static const unsigned long tag2bit[32] = {
@@ -116,6 +122,16 @@ unsigned long ASN1_tag2bit(int tag)
 #define asn1_tlc_clear(c)	if (c) (c)->valid = 0
 /* Version to avoid compiler warning about 'c' always non-NULL */
 #define asn1_tlc_clear_nc(c)	(c)->valid = 0
+/* Arena to decode into, if any */
+#define asn1_tlc_arena(c)	((c) ? (c)->arena : NULL)
+
+/* Size of the arena for 'len' bytes of DER: the structures decoded take
+ * up to about three times the space of the encoding, anything beyond
+ * that is allocated from the heap. When their contents are referenced in
+ * the input instead of copied they take about as much as the encoding.
+ */
+#define ASN1_ARENA_SIZE(len)	((size_t)(len) * 3 + 512)
+#define ASN1_ARENA_REF_SIZE(len)	((size_t)(len) * 3 / 2 + 512)
 
 /* Decode an ASN1 item, this currently behaves just 
  * like a standard 'd2i' function. 'in' points to 
@@ -133,16 +149,97 @@ ASN1_VALUE *ASN1_item_d2i(ASN1_VALUE **pval,
 	if (!pval)
 		pval = &ptmpval;
 	asn1_tlc_clear_nc(&c);
+	c.arena = NULL;
 	if (ASN1_item_ex_d2i(pval, in, len, it, -1, 0, 0, &c) > 0) 
 		return *pval;
 	return NULL;
 	}
 
+/* Decode an ASN1 item into an arena: the structure returned and most of
+ * what it contains are allocated from a single block, which is freed
+ * when the structure is. Only SEQUENCEs that can record the arena, see
+ * ASN1_AFLG_ARENA, are decoded this way, other items are decoded as by
+ * ASN1_item_d2i(). If buf is not NULL the
+ * input lies in it, and primitive contents are referenced in place where
+ * they can be.
+ */
+
+static ASN1_VALUE *asn1_item_d2i_arena(ASN1_VALUE **pval,
+		const unsigned char **in, long len, const ASN1_ITEM *it,
+							ASN1_BUFFER *buf)
+	{
+	ASN1_TLC c;
+	ASN1_VALUE *ret = NULL;
+
+	if (!asn1_item_arena_ok(it))
+		return ASN1_item_d2i(pval, in, len, it);
+
+	asn1_tlc_clear_nc(&c);
+	c.arena = NULL;
+	if (len > 0)
+		c.arena = asn1_arena_new(it->size + (buf ?
+			ASN1_ARENA_REF_SIZE(len) : ASN1_ARENA_SIZE(len)));
+	if (c.arena)
+		{
+		if (buf)
+			{
+			CRYPTO_add(&buf->references, 1, CRYPTO_LOCK_ASN1_ARENA);
+			c.arena->buf = buf;
+			}
+		if (!asn1_item_ex_arena_new(&ret, it, c.arena))
+			{
+			asn1_arena_free(c.arena);
+			return NULL;
+			}
+		if (asn1_arena_owns(c.arena, ret))
+			c.arena->root = ret;
+		else
+			{
+			/* Allocated by a callback: decode normally */
+			ASN1_item_ex_free(&ret, it);
+			asn1_arena_free(c.arena);
+			c.arena = NULL;
+			}
+		}
+	if (ASN1_item_ex_d2i(&ret, in, len, it, -1, 0, 0, &c) <= 0)
+		{
+		/* On error the structure, and with it the arena, is freed */
+		if (ret)
+			ASN1_item_ex_free(&ret, it);
+		return NULL;
+		}
+	if (pval)
+		{
+		ASN1_item_free(*pval, it);
+		*pval = ret;
+		}
+	return ret;
+	}
+
+ASN1_VALUE *ASN1_item_d2i_arena(ASN1_VALUE **pval,
+		const unsigned char **in, long len, const ASN1_ITEM *it)
+	{
+	return asn1_item_d2i_arena(pval, in, len, it, NULL);
+	}
+
+ASN1_VALUE *ASN1_item_d2i_buffer(ASN1_VALUE **pval,
+		const unsigned char **in, long len, const ASN1_ITEM *it,
+							ASN1_BUFFER *buf)
+	{
+	if (buf && (*in < buf->data || len > buf->data + buf->length - *in))
+		{
+		ASN1err(ASN1_F_ASN1_ITEM_D2I_BUFFER, ASN1_R_INPUT_NOT_IN_BUFFER);
+		return NULL;
+		}
+	return asn1_item_d2i_arena(pval, in, len, it, buf);
+	}
+
 int ASN1_template_d2i(ASN1_VALUE **pval,
 		const unsigned char **in, long len, const ASN1_TEMPLATE *tt)
 	{
 	ASN1_TLC c;
 	asn1_tlc_clear_nc(&c);
+	c.arena = NULL;
 	return asn1_template_ex_d2i(pval, in, len, tt, 0, &c);
 	}
 
@@ -160,6 +257,7 @@ int ASN1_item_ex_d2i(ASN1_VALUE **pval, const unsigned char **in, long len,
 	const ASN1_EXTERN_FUNCS *ef;
 	const ASN1_AUX *aux = it->funcs;
 	ASN1_aux_cb *asn1_cb;
+	ASN1_ARENA *arena = asn1_tlc_arena(ctx);
 	const unsigned char *p = NULL, *q;
 	unsigned char *wp=NULL;	/* BIG FAT WARNING!  BREAKS CONST WHERE USED */
 	unsigned char imphack = 0, oclass;
@@ -175,6 +273,21 @@ int ASN1_item_ex_d2i(ASN1_VALUE **pval, const unsigned char **in, long len,
 		asn1_cb = aux->asn1_cb;
 	else asn1_cb = 0;
 
+	/* A reference counted structure that is not the root of the arena
+	 * and everything in it come from the heap: see tasn_new.c
+	 */
+	if (arena && (it->itype == ASN1_ITYPE_SEQUENCE
+			|| it->itype == ASN1_ITYPE_NDEF_SEQUENCE)
+		&& aux && (aux->flags & ASN1_AFLG_REFCOUNT)
+		&& !asn1_arena_owns(arena, *pval))
+		{
+		ctx->arena = NULL;
+		ret = ASN1_item_ex_d2i(pval, in, len, it, tag, aclass, opt,
+									ctx);
+		ctx->arena = arena;
+		return ret;
+		}
+
 	switch(it->itype)
 		{
 		case ASN1_ITYPE_PRIMITIVE:
@@ -312,7 +425,7 @@ int ASN1_item_ex_d2i(ASN1_VALUE **pval, const unsigned char **in, long len,
 				goto auxerr;
 
 		/* Allocate structure */
-		if (!*pval && !ASN1_item_ex_new(pval, it))
+		if (!*pval && !asn1_item_ex_arena_new(pval, it, arena))
 			{
 			ASN1err(ASN1_F_ASN1_ITEM_EX_D2I,
 						ERR_R_NESTED_ASN1_ERROR);
@@ -397,7 +510,7 @@ int ASN1_item_ex_d2i(ASN1_VALUE **pval, const unsigned char **in, long len,
 			goto err;
 			}
 
-		if (!*pval && !ASN1_item_ex_new(pval, it))
+		if (!*pval && !asn1_item_ex_arena_new(pval, it, arena))
 			{
 			ASN1err(ASN1_F_ASN1_ITEM_EX_D2I,
 				ERR_R_NESTED_ASN1_ERROR);
@@ -912,7 +1025,8 @@ static int asn1_d2i_ex_primitive(ASN1_VALUE **pval,
 		}
 
 	/* We now have content length and type: translate into a structure */
-	if (!asn1_ex_c2i(pval, cont, len, utype, &free_cont, it))
+	if (!asn1_ex_c2i_arena(pval, cont, len, utype, &free_cont, it,
+							asn1_tlc_arena(ctx)))
 		goto err;
 
 	*in = p;
@@ -927,12 +1041,20 @@ static int asn1_d2i_ex_primitive(ASN1_VALUE **pval,
 int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 			int utype, char *free_cont, const ASN1_ITEM *it)
 	{
+	return asn1_ex_c2i_arena(pval, cont, len, utype, free_cont, it, NULL);
+	}
+
+static int asn1_ex_c2i_arena(ASN1_VALUE **pval, const unsigned char *cont,
+				int len, int utype, char *free_cont,
+				const ASN1_ITEM *it, ASN1_ARENA *arena)
+	{
 	ASN1_VALUE **opval = NULL;
 	ASN1_STRING *stmp;
 	ASN1_TYPE *typ = NULL;
 	int ret = 0;
 	const ASN1_PRIMITIVE_FUNCS *pf;
 	ASN1_INTEGER **tint;
+	unsigned char *data;
 	pf = it->funcs;
 
 	if (pf && pf->prim_c2i)
@@ -958,7 +1080,7 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 	switch(utype)
 		{
 		case V_ASN1_OBJECT:
-		if (!c2i_ASN1_OBJECT((ASN1_OBJECT **)pval, &cont, len))
+		if (!asn1_c2i_object((ASN1_OBJECT **)pval, &cont, len, arena))
 			goto err;
 		break;
 
@@ -988,6 +1110,8 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 		break;
 
 		case V_ASN1_BIT_STRING:
+		if (asn1_c2i_ref(pval, cont, len, utype, arena))
+			break;
 		if (!c2i_ASN1_BIT_STRING((ASN1_BIT_STRING **)pval, &cont, len))
 			goto err;
 		break;
@@ -997,7 +1121,8 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 		case V_ASN1_ENUMERATED:
 		case V_ASN1_NEG_ENUMERATED:
 		tint = (ASN1_INTEGER **)pval;
-		if (!c2i_ASN1_INTEGER(tint, &cont, len))
+		if (!asn1_c2i_ref(pval, cont, len, utype, arena)
+			&& !c2i_ASN1_INTEGER(tint, &cont, len))
 			goto err;
 		/* Fixup type to match the expected form */
 		(*tint)->type = utype | ((*tint)->type & V_ASN1_NEG);
@@ -1033,10 +1158,12 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 					ASN1_R_UNIVERSALSTRING_IS_WRONG_LENGTH);
 			goto err;
 			}
+		if (asn1_c2i_ref(pval, cont, len, utype, arena))
+			break;
 		/* All based on ASN1_STRING and handled the same */
 		if (!*pval)
 			{
-			stmp = ASN1_STRING_type_new(utype);
+			stmp = asn1_arena_string_new(utype, arena);
 			if (!stmp)
 				{
 				ASN1err(ASN1_F_ASN1_EX_C2I,
@@ -1053,12 +1180,20 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 		/* If we've already allocated a buffer use it */
 		if (*free_cont)
 			{
-			if (stmp->data)
-				OPENSSL_free(stmp->data);
+			asn1_string_free_data(stmp);
 			stmp->data = (unsigned char *)cont; /* UGLY CAST! RL */
 			stmp->length = len;
 			*free_cont = 0;
 			}
+		else if (arena && (data = asn1_arena_alloc(arena, len + 1)))
+			{
+			memcpy(data, cont, len);
+			data[len] = 0;
+			asn1_string_free_data(stmp);
+			stmp->data = data;
+			stmp->length = len;
+			stmp->flags |= ASN1_STRING_FLAG_ARENA_DATA;
+			}
 		else
 			{
 			if (!ASN1_STRING_set(stmp, cont, len))
@@ -1088,6 +1223,74 @@ int asn1_ex_c2i(ASN1_VALUE **pval, const unsigned char *cont, int len,
 	}
 
 
+/* Point a primitive at its contents in the input buffer of the arena
+ * instead of copying them, if they can be used as they are encoded.
+ * Returns 1 if this was done and 0 if the contents have to be copied.
+ */
+
+static int asn1_c2i_ref(ASN1_VALUE **pval, const unsigned char *cont,
+				int len, int utype, ASN1_ARENA *arena)
+	{
+	ASN1_STRING *stmp;
+	int flags = 0;
+
+	if (!asn1_arena_refs(arena, cont, len))
+		return 0;
+	switch(utype)
+		{
+		case V_ASN1_BIT_STRING:
+		/* Unused bits in the last octet are cleared when copying */
+		if (len < 2 || cont[0] > 7
+			|| (cont[len - 1] & ~(0xff << cont[0]) & 0xff))
+			return 0;
+		flags = ASN1_STRING_FLAG_BITS_LEFT | cont[0];
+		cont++;
+		len--;
+		break;
+
+		case V_ASN1_INTEGER:
+		case V_ASN1_ENUMERATED:
+		/* Negative numbers are stored as their absolute value */
+		if (len < 1 || (cont[0] & 0x80))
+			return 0;
+		if (cont[0] == 0 && len > 1)
+			{
+			cont++;
+			len--;
+			}
+		break;
+
+		case V_ASN1_OCTET_STRING:
+		case V_ASN1_OTHER:
+		case V_ASN1_SET:
+		case V_ASN1_SEQUENCE:
+		break;
+
+		default:
+		/* Character strings are expected to be NUL terminated */
+		return 0;
+		}
+
+	if (*pval)
+		{
+		stmp = (ASN1_STRING *)*pval;
+		asn1_string_free_data(stmp);
+		stmp->flags &= ~(ASN1_STRING_FLAG_BITS_LEFT | 0x07);
+		}
+	else
+		{
+		stmp = asn1_arena_string_new(utype, arena);
+		if (!stmp)
+			return 0;
+		*pval = (ASN1_VALUE *)stmp;
+		}
+	stmp->type = utype;
+	stmp->data = (unsigned char *)cont;
+	stmp->length = len;
+	stmp->flags |= flags | ASN1_STRING_FLAG_ARENA_DATA;
+	return 1;
+	}
+
 /* This function finds the end of an ASN1 structure when passed its maximum
  * length, whether it is indefinite length and a pointer to the content.
  * This is more efficient than calling asn1_collect because it does not
@@ -61,6 +61,7 @@
 #include <openssl/asn1.h>
 #include <openssl/asn1t.h>
 #include <openssl/objects.h>
+#include "asn1_locl.h"
 
 static void asn1_item_combine_free(ASN1_VALUE **pval, const ASN1_ITEM *it, int combine);
 
@@ -76,6 +77,20 @@ void ASN1_item_ex_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	asn1_item_combine_free(pval, it, 0);
 	}
 
+/* Free the memory of a structure. One decoded by ASN1_item_d2i_arena()
+ * records its arena: the root of the arena frees it, and with it
+ * everything else still in it, the others are not freed on their own.
+ */
+
+static void asn1_struct_free(ASN1_VALUE **pval, const ASN1_ITEM *it)
+	{
+	ASN1_ARENA *arena = asn1_enc_arena(pval, it);
+	if (arena == NULL)
+		OPENSSL_free(*pval);
+	else if (*pval == arena->root)
+		asn1_arena_free(arena);
+	}
+
 static void asn1_item_combine_free(ASN1_VALUE **pval, const ASN1_ITEM *it, int combine)
 	{
 	const ASN1_TEMPLATE *tt = NULL, *seqtt;
@@ -126,7 +141,7 @@ static void asn1_item_combine_free(ASN1_VALUE **pval, const ASN1_ITEM *it, int c
 			asn1_cb(ASN1_OP_FREE_POST, pval, it, NULL);
 		if (!combine)
 			{
-			OPENSSL_free(*pval);
+			asn1_struct_free(pval, it);
 			*pval = NULL;
 			}
 		break;
@@ -173,7 +188,7 @@ static void asn1_item_combine_free(ASN1_VALUE **pval, const ASN1_ITEM *it, int c
 			asn1_cb(ASN1_OP_FREE_POST, pval, it, NULL);
 		if (!combine)
 			{
-			OPENSSL_free(*pval);
+			asn1_struct_free(pval, it);
 			*pval = NULL;
 			}
 		break;
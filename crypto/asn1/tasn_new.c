@@ -63,9 +63,14 @@
 #include <openssl/err.h>
 #include <openssl/asn1t.h>
 #include <string.h>
+#include "asn1_locl.h"
 
 static int asn1_item_ex_combine_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
-								int combine);
+					int combine, ASN1_ARENA *arena);
+static int asn1_template_new(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt,
+					ASN1_ARENA *arena);
+static int asn1_primitive_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
+					ASN1_ARENA *arena);
 static void asn1_item_clear(ASN1_VALUE **pval, const ASN1_ITEM *it);
 static void asn1_template_clear(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt);
 static void asn1_primitive_clear(ASN1_VALUE **pval, const ASN1_ITEM *it);
@@ -82,11 +87,33 @@ ASN1_VALUE *ASN1_item_new(const ASN1_ITEM *it)
 
 int ASN1_item_ex_new(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	{
-	return asn1_item_ex_combine_new(pval, it, 0);
+	return asn1_item_ex_combine_new(pval, it, 0, NULL);
+	}
+
+/* Allocate an ASN1 structure, taking it and its fields from 'arena' if
+ * there is room. Only strings, objects and SEQUENCEs that can record the
+ * arena, see ASN1_AFLG_ARENA, are taken from it, so that anything freed
+ * on its own can tell whether it owns its memory.
+ */
+
+int asn1_item_ex_arena_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
+						ASN1_ARENA *arena)
+	{
+	return asn1_item_ex_combine_new(pval, it, 0, arena);
+	}
+
+static void *asn1_item_alloc(size_t size, ASN1_ARENA *arena)
+	{
+	void *ret = NULL;
+	if (arena)
+		ret = asn1_arena_alloc(arena, size);
+	if (!ret)
+		ret = OPENSSL_malloc(size);
+	return ret;
 	}
 
 static int asn1_item_ex_combine_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
-								int combine)
+					int combine, ASN1_ARENA *arena)
 	{
 	const ASN1_TEMPLATE *tt = NULL;
 	const ASN1_COMPAT_FUNCS *cf;
@@ -100,6 +127,13 @@ static int asn1_item_ex_combine_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
 	else
 		asn1_cb = 0;
 
+	/* Reference counted structures can outlive the one they are part of,
+	 * so only the root of an arena, its first allocation, is allowed to
+	 * be one.
+	 */
+	if (arena && arena->next != arena->start && aux && (aux->flags & ASN1_AFLG_REFCOUNT))
+		arena = NULL;
+
 	if (!combine) *pval = NULL;
 
 #ifdef CRYPTO_MDEBUG
@@ -131,15 +165,15 @@ static int asn1_item_ex_combine_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
 		case ASN1_ITYPE_PRIMITIVE:
 		if (it->templates)
 			{
-			if (!ASN1_template_new(pval, it->templates))
+			if (!asn1_template_new(pval, it->templates, arena))
 				goto memerr;
 			}
-		else if (!ASN1_primitive_new(pval, it))
+		else if (!asn1_primitive_new(pval, it, arena))
 				goto memerr;
 		break;
 
 		case ASN1_ITYPE_MSTRING:
-		if (!ASN1_primitive_new(pval, it))
+		if (!asn1_primitive_new(pval, it, arena))
 				goto memerr;
 		break;
 
@@ -188,17 +222,20 @@ static int asn1_item_ex_combine_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
 			}
 		if (!combine)
 			{
-			*pval = OPENSSL_malloc(it->size);
+			*pval = asn1_item_alloc(it->size,
+					asn1_item_arena_ok(it) ? arena : NULL);
 			if (!*pval)
 				goto memerr;
 			memset(*pval, 0, it->size);
 			asn1_do_lock(pval, 0, it);
 			asn1_enc_init(pval, it);
+			if (asn1_arena_owns(arena, *pval))
+				asn1_enc_set_arena(pval, it, arena);
 			}
 		for (i = 0, tt = it->templates; i < it->tcount; tt++, i++)
 			{
 			pseqval = asn1_get_field_ptr(pval, tt);
-			if (!ASN1_template_new(pseqval, tt))
+			if (!asn1_template_new(pseqval, tt, arena))
 				goto memerr;
 			}
 		if (asn1_cb && !asn1_cb(ASN1_OP_NEW_POST, pval, it, NULL))
@@ -265,6 +302,12 @@ static void asn1_item_clear(ASN1_VALUE **pval, const ASN1_ITEM *it)
 
 int ASN1_template_new(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt)
 	{
+	return asn1_template_new(pval, tt, NULL);
+	}
+
+static int asn1_template_new(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt,
+						ASN1_ARENA *arena)
+	{
 	const ASN1_ITEM *it = ASN1_ITEM_ptr(tt->item);
 	int ret;
 	if (tt->flags & ASN1_TFLG_OPTIONAL)
@@ -299,7 +342,8 @@ int ASN1_template_new(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt)
 		goto done;
 		}
 	/* Otherwise pass it back to the item routine */
-	ret = asn1_item_ex_combine_new(pval, it, tt->flags & ASN1_TFLG_COMBINE);
+	ret = asn1_item_ex_combine_new(pval, it, tt->flags & ASN1_TFLG_COMBINE,
+									arena);
 	done:
 #ifdef CRYPTO_MDEBUG
 	if (it->sname)
@@ -324,6 +368,26 @@ static void asn1_template_clear(ASN1_VALUE **pval, const ASN1_TEMPLATE *tt)
 
 int ASN1_primitive_new(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	{
+	return asn1_primitive_new(pval, it, NULL);
+	}
+
+/* Allocate an ASN1_STRING from 'arena' if there is room */
+
+ASN1_STRING *asn1_arena_string_new(int type, ASN1_ARENA *arena)
+	{
+	ASN1_STRING *ret;
+	if (!arena || !(ret = asn1_arena_alloc(arena, sizeof(ASN1_STRING))))
+		return ASN1_STRING_type_new(type);
+	ret->length = 0;
+	ret->type = type;
+	ret->data = NULL;
+	ret->flags = ASN1_STRING_FLAG_ARENA;
+	return ret;
+	}
+
+static int asn1_primitive_new(ASN1_VALUE **pval, const ASN1_ITEM *it,
+						ASN1_ARENA *arena)
+	{
 	ASN1_TYPE *typ;
 	ASN1_STRING *str;
 	int utype;
@@ -363,7 +427,7 @@ int ASN1_primitive_new(ASN1_VALUE **pval, const ASN1_ITEM *it)
 		break;
 
 		default:
-		str = ASN1_STRING_type_new(utype);
+		str = asn1_arena_string_new(utype, arena);
 		if (it->itype == ASN1_ITYPE_MSTRING && str)
 			str->flags |= ASN1_STRING_FLAG_MSTRING;
 		*pval = (ASN1_VALUE *)str;
@@ -63,6 +63,7 @@
 #include <openssl/asn1t.h>
 #include <openssl/objects.h>
 #include <openssl/err.h>
+#include "asn1_locl.h"
 
 /* Utility functions for manipulating fields and offsets */
 
@@ -136,6 +137,43 @@ static ASN1_ENCODING *asn1_get_enc_ptr(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	return offset2ptr(*pval, aux->enc_offset);
 	}
 
+/* A SEQUENCE can come from an arena if it has a field to record the arena
+ * in, given by ASN1_AFLG_ARENA: see tasn_arn.c
+ */
+
+int asn1_item_arena_ok(const ASN1_ITEM *it)
+	{
+	const ASN1_AUX *aux;
+	if ((it->itype != ASN1_ITYPE_SEQUENCE)
+	   && (it->itype != ASN1_ITYPE_NDEF_SEQUENCE))
+		return 0;
+	aux = it->funcs;
+	if (!aux || !(aux->flags & ASN1_AFLG_ARENA))
+		return 0;
+	return 1;
+	}
+
+ASN1_ARENA *asn1_enc_arena(ASN1_VALUE **pval, const ASN1_ITEM *it)
+	{
+	const ASN1_AUX *aux = it->funcs;
+	ASN1_ARENA **parena;
+	if (!pval || !*pval || !asn1_item_arena_ok(it))
+		return NULL;
+	parena = offset2ptr(*pval, aux->enc_offset);
+	return *parena;
+	}
+
+void asn1_enc_set_arena(ASN1_VALUE **pval, const ASN1_ITEM *it,
+							ASN1_ARENA *arena)
+	{
+	const ASN1_AUX *aux = it->funcs;
+	ASN1_ARENA **parena;
+	if (!pval || !*pval || !asn1_item_arena_ok(it))
+		return;
+	parena = offset2ptr(*pval, aux->enc_offset);
+	*parena = arena;
+	}
+
 void asn1_enc_init(ASN1_VALUE **pval, const ASN1_ITEM *it)
 	{
 	ASN1_ENCODING *enc;
@@ -181,6 +219,27 @@ int asn1_enc_save(ASN1_VALUE **pval, const unsigned char *in, int inlen,
 
 	return 1;
 	}
+
+/* As asn1_enc_save() but take over the encoding instead of copying it:
+ * 'in' must come from OPENSSL_malloc() and is freed with the structure.
+ */
+
+int asn1_enc_set0(ASN1_VALUE **pval, unsigned char *in, int inlen,
+							 const ASN1_ITEM *it)
+	{
+	ASN1_ENCODING *enc;
+	enc = asn1_get_enc_ptr(pval, it);
+	if (!enc)
+		return 0;
+
+	if (enc->enc)
+		OPENSSL_free(enc->enc);
+	enc->enc = in;
+	enc->len = inlen;
+	enc->modified = 0;
+
+	return 1;
+	}
 		
 int asn1_enc_restore(int *len, unsigned char **out, ASN1_VALUE **pval,
 							const ASN1_ITEM *it)
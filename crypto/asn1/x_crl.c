@@ -76,6 +76,9 @@ ASN1_SEQUENCE(X509_REVOKED) = {
 static int def_crl_verify(X509_CRL *crl, EVP_PKEY *r);
 static int def_crl_lookup(X509_CRL *crl,
 		X509_REVOKED **ret, ASN1_INTEGER *serial, X509_NAME *issuer);
+static int compact_crl_free(X509_CRL *crl);
+static int compact_crl_lookup(X509_CRL *crl,
+		X509_REVOKED **ret, ASN1_INTEGER *serial, X509_NAME *issuer);
 
 static X509_CRL_METHOD int_crl_meth =
 	{
@@ -87,6 +90,42 @@ static X509_CRL_METHOD int_crl_meth =
 
 static const X509_CRL_METHOD *default_crl_method = &int_crl_meth;
 
+/* CRLs from d2i_X509_CRL_compact() keep their revoked entries encoded and
+ * only index the serial numbers.
+ */
+
+static X509_CRL_METHOD compact_crl_meth =
+	{
+	0,
+	0,
+	compact_crl_free,
+	compact_crl_lookup,
+	def_crl_verify
+	};
+
+/* Index entry: the position of a revoked entry in the encoding of the
+ * X509_CRL_INFO and of its serial number contents, with any leading zero
+ * octet removed as c2i_ASN1_INTEGER() does.
+ */
+typedef struct
+	{
+	unsigned int offset;
+	unsigned short serial;
+	unsigned short length;
+	} CRL_SERIAL;
+
+DECLARE_CLHASH_OF(X509_REVOKED);
+
+typedef struct
+	{
+	unsigned char *enc;		/* Encoding of the X509_CRL_INFO, owned
+					 * by its ASN1_ENCODING */
+	long enclen;
+	CRL_SERIAL *serials;		/* Sorted in serial number order */
+	int num;
+	CLHASH_OF(X509_REVOKED) *revoked;	/* Entries looked up so far */
+	} CRL_COMPACT;
+
 /* The X509_CRL_INFO structure needs a bit of customisation.
  * Since we cache the original encoding the signature wont be affected by
  * reordering of the revoked field.
@@ -228,6 +267,16 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
 		crl->base_crl_number = NULL;
 		break;
 
+		case ASN1_OP_D2I_PRE:
+		/* The entries of a compact CRL index the encoding that an
+		 * ordinary decode into it replaces */
+		if (crl->meth == &compact_crl_meth)
+			{
+			compact_crl_free(crl);
+			crl->meth = default_crl_method;
+			}
+		break;
+
 		case ASN1_OP_D2I_POST:
 #ifndef OPENSSL_NO_SHA
 		X509_CRL_digest(crl, EVP_sha1(), crl->sha1_hash, NULL);
@@ -350,7 +399,7 @@ static void setup_idp(X509_CRL *crl, ISSUING_DIST_POINT *idp)
 	DIST_POINT_set_dpname(idp->distpoint, X509_CRL_get_issuer(crl));
 	}
 
-ASN1_SEQUENCE_ref(X509_CRL, crl_cb, CRYPTO_LOCK_X509_CRL) = {
+ASN1_SEQUENCE_ref_arena(X509_CRL, arena, crl_cb, CRYPTO_LOCK_X509_CRL) = {
 	ASN1_SIMPLE(X509_CRL, crl, X509_CRL_INFO),
 	ASN1_SIMPLE(X509_CRL, sig_alg, X509_ALGOR),
 	ASN1_SIMPLE(X509_CRL, signature, ASN1_BIT_STRING)
@@ -362,6 +411,386 @@ IMPLEMENT_ASN1_FUNCTIONS(X509_CRL_INFO)
 IMPLEMENT_ASN1_FUNCTIONS(X509_CRL)
 IMPLEMENT_ASN1_DUP_FUNCTION(X509_CRL)
 
+X509_CRL *d2i_X509_CRL_buffer(X509_CRL **a, const unsigned char **in,
+					long len, ASN1_BUFFER *buf)
+	{
+	return (X509_CRL *)ASN1_item_d2i_buffer((ASN1_VALUE **)a, in, len,
+					ASN1_ITEM_rptr(X509_CRL), buf);
+	}
+
+#define CRL_DER_SEQUENCE	(V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED)
+
+#define crl_der_is_time(id) \
+	(((id) == V_ASN1_UTCTIME) || ((id) == V_ASN1_GENERALIZEDTIME))
+
+/* Read a definite length header ending before end and return its
+ * identifier octet, or -1 if there is none: *pp is left at the contents.
+ */
+static int crl_der_next(const unsigned char **pp, const unsigned char *end,
+								long *plen)
+	{
+	const unsigned char *p = *pp;
+	int id, tag, xclass, ret;
+	if (p >= end)
+		return -1;
+	id = *p;
+	/* High tag numbers do not occur in CRLs */
+	if ((id & V_ASN1_PRIMITIVE_TAG) == V_ASN1_PRIMITIVE_TAG)
+		return -1;
+	ret = ASN1_get_object(&p, plen, &tag, &xclass, end - p);
+	if (ret & 0x81)
+		return -1;
+	*pp = p;
+	return id;
+	}
+
+/* As crl_der_next() but leave *next after the whole element at p */
+static int crl_der_peek(const unsigned char *p, const unsigned char *end,
+					const unsigned char **next)
+	{
+	long len;
+	int id;
+	id = crl_der_next(&p, end, &len);
+	*next = p + len;
+	return id;
+	}
+
+static const unsigned char crl_oid_reason[] = { 0x55, 0x1d, 0x15 };
+static const unsigned char crl_oid_issuer[] = { 0x55, 0x1d, 0x1d };
+
+/* Check the extensions of a revoked entry the way crl_set_issuers() does.
+ * Entries with a certificate issuer cannot be indexed: return 0 for them
+ * or anything that does not parse.
+ */
+static int crl_compact_exts(const unsigned char *p, const unsigned char *end,
+								int *pflags)
+	{
+	const unsigned char *q, *ext_end, *oid;
+	long len, oidlen;
+	int id, crit, nreason = 0;
+	while (p < end)
+		{
+		q = p;
+		if (crl_der_next(&q, end, &len) != CRL_DER_SEQUENCE)
+			return 0;
+		ext_end = q + len;
+		if (crl_der_next(&q, ext_end, &oidlen) != V_ASN1_OBJECT
+			|| oidlen == 0 || (q[oidlen - 1] & 0x80))
+			return 0;
+		oid = q;
+		q += oidlen;
+		crit = 0;
+		id = crl_der_next(&q, ext_end, &len);
+		if (id == V_ASN1_BOOLEAN)
+			{
+			if (len != 1)
+				return 0;
+			crit = q[0] != 0;
+			q += len;
+			id = crl_der_next(&q, ext_end, &len);
+			}
+		if (id != V_ASN1_OCTET_STRING || q + len != ext_end)
+			return 0;
+		if (oidlen == sizeof(crl_oid_issuer)
+			&& !memcmp(oid, crl_oid_issuer, oidlen))
+			return 0;
+		if (oidlen == sizeof(crl_oid_reason)
+			&& !memcmp(oid, crl_oid_reason, oidlen))
+			{
+			if (nreason++ || crl_der_next(&q, ext_end, &len)
+						!= V_ASN1_ENUMERATED)
+				*pflags |= EXFLAG_INVALID;
+			}
+		if (crit)
+			*pflags |= EXFLAG_CRITICAL;
+		p = ext_end;
+		}
+	return 1;
+	}
+
+/* Index the revoked entries between p and end, relative to base, without
+ * decoding them: if serials is NULL they are only counted. Returns the
+ * number of entries, or -1 if the list cannot be indexed.
+ */
+static int crl_compact_scan(const unsigned char *base, const unsigned char *p,
+		const unsigned char *end, CRL_SERIAL *serials, int *pflags)
+	{
+	const unsigned char *q, *s, *entry_end;
+	long len;
+	int id, n = 0;
+	while (p < end)
+		{
+		q = p;
+		if (crl_der_next(&q, end, &len) != CRL_DER_SEQUENCE)
+			return -1;
+		entry_end = q + len;
+		/* Only positive serial numbers are indexed */
+		if (crl_der_next(&q, entry_end, &len) != V_ASN1_INTEGER)
+			return -1;
+		s = q;
+		q += len;
+		if (len > 0 && (*s & 0x80))
+			return -1;
+		if (len > 1 && *s == 0)
+			{
+			s++;
+			len--;
+			}
+		if (len > 0xffff || s - p > 0xffff)
+			return -1;
+		if (serials)
+			{
+			serials[n].offset = (unsigned int)(p - base);
+			serials[n].serial = (unsigned short)(s - p);
+			serials[n].length = (unsigned short)len;
+			}
+		id = crl_der_next(&q, entry_end, &len);
+		if (!crl_der_is_time(id))
+			return -1;
+		q += len;
+		if (q < entry_end)
+			{
+			if (crl_der_next(&q, entry_end, &len)
+						!= CRL_DER_SEQUENCE
+				|| q + len != entry_end
+				|| !crl_compact_exts(q, entry_end, pflags))
+				return -1;
+			}
+		else if (q != entry_end)
+			return -1;
+		p = entry_end;
+		n++;
+		}
+	return n;
+	}
+
+/* Hash table of the entries decoded by compact_crl_lookup() */
+static unsigned long crl_revoked_hash(const X509_REVOKED *a)
+	{
+	const ASN1_INTEGER *s = a->serialNumber;
+	unsigned long ret = 0;
+	int i;
+	for (i = 0; i < s->length; i++)
+		ret = (ret << 8 | ret >> (sizeof(ret) * 8 - 8)) ^ s->data[i];
+	return ret;
+	}
+
+static int crl_revoked_cmp(const X509_REVOKED *a, const X509_REVOKED *b)
+	{
+	return ASN1_STRING_cmp(a->serialNumber, b->serialNumber);
+	}
+
+static void crl_revoked_doall(X509_REVOKED *a)
+	{
+	X509_REVOKED_free(a);
+	}
+
+static IMPLEMENT_LHASH_HASH_FN(crl_revoked, X509_REVOKED)
+static IMPLEMENT_LHASH_COMP_FN(crl_revoked, X509_REVOKED)
+static IMPLEMENT_LHASH_DOALL_FN(crl_revoked, X509_REVOKED)
+
+/* Serial number order, as X509_REVOKED_cmp(), then order in the CRL */
+static int crl_serial_cmp(const unsigned char *base,
+				const CRL_SERIAL *a, const CRL_SERIAL *b)
+	{
+	int i;
+	if (a->length != b->length)
+		return a->length < b->length ? -1 : 1;
+	i = memcmp(base + a->offset + a->serial, base + b->offset + b->serial,
+								a->length);
+	if (i)
+		return i;
+	if (a->offset != b->offset)
+		return a->offset < b->offset ? -1 : 1;
+	return 0;
+	}
+
+static void crl_serial_sift(const unsigned char *base, CRL_SERIAL *s,
+								int i, int n)
+	{
+	CRL_SERIAL tmp;
+	int j;
+	while ((j = 2 * i + 1) < n)
+		{
+		if (j + 1 < n && crl_serial_cmp(base, s + j, s + j + 1) < 0)
+			j++;
+		if (crl_serial_cmp(base, s + i, s + j) >= 0)
+			break;
+		tmp = s[i];
+		s[i] = s[j];
+		s[j] = tmp;
+		i = j;
+		}
+	}
+
+/* Heapsort, so that sorting needs no memory and no global state */
+static void crl_serial_sort(const unsigned char *base, CRL_SERIAL *s, int n)
+	{
+	CRL_SERIAL tmp;
+	int i;
+	/* CAs often list their entries in order already */
+	for (i = 1; i < n; i++)
+		{
+		if (crl_serial_cmp(base, s + i - 1, s + i) > 0)
+			break;
+		}
+	if (i >= n)
+		return;
+	for (i = n / 2 - 1; i >= 0; i--)
+		crl_serial_sift(base, s, i, n);
+	for (i = n - 1; i > 0; i--)
+		{
+		tmp = s[0];
+		s[0] = s[i];
+		s[i] = tmp;
+		crl_serial_sift(base, s, 0, i);
+		}
+	}
+
+/* Decode a CRL without its revoked entries, which are indexed by serial
+ * number in a single pass over their encoding instead. Anything that cannot
+ * be indexed is decoded with d2i_X509_CRL().
+ */
+X509_CRL *d2i_X509_CRL_compact(X509_CRL **a, const unsigned char **in,
+								long len)
+	{
+	const unsigned char *p, *q, *end, *tbs, *tbs_cont, *tbs_end;
+	const unsigned char *rev, *rev_end;
+	unsigned char *der, *d;
+	long l;
+	int id, n, inner, tbslen, derlen, flags = 0;
+	CRL_COMPACT *c = NULL;
+	X509_CRL *ret = NULL;
+
+	/* Applications setting their own method get the entries it expects */
+	if (default_crl_method != &int_crl_meth || len > 0x7fffffffL)
+		return d2i_X509_CRL(a, in, len);
+
+	ERR_set_mark();
+	p = *in;
+	if (crl_der_next(&p, *in + len, &l) != CRL_DER_SEQUENCE)
+		goto full;
+	end = p + l;
+	tbs = p;
+	if (crl_der_next(&p, end, &l) != CRL_DER_SEQUENCE)
+		goto full;
+	tbs_cont = p;
+	tbs_end = p + l;
+
+	/* Skip version, signature, issuer and update times to the revoked
+	 * entries, which are all that is left out of the decoding.
+	 */
+	id = crl_der_peek(p, tbs_end, &q);
+	if (id == V_ASN1_INTEGER)
+		{
+		p = q;
+		id = crl_der_peek(p, tbs_end, &q);
+		}
+	if (id != CRL_DER_SEQUENCE)
+		goto full;
+	p = q;
+	if (crl_der_peek(p, tbs_end, &q) != CRL_DER_SEQUENCE)
+		goto full;
+	p = q;
+	if (!crl_der_is_time(crl_der_peek(p, tbs_end, &q)))
+		goto full;
+	p = q;
+	id = crl_der_peek(p, tbs_end, &q);
+	if (crl_der_is_time(id))
+		{
+		p = q;
+		id = crl_der_peek(p, tbs_end, &q);
+		}
+	if (id != CRL_DER_SEQUENCE)
+		goto full;
+	rev = p;
+	rev_end = q;
+	crl_der_next(&p, rev_end, &l);
+	n = crl_compact_scan(tbs, p, rev_end, NULL, &flags);
+	if (n <= 0)
+		goto full;
+
+	/* Decode everything else from a copy without the revoked entries */
+	inner = (int)((rev - tbs_cont) + (tbs_end - rev_end));
+	tbslen = ASN1_object_size(1, inner, V_ASN1_SEQUENCE);
+	derlen = ASN1_object_size(1, tbslen + (int)(end - tbs_end),
+							V_ASN1_SEQUENCE);
+	der = OPENSSL_malloc(derlen);
+	if (der == NULL)
+		goto err;
+	d = der;
+	ASN1_put_object(&d, 1, tbslen + (int)(end - tbs_end), V_ASN1_SEQUENCE,
+							V_ASN1_UNIVERSAL);
+	ASN1_put_object(&d, 1, inner, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL);
+	memcpy(d, tbs_cont, rev - tbs_cont);
+	d += rev - tbs_cont;
+	memcpy(d, rev_end, end - rev_end);
+	q = der;
+	ret = d2i_X509_CRL(NULL, &q, derlen);
+	OPENSSL_free(der);
+	if (ret == NULL)
+		goto full;
+
+	/* Keep the original encoding for the signature and the entries */
+	c = OPENSSL_malloc(sizeof(CRL_COMPACT));
+	if (c == NULL)
+		goto err;
+	c->enclen = tbs_end - tbs;
+	c->enc = OPENSSL_malloc(c->enclen);
+	c->serials = OPENSSL_malloc(n * sizeof(CRL_SERIAL));
+	c->revoked = CLHM_clh_new(X509_REVOKED, crl_revoked,
+						CRYPTO_LOCK_X509_CRL);
+	if (c->enc == NULL || c->serials == NULL || c->revoked == NULL)
+		goto err;
+	memcpy(c->enc, tbs, c->enclen);
+	c->num = crl_compact_scan(c->enc, c->enc + (p - tbs),
+				c->enc + (rev_end - tbs), c->serials, &flags);
+	crl_serial_sort(c->enc, c->serials, c->num);
+	if (!asn1_enc_set0((ASN1_VALUE **)&ret->crl, c->enc, c->enclen,
+					ASN1_ITEM_rptr(X509_CRL_INFO)))
+		goto err;
+	/* From here on X509_CRL_free() frees both */
+	ret->meth = &compact_crl_meth;
+	ret->meth_data = c;
+	c = NULL;
+	ret->flags |= flags;
+#ifndef OPENSSL_NO_SHA
+	/* The hash of the copy decoded is not that of the CRL: redo it, as
+	 * crl_cb() does, over the encoding that now has the entries.
+	 */
+	if (!X509_CRL_digest(ret, EVP_sha1(), ret->sha1_hash, NULL))
+		goto err;
+#endif
+	ERR_pop_to_mark();
+	*in = end;
+	if (a)
+		{
+		X509_CRL_free(*a);
+		*a = ret;
+		}
+	return ret;
+
+	full:
+	ERR_pop_to_mark();
+	return d2i_X509_CRL(a, in, len);
+
+	err:
+	ERR_pop_to_mark();
+	ASN1err(ASN1_F_D2I_X509_CRL_COMPACT, ERR_R_MALLOC_FAILURE);
+	if (c)
+		{
+		if (c->revoked)
+			CLHM_clh_free(X509_REVOKED, c->revoked);
+		if (c->serials)
+			OPENSSL_free(c->serials);
+		if (c->enc)
+			OPENSSL_free(c->enc);
+		OPENSSL_free(c);
+		}
+	X509_CRL_free(ret);
+	return NULL;
+	}
+
 static int X509_REVOKED_cmp(const X509_REVOKED * const *a,
 			const X509_REVOKED * const *b)
 	{
@@ -479,6 +908,113 @@ static int def_crl_lookup(X509_CRL *crl,
 	return 0;
 	}
 
+static int compact_crl_free(X509_CRL *crl)
+	{
+	CRL_COMPACT *c = crl->meth_data;
+	if (c == NULL)
+		return 1;
+	CLHM_clh_doall(X509_REVOKED, c->revoked, LHASH_DOALL_FN(crl_revoked));
+	CLHM_clh_free(X509_REVOKED, c->revoked);
+	OPENSSL_free(c->serials);
+	OPENSSL_free(c);
+	crl->meth_data = NULL;
+	return 1;
+	}
+
+/* Decode the entry at s and set its cached fields, which crl_set_issuers()
+ * does for the entries of other CRLs.
+ */
+static X509_REVOKED *compact_crl_decode(CRL_COMPACT *c, const CRL_SERIAL *s)
+	{
+	const unsigned char *p = c->enc + s->offset;
+	X509_REVOKED *rev;
+	ASN1_ENUMERATED *reason;
+
+	rev = d2i_X509_REVOKED(NULL, &p, c->enclen - s->offset);
+	if (rev == NULL)
+		return NULL;
+	/* Extensions were checked when the CRL was decoded */
+	rev->issuer = NULL;
+	reason = X509_REVOKED_get_ext_d2i(rev, NID_crl_reason, NULL, NULL);
+	if (reason)
+		{
+		rev->reason = ASN1_ENUMERATED_get(reason);
+		ASN1_ENUMERATED_free(reason);
+		}
+	else
+		rev->reason = CRL_REASON_NONE;
+	return rev;
+	}
+
+/* Binary search the index and decode a matching entry on first use: it is
+ * then kept, as the entries of other CRLs are, until the CRL is freed.
+ * The entries decoded are kept in a CLHASH, which lookups in other threads
+ * only lock for reading; a new entry is decoded without a lock and only
+ * inserted if another thread has not got there first.
+ */
+static int compact_crl_lookup(X509_CRL *crl,
+		X509_REVOKED **ret, ASN1_INTEGER *serial, X509_NAME *issuer)
+	{
+	CRL_COMPACT *c = crl->meth_data;
+	const CRL_SERIAL *s;
+	X509_REVOKED rtmp, *rev, *old;
+	int lo = 0, hi = c->num, mid, i;
+
+	/* Only positive serial numbers are indexed */
+	if (serial->type != V_ASN1_INTEGER)
+		return 0;
+	while (lo < hi)
+		{
+		mid = lo + (hi - lo) / 2;
+		s = c->serials + mid;
+		if (s->length != serial->length)
+			i = s->length < serial->length ? -1 : 1;
+		else
+			i = memcmp(c->enc + s->offset + s->serial,
+						serial->data, s->length);
+		if (i < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+		}
+	if (lo == c->num)
+		return 0;
+	s = c->serials + lo;
+	if (s->length != serial->length || memcmp(c->enc + s->offset
+				+ s->serial, serial->data, s->length))
+		return 0;
+
+	rtmp.serialNumber = serial;
+	rev = CLHM_clh_retrieve(X509_REVOKED, c->revoked, &rtmp, NULL);
+	if (rev == NULL)
+		{
+		rev = compact_crl_decode(c, s);
+		old = rev ? CLHM_clh_insert_new(X509_REVOKED, c->revoked, rev)
+			  : NULL;
+		if (old == NULL)
+			{
+			ASN1err(ASN1_F_COMPACT_CRL_LOOKUP,
+						ERR_R_MALLOC_FAILURE);
+			if (rev)
+				X509_REVOKED_free(rev);
+			return -1;
+			}
+		if (old != rev)
+			{
+			X509_REVOKED_free(rev);
+			rev = old;
+			}
+		}
+
+	if (!crl_revoked_issuer_match(crl, issuer, rev))
+		return 0;
+	if (ret)
+		*ret = rev;
+	if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
+		return 2;
+	return 1;
+	}
+
 void X509_CRL_set_default_method(const X509_CRL_METHOD *meth)
 	{
 	if (meth == NULL)
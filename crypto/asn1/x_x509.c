@@ -132,7 +132,7 @@ static int x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
 
 }
 
-ASN1_SEQUENCE_ref(X509, x509_cb, CRYPTO_LOCK_X509) = {
+ASN1_SEQUENCE_ref_arena(X509, arena, x509_cb, CRYPTO_LOCK_X509) = {
 	ASN1_SIMPLE(X509, cert_info, X509_CINF),
 	ASN1_SIMPLE(X509, sig_alg, X509_ALGOR),
 	ASN1_SIMPLE(X509, signature, ASN1_BIT_STRING)
@@ -141,6 +141,19 @@ ASN1_SEQUENCE_ref(X509, x509_cb, CRYPTO_LOCK_X509) = {
 IMPLEMENT_ASN1_FUNCTIONS(X509)
 IMPLEMENT_ASN1_DUP_FUNCTION(X509)
 
+X509 *d2i_X509_arena(X509 **a, const unsigned char **in, long len)
+	{
+	return (X509 *)ASN1_item_d2i_arena((ASN1_VALUE **)a, in, len,
+						ASN1_ITEM_rptr(X509));
+	}
+
+X509 *d2i_X509_buffer(X509 **a, const unsigned char **in, long len,
+							ASN1_BUFFER *buf)
+	{
+	return (X509 *)ASN1_item_d2i_buffer((ASN1_VALUE **)a, in, len,
+						ASN1_ITEM_rptr(X509), buf);
+	}
+
 int X509_get_ex_new_index(long argl, void *argp, CRYPTO_EX_new *new_func,
 	     CRYPTO_EX_dup *dup_func, CRYPTO_EX_free *free_func)
         {
@@ -572,6 +572,182 @@ err:
 	return(ret);
 	}
 
+#ifdef OPENSSL_BN_ASM_MONT
+typedef struct
+	{
+	int i;			/* index of the exponentiation */
+	int top;		/* words in the modulus */
+	int bits;		/* bits in the exponent */
+	int ok;
+	BN_MONT_CTX *mont;
+	BN_ULONG *acc;		/* the running power, Montgomery form */
+	BN_ULONG *base;		/* a, Montgomery form */
+	BN_ULONG *aa;		/* a, plain */
+	} BN_EXP_LANE;
+#endif
+
+/* BN_mod_exp_mont_batch() computes rr[i] = a[i]^p[i] mod m[i] for num
+ * independent exponentiations, such as the public key operations of a
+ * batch of signature verifications. The lanes are stepped through the
+ * exponent bits together, each square and multiply going straight to
+ * bn_mul_mont() on fixed-size word arrays, so that none of the BIGNUM
+ * bookkeeping of BN_mod_exp_mont() is repeated for every operation. The
+ * last multiplication of a lane is by a in plain form, which leaves the
+ * result out of Montgomery form without a further reduction.
+ *
+ * It is intended for short public exponents and is not constant time;
+ * a lane whose exponent has BN_FLG_CONSTTIME set, which has no
+ * m_ctx[i], or which is otherwise not suited is passed on to
+ * BN_mod_exp_mont() instead.
+ */
+int BN_mod_exp_mont_batch(BIGNUM *rr[], const BIGNUM *a[], const BIGNUM *p[],
+		const BIGNUM *m[], BN_CTX *ctx, BN_MONT_CTX *m_ctx[], int num)
+	{
+	int i,ret=0;
+#ifdef OPENSSL_BN_ASM_MONT
+	BN_EXP_LANE *lanes=NULL,*l;
+	BN_ULONG *words=NULL,*w,*one=NULL;
+	size_t nwords;
+	int j,k,nlanes=0,bits=0,top=0;
+
+	if (num <= 0)
+		return 1;
+	lanes = OPENSSL_malloc(num * sizeof(BN_EXP_LANE));
+	if (lanes == NULL)
+		{
+		BNerr(BN_F_BN_MOD_EXP_MONT_BATCH,ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+
+	nwords = 0;
+	for (i = 0; i < num; i++)
+		{
+		l = &lanes[nlanes];
+		l->i = i;
+		l->top = m[i]->top;
+		l->bits = BN_num_bits(p[i]);
+		l->mont = m_ctx ? m_ctx[i] : NULL;
+		bn_check_top(a[i]);
+		bn_check_top(p[i]);
+		bn_check_top(m[i]);
+		if (l->mont == NULL || l->mont->N.top != l->top ||
+				l->top < 2 || !BN_is_odd(m[i]) ||
+				l->bits < 2 ||
+				BN_get_flags(p[i], BN_FLG_CONSTTIME) != 0 ||
+				a[i]->neg || BN_is_zero(a[i]) ||
+				BN_ucmp(a[i],m[i]) >= 0)
+			continue;
+		nwords += 3 * l->top;
+		if (l->top > top)
+			top = l->top;
+		if (l->bits > bits)
+			bits = l->bits;
+		nlanes++;
+		}
+
+	if (nlanes > 0)
+		{
+		words = OPENSSL_malloc((nwords + top) * sizeof(BN_ULONG));
+		if (words == NULL)
+			{
+			BNerr(BN_F_BN_MOD_EXP_MONT_BATCH,ERR_R_MALLOC_FAILURE);
+			goto err;
+			}
+		one = words;
+		memset(one, 0, top * sizeof(BN_ULONG));
+		one[0] = 1;
+		w = words + top;
+		for (k = 0; k < nlanes; k++)
+			{
+			l = &lanes[k];
+			l->acc = w;
+			l->base = w + l->top;
+			l->aa = w + 2 * l->top;
+			w += 3 * l->top;
+
+			/* base = a*RR/R = a*R */
+			i = a[l->i]->top;
+			memcpy(l->aa, a[l->i]->d, i * sizeof(BN_ULONG));
+			memset(l->aa + i, 0, (l->top - i) * sizeof(BN_ULONG));
+			i = l->mont->RR.top;
+			memcpy(l->acc, l->mont->RR.d, i * sizeof(BN_ULONG));
+			memset(l->acc + i, 0, (l->top - i) * sizeof(BN_ULONG));
+			l->ok = bn_mul_mont(l->base, l->aa, l->acc,
+				l->mont->N.d, l->mont->n0, l->top);
+			}
+		}
+
+	/* The top bit of each exponent starts its lane with acc = base and
+	 * bit 0 is left for the final multiplication below.
+	 */
+	for (j = bits - 1; j > 0; j--)
+		for (k = 0; k < nlanes; k++)
+			{
+			l = &lanes[k];
+			if (!l->ok || j >= l->bits)
+				continue;
+			if (j == l->bits - 1)
+				{
+				memcpy(l->acc, l->base, l->top * sizeof(BN_ULONG));
+				continue;
+				}
+			l->ok = bn_mul_mont(l->acc, l->acc, l->acc,
+				l->mont->N.d, l->mont->n0, l->top);
+			if (l->ok && BN_is_bit_set(p[l->i], j))
+				l->ok = bn_mul_mont(l->acc, l->acc, l->base,
+					l->mont->N.d, l->mont->n0, l->top);
+			}
+
+	for (k = 0; k < nlanes; k++)
+		{
+		l = &lanes[k];
+		if (!l->ok)
+			continue;
+		l->ok = bn_mul_mont(l->acc, l->acc, l->acc,
+			l->mont->N.d, l->mont->n0, l->top);
+		if (!l->ok)
+			continue;
+		/* acc*R * a/R = acc*a, or acc*R * 1/R = acc */
+		l->ok = bn_mul_mont(l->acc, l->acc,
+			BN_is_bit_set(p[l->i], 0) ? l->aa : one,
+			l->mont->N.d, l->mont->n0, l->top);
+		if (!l->ok)
+			continue;
+		if (bn_wexpand(rr[l->i], l->top) == NULL)
+			goto err;
+		memcpy(rr[l->i]->d, l->acc, l->top * sizeof(BN_ULONG));
+		rr[l->i]->top = l->top;
+		rr[l->i]->neg = 0;
+		bn_correct_top(rr[l->i]);
+		}
+
+	/* Everything not done above */
+	for (i = 0, k = 0; i < num; i++)
+		{
+		if (k < nlanes && lanes[k].i == i && lanes[k++].ok)
+			continue;
+		if (!BN_mod_exp_mont(rr[i], a[i], p[i], m[i], ctx,
+				m_ctx ? m_ctx[i] : NULL))
+			goto err;
+		}
+	ret = 1;
+err:
+	if (words != NULL)
+		{
+		OPENSSL_cleanse(words, (nwords + top) * sizeof(BN_ULONG));
+		OPENSSL_free(words);
+		}
+	OPENSSL_free(lanes);
+#else
+	for (i = 0; i < num; i++)
+		if (!BN_mod_exp_mont(rr[i], a[i], p[i], m[i], ctx,
+				m_ctx ? m_ctx[i] : NULL))
+			return 0;
+	ret = 1;
+#endif
+	return(ret);
+	}
+
 #if defined(SPARC_T4_MONT)
 static BN_ULONG bn_get_bits(const BIGNUM *a, int bitpos)
 	{
@@ -478,9 +478,15 @@ BN_MONT_CTX *BN_MONT_CTX_set_locked(BN_MONT_CTX **pmont, int lock,
 	{
 	BN_MONT_CTX *ret;
 
+	/* '*pmont' is only set once, so after that it is read without the
+	 * lock where the store below can be made visible atomically. */
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+	ret = CRYPTO_ATOMIC_LOAD_PTR(pmont);
+#else
 	CRYPTO_r_lock(lock);
 	ret = *pmont;
 	CRYPTO_r_unlock(lock);
+#endif
 	if (ret)
 		return ret;
 
@@ -507,7 +513,11 @@ BN_MONT_CTX *BN_MONT_CTX_set_locked(BN_MONT_CTX **pmont, int lock,
 		ret = *pmont;
 		}
 	else
+#ifdef CRYPTO_ATOMIC_STORE_PTR
+		CRYPTO_ATOMIC_STORE_PTR(pmont, ret);
+#else
 		*pmont = ret;
+#endif
 	CRYPTO_w_unlock(lock);
 	return ret;
 	}
@@ -104,6 +104,7 @@ int test_mod_mul(BIO *bp,BN_CTX *ctx);
 int test_mod_exp(BIO *bp,BN_CTX *ctx);
 int test_mod_exp_mont_consttime(BIO *bp,BN_CTX *ctx);
 int test_mod_exp_mont5(BIO *bp, BN_CTX *ctx);
+int test_mod_exp_mont_batch(BIO *bp, BN_CTX *ctx);
 int test_exp(BIO *bp,BN_CTX *ctx);
 int test_gf2m_add(BIO *bp);
 int test_gf2m_mod(BIO *bp);
@@ -251,6 +252,10 @@ int main(int argc, char *argv[])
 	if (!test_mod_exp_mont5(out,ctx)) goto err;
 	(void)BIO_flush(out);
 
+	message(out,"BN_mod_exp_mont_batch");
+	if (!test_mod_exp_mont_batch(out,ctx)) goto err;
+	(void)BIO_flush(out);
+
 	message(out,"BN_exp");
 	if (!test_exp(out,ctx)) goto err;
 	(void)BIO_flush(out);
@@ -1099,6 +1104,97 @@ int test_mod_exp_mont5(BIO *bp, BN_CTX *ctx)
 	return(1);
 	}
 
+#define NUM_BATCH	24
+
+int test_mod_exp_mont_batch(BIO *bp, BN_CTX *ctx)
+	{
+	BIGNUM *a[NUM_BATCH],*p[NUM_BATCH],*m[NUM_BATCH],*r[NUM_BATCH],*e,*c,*q;
+	BN_MONT_CTX *mont[NUM_BATCH];
+	int i,ret=0;
+
+	e=BN_new();
+	q=BN_new();
+	for (i=0; i<NUM_BATCH; i++)
+		{
+		a[i]=BN_new();
+		p[i]=BN_new();
+		m[i]=BN_new();
+		r[i]=NULL;
+		/* Lanes of different sizes, exponents from 0 to a few
+		 * hundred bits, and some lanes that have to fall back to
+		 * BN_mod_exp_mont() */
+		BN_bntest_rand(m[i],64+(i%6)*200,0,1);
+		BN_bntest_rand(a[i],BN_num_bits(m[i])-1,0,0);
+		switch (i%8)
+			{
+		case 0:
+			BN_set_word(p[i],65537);
+			break;
+		case 1:
+			BN_set_word(p[i],3);
+			break;
+		case 2:
+			BN_set_word(p[i],i/8);
+			break;
+		case 3:
+			BN_bntest_rand(p[i],200,0,0);
+			BN_set_flags(p[i],BN_FLG_CONSTTIME);
+			break;
+		case 4:
+			BN_bntest_rand(a[i],BN_num_bits(m[i])+8,0,0);
+			BN_set_word(p[i],17);
+			break;
+		default:
+			BN_bntest_rand(p[i],i*11,0,0);
+			break;
+			}
+		if (i%5 == 4)
+			mont[i]=NULL;
+		else
+			{
+			mont[i]=BN_MONT_CTX_new();
+			BN_MONT_CTX_set(mont[i],m[i],ctx);
+			}
+		}
+	/* Lane 1 has its output aliasing its input */
+	c=BN_dup(a[1]);
+	for (i=0; i<NUM_BATCH; i++)
+		r[i]=i == 1 ? a[1] : BN_new();
+
+	if (!BN_mod_exp_mont_batch(r,(const BIGNUM **)a,(const BIGNUM **)p,
+			(const BIGNUM **)m,ctx,mont,NUM_BATCH))
+		goto err;
+	for (i=0; i<NUM_BATCH; i++)
+		{
+		/* BN_copy() leaves BN_FLG_CONSTTIME, which
+		 * BN_mod_exp_simple() does not take, behind */
+		if (!BN_copy(q,p[i]) ||
+			!BN_mod_exp_simple(e,i == 1 ? c : a[i],q,m[i],ctx))
+			goto err;
+		if (BN_cmp(e,r[i]) != 0)
+			{
+			fprintf(stderr,"Batch modular exponentiation test %d failed!\n",i);
+			goto err;
+			}
+		}
+	ret=1;
+err:
+	for (i=0; i<NUM_BATCH; i++)
+		{
+		BN_free(a[i]);
+		BN_free(p[i]);
+		BN_free(m[i]);
+		if (i != 1)
+			BN_free(r[i]);
+		if (mont[i] != NULL)
+			BN_MONT_CTX_free(mont[i]);
+		}
+	BN_free(c);
+	BN_free(q);
+	BN_free(e);
+	return(ret);
+	}
+
 int test_exp(BIO *bp, BN_CTX *ctx)
 	{
 	BIGNUM *a,*b,*d,*e,*one;
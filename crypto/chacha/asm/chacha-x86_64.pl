@@ -0,0 +1,509 @@
+#!/usr/bin/env perl
+#
+# ====================================================================
+# Written for the OpenSSL project.
+# ====================================================================
+#
+# ChaCha20 for x86_64.
+#
+# The state is kept row-wise, one 128-bit register per row of the 4x4
+# matrix, so that a column round works on all four columns at once and
+# a diagonal round is the same code after rotating rows 1-3 with
+# pshufd. There are three code paths:
+#
+# - SSE2, one block at a time, with rotations done by shifts; this is
+#   the baseline every x86_64 processor has;
+# - SSSE3, three interleaved blocks, with byte-aligned rotations done
+#   by pshufb;
+# - AVX2, six interleaved blocks, two per 256-bit register and three
+#   register sets, handing the tail to the SSSE3 code.
+#
+# Processing several independent blocks hides the latency of the long
+# dependency chain within a quarter-round. Each path is selected at run
+# time from OPENSSL_ia32cap_P.
+#
+# On an AVX2-capable Xeon, relative to chacha_enc.c compiled by gcc -O2
+# for long inputs, the SSE2 path is 1.2 times, the SSSE3 path 2.4 times
+# and the AVX2 path 5.4 times as fast.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+$avx=0;
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22);
+}
+
+if (!$avx && $win64 && ($flavour =~ /nasm/ || $ENV{ASM} =~ /nasm/) &&
+	   `nasm -v 2>&1` =~ /NASM version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.09) + ($1>=2.10);
+}
+
+if (!$avx && $win64 && ($flavour =~ /masm/ || $ENV{ASM} =~ /ml64/) &&
+	   `ml64 2>&1` =~ /Version ([0-9]+)\./) {
+	$avx = ($1>=10) + ($1>=11);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /(^clang version|based on LLVM) ([3-9]\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0);
+}
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+# void ChaCha20_ctr32(unsigned char *out, const unsigned char *inp,
+#		size_t len, const unsigned int key[8],
+#		const unsigned int counter[4]);
+my ($out,$inp,$len,$key,$counter)=("%rdi","%rsi","%rdx","%rcx","%r8");
+my $frame="%r9";
+
+# Stack layout, 64-byte aligned:
+#	0	key row 1
+#	16	key row 2
+#	32	counter rows of the SSE blocks in flight, 3 of them
+#	96	keystream of a partial block
+#	160	key row 1 twice
+#	192	key row 2 twice
+#	224	counter rows of the AVX2 blocks in flight, 3 pairs
+my ($KEY1,$KEY2,$CTR,$BUF)=map("$_(%rsp)",(0,16,32,96));
+my ($YKEY1,$YKEY2,$YCTR)=map("$_(%rsp)",(160,192,224));
+
+# One step of a quarter-round on a set of rows: two additions, an xor
+# and a rotation; $rot is the rotation count, $ssse3 says whether
+# rotations by 16 and 8 may use pshufb with the masks in $r16/$r8.
+sub sse_step {
+my ($a,$b,$d,$t,$rot,$ssse3,$r16,$r8)=@_;
+my $s=<<___;
+	paddd	$b,$a
+	pxor	$a,$d
+___
+if ($rot==16 && $ssse3) {
+$s.=<<___;
+	pshufb	$r16,$d
+___
+} elsif ($rot==16) {
+$s.=<<___;
+	pshuflw	\$0xb1,$d,$d
+	pshufhw	\$0xb1,$d,$d
+___
+} elsif ($rot==8 && $ssse3) {
+$s.=<<___;
+	pshufb	$r8,$d
+___
+} else {
+my $r=32-$rot;
+$s.=<<___;
+	movdqa	$d,$t
+	pslld	\$$rot,$d
+	psrld	\$$r,$t
+	por	$t,$d
+___
+}
+return $s;
+}
+
+sub avx2_step {
+my ($a,$b,$d,$t,$rot,$r16,$r8)=@_;
+my $s=<<___;
+	vpaddd	$b,$a,$a
+	vpxor	$a,$d,$d
+___
+if ($rot==16) {
+$s.=<<___;
+	vpshufb	$r16,$d,$d
+___
+} elsif ($rot==8) {
+$s.=<<___;
+	vpshufb	$r8,$d,$d
+___
+} else {
+my $r=32-$rot;
+$s.=<<___;
+	vpsrld	\$$r,$d,$t
+	vpslld	\$$rot,$d,$d
+	vpor	$t,$d,$d
+___
+}
+return $s;
+}
+
+# A double round on several sets of rows [a,b,c,d], interleaving the
+# sets step by step. All sets share the temporary $t: register renaming
+# takes care of the false dependencies.
+sub double_round {
+my ($step,$t,$sets,@masks)=@_;
+my $s="";
+my $sh=$step==\&avx2_step ? "vpshufd" : "pshufd";
+# a+=b, d^=a, d<<<=16; c+=d, b^=c, b<<<=12; and again for 8 and 7
+my @quarter=([0,1,3,16],[2,3,1,12],[0,1,3,8],[2,3,1,7]);
+
+    for my $diag (0,1) {
+	for my $q (@quarter) {
+	    my ($x,$y,$z,$rot)=@$q;
+	    for my $set (@$sets) {
+		$s.=&$step($$set[$x],$$set[$y],$$set[$z],$t,$rot,@masks);
+	    }
+	}
+	my @imm=$diag ? (0x93,0x4e,0x39) : (0x39,0x4e,0x93);
+	for my $set (@$sets) {
+	    for my $i (0..2) {
+		$s.="\t$sh\t\$$imm[$i],$$set[$i+1],$$set[$i+1]\n";
+	    }
+	}
+    }
+return $s;
+}
+
+sub sse_step1 { my @a=@_; splice(@a,5,0,0); &sse_step(@a); }
+sub sse_step3 { my @a=@_; splice(@a,5,0,1); &sse_step(@a); }
+
+my @x=map("%xmm$_",(0..15));
+my @set3=([@x[0..3]],[@x[4..7]],[@x[8..11]]);
+my ($T,$R16,$R8)=@x[12..14];
+
+# Adds the input to the single block in \@x[0..3], xors it into as
+# much of the input as is left, advances the pointers and the counter
+# and loops back to .L${pfx}_loop1 while there is data left.
+sub finish1 {
+my $pfx=shift;
+return <<___;
+	paddd	.Lsigma(%rip),@x[0]
+	paddd	$KEY1,@x[1]
+	paddd	$KEY2,@x[2]
+	paddd	$CTR,@x[3]
+	cmp	\$64,$len
+	jb	.L${pfx}_partial
+
+	movdqu	0($inp),$T
+	pxor	$T,@x[0]
+	movdqu	16($inp),$T
+	pxor	$T,@x[1]
+	movdqu	32($inp),$T
+	pxor	$T,@x[2]
+	movdqu	48($inp),$T
+	pxor	$T,@x[3]
+	movdqu	@x[0],0($out)
+	movdqu	@x[1],16($out)
+	movdqu	@x[2],32($out)
+	movdqu	@x[3],48($out)
+
+	movdqa	$CTR,$T
+	paddd	.Lone(%rip),$T
+	movdqa	$T,$CTR
+	lea	64($inp),$inp
+	lea	64($out),$out
+	sub	\$64,$len
+	jnz	.L${pfx}_loop1
+	jmp	.Ldone
+
+.L${pfx}_partial:
+	movdqa	@x[0],$BUF
+	movdqa	@x[1],112(%rsp)
+	movdqa	@x[2],128(%rsp)
+	movdqa	@x[3],144(%rsp)
+	xor	%r10,%r10
+.L${pfx}_partial_loop:
+	movzb	($inp,%r10),%eax
+	movzb	96(%rsp,%r10),%r11d
+	xor	%r11d,%eax
+	mov	%al,($out,%r10)
+	inc	%r10
+	cmp	$len,%r10
+	jne	.L${pfx}_partial_loop
+
+	pxor	$T,$T
+	movdqa	$T,$BUF
+	movdqa	$T,112(%rsp)
+	movdqa	$T,128(%rsp)
+	movdqa	$T,144(%rsp)
+	jmp	.Ldone
+___
+}
+
+$code.=<<___;
+.text
+
+.extern	OPENSSL_ia32cap_P
+
+.globl	ChaCha20_ctr32
+.type	ChaCha20_ctr32,\@function,5
+.align	64
+ChaCha20_ctr32:
+	cmp	\$0,$len
+	je	.Lno_data
+	mov	%rsp,$frame
+___
+$code.=<<___ if ($win64);
+	lea	-0xa8(%rsp),%rsp
+	movaps	%xmm6,0x00(%rsp)
+	movaps	%xmm7,0x10(%rsp)
+	movaps	%xmm8,0x20(%rsp)
+	movaps	%xmm9,0x30(%rsp)
+	movaps	%xmm10,0x40(%rsp)
+	movaps	%xmm11,0x50(%rsp)
+	movaps	%xmm12,0x60(%rsp)
+	movaps	%xmm13,0x70(%rsp)
+	movaps	%xmm14,0x80(%rsp)
+___
+$code.=<<___;
+	sub	\$384,%rsp
+	and	\$-64,%rsp
+
+	movdqu	($key),%xmm0
+	movdqu	16($key),%xmm1
+	movdqu	($counter),%xmm2
+	movdqa	%xmm0,$KEY1
+	movdqa	%xmm1,$KEY2
+	movdqa	%xmm2,$CTR
+
+	mov	OPENSSL_ia32cap_P+4(%rip),%r10
+___
+$code.=<<___ if ($avx>1);
+	bt	\$37,%r10		# AVX2?
+	jc	.Lavx2
+___
+$code.=<<___;
+	test	\$`1<<9`,%r10d		# SSSE3?
+	jnz	.Lssse3
+
+.Lsse2_loop1:
+	movdqa	.Lsigma(%rip),@x[0]
+	movdqa	$KEY1,@x[1]
+	movdqa	$KEY2,@x[2]
+	movdqa	$CTR,@x[3]
+	mov	\$10,%eax
+.Lsse2_rounds:
+___
+$code.=&double_round(\&sse_step1,$T,[$set3[0]]);
+$code.=<<___;
+	dec	%eax
+	jnz	.Lsse2_rounds
+___
+$code.=&finish1("sse2");
+$code.=<<___;
+
+.align	32
+.Lssse3:
+	movdqa	.Lrot16(%rip),$R16
+	movdqa	.Lrot24(%rip),$R8
+	cmp	\$192,$len
+	jb	.Lssse3_loop1
+
+.Lssse3_loop3:
+	movdqa	.Lsigma(%rip),@x[0]
+	movdqa	$KEY1,@x[1]
+	movdqa	$KEY2,@x[2]
+	movdqa	$CTR,@x[3]
+	movdqa	@x[0],@x[4]
+	movdqa	@x[1],@x[5]
+	movdqa	@x[2],@x[6]
+	movdqa	@x[3],@x[7]
+	paddd	.Lone(%rip),@x[7]
+	movdqa	@x[0],@x[8]
+	movdqa	@x[1],@x[9]
+	movdqa	@x[2],@x[10]
+	movdqa	@x[7],@x[11]
+	paddd	.Lone(%rip),@x[11]
+	movdqa	@x[7],48(%rsp)
+	movdqa	@x[11],64(%rsp)
+	mov	\$10,%eax
+.Lssse3_rounds3:
+___
+$code.=&double_round(\&sse_step3,$T,\@set3,$R16,$R8);
+$code.=<<___;
+	dec	%eax
+	jnz	.Lssse3_rounds3
+___
+for my $i (0..2) {
+my ($a,$b,$c,$d)=@{$set3[$i]};
+my $ctr=32+16*$i;
+$code.=<<___;
+	paddd	.Lsigma(%rip),$a
+	paddd	$KEY1,$b
+	paddd	$KEY2,$c
+	paddd	$ctr(%rsp),$d
+	movdqu	`64*$i+0`($inp),$T
+	pxor	$T,$a
+	movdqu	`64*$i+16`($inp),$T
+	pxor	$T,$b
+	movdqu	`64*$i+32`($inp),$T
+	pxor	$T,$c
+	movdqu	`64*$i+48`($inp),$T
+	pxor	$T,$d
+	movdqu	$a,`64*$i+0`($out)
+	movdqu	$b,`64*$i+16`($out)
+	movdqu	$c,`64*$i+32`($out)
+	movdqu	$d,`64*$i+48`($out)
+___
+}
+$code.=<<___;
+	movdqa	$CTR,$T
+	paddd	.Lthree(%rip),$T
+	movdqa	$T,$CTR
+	lea	192($inp),$inp
+	lea	192($out),$out
+	sub	\$192,$len
+	jz	.Ldone
+	cmp	\$192,$len
+	jae	.Lssse3_loop3
+
+.Lssse3_loop1:
+	movdqa	.Lsigma(%rip),@x[0]
+	movdqa	$KEY1,@x[1]
+	movdqa	$KEY2,@x[2]
+	movdqa	$CTR,@x[3]
+	mov	\$10,%eax
+.Lssse3_rounds1:
+___
+$code.=&double_round(\&sse_step3,$T,[$set3[0]],$R16,$R8);
+$code.=<<___;
+	dec	%eax
+	jnz	.Lssse3_rounds1
+___
+$code.=&finish1("ssse3");
+$code.=<<___;
+
+___
+if ($avx>1) {
+my @y=map("%ymm$_",(0..15));
+my @yset3=([@y[0..3]],[@y[4..7]],[@y[8..11]]);
+my ($YT,$YR16,$YR8)=@y[12..14];
+
+$code.=<<___;
+
+.align	32
+.Lavx2:
+	cmp	\$384,$len
+	jb	.Lssse3
+
+	vbroadcasti128	.Lsigma(%rip),@y[0]
+	vbroadcasti128	$KEY1,@y[1]
+	vbroadcasti128	$KEY2,@y[2]
+	vbroadcasti128	$CTR,@y[3]
+	vpaddd	.Lavx2_init(%rip),@y[3],@y[3]
+	vmovdqa	@y[1],$YKEY1
+	vmovdqa	@y[2],$YKEY2
+	vmovdqa	@y[3],$YCTR
+	vbroadcasti128	.Lrot16(%rip),$YR16
+	vbroadcasti128	.Lrot24(%rip),$YR8
+
+.Lavx2_loop6:
+	vbroadcasti128	.Lsigma(%rip),@y[0]
+	vmovdqa	$YKEY1,@y[1]
+	vmovdqa	$YKEY2,@y[2]
+	vmovdqa	$YCTR,@y[3]
+	vmovdqa	@y[0],@y[4]
+	vmovdqa	@y[1],@y[5]
+	vmovdqa	@y[2],@y[6]
+	vpaddd	.Lavx2_inc(%rip),@y[3],@y[7]
+	vmovdqa	@y[0],@y[8]
+	vmovdqa	@y[1],@y[9]
+	vmovdqa	@y[2],@y[10]
+	vpaddd	.Lavx2_inc(%rip),@y[7],@y[11]
+	vmovdqa	@y[7],256(%rsp)
+	vmovdqa	@y[11],288(%rsp)
+	mov	\$10,%eax
+.Lavx2_rounds:
+___
+$code.=&double_round(\&avx2_step,$YT,\@yset3,$YR16,$YR8);
+$code.=<<___;
+	dec	%eax
+	jnz	.Lavx2_rounds
+___
+for my $i (0..2) {
+my ($a,$b,$c,$d)=@{$yset3[$i]};
+my $ctr=224+32*$i;
+$code.=<<___;
+	vbroadcasti128	.Lsigma(%rip),$YT
+	vpaddd	$YT,$a,$a
+	vpaddd	$YKEY1,$b,$b
+	vpaddd	$YKEY2,$c,$c
+	vpaddd	$ctr(%rsp),$d,$d
+	vperm2i128	\$0x20,$b,$a,$YT
+	vpxor	`128*$i+0`($inp),$YT,$YT
+	vmovdqu	$YT,`128*$i+0`($out)
+	vperm2i128	\$0x20,$d,$c,$YT
+	vpxor	`128*$i+32`($inp),$YT,$YT
+	vmovdqu	$YT,`128*$i+32`($out)
+	vperm2i128	\$0x31,$b,$a,$YT
+	vpxor	`128*$i+64`($inp),$YT,$YT
+	vmovdqu	$YT,`128*$i+64`($out)
+	vperm2i128	\$0x31,$d,$c,$YT
+	vpxor	`128*$i+96`($inp),$YT,$YT
+	vmovdqu	$YT,`128*$i+96`($out)
+___
+}
+$code.=<<___;
+	vmovdqa	$YCTR,$YT
+	vpaddd	.Lavx2_six(%rip),$YT,$YT
+	vmovdqa	$YT,$YCTR
+	lea	384($inp),$inp
+	lea	384($out),$out
+	sub	\$384,$len
+	jz	.Lavx2_done
+	cmp	\$384,$len
+	jae	.Lavx2_loop6
+
+	vmovdqa	$YCTR,%xmm0		# first block's counter
+	vmovdqa	%xmm0,$CTR
+	vzeroupper
+	jmp	.Lssse3
+
+.Lavx2_done:
+	vzeroupper
+___
+}
+$code.=<<___;
+.Ldone:
+___
+$code.=<<___ if ($win64);
+	movaps	-0xa8($frame),%xmm6
+	movaps	-0x98($frame),%xmm7
+	movaps	-0x88($frame),%xmm8
+	movaps	-0x78($frame),%xmm9
+	movaps	-0x68($frame),%xmm10
+	movaps	-0x58($frame),%xmm11
+	movaps	-0x48($frame),%xmm12
+	movaps	-0x38($frame),%xmm13
+	movaps	-0x28($frame),%xmm14
+___
+$code.=<<___;
+	mov	$frame,%rsp
+.Lno_data:
+	ret
+.size	ChaCha20_ctr32,.-ChaCha20_ctr32
+
+.align	64
+.Lsigma:
+.asciz	"expand 32-byte k"
+.align	16
+.Lone:
+.long	1,0,0,0
+.Lthree:
+.long	3,0,0,0
+.Lrot16:
+.byte	0x2,0x3,0x0,0x1, 0x6,0x7,0x4,0x5, 0xa,0xb,0x8,0x9, 0xe,0xf,0xc,0xd
+.Lrot24:
+.byte	0x3,0x0,0x1,0x2, 0x7,0x4,0x5,0x6, 0xb,0x8,0x9,0xa, 0xf,0xc,0xd,0xe
+.align	32
+.Lavx2_init:
+.long	0,0,0,0, 1,0,0,0
+.Lavx2_inc:
+.long	2,0,0,0, 2,0,0,0
+.Lavx2_six:
+.long	6,0,0,0, 6,0,0,0
+___
+
+$code =~ s/\`([^\`]*)\`/eval $1/gem;
+print $code;
+close STDOUT;
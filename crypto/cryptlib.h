@@ -104,6 +104,33 @@ void OPENSSL_showfatal(const char *fmta,...);
 void *OPENSSL_stderr(void);
 extern int OPENSSL_NONPIC_relocated;
 
+/* Atomic operations provided by the compiler. Where CRYPTO_ATOMIC_ADD is
+ * available, CRYPTO_add() uses it instead of taking a lock, unless the
+ * application has set an add_lock callback. CRYPTO_ATOMIC_ADD_LONG is the
+ * same for long counters, where the compiler can update those without a
+ * lock. */
+#if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL) && \
+	defined(__GCC_ATOMIC_INT_LOCK_FREE) && __GCC_ATOMIC_INT_LOCK_FREE == 2
+# define CRYPTO_ATOMIC_ADD(p,n)		__atomic_add_fetch(p,n,__ATOMIC_ACQ_REL)
+# define CRYPTO_ATOMIC_LOAD_INT(p)	__atomic_load_n(p,__ATOMIC_ACQUIRE)
+# define CRYPTO_ATOMIC_LOAD_PTR(p)	__atomic_load_n(p,__ATOMIC_ACQUIRE)
+# define CRYPTO_ATOMIC_STORE_PTR(p,v)	__atomic_store_n(p,v,__ATOMIC_RELEASE)
+# define CRYPTO_ATOMIC_CAS(p,o,n)	__sync_bool_compare_and_swap(p,o,n)
+# if defined(__GCC_ATOMIC_LONG_LOCK_FREE) && __GCC_ATOMIC_LONG_LOCK_FREE == 2
+#  define CRYPTO_ATOMIC_ADD_LONG(p,n)	__atomic_add_fetch(p,n,__ATOMIC_ACQ_REL)
+# endif
+#elif defined(__GNUC__) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+# define CRYPTO_ATOMIC_ADD(p,n)		__sync_add_and_fetch(p,n)
+# define CRYPTO_ATOMIC_CAS(p,o,n)	__sync_bool_compare_and_swap(p,o,n)
+# if (__SIZEOF_LONG__ == 4 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)) || \
+	(__SIZEOF_LONG__ == 8 && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#  define CRYPTO_ATOMIC_ADD_LONG(p,n)	__sync_add_and_fetch(p,n)
+# endif
+#endif
+
+int CRYPTO_add_locked(int *pointer, int amount);
+int CRYPTO_add_atomic(int *pointer, int amount, int *ret);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -222,7 +222,15 @@ typedef struct openssl_item_st
 #define CRYPTO_LOCK_COMP		38
 #define CRYPTO_LOCK_FIPS		39
 #define CRYPTO_LOCK_FIPS2		40
-#define CRYPTO_NUM_LOCKS		41
+/* Locks for the partitions of a sharded SSL_CTX session cache, shards are
+ * mapped onto CRYPTO_LOCK_SSL_SESS_SHARD + (shard % CRYPTO_SSL_SESS_SHARD_LOCKS)
+ */
+#define CRYPTO_LOCK_SSL_SESS_SHARD	41
+#define CRYPTO_SSL_SESS_SHARD_LOCKS	16
+#define CRYPTO_LOCK_SSL_BUF		57
+#define CRYPTO_LOCK_ASN1_ARENA		58
+#define CRYPTO_LOCK_FORK		59
+#define CRYPTO_NUM_LOCKS		60
 
 #define CRYPTO_LOCK		1
 #define CRYPTO_UNLOCK		2
@@ -442,6 +450,18 @@ void CRYPTO_THREADID_current(CRYPTO_THREADID *id);
 int CRYPTO_THREADID_cmp(const CRYPTO_THREADID *a, const CRYPTO_THREADID *b);
 void CRYPTO_THREADID_cpy(CRYPTO_THREADID *dest, const CRYPTO_THREADID *src);
 unsigned long CRYPTO_THREADID_hash(const CRYPTO_THREADID *id);
+/* Changes in the child after fork(), for state that parent and child must
+ * not share */
+int CRYPTO_fork_generation(void);
+
+/* Thread-local storage: every thread sees its own value for a key. Where the
+ * platform allows it, the cleanup function is called with the value of a
+ * thread when that thread exits. */
+typedef struct crypto_thread_local_st CRYPTO_THREAD_LOCAL;
+CRYPTO_THREAD_LOCAL *CRYPTO_THREAD_LOCAL_new(void (*cleanup)(void *));
+void CRYPTO_THREAD_LOCAL_free(CRYPTO_THREAD_LOCAL *key);
+void *CRYPTO_THREAD_LOCAL_get(CRYPTO_THREAD_LOCAL *key);
+int CRYPTO_THREAD_LOCAL_set(CRYPTO_THREAD_LOCAL *key, void *val);
 #ifdef OPENSSL_USE_DEPRECATED
 DECLARE_DEPRECATED(void CRYPTO_set_id_callback(unsigned long (*func)(void)));
 /*
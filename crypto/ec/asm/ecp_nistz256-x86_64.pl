@@ -1325,6 +1325,297 @@ __ecp_nistz256_sqr_montx:
 
 	ret
 .size	__ecp_nistz256_sqr_montx,.-__ecp_nistz256_sqr_montx
+___
+}
+}
+{
+################################################################################
+# Montgomery multiplication modulo the group order n of P-256, used for
+# constant-time inversion of ECDSA scalars. The order has no special form
+# in its lower half, so reduction is done word by word with n0 = -1/n mod
+# 2^64, the operand-scanning (CIOS) way.
+#
+# void ecp_nistz256_ord_mul_mont(
+#   uint64_t res[4],
+#   uint64_t a[4],
+#   uint64_t b[4]);
+#
+# void ecp_nistz256_ord_sqr_mont(
+#   uint64_t res[4],
+#   uint64_t a[4],
+#   int rep);
+#
+# ecp_nistz256_ord_sqr_mont squares a |rep| times in a row.
+
+my ($r_ptr,$a_ptr,$b_org,$b_ptr)=("%rdi","%rsi","%rdx","%rbx");
+my @acc=map("%r$_",(8..13));
+my ($t0,$t1,$ord,$cnt)=("%rcx","%rbp","%r14","%r15d");
+
+$code.=<<___;
+.align	64
+.Lord:
+.quad	0xf3b9cac2fc632551, 0xbce6faada7179e84, 0xffffffffffffffff, 0xffffffff00000000
+.LordK:
+.quad	0xccd1c8aaee00bc4f
+
+.globl	ecp_nistz256_ord_mul_mont
+.type	ecp_nistz256_ord_mul_mont,\@function,3
+.align	32
+ecp_nistz256_ord_mul_mont:
+___
+$code.=<<___	if ($addx);
+	mov	\$0x80100, %ecx
+	and	OPENSSL_ia32cap_P+8(%rip), %ecx
+___
+$code.=<<___;
+	push	%rbp
+	push	%rbx
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+
+	mov	$b_org, $b_ptr
+	lea	.Lord(%rip), $ord
+___
+$code.=<<___	if ($addx);
+	cmp	\$0x80100, %ecx
+	je	.Lord_mul_montx
+___
+$code.=<<___;
+	call	__ecp_nistz256_ord_mul_montq
+___
+$code.=<<___	if ($addx);
+	jmp	.Lord_mul_mont_done
+
+.Lord_mul_montx:
+	call	__ecp_nistz256_ord_mul_montx
+___
+$code.=<<___;
+.Lord_mul_mont_done:
+	pop	%r15
+	pop	%r14
+	pop	%r13
+	pop	%r12
+	pop	%rbx
+	pop	%rbp
+	ret
+.size	ecp_nistz256_ord_mul_mont,.-ecp_nistz256_ord_mul_mont
+
+.globl	ecp_nistz256_ord_sqr_mont
+.type	ecp_nistz256_ord_sqr_mont,\@function,3
+.align	32
+ecp_nistz256_ord_sqr_mont:
+___
+$code.=<<___	if ($addx);
+	mov	\$0x80100, %ecx
+	and	OPENSSL_ia32cap_P+8(%rip), %ecx
+___
+$code.=<<___;
+	push	%rbp
+	push	%rbx
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+
+	mov	%edx, $cnt
+	lea	.Lord(%rip), $ord
+___
+$code.=<<___	if ($addx);
+	cmp	\$0x80100, %ecx
+	je	.Lord_sqr_montx
+___
+$code.=<<___;
+.Lord_sqr_loop:
+	mov	$a_ptr, $b_ptr
+	call	__ecp_nistz256_ord_mul_montq
+	mov	$r_ptr, $a_ptr
+	dec	$cnt
+	jnz	.Lord_sqr_loop
+___
+$code.=<<___	if ($addx);
+	jmp	.Lord_sqr_mont_done
+
+.Lord_sqr_montx:
+	mov	$a_ptr, $b_ptr
+	call	__ecp_nistz256_ord_mul_montx
+	mov	$r_ptr, $a_ptr
+	dec	$cnt
+	jnz	.Lord_sqr_montx
+___
+$code.=<<___;
+.Lord_sqr_mont_done:
+	pop	%r15
+	pop	%r14
+	pop	%r13
+	pop	%r12
+	pop	%rbx
+	pop	%rbp
+	ret
+.size	ecp_nistz256_ord_sqr_mont,.-ecp_nistz256_ord_sqr_mont
+
+################################################################################
+# Computes a*b*2^-256 mod n into r_ptr, with a at a_ptr, b at b_ptr and n at
+# $ord. The result is written after all the input words have been read, so
+# the inputs may overlap the output.
+.type	__ecp_nistz256_ord_mul_montq,\@abi-omnipotent
+.align	32
+__ecp_nistz256_ord_mul_montq:
+	xor	$acc[0], $acc[0]
+	xor	$acc[1], $acc[1]
+	xor	$acc[2], $acc[2]
+	xor	$acc[3], $acc[3]
+	xor	$acc[4], $acc[4]
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	########################################################################
+	# acc += a*b[$i]
+	mov	8*$i($b_ptr), $t0
+	xor	$acc[5], $acc[5]
+	mov	$t0, %rax
+	mulq	8*0($a_ptr)
+	add	%rax, $acc[0]
+	mov	$t0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t1
+___
+for (my $j=1; $j<4; $j++) {
+$code.=<<___;
+
+	mulq	8*$j($a_ptr)
+	add	$t1, $acc[$j]
+	adc	\$0, %rdx
+	add	%rax, $acc[$j]
+	mov	$t0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t1
+___
+}
+$code.=<<___;
+	add	$t1, $acc[4]
+	adc	\$0, $acc[5]
+
+	########################################################################
+	# acc = (acc + m*n)/2^64 with m = acc[0]*n0 mod 2^64
+	mov	$acc[0], $t0
+	imulq	8*4($ord), $t0
+	mov	$t0, %rax
+	mulq	8*0($ord)
+	add	%rax, $acc[0]		# guaranteed to be zero
+	mov	$t0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t1
+___
+for (my $j=1; $j<4; $j++) {
+$code.=<<___;
+
+	mulq	8*$j($ord)
+	add	$t1, $acc[$j]
+	adc	\$0, %rdx
+	add	%rax, $acc[$j]
+	mov	$t0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t1
+___
+}
+$code.=<<___;
+	add	$t1, $acc[4]
+	adc	\$0, $acc[5]
+
+___
+	push(@acc,shift(@acc));
+}
+&ord_final_sub();
+$code.=<<___;
+	ret
+.size	__ecp_nistz256_ord_mul_montq,.-__ecp_nistz256_ord_mul_montq
+___
+
+if ($addx) {
+$code.=<<___;
+
+.type	__ecp_nistz256_ord_mul_montx,\@abi-omnipotent
+.align	32
+__ecp_nistz256_ord_mul_montx:
+	xor	$acc[0], $acc[0]
+	xor	$acc[1], $acc[1]
+	xor	$acc[2], $acc[2]
+	xor	$acc[3], $acc[3]
+	xor	$acc[4], $acc[4]
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	########################################################################
+	# acc += a*b[$i], low halves on the carry chain, high halves on the
+	# overflow chain
+	mov	8*$i($b_ptr), %rdx
+	xor	$acc[5], $acc[5]	# cf=0, of=0
+___
+for (my $j=0; $j<4; $j++) {
+$code.=<<___;
+	mulx	8*$j($a_ptr), %rax, $t1
+	adcx	%rax, $acc[$j]
+	adox	$t1, $acc[$j+1]
+___
+}
+$code.=<<___;
+	mov	\$0, %eax
+	adcx	%rax, $acc[4]
+	adox	%rax, $acc[5]
+	adcx	%rax, $acc[5]
+
+	########################################################################
+	# acc = (acc + m*n)/2^64 with m = acc[0]*n0 mod 2^64
+	mov	$acc[0], %rdx
+	imulq	8*4($ord), %rdx
+	xor	$t0, $t0		# cf=0, of=0
+___
+for (my $j=0; $j<4; $j++) {
+$code.=<<___;
+	mulx	8*$j($ord), %rax, $t1
+	adcx	%rax, $acc[$j]
+	adox	$t1, $acc[$j+1]
+___
+}
+$code.=<<___;
+	adcx	$t0, $acc[4]
+	adox	$t0, $acc[5]
+	adcx	$t0, $acc[5]
+
+___
+	push(@acc,shift(@acc));
+}
+&ord_final_sub();
+$code.=<<___;
+	ret
+.size	__ecp_nistz256_ord_mul_montx,.-__ecp_nistz256_ord_mul_montx
+___
+}
+
+sub ord_final_sub {
+# acc[0..4] holds a value below 2*n, subtract n if it is not below n
+$code.=<<___;
+	mov	$acc[0], %rax
+	mov	$acc[1], %rdx
+	mov	$acc[2], $t0
+	mov	$acc[3], $t1
+	sub	8*0($ord), $acc[0]
+	sbb	8*1($ord), $acc[1]
+	sbb	8*2($ord), $acc[2]
+	sbb	8*3($ord), $acc[3]
+	sbb	\$0, $acc[4]
+
+	cmovc	%rax, $acc[0]
+	cmovc	%rdx, $acc[1]
+	mov	$acc[0], 8*0($r_ptr)
+	cmovc	$t0, $acc[2]
+	mov	$acc[1], 8*1($r_ptr)
+	cmovc	$t1, $acc[3]
+	mov	$acc[2], 8*2($r_ptr)
+	mov	$acc[3], 8*3($r_ptr)
+
 ___
 }
 }
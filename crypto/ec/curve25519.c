@@ -0,0 +1,474 @@
+/* crypto/ec/curve25519.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ */
+
+/*
+ * X25519 Diffie-Hellman function over Curve25519, as specified in
+ * RFC 7748.
+ *
+ * Field elements are held in five 51-bit limbs, so that a product of
+ * two elements fits in five 128-bit accumulators and the reduction
+ * modulo 2^255-19 is a multiplication of the upper half by 19.  Where
+ * the compiler has no 128-bit integer type the accumulators are
+ * emulated with pairs of 64-bit words.  On x86_64 the multiplication,
+ * squaring and multiplication by 121666 are done in assembly, see
+ * asm/x25519-x86_64.pl.
+ *
+ * Every operation on secret data runs in time that does not depend
+ * on it: the ladder swaps its points with masks rather than branches
+ * and inversion is exponentiation by p-2.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "ec_lcl.h"
+
+#if (defined(_WIN32) || defined(_WIN64)) && !defined(__MINGW32__)
+typedef unsigned __int64 u64;
+# define U64(C) C##UI64
+#elif defined(__arch64__)
+typedef unsigned long u64;
+# define U64(C) C##UL
+#else
+typedef unsigned long long u64;
+# define U64(C) C##ULL
+#endif
+
+typedef u64 fe51[5];
+
+#define MASK51	U64(0x7ffffffffffff)
+
+#if defined(X25519_ASM)
+void x25519_fe51_mul(fe51 h, const fe51 f, const fe51 g);
+void x25519_fe51_sqr(fe51 h, const fe51 f);
+void x25519_fe51_mul121666(fe51 h, fe51 f);
+# define fe51_mul	x25519_fe51_mul
+# define fe51_sq	x25519_fe51_sqr
+# define fe51_mul121666	x25519_fe51_mul121666
+#else
+
+# if defined(__SIZEOF_INT128__) && __SIZEOF_INT128__==16
+typedef unsigned __int128 u128;
+
+#  define mul64(a,b)	((u128)(a)*(b))
+#  define add128(a,b)	((a)+(b))
+#  define lo64(a)	((u64)(a))
+#  define shr51(a)	((u64)((a)>>51))
+# else
+/* 128-bit accumulator emulated with two 64-bit words */
+typedef struct { u64 hi, lo; } u128;
+
+static u128 mul64(u64 a, u64 b)
+	{
+	u64 a0 = a&0xffffffff, a1 = a>>32;
+	u64 b0 = b&0xffffffff, b1 = b>>32;
+	u64 t00 = a0*b0, t01 = a0*b1, t10 = a1*b0, t11 = a1*b1;
+	u64 mid = (t00>>32) + (t01&0xffffffff) + (t10&0xffffffff);
+	u128 r;
+
+	r.lo = (mid<<32) | (t00&0xffffffff);
+	r.hi = t11 + (t01>>32) + (t10>>32) + (mid>>32);
+	return r;
+	}
+
+static u128 add128(u128 a, u128 b)
+	{
+	a.lo += b.lo;
+	a.hi += b.hi + (a.lo < b.lo);
+	return a;
+	}
+
+#  define lo64(a)	((a).lo)
+#  define shr51(a)	(((a).hi<<13) | ((a).lo>>51))
+# endif
+
+/*
+ * Carry the five accumulators of a product into limbs.  The result
+ * has limbs below 2^51 apart from h1, which may exceed it slightly;
+ * that is enough for further multiplications, additions and
+ * subtractions.
+ */
+static void fe51_reduce(fe51 h, u128 h0, u128 h1, u128 h2, u128 h3,
+	u128 h4)
+	{
+	u64 g0, g1, g2, g3, g4;
+
+	g0 = lo64(h0) & MASK51;	h1 = add128(h1, mul64(shr51(h0), 1));
+	g1 = lo64(h1) & MASK51;	h2 = add128(h2, mul64(shr51(h1), 1));
+	g2 = lo64(h2) & MASK51;	h3 = add128(h3, mul64(shr51(h2), 1));
+	g3 = lo64(h3) & MASK51;	h4 = add128(h4, mul64(shr51(h3), 1));
+	g4 = lo64(h4) & MASK51;
+	g0 += shr51(h4) * 19;
+	g1 += g0 >> 51;
+	g0 &= MASK51;
+
+	h[0] = g0; h[1] = g1; h[2] = g2; h[3] = g3; h[4] = g4;
+	}
+
+static void fe51_mul(fe51 h, const fe51 f, const fe51 g)
+	{
+	u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+	u64 g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+	u64 g1_19 = g1 * 19, g2_19 = g2 * 19, g3_19 = g3 * 19,
+	    g4_19 = g4 * 19;
+	u128 h0, h1, h2, h3, h4;
+
+	h0 = mul64(f0, g0);
+	h0 = add128(h0, mul64(f1, g4_19));
+	h0 = add128(h0, mul64(f2, g3_19));
+	h0 = add128(h0, mul64(f3, g2_19));
+	h0 = add128(h0, mul64(f4, g1_19));
+
+	h1 = mul64(f0, g1);
+	h1 = add128(h1, mul64(f1, g0));
+	h1 = add128(h1, mul64(f2, g4_19));
+	h1 = add128(h1, mul64(f3, g3_19));
+	h1 = add128(h1, mul64(f4, g2_19));
+
+	h2 = mul64(f0, g2);
+	h2 = add128(h2, mul64(f1, g1));
+	h2 = add128(h2, mul64(f2, g0));
+	h2 = add128(h2, mul64(f3, g4_19));
+	h2 = add128(h2, mul64(f4, g3_19));
+
+	h3 = mul64(f0, g3);
+	h3 = add128(h3, mul64(f1, g2));
+	h3 = add128(h3, mul64(f2, g1));
+	h3 = add128(h3, mul64(f3, g0));
+	h3 = add128(h3, mul64(f4, g4_19));
+
+	h4 = mul64(f0, g4);
+	h4 = add128(h4, mul64(f1, g3));
+	h4 = add128(h4, mul64(f2, g2));
+	h4 = add128(h4, mul64(f3, g1));
+	h4 = add128(h4, mul64(f4, g0));
+
+	fe51_reduce(h, h0, h1, h2, h3, h4);
+	}
+
+static void fe51_sq(fe51 h, const fe51 f)
+	{
+	u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+	u64 f0_2 = f0 * 2, f1_2 = f1 * 2;
+	u64 f3_19 = f3 * 19, f4_19 = f4 * 19;
+	u128 h0, h1, h2, h3, h4;
+
+	h0 = mul64(f0, f0);
+	h0 = add128(h0, mul64(f1_2, f4_19));
+	h0 = add128(h0, mul64(f2 * 2, f3_19));
+
+	h1 = mul64(f0_2, f1);
+	h1 = add128(h1, mul64(f2 * 2, f4_19));
+	h1 = add128(h1, mul64(f3, f3_19));
+
+	h2 = mul64(f0_2, f2);
+	h2 = add128(h2, mul64(f1, f1));
+	h2 = add128(h2, mul64(f3 * 2, f4_19));
+
+	h3 = mul64(f0_2, f3);
+	h3 = add128(h3, mul64(f1_2, f2));
+	h3 = add128(h3, mul64(f4, f4_19));
+
+	h4 = mul64(f0_2, f4);
+	h4 = add128(h4, mul64(f1_2, f3));
+	h4 = add128(h4, mul64(f2, f2));
+
+	fe51_reduce(h, h0, h1, h2, h3, h4);
+	}
+
+static void fe51_mul121666(fe51 h, fe51 f)
+	{
+	fe51_reduce(h, mul64(f[0], 121666), mul64(f[1], 121666),
+		mul64(f[2], 121666), mul64(f[3], 121666),
+		mul64(f[4], 121666));
+	}
+#endif
+
+static void fe51_frombytes(fe51 h, const unsigned char *s)
+	{
+	u64 a[4];
+	int i, j;
+
+	for (i = 0; i < 4; i++)
+		{
+		a[i] = 0;
+		for (j = 7; j >= 0; j--)
+			a[i] = (a[i] << 8) | s[8 * i + j];
+		}
+
+	/* the most significant bit is ignored, RFC 7748 section 5 */
+	h[0] = a[0] & MASK51;
+	h[1] = ((a[0] >> 51) | (a[1] << 13)) & MASK51;
+	h[2] = ((a[1] >> 38) | (a[2] << 26)) & MASK51;
+	h[3] = ((a[2] >> 25) | (a[3] << 39)) & MASK51;
+	h[4] = (a[3] >> 12) & MASK51;
+	}
+
+static void fe51_tobytes(unsigned char *s, const fe51 h)
+	{
+	u64 h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+	u64 q, a[4];
+	int i, j;
+
+	/* bring all limbs below 2^51, so that h < 2^255 < 2*p */
+	h1 += h0 >> 51; h0 &= MASK51;
+	h2 += h1 >> 51; h1 &= MASK51;
+	h3 += h2 >> 51; h2 &= MASK51;
+	h4 += h3 >> 51; h3 &= MASK51;
+	h0 += (h4 >> 51) * 19; h4 &= MASK51;
+	h1 += h0 >> 51; h0 &= MASK51;
+
+	/* q is 1 if h >= p, i.e. if h + 19 >= 2^255 */
+	q = (h0 + 19) >> 51;
+	q = (h1 + q) >> 51;
+	q = (h2 + q) >> 51;
+	q = (h3 + q) >> 51;
+	q = (h4 + q) >> 51;
+
+	/* h - q*p = h + 19*q - q*2^255 */
+	h0 += 19 * q;
+	h1 += h0 >> 51; h0 &= MASK51;
+	h2 += h1 >> 51; h1 &= MASK51;
+	h3 += h2 >> 51; h2 &= MASK51;
+	h4 += h3 >> 51; h3 &= MASK51;
+	h4 &= MASK51;
+
+	a[0] = h0 | (h1 << 51);
+	a[1] = (h1 >> 13) | (h2 << 38);
+	a[2] = (h2 >> 26) | (h3 << 25);
+	a[3] = (h3 >> 39) | (h4 << 12);
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 8; j++)
+			s[8 * i + j] = (unsigned char)(a[i] >> (8 * j));
+	}
+
+static void fe51_add(fe51 h, const fe51 f, const fe51 g)
+	{
+	h[0] = f[0] + g[0];
+	h[1] = f[1] + g[1];
+	h[2] = f[2] + g[2];
+	h[3] = f[3] + g[3];
+	h[4] = f[4] + g[4];
+	}
+
+/* h = f - g, computed as f + 2*p - g so that the limbs stay positive */
+static void fe51_sub(fe51 h, const fe51 f, const fe51 g)
+	{
+	h[0] = (f[0] + U64(0xfffffffffffda)) - g[0];
+	h[1] = (f[1] + U64(0xffffffffffffe)) - g[1];
+	h[2] = (f[2] + U64(0xffffffffffffe)) - g[2];
+	h[3] = (f[3] + U64(0xffffffffffffe)) - g[3];
+	h[4] = (f[4] + U64(0xffffffffffffe)) - g[4];
+	}
+
+static void fe51_0(fe51 h)
+	{
+	h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+	}
+
+static void fe51_1(fe51 h)
+	{
+	h[0] = 1;
+	h[1] = h[2] = h[3] = h[4] = 0;
+	}
+
+static void fe51_copy(fe51 h, const fe51 f)
+	{
+	h[0] = f[0]; h[1] = f[1]; h[2] = f[2]; h[3] = f[3]; h[4] = f[4];
+	}
+
+/* swap f and g if b is 1, leave them alone if b is 0 */
+static void fe51_cswap(fe51 f, fe51 g, unsigned int b)
+	{
+	u64 mask = 0 - (u64)b, x;
+	int i;
+
+	for (i = 0; i < 5; i++)
+		{
+		x = (f[i] ^ g[i]) & mask;
+		f[i] ^= x;
+		g[i] ^= x;
+		}
+	}
+
+/* out = z^(p-2) = z^-1 */
+static void fe51_invert(fe51 out, const fe51 z)
+	{
+	fe51 t0, t1, t2, t3;
+	int i;
+
+	fe51_sq(t0, z);				/* 2 */
+	fe51_sq(t1, t0);
+	fe51_sq(t1, t1);			/* 8 */
+	fe51_mul(t1, z, t1);			/* 9 */
+	fe51_mul(t0, t0, t1);			/* 11 */
+	fe51_sq(t2, t0);			/* 22 */
+	fe51_mul(t1, t1, t2);			/* 2^5 - 1 */
+	fe51_sq(t2, t1);
+	for (i = 1; i < 5; i++)
+		fe51_sq(t2, t2);
+	fe51_mul(t1, t2, t1);			/* 2^10 - 1 */
+	fe51_sq(t2, t1);
+	for (i = 1; i < 10; i++)
+		fe51_sq(t2, t2);
+	fe51_mul(t2, t2, t1);			/* 2^20 - 1 */
+	fe51_sq(t3, t2);
+	for (i = 1; i < 20; i++)
+		fe51_sq(t3, t3);
+	fe51_mul(t2, t3, t2);			/* 2^40 - 1 */
+	for (i = 0; i < 10; i++)
+		fe51_sq(t2, t2);
+	fe51_mul(t1, t2, t1);			/* 2^50 - 1 */
+	fe51_sq(t2, t1);
+	for (i = 1; i < 50; i++)
+		fe51_sq(t2, t2);
+	fe51_mul(t2, t2, t1);			/* 2^100 - 1 */
+	fe51_sq(t3, t2);
+	for (i = 1; i < 100; i++)
+		fe51_sq(t3, t3);
+	fe51_mul(t2, t3, t2);			/* 2^200 - 1 */
+	for (i = 0; i < 50; i++)
+		fe51_sq(t2, t2);
+	fe51_mul(t1, t2, t1);			/* 2^250 - 1 */
+	for (i = 0; i < 5; i++)
+		fe51_sq(t1, t1);
+	fe51_mul(out, t1, t0);			/* 2^255 - 21 */
+	}
+
+/*
+ * Montgomery ladder on the u-coordinate, RFC 7748 section 5, with the
+ * scalar already clamped.
+ */
+static void x25519_scalar_mult(unsigned char out[32],
+	const unsigned char scalar[32], const unsigned char point[32])
+	{
+	fe51 x1, x2, z2, x3, z3, a, aa, b, bb, e, c, d;
+	unsigned int swap = 0, bit;
+	int pos;
+
+	fe51_frombytes(x1, point);
+	fe51_1(x2);
+	fe51_0(z2);
+	fe51_copy(x3, x1);
+	fe51_1(z3);
+
+	for (pos = 254; pos >= 0; pos--)
+		{
+		bit = (scalar[pos / 8] >> (pos & 7)) & 1;
+		swap ^= bit;
+		fe51_cswap(x2, x3, swap);
+		fe51_cswap(z2, z3, swap);
+		swap = bit;
+
+		fe51_add(a, x2, z2);
+		fe51_sq(aa, a);
+		fe51_sub(b, x2, z2);
+		fe51_sq(bb, b);
+		fe51_sub(e, aa, bb);
+		fe51_add(c, x3, z3);
+		fe51_sub(d, x3, z3);
+		fe51_mul(d, d, a);		/* DA */
+		fe51_mul(c, c, b);		/* CB */
+		fe51_add(x3, d, c);
+		fe51_sq(x3, x3);
+		fe51_sub(z3, d, c);
+		fe51_sq(z3, z3);
+		fe51_mul(z3, z3, x1);
+		fe51_mul(x2, aa, bb);
+		fe51_mul121666(z2, e);
+		fe51_add(z2, z2, bb);
+		fe51_mul(z2, z2, e);
+		}
+
+	fe51_cswap(x2, x3, swap);
+	fe51_cswap(z2, z3, swap);
+
+	fe51_invert(z2, z2);
+	fe51_mul(x2, x2, z2);
+	fe51_tobytes(out, x2);
+
+	OPENSSL_cleanse(x2, sizeof(x2));
+	OPENSSL_cleanse(z2, sizeof(z2));
+	OPENSSL_cleanse(x3, sizeof(x3));
+	OPENSSL_cleanse(z3, sizeof(z3));
+	OPENSSL_cleanse(aa, sizeof(aa));
+	OPENSSL_cleanse(bb, sizeof(bb));
+	}
+
+int X25519(unsigned char out_shared_key[32],
+	const unsigned char private_key[32],
+	const unsigned char peer_public_value[32])
+	{
+	static const unsigned char kZeros[32] = {0};
+	unsigned char e[32];
+
+	memcpy(e, private_key, 32);
+	e[0] &= 248;
+	e[31] &= 127;
+	e[31] |= 64;
+	x25519_scalar_mult(out_shared_key, e, peer_public_value);
+	OPENSSL_cleanse(e, sizeof(e));
+
+	/*
+	 * A low order peer point gives an all-zero result, which is
+	 * rejected as RFC 7748 section 6.1 allows.
+	 */
+	return CRYPTO_memcmp(kZeros, out_shared_key, 32) != 0;
+	}
+
+void X25519_public_from_private(unsigned char out_public_value[32],
+	const unsigned char private_key[32])
+	{
+	static const unsigned char kBasePoint[32] = {9};
+
+	X25519(out_public_value, private_key, kBasePoint);
+	}
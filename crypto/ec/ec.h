@@ -251,6 +251,17 @@ const EC_POINT *EC_GROUP_get0_generator(const EC_GROUP *group);
 */
 BN_MONT_CTX *EC_GROUP_get_mont_data(const EC_GROUP *group);
 
+/** Computes the inverse of x modulo the order of the generator, in
+ *  constant time if the order is odd. The order must be prime.
+ *  \param  group  EC_GROUP object
+ *  \param  r      BIGNUM for the result
+ *  \param  x      BIGNUM to invert, not a multiple of the order
+ *  \param  ctx    BN_CTX object (optional)
+ *  \return 1 on success and 0 if an error occurred
+ */
+int EC_GROUP_do_inverse_ord(const EC_GROUP *group, BIGNUM *r,
+	const BIGNUM *x, BN_CTX *ctx);
+
 /** Gets the order of a EC_GROUP
  *  \param  group  EC_GROUP object
  *  \param  order  BIGNUM to which the order is copied
@@ -843,6 +854,14 @@ int EC_KEY_precompute_mult(EC_KEY *key, BN_CTX *ctx);
  */
 int EC_KEY_generate_key(EC_KEY *key);
 
+/** Creates new ec keys for several EC_KEY objects sharing a group, with
+ *  the public keys converted to affine coordinates in a single step.
+ *  \param  keys  array of EC_KEY objects
+ *  \param  num   number of EC_KEY objects
+ *  \return 1 on success and 0 if an error occurred.
+ */
+int EC_KEY_generate_key_batch(EC_KEY **keys, int num);
+
 /** Verifies that a private and/or public key is valid.
  *  \param  key  the EC_KEY object
  *  \return 1 on success and 0 otherwise.
@@ -1071,10 +1090,20 @@ void ERR_load_EC_strings(void);
 #define EC_F_ECPARAMETERS_PRINT_FP			 148
 #define EC_F_ECPKPARAMETERS_PRINT			 149
 #define EC_F_ECPKPARAMETERS_PRINT_FP			 150
+#define EC_F_ECP_NISTZ256_GET_AFFINE			 240
+#define EC_F_ECP_NISTZ256_INV_MOD_ORD			 247
+#define EC_F_ECP_NISTZ256_MULT_PRECOMPUTE		 243
+#define EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE		 245
+#define EC_F_ECP_NISTZ256_POINTS_MUL			 241
+#define EC_F_ECP_NISTZ256_PRE_COMP_NEW			 244
+#define EC_F_ECP_NISTZ256_WINDOWED_MUL			 242
 #define EC_F_ECP_NIST_MOD_192				 203
 #define EC_F_ECP_NIST_MOD_224				 204
 #define EC_F_ECP_NIST_MOD_256				 205
 #define EC_F_ECP_NIST_MOD_521				 206
+#define EC_F_ECX_KEY_OP					 249
+#define EC_F_ECX_PRIV_ENCODE				 250
+#define EC_F_ECX_PUB_ENCODE				 251
 #define EC_F_EC_ASN1_GROUP2CURVE			 153
 #define EC_F_EC_ASN1_GROUP2FIELDID			 154
 #define EC_F_EC_ASN1_GROUP2PARAMETERS			 155
@@ -1142,9 +1171,11 @@ void ERR_load_EC_strings(void);
 #define EC_F_EC_GROUP_SET_CURVE_GFP			 109
 #define EC_F_EC_GROUP_SET_EXTRA_DATA			 110
 #define EC_F_EC_GROUP_SET_GENERATOR			 111
+#define EC_F_EC_GROUP_SIMPLE_INVERSE_ORD		 248
 #define EC_F_EC_KEY_CHECK_KEY				 177
 #define EC_F_EC_KEY_COPY				 178
 #define EC_F_EC_KEY_GENERATE_KEY			 179
+#define EC_F_EC_KEY_GENERATE_KEY_BATCH			 246
 #define EC_F_EC_KEY_NEW					 182
 #define EC_F_EC_KEY_PRINT				 180
 #define EC_F_EC_KEY_PRINT_FP				 181
@@ -1182,13 +1213,9 @@ void ERR_load_EC_strings(void);
 #define EC_F_NISTP224_PRE_COMP_NEW			 227
 #define EC_F_NISTP256_PRE_COMP_NEW			 236
 #define EC_F_NISTP521_PRE_COMP_NEW			 237
-#define EC_F_ECP_NISTZ256_GET_AFFINE			 240
-#define EC_F_ECP_NISTZ256_POINTS_MUL			 241
-#define EC_F_ECP_NISTZ256_WINDOWED_MUL			 242
-#define EC_F_ECP_NISTZ256_MULT_PRECOMPUTE		 243
-#define EC_F_ECP_NISTZ256_PRE_COMP_NEW			 244
 #define EC_F_O2I_ECPUBLICKEY				 152
 #define EC_F_OLD_EC_PRIV_DECODE				 222
+#define EC_F_PKEY_ECX_DERIVE				 252
 #define EC_F_PKEY_EC_CTRL				 197
 #define EC_F_PKEY_EC_CTRL_STR				 198
 #define EC_F_PKEY_EC_DERIVE				 217
@@ -1221,6 +1248,8 @@ void ERR_load_EC_strings(void);
 #define EC_R_INVALID_FIELD				 103
 #define EC_R_INVALID_FORM				 104
 #define EC_R_INVALID_GROUP_ORDER			 122
+#define EC_R_INVALID_KEY				 152
+#define EC_R_INVALID_PEER_KEY				 153
 #define EC_R_INVALID_PENTANOMIAL_BASIS			 132
 #define EC_R_INVALID_PRIVATE_KEY			 123
 #define EC_R_INVALID_TRINOMIAL_BASIS			 137
@@ -119,7 +119,8 @@ const EC_METHOD *EC_GF2m_simple_method(void)
 		ec_GF2m_simple_field_div,
 		0 /* field_encode */,
 		0 /* field_decode */,
-		0 /* field_set_to_one */ };
+		0 /* field_set_to_one */,
+		0 /* field_inverse_mod_ord */ };
 
 	return &ret;
 	}
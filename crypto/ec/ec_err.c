@@ -89,10 +89,20 @@ static ERR_STRING_DATA EC_str_functs[]=
 {ERR_FUNC(EC_F_ECPARAMETERS_PRINT_FP),	"ECParameters_print_fp"},
 {ERR_FUNC(EC_F_ECPKPARAMETERS_PRINT),	"ECPKParameters_print"},
 {ERR_FUNC(EC_F_ECPKPARAMETERS_PRINT_FP),	"ECPKParameters_print_fp"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_GET_AFFINE),	"ecp_nistz256_get_affine"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_INV_MOD_ORD),	"ecp_nistz256_inv_mod_ord"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_MULT_PRECOMPUTE),	"ecp_nistz256_mult_precompute"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE),	"ecp_nistz256_points_make_affine"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_POINTS_MUL),	"ecp_nistz256_points_mul"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_PRE_COMP_NEW),	"ecp_nistz256_pre_comp_new"},
+{ERR_FUNC(EC_F_ECP_NISTZ256_WINDOWED_MUL),	"ecp_nistz256_windowed_mul"},
 {ERR_FUNC(EC_F_ECP_NIST_MOD_192),	"ECP_NIST_MOD_192"},
 {ERR_FUNC(EC_F_ECP_NIST_MOD_224),	"ECP_NIST_MOD_224"},
 {ERR_FUNC(EC_F_ECP_NIST_MOD_256),	"ECP_NIST_MOD_256"},
 {ERR_FUNC(EC_F_ECP_NIST_MOD_521),	"ECP_NIST_MOD_521"},
+{ERR_FUNC(EC_F_ECX_KEY_OP),	"ECX_KEY_OP"},
+{ERR_FUNC(EC_F_ECX_PRIV_ENCODE),	"ECX_PRIV_ENCODE"},
+{ERR_FUNC(EC_F_ECX_PUB_ENCODE),	"ECX_PUB_ENCODE"},
 {ERR_FUNC(EC_F_EC_ASN1_GROUP2CURVE),	"EC_ASN1_GROUP2CURVE"},
 {ERR_FUNC(EC_F_EC_ASN1_GROUP2FIELDID),	"EC_ASN1_GROUP2FIELDID"},
 {ERR_FUNC(EC_F_EC_ASN1_GROUP2PARAMETERS),	"EC_ASN1_GROUP2PARAMETERS"},
@@ -160,9 +170,11 @@ static ERR_STRING_DATA EC_str_functs[]=
 {ERR_FUNC(EC_F_EC_GROUP_SET_CURVE_GFP),	"EC_GROUP_set_curve_GFp"},
 {ERR_FUNC(EC_F_EC_GROUP_SET_EXTRA_DATA),	"EC_GROUP_SET_EXTRA_DATA"},
 {ERR_FUNC(EC_F_EC_GROUP_SET_GENERATOR),	"EC_GROUP_set_generator"},
+{ERR_FUNC(EC_F_EC_GROUP_SIMPLE_INVERSE_ORD),	"ec_group_simple_inverse_ord"},
 {ERR_FUNC(EC_F_EC_KEY_CHECK_KEY),	"EC_KEY_check_key"},
 {ERR_FUNC(EC_F_EC_KEY_COPY),	"EC_KEY_copy"},
 {ERR_FUNC(EC_F_EC_KEY_GENERATE_KEY),	"EC_KEY_generate_key"},
+{ERR_FUNC(EC_F_EC_KEY_GENERATE_KEY_BATCH),	"EC_KEY_generate_key_batch"},
 {ERR_FUNC(EC_F_EC_KEY_NEW),	"EC_KEY_new"},
 {ERR_FUNC(EC_F_EC_KEY_PRINT),	"EC_KEY_print"},
 {ERR_FUNC(EC_F_EC_KEY_PRINT_FP),	"EC_KEY_print_fp"},
@@ -200,13 +212,9 @@ static ERR_STRING_DATA EC_str_functs[]=
 {ERR_FUNC(EC_F_NISTP224_PRE_COMP_NEW),	"NISTP224_PRE_COMP_NEW"},
 {ERR_FUNC(EC_F_NISTP256_PRE_COMP_NEW),	"NISTP256_PRE_COMP_NEW"},
 {ERR_FUNC(EC_F_NISTP521_PRE_COMP_NEW),	"NISTP521_PRE_COMP_NEW"},
-{ERR_FUNC(EC_F_ECP_NISTZ256_GET_AFFINE),	"ecp_nistz256_get_affine"},
-{ERR_FUNC(EC_F_ECP_NISTZ256_POINTS_MUL),	"ecp_nistz256_points_mul"},
-{ERR_FUNC(EC_F_ECP_NISTZ256_WINDOWED_MUL),	"ecp_nistz256_windowed_mul"},
-{ERR_FUNC(EC_F_ECP_NISTZ256_MULT_PRECOMPUTE),	"ecp_nistz256_mult_precompute"},
-{ERR_FUNC(EC_F_ECP_NISTZ256_PRE_COMP_NEW),	"ecp_nistz256_pre_comp_new"},
 {ERR_FUNC(EC_F_O2I_ECPUBLICKEY),	"o2i_ECPublicKey"},
 {ERR_FUNC(EC_F_OLD_EC_PRIV_DECODE),	"OLD_EC_PRIV_DECODE"},
+{ERR_FUNC(EC_F_PKEY_ECX_DERIVE),	"PKEY_ECX_DERIVE"},
 {ERR_FUNC(EC_F_PKEY_EC_CTRL),	"PKEY_EC_CTRL"},
 {ERR_FUNC(EC_F_PKEY_EC_CTRL_STR),	"PKEY_EC_CTRL_STR"},
 {ERR_FUNC(EC_F_PKEY_EC_DERIVE),	"PKEY_EC_DERIVE"},
@@ -242,6 +250,8 @@ static ERR_STRING_DATA EC_str_reasons[]=
 {ERR_REASON(EC_R_INVALID_FIELD)          ,"invalid field"},
 {ERR_REASON(EC_R_INVALID_FORM)           ,"invalid form"},
 {ERR_REASON(EC_R_INVALID_GROUP_ORDER)    ,"invalid group order"},
+{ERR_REASON(EC_R_INVALID_KEY)            ,"invalid key"},
+{ERR_REASON(EC_R_INVALID_PEER_KEY)       ,"invalid peer key"},
 {ERR_REASON(EC_R_INVALID_PENTANOMIAL_BASIS),"invalid pentanomial basis"},
 {ERR_REASON(EC_R_INVALID_PRIVATE_KEY)    ,"invalid private key"},
 {ERR_REASON(EC_R_INVALID_TRINOMIAL_BASIS),"invalid trinomial basis"},
@@ -295,6 +295,57 @@ err:
 	return(ok);
 	}
 
+int EC_KEY_generate_key_batch(EC_KEY **keys, int num)
+	{
+	int	i, ok = 0;
+	BN_CTX	*ctx = NULL;
+	EC_POINT **pub_keys = NULL;
+
+	if (num <= 0)
+		return 1;
+	if (!keys || !keys[0] || !keys[0]->group)
+		{
+		ECerr(EC_F_EC_KEY_GENERATE_KEY_BATCH, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+		}
+
+	if ((ctx = BN_CTX_new()) == NULL) goto err;
+	pub_keys = OPENSSL_malloc(num * sizeof(EC_POINT *));
+	if (pub_keys == NULL)
+		{
+		ECerr(EC_F_EC_KEY_GENERATE_KEY_BATCH, ERR_R_MALLOC_FAILURE);
+		goto err;
+		}
+
+	for (i = 0; i < num; i++)
+		{
+		if (keys[i] == NULL || keys[i]->group == NULL ||
+		    (i > 0 && EC_GROUP_cmp(keys[0]->group, keys[i]->group, ctx)))
+			{
+			ECerr(EC_F_EC_KEY_GENERATE_KEY_BATCH,
+						EC_R_INCOMPATIBLE_OBJECTS);
+			goto err;
+			}
+		if (!EC_KEY_generate_key(keys[i]))
+			goto err;
+		pub_keys[i] = keys[i]->pub_key;
+		}
+
+	/* Share a single field inversion between all the public keys,
+	 * rather than one each when they are later encoded. */
+	if (!EC_POINTs_make_affine(keys[0]->group, num, pub_keys, ctx))
+		goto err;
+
+	ok = 1;
+
+err:
+	if (pub_keys != NULL)
+		OPENSSL_free(pub_keys);
+	if (ctx != NULL)
+		BN_CTX_free(ctx);
+	return(ok);
+	}
+
 int EC_KEY_check_key(const EC_KEY *eckey)
 	{
 	int	ok   = 0;
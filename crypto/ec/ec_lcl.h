@@ -176,6 +176,10 @@ struct ec_method_st {
 	int (*field_encode)(const EC_GROUP *, BIGNUM *r, const BIGNUM *a, BN_CTX *); /* e.g. to Montgomery */
 	int (*field_decode)(const EC_GROUP *, BIGNUM *r, const BIGNUM *a, BN_CTX *); /* e.g. from Montgomery */
 	int (*field_set_to_one)(const EC_GROUP *, BIGNUM *r, BN_CTX *);
+
+	/* used by EC_GROUP_do_inverse_ord, r = x^-1 mod order in constant
+	 * time (ec_group_simple_inverse_ord is used if the pointer is 0): */
+	int (*field_inverse_mod_ord)(const EC_GROUP *, BIGNUM *r, const BIGNUM *x, BN_CTX *);
 } /* EC_METHOD */;
 
 typedef struct ec_extra_data_st {
@@ -289,6 +293,11 @@ struct ec_point_st {
 
 
 
+/* default for field_inverse_mod_ord, in ec_lib.c
+ * (EC_GROUP_do_inverse_ord uses it if group->meth->field_inverse_mod_ord is 0) */
+int ec_group_simple_inverse_ord(const EC_GROUP *group, BIGNUM *r,
+	const BIGNUM *x, BN_CTX *);
+
 /* method functions in ec_mult.c
  * (ec_lib.c uses these as defaults if group->method->mul is 0) */
 int ec_wNAF_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *scalar,
@@ -455,3 +464,22 @@ int ec_precompute_mont_data(EC_GROUP *);
  */
 const EC_METHOD *EC_GFp_nistz256_method(void);
 #endif
+
+#define X25519_KEYLEN		32
+#define X25519_BITS		253
+#define X25519_SECURITY_BITS	128
+
+/* X25519 key held in an EVP_PKEY, see ecx_meth.c */
+typedef struct
+	{
+	unsigned char pubkey[X25519_KEYLEN];
+	/* NULL for a public key */
+	unsigned char *privkey;
+	} X25519_KEY;
+
+/* X25519 Diffie-Hellman function of RFC 7748, in curve25519.c */
+int X25519(unsigned char out_shared_key[32],
+	const unsigned char private_key[32],
+	const unsigned char peer_public_value[32]);
+void X25519_public_from_private(unsigned char out_public_value[32],
+	const unsigned char private_key[32]);
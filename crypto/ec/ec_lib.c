@@ -357,6 +357,74 @@ BN_MONT_CTX *EC_GROUP_get_mont_data(const EC_GROUP *group)
 	return group->mont_data;
 	}
 
+int ec_group_simple_inverse_ord(const EC_GROUP *group, BIGNUM *r,
+	const BIGNUM *x, BN_CTX *ctx)
+	{
+	BN_CTX *new_ctx = NULL;
+	BIGNUM *e, *p;
+	int ret = 0;
+
+	if (ctx == NULL)
+		{
+		ctx = new_ctx = BN_CTX_new();
+		if (ctx == NULL)
+			return 0;
+		}
+
+	BN_CTX_start(ctx);
+
+	if (group->mont_data == NULL)
+		{
+		/* the order is not odd, use the variable-time inversion */
+		if (BN_mod_inverse(r, x, group->order, ctx) != NULL)
+			ret = 1;
+		goto err;
+		}
+
+	if ((e = BN_CTX_get(ctx)) == NULL)
+		goto err;
+
+	/* BN_mod_exp_mont_consttime leaves negative inputs negative */
+	if (BN_is_negative(x))
+		{
+		if (!BN_nnmod(e, x, group->order, ctx))
+			goto err;
+		x = e;
+		}
+
+	/* We want the inverse in constant time, therefore we utilize the
+	 * fact that the order must be prime and use Fermat's Little Theorem
+	 * instead: x^-1 = x^(order - 2) */
+	if ((p = BN_CTX_get(ctx)) == NULL)
+		goto err;
+	if (!BN_set_word(p, 2))
+		goto err;
+	if (!BN_sub(p, group->order, p))
+		goto err;
+	BN_set_flags(p, BN_FLG_CONSTTIME);
+	if (!BN_mod_exp_mont_consttime(r, x, p, group->order, ctx,
+			group->mont_data))
+		goto err;
+
+	ret = 1;
+
+err:
+	if (!ret)
+		ECerr(EC_F_EC_GROUP_SIMPLE_INVERSE_ORD, ERR_R_BN_LIB);
+	BN_CTX_end(ctx);
+	if (new_ctx != NULL)
+		BN_CTX_free(new_ctx);
+	return ret;
+	}
+
+int EC_GROUP_do_inverse_ord(const EC_GROUP *group, BIGNUM *r,
+	const BIGNUM *x, BN_CTX *ctx)
+	{
+	if (group->meth->field_inverse_mod_ord != 0)
+		return group->meth->field_inverse_mod_ord(group, r, x, ctx);
+	return ec_group_simple_inverse_ord(group, r, x, ctx);
+	}
+
 int EC_GROUP_get_order(const EC_GROUP *group, BIGNUM *order, BN_CTX *ctx)
 	{
 	if (!BN_copy(order, group->order))
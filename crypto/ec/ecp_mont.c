@@ -107,7 +107,8 @@ const EC_METHOD *EC_GFp_mont_method(void)
 		0 /* field_div */,
 		ec_GFp_mont_field_encode,
 		ec_GFp_mont_field_decode,
-		ec_GFp_mont_field_set_to_one };
+		ec_GFp_mont_field_set_to_one,
+		0 /* field_inverse_mod_ord */ };
 
 	return &ret;
 	}
@@ -108,7 +108,8 @@ const EC_METHOD *EC_GFp_nist_method(void)
 		0 /* field_div */,
 		0 /* field_encode */,
 		0 /* field_decode */,
-		0 /* field_set_to_one */ };
+		0 /* field_set_to_one */,
+		0 /* field_inverse_mod_ord */ };
 
 	return &ret;
 	}
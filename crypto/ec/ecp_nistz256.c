@@ -112,6 +112,13 @@ void ecp_nistz256_from_mont(BN_ULONG res[P256_LIMBS],
 /* Convert a number to Montgomery domain, by multiplying with 2^512 mod P*/
 void ecp_nistz256_to_mont(BN_ULONG res[P256_LIMBS],
                           const BN_ULONG in[P256_LIMBS]);
+/* Montgomery mul modulo the group order: res = a*b*2^-256 mod ord */
+void ecp_nistz256_ord_mul_mont(BN_ULONG res[P256_LIMBS],
+                               const BN_ULONG a[P256_LIMBS],
+                               const BN_ULONG b[P256_LIMBS]);
+/* Montgomery sqr modulo the group order, |rep| times in a row */
+void ecp_nistz256_ord_sqr_mont(BN_ULONG res[P256_LIMBS],
+                               const BN_ULONG a[P256_LIMBS], int rep);
 /* Functions that perform constant time access to the precomputed tables */
 void ecp_nistz256_scatter_w5(P256_POINT * val,
                             const P256_POINT * in_t, int index);
@@ -1308,6 +1315,7 @@ static int ecp_nistz256_points_mul(const EC_GROUP * group,
     bn_correct_top(r->X);
     bn_correct_top(r->Y);
     bn_correct_top(r->Z);
+    r->Z_is_one = is_one(p.p.Z) & 1;
 
     ret = 1;
 
@@ -1337,9 +1345,18 @@ static int ecp_nistz256_get_affine(const EC_GROUP * group,
         return 0;
     }
 
-    ecp_nistz256_mod_inverse(z_inv3, point_z);
-    ecp_nistz256_sqr_mont(z_inv2, z_inv3);
-    ecp_nistz256_mul_mont(x_aff, z_inv2, point_x);
+    if (point->Z_is_one) {
+        memcpy(x_aff, point_x, sizeof(x_aff));
+        memcpy(y_aff, point_y, sizeof(y_aff));
+    } else {
+        ecp_nistz256_mod_inverse(z_inv3, point_z);
+        ecp_nistz256_sqr_mont(z_inv2, z_inv3);
+        ecp_nistz256_mul_mont(x_aff, z_inv2, point_x);
+        if (y != NULL) {
+            ecp_nistz256_mul_mont(z_inv3, z_inv3, z_inv2);
+            ecp_nistz256_mul_mont(y_aff, z_inv3, point_y);
+        }
+    }
 
     if (x != NULL) {
         bn_wexpand(x, P256_LIMBS);
@@ -1349,8 +1366,6 @@ static int ecp_nistz256_get_affine(const EC_GROUP * group,
     }
 
     if (y != NULL) {
-        ecp_nistz256_mul_mont(z_inv3, z_inv3, z_inv2);
-        ecp_nistz256_mul_mont(y_aff, z_inv3, point_y);
         bn_wexpand(y, P256_LIMBS);
         bn_set_top(y, P256_LIMBS);
         ecp_nistz256_from_mont(bn_get_words(y), y_aff);
@@ -1360,6 +1375,104 @@ static int ecp_nistz256_get_affine(const EC_GROUP * group,
     return 1;
 }
 
+/*
+ * Convert |num| points to affine coordinates with a single inversion, using
+ * Montgomery's trick. Unlike ec_GFp_simple_points_make_affine the inversion
+ * is the constant-time one used for single points, so the points may be
+ * secret, e.g. the k*G of ECDSA signatures computed in advance.
+ */
+static int ecp_nistz256_points_make_affine(const EC_GROUP * group,
+                                           size_t num, EC_POINT * points[],
+                                           BN_CTX * ctx)
+{
+    BN_ULONG (*z)[P256_LIMBS] = NULL, (*prod)[P256_LIMBS] = NULL;
+    BN_ULONG acc[P256_LIMBS], z_inv[P256_LIMBS];
+    BN_ULONG z_inv2[P256_LIMBS], z_inv3[P256_LIMBS];
+    BN_ULONG point_x[P256_LIMBS], point_y[P256_LIMBS];
+    BN_ULONG x_aff[P256_LIMBS], y_aff[P256_LIMBS];
+    size_t i;
+    int ret = 0;
+
+    if (num == 0)
+        return 1;
+
+    z = OPENSSL_malloc(num * sizeof(z[0]));
+    prod = OPENSSL_malloc(num * sizeof(prod[0]));
+    if (z == NULL || prod == NULL) {
+        ECerr(EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /* prod[i] is the product of the Z coordinates of points[0..i-1] */
+    memcpy(acc, ONE, sizeof(acc));
+    for (i = 0; i < num; i++) {
+        if (EC_POINT_is_at_infinity(group, points[i])) {
+            memcpy(z[i], ONE, sizeof(z[i]));
+        } else if (!ecp_nistz256_bignum_to_field_elem(z[i], points[i]->Z)) {
+            ECerr(EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE,
+                  EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+        memcpy(prod[i], acc, sizeof(acc));
+        ecp_nistz256_mul_mont(acc, acc, z[i]);
+    }
+
+    ecp_nistz256_mod_inverse(acc, acc);
+
+    for (i = num; i-- > 0;) {
+        EC_POINT *p = points[i];
+
+        /* acc is now the inverse of the product of Z of points[0..i] */
+        ecp_nistz256_mul_mont(z_inv, acc, prod[i]);
+        ecp_nistz256_mul_mont(acc, acc, z[i]);
+
+        if (EC_POINT_is_at_infinity(group, p) || p->Z_is_one)
+            continue;
+
+        if (!ecp_nistz256_bignum_to_field_elem(point_x, p->X) ||
+            !ecp_nistz256_bignum_to_field_elem(point_y, p->Y)) {
+            ECerr(EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE,
+                  EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+
+        ecp_nistz256_sqr_mont(z_inv2, z_inv);
+        ecp_nistz256_mul_mont(z_inv3, z_inv2, z_inv);
+        ecp_nistz256_mul_mont(x_aff, z_inv2, point_x);
+        ecp_nistz256_mul_mont(y_aff, z_inv3, point_y);
+
+        if (bn_wexpand(p->X, P256_LIMBS) == NULL ||
+            bn_wexpand(p->Y, P256_LIMBS) == NULL ||
+            bn_wexpand(p->Z, P256_LIMBS) == NULL) {
+            ECerr(EC_F_ECP_NISTZ256_POINTS_MAKE_AFFINE, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        bn_set_top(p->X, P256_LIMBS);
+        bn_set_top(p->Y, P256_LIMBS);
+        bn_set_top(p->Z, P256_LIMBS);
+        bn_set_data(p->X, x_aff, sizeof(x_aff));
+        bn_set_data(p->Y, y_aff, sizeof(y_aff));
+        bn_set_data(p->Z, ONE, sizeof(ONE));
+        bn_correct_top(p->X);
+        bn_correct_top(p->Y);
+        bn_correct_top(p->Z);
+        p->Z_is_one = 1;
+    }
+
+    ret = 1;
+
+ err:
+    if (z != NULL) {
+        OPENSSL_cleanse(z, num * sizeof(z[0]));
+        OPENSSL_free(z);
+    }
+    if (prod != NULL) {
+        OPENSSL_cleanse(prod, num * sizeof(prod[0]));
+        OPENSSL_free(prod);
+    }
+    return ret;
+}
+
 static EC_PRE_COMP *ecp_nistz256_pre_comp_new(const EC_GROUP * group)
 {
     EC_PRE_COMP *ret = NULL;
@@ -1445,6 +1558,119 @@ static int ecp_nistz256_window_have_precompute_mult(const EC_GROUP * group)
                                ecp_nistz256_pre_comp_clear_free) != NULL;
 }
 
+/*
+ * r = x^-1 mod ord, where ord is the order of the P-256 generator. The
+ * inverse is computed in constant time as x^(ord-2), on limbs in the
+ * Montgomery domain modulo ord. Groups of this method with any other order
+ * get the generic inversion.
+ */
+static int ecp_nistz256_inv_mod_ord(const EC_GROUP * group, BIGNUM * r,
+                                    const BIGNUM * x, BN_CTX * ctx)
+{
+    static const BN_ULONG ord[P256_LIMBS] = {
+        TOBN(0xf3b9cac2, 0xfc632551), TOBN(0xbce6faad, 0xa7179e84),
+        TOBN(0xffffffff, 0xffffffff), TOBN(0xffffffff, 0x00000000)
+    };
+    /* 2^512 mod ord, to convert into the Montgomery domain */
+    static const BN_ULONG RR[P256_LIMBS] = {
+        TOBN(0x83244c95, 0xbe79eea2), TOBN(0x4699799c, 0x49bd6fa6),
+        TOBN(0x2845b239, 0x2b6bec59), TOBN(0x66e12d94, 0xf3d95620)
+    };
+    static const BN_ULONG one[P256_LIMBS] = {
+        TOBN(0, 1), TOBN(0, 0), TOBN(0, 0), TOBN(0, 0)
+    };
+    /*
+     * The lower 128 bits of ord-2 = 0xbce6faada7179e84f3b9cac2fc63254f as
+     * a sliding window: each entry is a number of squarings followed by a
+     * multiplication by table[i] = x^(2*i+1).
+     */
+    static const unsigned char chain[27][2] = {
+        {4, 5}, {2, 1}, {5, 3}, {6, 6}, {4, 7}, {4, 2}, {5, 5}, {5, 6},
+        {5, 3}, {7, 5}, {2, 1}, {6, 7}, {2, 0}, {8, 4}, {3, 3}, {5, 3},
+        {4, 3}, {5, 3}, {5, 2}, {3, 1}, {8, 5}, {4, 7}, {5, 1}, {5, 1},
+        {6, 4}, {4, 2}, {6, 7}
+    };
+    BN_ULONG table[8][P256_LIMBS];
+    BN_ULONG t[P256_LIMBS], x2[P256_LIMBS], x8[P256_LIMBS];
+    BN_ULONG x16[P256_LIMBS], x32[P256_LIMBS];
+    BN_CTX *new_ctx = NULL;
+    BIGNUM *tmp = NULL;
+    int i, ret = 0;
+
+    if (!ecp_nistz256_bignum_to_field_elem(t, group->order) ||
+        memcmp(t, ord, sizeof(t)) != 0)
+        return ec_group_simple_inverse_ord(group, r, x, ctx);
+
+    if (BN_is_negative(x) || BN_ucmp(x, group->order) >= 0) {
+        if (ctx == NULL) {
+            ctx = new_ctx = BN_CTX_new();
+            if (ctx == NULL)
+                goto err;
+        }
+        if ((tmp = BN_new()) == NULL || !BN_nnmod(tmp, x, group->order, ctx)) {
+            ECerr(EC_F_ECP_NISTZ256_INV_MOD_ORD, ERR_R_BN_LIB);
+            goto err;
+        }
+        x = tmp;
+    }
+
+    if (!ecp_nistz256_bignum_to_field_elem(t, x)) {
+        ECerr(EC_F_ECP_NISTZ256_INV_MOD_ORD, EC_R_COORDINATES_OUT_OF_RANGE);
+        goto err;
+    }
+
+    /* table[i] = x^(2*i+1) */
+    ecp_nistz256_ord_mul_mont(table[0], t, RR);
+    ecp_nistz256_ord_sqr_mont(x2, table[0], 1);
+    for (i = 1; i < 8; i++)
+        ecp_nistz256_ord_mul_mont(table[i], table[i - 1], x2);
+
+    /* xN = x^(2^N-1), starting from table[7] = x^(2^4-1) */
+    ecp_nistz256_ord_sqr_mont(x8, table[7], 4);
+    ecp_nistz256_ord_mul_mont(x8, x8, table[7]);
+    ecp_nistz256_ord_sqr_mont(x16, x8, 8);
+    ecp_nistz256_ord_mul_mont(x16, x16, x8);
+    ecp_nistz256_ord_sqr_mont(x32, x16, 16);
+    ecp_nistz256_ord_mul_mont(x32, x32, x16);
+
+    /* The upper 128 bits of ord-2 are 0xffffffff00000000ffffffffffffffff */
+    ecp_nistz256_ord_sqr_mont(t, x32, 64);
+    ecp_nistz256_ord_mul_mont(t, t, x32);
+    ecp_nistz256_ord_sqr_mont(t, t, 32);
+    ecp_nistz256_ord_mul_mont(t, t, x32);
+
+    for (i = 0; i < (int)(sizeof(chain) / sizeof(chain[0])); i++) {
+        ecp_nistz256_ord_sqr_mont(t, t, chain[i][0]);
+        ecp_nistz256_ord_mul_mont(t, t, table[chain[i][1]]);
+    }
+
+    /* Leave the Montgomery domain */
+    ecp_nistz256_ord_mul_mont(t, t, one);
+
+    if (bn_wexpand(r, P256_LIMBS) == NULL) {
+        ECerr(EC_F_ECP_NISTZ256_INV_MOD_ORD, ERR_R_BN_LIB);
+        goto err;
+    }
+    bn_set_top(r, P256_LIMBS);
+    memcpy(bn_get_words(r), t, sizeof(t));
+    bn_correct_top(r);
+
+    ret = 1;
+
+ err:
+    OPENSSL_cleanse(table, sizeof(table));
+    OPENSSL_cleanse(t, sizeof(t));
+    OPENSSL_cleanse(x2, sizeof(x2));
+    OPENSSL_cleanse(x8, sizeof(x8));
+    OPENSSL_cleanse(x16, sizeof(x16));
+    OPENSSL_cleanse(x32, sizeof(x32));
+    if (tmp != NULL)
+        BN_clear_free(tmp);
+    if (new_ctx != NULL)
+        BN_CTX_free(new_ctx);
+    return ret;
+}
+
 const EC_METHOD *EC_GFp_nistz256_method(void)
 {
     static const EC_METHOD ret = {
@@ -1475,7 +1701,7 @@ const EC_METHOD *EC_GFp_nistz256_method(void)
         ec_GFp_simple_is_on_curve,
         ec_GFp_simple_cmp,
         ec_GFp_simple_make_affine,
-        ec_GFp_simple_points_make_affine,
+        ecp_nistz256_points_make_affine,
         ecp_nistz256_points_mul,                    /* mul */
         ecp_nistz256_mult_precompute,               /* precompute_mult */
         ecp_nistz256_window_have_precompute_mult,   /* have_precompute_mult */
@@ -1484,7 +1710,8 @@ const EC_METHOD *EC_GFp_nistz256_method(void)
         0,                                          /* field_div */
         ec_GFp_mont_field_encode,
         ec_GFp_mont_field_decode,
-        ec_GFp_mont_field_set_to_one
+        ec_GFp_mont_field_set_to_one,
+        ecp_nistz256_inv_mod_ord                    /* field_inverse_mod_ord */
     };
 
     return &ret;
@@ -108,7 +108,8 @@ const EC_METHOD *EC_GFp_simple_method(void)
 		0 /* field_div */,
 		0 /* field_encode */,
 		0 /* field_decode */,
-		0 /* field_set_to_one */ };
+		0 /* field_set_to_one */,
+		0 /* field_inverse_mod_ord */ };
 
 	return &ret;
 	}
@@ -1249,8 +1250,10 @@ int ec_GFp_simple_points_make_affine(const EC_GROUP *group, size_t num, EC_POINT
 		}
 
 	/* Now use a single explicit inversion to replace every
-	 * non-zero points[i]->Z by its inverse. */
+	 * non-zero points[i]->Z by its inverse. The points may be secret
+	 * (see EC_KEY_generate_key_batch()), so use the constant-time path. */
 
+	BN_set_flags(prod_Z[num - 1], BN_FLG_CONSTTIME);
 	if (!BN_mod_inverse(tmp, prod_Z[num - 1], group->field, ctx))
 		{
 		ECerr(EC_F_EC_GFP_SIMPLE_POINTS_MAKE_AFFINE, ERR_R_BN_LIB);
@@ -1249,6 +1249,62 @@ static void char2_field_tests(void)
 	}
 #endif
 
+/* check EC_GROUP_do_inverse_ord against BN_mod_inverse, including
+ * inputs that are negative or not below the order; groups with a
+ * composite order are skipped */
+static int inverse_ord_test(const EC_GROUP *group)
+	{
+	BIGNUM *order, *x, *inv, *expected;
+	BN_CTX *ctx = BN_CTX_new();
+	int i, ok = 0;
+
+	order = BN_new(); x = BN_new(); inv = BN_new(); expected = BN_new();
+	if (ctx == NULL || order == NULL || x == NULL || inv == NULL ||
+		expected == NULL)
+		goto err;
+	if (!EC_GROUP_get_order(group, order, ctx)) goto err;
+	if (BN_is_prime_ex(order, BN_prime_checks, ctx, NULL) != 1)
+		{
+		ok = 1;
+		goto err;
+		}
+
+	for (i = 0; i < 16; i++)
+		{
+		if (i == 0)
+			{ if (!BN_one(x)) goto err; }
+		else if (i == 1)
+			{ if (!BN_sub(x, order, BN_value_one())) goto err; }
+		else if (!BN_rand_range(x, order) || BN_is_zero(x))
+			continue;
+		if (!BN_mod_inverse(expected, x, order, ctx)) goto err;
+
+		if (!EC_GROUP_do_inverse_ord(group, inv, x, ctx)) goto err;
+		if (BN_cmp(inv, expected) != 0) goto err;
+
+		/* x + order and x - order */
+		if (!BN_add(x, x, order)) goto err;
+		if (!EC_GROUP_do_inverse_ord(group, inv, x, NULL)) goto err;
+		if (BN_cmp(inv, expected) != 0) goto err;
+		if (!BN_sub(x, x, order) || !BN_sub(x, x, order)) goto err;
+		if (!EC_GROUP_do_inverse_ord(group, inv, x, ctx)) goto err;
+		if (BN_cmp(inv, expected) != 0) goto err;
+
+		/* in place */
+		if (!BN_add(x, x, order)) goto err;
+		if (!EC_GROUP_do_inverse_ord(group, x, x, ctx)) goto err;
+		if (BN_cmp(x, expected) != 0) goto err;
+		}
+	ok = 1;
+err:
+	BN_free(order);
+	BN_free(x);
+	BN_free(inv);
+	BN_free(expected);
+	BN_CTX_free(ctx);
+	return ok;
+	}
+
 static void internal_curve_test(void)
 	{
 	EC_builtin_curve *curves = NULL;
@@ -1291,6 +1347,16 @@ static void internal_curve_test(void)
 			/* try the next curve */
 			continue;
 			}
+		if (!inverse_ord_test(group))
+			{
+			ok = 0;
+			fprintf(stdout, "\nEC_GROUP_do_inverse_ord() failed with"
+				" curve %s\n", OBJ_nid2sn(nid));
+			ERR_print_errors_fp(stdout);
+			EC_GROUP_free(group);
+			/* try the next curve */
+			continue;
+			}
 		fprintf(stdout, ".");
 		fflush(stdout);
 		EC_GROUP_free(group);
@@ -0,0 +1,475 @@
+/* crypto/ec/ecx_meth.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.OpenSSL.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    licensing@OpenSSL.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.OpenSSL.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ */
+
+/*
+ * EVP_PKEY methods for X25519 keys.
+ *
+ * Curve25519 is not a short Weierstrass curve and has no EC_GROUP, so
+ * its keys are a separate EVP_PKEY type rather than EC_KEYs. Public
+ * and private keys are encoded as in draft-ietf-curdle-pkix: the
+ * algorithm identifier has no parameters, the public key is the raw
+ * 32-byte u-coordinate and the PKCS#8 private key is the 32-byte
+ * scalar wrapped in an OCTET STRING.
+ */
+
+#include <stdio.h>
+#include "cryptlib.h"
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+#include <openssl/rand.h>
+#include "asn1_locl.h"
+#include "evp_locl.h"
+#include "ec_lcl.h"
+
+typedef enum { X25519_PUBLIC, X25519_PRIVATE, X25519_KEYGEN } ecx_key_op_t;
+
+/* Set up the key of pkey from an encoded public or private key, or a
+ * freshly generated private one.
+ */
+static int ecx_key_op(EVP_PKEY *pkey, X509_ALGOR *palg,
+		const unsigned char *p, int plen, ecx_key_op_t op)
+	{
+	X25519_KEY *xkey;
+
+	if (op != X25519_KEYGEN)
+		{
+		if (palg != NULL)
+			{
+			int ptype;
+
+			/* Algorithm parameters must be absent */
+			X509_ALGOR_get0(NULL, &ptype, NULL, palg);
+			if (ptype != V_ASN1_UNDEF)
+				{
+				ECerr(EC_F_ECX_KEY_OP, EC_R_INVALID_ENCODING);
+				return 0;
+				}
+			}
+
+		if (p == NULL || plen != X25519_KEYLEN)
+			{
+			ECerr(EC_F_ECX_KEY_OP, EC_R_INVALID_ENCODING);
+			return 0;
+			}
+		}
+
+	xkey = OPENSSL_malloc(sizeof(X25519_KEY));
+	if (xkey == NULL)
+		{
+		ECerr(EC_F_ECX_KEY_OP, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	xkey->privkey = NULL;
+
+	if (op == X25519_PUBLIC)
+		memcpy(xkey->pubkey, p, X25519_KEYLEN);
+	else
+		{
+		xkey->privkey = OPENSSL_malloc(X25519_KEYLEN);
+		if (xkey->privkey == NULL)
+			{
+			ECerr(EC_F_ECX_KEY_OP, ERR_R_MALLOC_FAILURE);
+			OPENSSL_free(xkey);
+			return 0;
+			}
+		if (op == X25519_KEYGEN)
+			{
+			if (RAND_bytes(xkey->privkey, X25519_KEYLEN) <= 0)
+				{
+				OPENSSL_free(xkey->privkey);
+				OPENSSL_free(xkey);
+				return 0;
+				}
+			xkey->privkey[0] &= 248;
+			xkey->privkey[31] &= 127;
+			xkey->privkey[31] |= 64;
+			}
+		else
+			memcpy(xkey->privkey, p, X25519_KEYLEN);
+		X25519_public_from_private(xkey->pubkey, xkey->privkey);
+		}
+
+	EVP_PKEY_assign(pkey, NID_X25519, xkey);
+	return 1;
+	}
+
+static int ecx_pub_encode(X509_PUBKEY *pk, const EVP_PKEY *pkey)
+	{
+	const X25519_KEY *xkey = (const X25519_KEY *)pkey->pkey.ptr;
+	unsigned char *penc;
+
+	if (xkey == NULL)
+		{
+		ECerr(EC_F_ECX_PUB_ENCODE, EC_R_INVALID_KEY);
+		return 0;
+		}
+
+	penc = BUF_memdup(xkey->pubkey, X25519_KEYLEN);
+	if (penc == NULL)
+		{
+		ECerr(EC_F_ECX_PUB_ENCODE, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+
+	if (!X509_PUBKEY_set0_param(pk, OBJ_nid2obj(NID_X25519), V_ASN1_UNDEF,
+					NULL, penc, X25519_KEYLEN))
+		{
+		OPENSSL_free(penc);
+		ECerr(EC_F_ECX_PUB_ENCODE, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	return 1;
+	}
+
+static int ecx_pub_decode(EVP_PKEY *pkey, X509_PUBKEY *pubkey)
+	{
+	const unsigned char *p;
+	int pklen;
+	X509_ALGOR *palg;
+
+	if (!X509_PUBKEY_get0_param(NULL, &p, &pklen, &palg, pubkey))
+		return 0;
+	return ecx_key_op(pkey, palg, p, pklen, X25519_PUBLIC);
+	}
+
+static int ecx_pub_cmp(const EVP_PKEY *a, const EVP_PKEY *b)
+	{
+	const X25519_KEY *akey = (const X25519_KEY *)a->pkey.ptr;
+	const X25519_KEY *bkey = (const X25519_KEY *)b->pkey.ptr;
+
+	if (akey == NULL || bkey == NULL)
+		return -2;
+	return !memcmp(akey->pubkey, bkey->pubkey, X25519_KEYLEN);
+	}
+
+static int ecx_priv_decode(EVP_PKEY *pkey, PKCS8_PRIV_KEY_INFO *p8)
+	{
+	const unsigned char *p;
+	int plen, rv;
+	ASN1_OCTET_STRING *oct = NULL;
+	X509_ALGOR *palg;
+
+	if (!PKCS8_pkey_get0(NULL, &p, &plen, &palg, p8))
+		return 0;
+
+	oct = d2i_ASN1_OCTET_STRING(NULL, &p, plen);
+	if (oct == NULL)
+		{
+		p = NULL;
+		plen = 0;
+		}
+	else
+		{
+		p = ASN1_STRING_data(oct);
+		plen = ASN1_STRING_length(oct);
+		}
+
+	rv = ecx_key_op(pkey, palg, p, plen, X25519_PRIVATE);
+	if (oct != NULL)
+		{
+		OPENSSL_cleanse(oct->data, oct->length);
+		ASN1_OCTET_STRING_free(oct);
+		}
+	return rv;
+	}
+
+static int ecx_priv_encode(PKCS8_PRIV_KEY_INFO *p8, const EVP_PKEY *pkey)
+	{
+	const X25519_KEY *xkey = (const X25519_KEY *)pkey->pkey.ptr;
+	ASN1_OCTET_STRING oct;
+	unsigned char *penc = NULL;
+	int penclen;
+
+	if (xkey == NULL || xkey->privkey == NULL)
+		{
+		ECerr(EC_F_ECX_PRIV_ENCODE, EC_R_INVALID_PRIVATE_KEY);
+		return 0;
+		}
+
+	oct.data = xkey->privkey;
+	oct.length = X25519_KEYLEN;
+	oct.type = V_ASN1_OCTET_STRING;
+	oct.flags = 0;
+
+	penclen = i2d_ASN1_OCTET_STRING(&oct, &penc);
+	if (penclen < 0)
+		{
+		ECerr(EC_F_ECX_PRIV_ENCODE, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+
+	if (!PKCS8_pkey_set0(p8, OBJ_nid2obj(NID_X25519), 0,
+				V_ASN1_UNDEF, NULL, penc, penclen))
+		{
+		OPENSSL_cleanse(penc, penclen);
+		OPENSSL_free(penc);
+		ECerr(EC_F_ECX_PRIV_ENCODE, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	return 1;
+	}
+
+static int ecx_size(const EVP_PKEY *pkey)
+	{
+	return X25519_KEYLEN;
+	}
+
+static int ecx_bits(const EVP_PKEY *pkey)
+	{
+	return X25519_BITS;
+	}
+
+static int ecx_security_bits(const EVP_PKEY *pkey)
+	{
+	return X25519_SECURITY_BITS;
+	}
+
+static void ecx_free(EVP_PKEY *pkey)
+	{
+	X25519_KEY *xkey = (X25519_KEY *)pkey->pkey.ptr;
+
+	if (xkey == NULL)
+		return;
+	if (xkey->privkey != NULL)
+		{
+		OPENSSL_cleanse(xkey->privkey, X25519_KEYLEN);
+		OPENSSL_free(xkey->privkey);
+		}
+	OPENSSL_free(xkey);
+	}
+
+static int ecx_print_bin(BIO *bp, const char *name, const unsigned char *p,
+		int indent)
+	{
+	int i;
+
+	if (BIO_printf(bp, "%*s%s:", indent, "", name) <= 0)
+		return 0;
+	for (i = 0; i < X25519_KEYLEN; i++)
+		{
+		if (i % 15 == 0 &&
+			BIO_printf(bp, "\n%*s", indent + 4, "") <= 0)
+			return 0;
+		if (BIO_printf(bp, "%02x%s", p[i],
+				i == X25519_KEYLEN - 1 ? "" : ":") <= 0)
+			return 0;
+		}
+	return BIO_printf(bp, "\n") > 0;
+	}
+
+static int ecx_key_print(BIO *bp, const EVP_PKEY *pkey, int indent,
+		ecx_key_op_t op)
+	{
+	const X25519_KEY *xkey = (const X25519_KEY *)pkey->pkey.ptr;
+	const char *nm = OBJ_nid2ln(pkey->type);
+
+	if (op == X25519_PRIVATE)
+		{
+		if (xkey == NULL || xkey->privkey == NULL)
+			return BIO_printf(bp, "%*s<INVALID PRIVATE KEY>\n",
+							indent, "") > 0;
+		if (BIO_printf(bp, "%*s%s Private-Key:\n", indent, "", nm) <= 0)
+			return 0;
+		if (!ecx_print_bin(bp, "priv", xkey->privkey, indent))
+			return 0;
+		}
+	else
+		{
+		if (xkey == NULL)
+			return BIO_printf(bp, "%*s<INVALID PUBLIC KEY>\n",
+							indent, "") > 0;
+		if (BIO_printf(bp, "%*s%s Public-Key:\n", indent, "", nm) <= 0)
+			return 0;
+		}
+	return ecx_print_bin(bp, "pub", xkey->pubkey, indent);
+	}
+
+static int ecx_priv_print(BIO *bp, const EVP_PKEY *pkey, int indent,
+		ASN1_PCTX *ctx)
+	{
+	return ecx_key_print(bp, pkey, indent, X25519_PRIVATE);
+	}
+
+static int ecx_pub_print(BIO *bp, const EVP_PKEY *pkey, int indent,
+		ASN1_PCTX *ctx)
+	{
+	return ecx_key_print(bp, pkey, indent, X25519_PUBLIC);
+	}
+
+static int ecx_ctrl(EVP_PKEY *pkey, int op, long arg1, void *arg2)
+	{
+	switch (op)
+		{
+	case ASN1_PKEY_CTRL_SET1_TLS_ENCPT:
+		return ecx_key_op(pkey, NULL, arg2, arg1, X25519_PUBLIC);
+
+	case ASN1_PKEY_CTRL_GET1_TLS_ENCPT:
+		if (pkey->pkey.ptr != NULL)
+			{
+			const X25519_KEY *xkey =
+				(const X25519_KEY *)pkey->pkey.ptr;
+			unsigned char **ppt = arg2;
+
+			*ppt = BUF_memdup(xkey->pubkey, X25519_KEYLEN);
+			if (*ppt != NULL)
+				return X25519_KEYLEN;
+			}
+		return 0;
+
+	default:
+		return -2;
+		}
+	}
+
+const EVP_PKEY_ASN1_METHOD ecx25519_asn1_meth =
+	{
+	NID_X25519,
+	NID_X25519,
+	0,
+	"X25519",
+	"OpenSSL X25519 algorithm",
+
+	ecx_pub_decode,
+	ecx_pub_encode,
+	ecx_pub_cmp,
+	ecx_pub_print,
+
+	ecx_priv_decode,
+	ecx_priv_encode,
+	ecx_priv_print,
+
+	ecx_size,
+	ecx_bits,
+	ecx_security_bits,
+
+	0, 0, 0, 0, 0, 0,
+	0,
+
+	ecx_free,
+	ecx_ctrl,
+	0, 0
+	};
+
+static int pkey_ecx_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+	{
+	return ecx_key_op(pkey, NULL, NULL, 0, X25519_KEYGEN);
+	}
+
+static int pkey_ecx_derive(EVP_PKEY_CTX *ctx, unsigned char *key,
+		size_t *keylen)
+	{
+	const X25519_KEY *pkey, *peerkey;
+
+	if (ctx->pkey == NULL || ctx->peerkey == NULL)
+		{
+		ECerr(EC_F_PKEY_ECX_DERIVE, EC_R_KEYS_NOT_SET);
+		return 0;
+		}
+	pkey = (const X25519_KEY *)ctx->pkey->pkey.ptr;
+	peerkey = (const X25519_KEY *)ctx->peerkey->pkey.ptr;
+	if (pkey == NULL || pkey->privkey == NULL)
+		{
+		ECerr(EC_F_PKEY_ECX_DERIVE, EC_R_INVALID_PRIVATE_KEY);
+		return 0;
+		}
+	if (peerkey == NULL)
+		{
+		ECerr(EC_F_PKEY_ECX_DERIVE, EC_R_INVALID_PEER_KEY);
+		return 0;
+		}
+
+	*keylen = X25519_KEYLEN;
+	if (key != NULL && X25519(key, pkey->privkey, peerkey->pubkey) == 0)
+		{
+		/* the peer key has a small order */
+		ECerr(EC_F_PKEY_ECX_DERIVE, EC_R_INVALID_PEER_KEY);
+		return 0;
+		}
+	return 1;
+	}
+
+static int pkey_ecx_ctrl(EVP_PKEY_CTX *ctx, int type, int p1, void *p2)
+	{
+	/* Only need to handle peer key for derivation */
+	if (type == EVP_PKEY_CTRL_PEER_KEY)
+		return 1;
+	return -2;
+	}
+
+const EVP_PKEY_METHOD ecx25519_pkey_meth =
+	{
+	NID_X25519,
+	EVP_PKEY_FLAG_AUTOARGLEN,
+	0, 0, 0,
+
+	0, 0,
+
+	0,
+	pkey_ecx_keygen,
+
+	0, 0,
+
+	0, 0,
+
+	0, 0,
+
+	0, 0, 0, 0,
+
+	0, 0,
+
+	0, 0,
+
+	0,
+	pkey_ecx_derive,
+
+	pkey_ecx_ctrl,
+	0
+	};
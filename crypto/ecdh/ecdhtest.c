@@ -91,6 +91,8 @@ int main(int argc, char *argv[])
 #else
 #include <openssl/ec.h>
 #include <openssl/ecdh.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
 
 #ifdef OPENSSL_SYS_WIN16
 #define MS_CALLBACK	_far _loadds
@@ -465,6 +467,167 @@ static int ecdh_kat(BIO *out, const char *cname, int nid,
 		bp##bits##_db, sizeof(bp##bits##_db), \
 		bp##bits##_Z, sizeof(bp##bits##_Z))
 
+/* Keys and shared secret from RFC 7748 section 6.1 */
+
+static const unsigned char x25519_a[] = {
+	0x77,0x07,0x6D,0x0A,0x73,0x18,0xA5,0x7D,0x3C,0x16,0xC1,0x72,
+	0x51,0xB2,0x66,0x45,0xDF,0x4C,0x2F,0x87,0xEB,0xC0,0x99,0x2A,
+	0xB1,0x77,0xFB,0xA5,0x1D,0xB9,0x2C,0x2A
+};
+
+static const unsigned char x25519_pub_a[] = {
+	0x85,0x20,0xF0,0x09,0x89,0x30,0xA7,0x54,0x74,0x8B,0x7D,0xDC,
+	0xB4,0x3E,0xF7,0x5A,0x0D,0xBF,0x3A,0x0D,0x26,0x38,0x1A,0xF4,
+	0xEB,0xA4,0xA9,0x8E,0xAA,0x9B,0x4E,0x6A
+};
+
+static const unsigned char x25519_b[] = {
+	0x5D,0xAB,0x08,0x7E,0x62,0x4A,0x8A,0x4B,0x79,0xE1,0x7F,0x8B,
+	0x83,0x80,0x0E,0xE6,0x6F,0x3B,0xB1,0x29,0x26,0x18,0xB6,0xFD,
+	0x1C,0x2F,0x8B,0x27,0xFF,0x88,0xE0,0xEB
+};
+
+static const unsigned char x25519_pub_b[] = {
+	0xDE,0x9E,0xDB,0x7D,0x7B,0x7D,0xC1,0xB4,0xD3,0x5B,0x61,0xC2,
+	0xEC,0xE4,0x35,0x37,0x3F,0x83,0x43,0xC8,0x5B,0x78,0x67,0x4D,
+	0xAD,0xFC,0x7E,0x14,0x6F,0x88,0x2B,0x4F
+};
+
+static const unsigned char x25519_Z[] = {
+	0x4A,0x5D,0x9D,0x5B,0xA4,0xCE,0x2D,0xE1,0x72,0x8E,0x3B,0xF4,
+	0x80,0x35,0x0F,0x25,0xE0,0x7E,0x21,0xC9,0x47,0xD1,0x9E,0x33,
+	0x76,0xF0,0x9B,0x3C,0x1E,0x16,0x17,0x42
+};
+
+/* PKCS#8 encoding of an X25519 private key up to the key itself */
+static const unsigned char x25519_p8_prefix[] = {
+	0x30,0x2E,0x02,0x01,0x00,0x30,0x05,0x06,0x03,0x2B,0x65,0x6E,
+	0x04,0x22,0x04,0x20
+};
+
+static EVP_PKEY *mk_x25519_priv(const unsigned char *priv)
+	{
+	unsigned char der[sizeof(x25519_p8_prefix) + 32];
+	const unsigned char *p = der;
+
+	memcpy(der, x25519_p8_prefix, sizeof(x25519_p8_prefix));
+	memcpy(der + sizeof(x25519_p8_prefix), priv, 32);
+	return d2i_AutoPrivateKey(NULL, &p, sizeof(der));
+	}
+
+static EVP_PKEY *mk_x25519_pub(const unsigned char *pub)
+	{
+	EVP_PKEY *pkey = EVP_PKEY_new();
+
+	if (pkey == NULL)
+		return NULL;
+	if (!EVP_PKEY_set_type(pkey, EVP_PKEY_X25519) ||
+		!EVP_PKEY_set1_tls_encodedpoint(pkey, pub, 32))
+		{
+		EVP_PKEY_free(pkey);
+		return NULL;
+		}
+	return pkey;
+	}
+
+static int x25519_derive(EVP_PKEY *key, EVP_PKEY *peer,
+		unsigned char *Z, size_t *Zlen)
+	{
+	EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new(key, NULL);
+	int rv;
+
+	rv = pctx != NULL && EVP_PKEY_derive_init(pctx) > 0 &&
+		EVP_PKEY_derive_set_peer(pctx, peer) > 0 &&
+		EVP_PKEY_derive(pctx, Z, Zlen) > 0;
+	EVP_PKEY_CTX_free(pctx);
+	return rv;
+	}
+
+/* Known answer test for X25519, through the EVP interface that TLS
+ * uses, and agreement between freshly generated keys.
+ */
+
+static int x25519_test(BIO *out)
+	{
+	static const unsigned char zero[32] = {0};
+	int rv = 0;
+	EVP_PKEY *a = NULL, *b = NULL, *pub_a = NULL, *pub_b = NULL;
+	EVP_PKEY *low = NULL, *c = NULL, *d = NULL;
+	EVP_PKEY_CTX *kctx = NULL;
+	PKCS8_PRIV_KEY_INFO *p8 = NULL;
+	unsigned char *pt = NULL, Z[32], Z2[32];
+	size_t Zlen, Z2len;
+
+	BIO_puts(out, "Testing X25519 shared secret");
+	a = mk_x25519_priv(x25519_a);
+	b = mk_x25519_priv(x25519_b);
+	pub_a = mk_x25519_pub(x25519_pub_a);
+	pub_b = mk_x25519_pub(x25519_pub_b);
+	low = mk_x25519_pub(zero);
+	if (!a || !b || !pub_a || !pub_b || !low)
+		goto err;
+
+	/* The public key is computed from the private one */
+	if (EVP_PKEY_get1_tls_encodedpoint(a, &pt) != 32 ||
+		memcmp(pt, x25519_pub_a, 32))
+		goto err;
+
+	Zlen = sizeof(Z);
+	if (!x25519_derive(a, pub_b, Z, &Zlen) || Zlen != 32 ||
+		memcmp(Z, x25519_Z, 32))
+		goto err;
+	Zlen = sizeof(Z);
+	if (!x25519_derive(b, pub_a, Z, &Zlen) || Zlen != 32 ||
+		memcmp(Z, x25519_Z, 32))
+		goto err;
+
+	/* A point of small order gives an all zero secret, which is refused */
+	Zlen = sizeof(Z);
+	if (x25519_derive(a, low, Z, &Zlen))
+		goto err;
+	ERR_clear_error();
+
+	kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, NULL);
+	if (kctx == NULL || EVP_PKEY_keygen_init(kctx) <= 0 ||
+		EVP_PKEY_keygen(kctx, &c) <= 0 ||
+		EVP_PKEY_keygen(kctx, &d) <= 0)
+		goto err;
+	Zlen = sizeof(Z);
+	Z2len = sizeof(Z2);
+	if (!x25519_derive(c, d, Z, &Zlen) || !x25519_derive(d, c, Z2, &Z2len)
+		|| Zlen != Z2len || memcmp(Z, Z2, Zlen))
+		goto err;
+
+	/* PKCS#8 round trip */
+	EVP_PKEY_free(a);
+	a = NULL;
+	if ((p8 = EVP_PKEY2PKCS8(c)) == NULL || (a = EVP_PKCS82PKEY(p8)) == NULL
+		|| EVP_PKEY_cmp(a, c) != 1)
+		goto err;
+
+	rv = 1;
+	err:
+	EVP_PKEY_free(a);
+	EVP_PKEY_free(b);
+	EVP_PKEY_free(pub_a);
+	EVP_PKEY_free(pub_b);
+	EVP_PKEY_free(low);
+	EVP_PKEY_free(c);
+	EVP_PKEY_free(d);
+	EVP_PKEY_CTX_free(kctx);
+	PKCS8_PRIV_KEY_INFO_free(p8);
+	if (pt)
+		OPENSSL_free(pt);
+	if (rv)
+		BIO_puts(out, " ok\n");
+	else
+		{
+		fprintf(stderr, "Error in X25519 routines\n");
+		ERR_print_errors_fp(stderr);
+		}
+	return rv;
+	}
+
 int main(int argc, char *argv[])
 	{
 	BN_CTX *ctx=NULL;
@@ -512,6 +675,8 @@ int main(int argc, char *argv[])
 		goto err;
 	if (!test_ecdh_kat(out, "Brainpool Prime-Curve brainpoolP512r1", 512))
 		goto err;
+	if (!x25519_test(out))
+		goto err;
 
 	ret = 0;
 
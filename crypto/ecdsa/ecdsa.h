@@ -142,6 +142,21 @@ ECDSA_SIG *ECDSA_do_sign_ex(const unsigned char *dgst, int dgstlen,
 int	  ECDSA_do_verify(const unsigned char *dgst, int dgst_len,
 		const ECDSA_SIG *sig, EC_KEY* eckey);
 
+/** Verifies a number of ECDSA signatures together, sharing the work
+ *  that does not depend on the individual signatures.
+ *  \param  dgsts     array of pointers to the hash values
+ *  \param  dgst_lens array of the lengths of the hash values
+ *  \param  sigs      array of ECDSA_SIG structures
+ *  \param  eckeys    array of EC_KEY objects containing public EC keys
+ *  \param  results   array in which the result of ECDSA_do_verify()
+ *                    for each signature is returned
+ *  \param  num       number of signatures
+ *  \return 1 if all signatures are valid and 0 otherwise
+ */
+int	  ECDSA_do_verify_batch(const unsigned char **dgsts,
+		const int *dgst_lens, ECDSA_SIG **sigs, EC_KEY **eckeys,
+		int *results, int num);
+
 const ECDSA_METHOD *ECDSA_OpenSSL(void);
 
 /** Sets the default ECDSA method
@@ -177,6 +192,30 @@ int	  ECDSA_size(const EC_KEY *eckey);
 int 	  ECDSA_sign_setup(EC_KEY *eckey, BN_CTX *ctx, BIGNUM **kinv, 
 		BIGNUM **rp);
 
+/** Precompute parts of several signing operations together, sharing
+ *  the inversions between them
+ *  \param  eckey  EC_KEY object containing a private EC key
+ *  \param  ctx    BN_CTX object (optional)
+ *  \param  kinv   array of BIGNUM pointers for the inverses of k
+ *  \param  rp     array of BIGNUM pointers for the x coordinates of
+ *                 k * generator
+ *  \param  num    number of pairs to compute
+ *  \return 1 on success and 0 otherwise
+ */
+int 	  ECDSA_sign_setup_batch(EC_KEY *eckey, BN_CTX *ctx, BIGNUM **kinv,
+		BIGNUM **rp, int num);
+
+/** Keeps a queue of precomputed (kinv, rp) pairs with the key, from
+ *  which ECDSA_do_sign() and ECDSA_sign() take one whenever the caller
+ *  does not supply its own; num pairs are computed at a time with
+ *  ECDSA_sign_setup_batch() whenever the queue is empty. The pairs are
+ *  dropped in the child after a fork().
+ *  \param  eckey  EC_KEY object containing a private EC key
+ *  \param  num    size of the queue, or 0 to stop precomputing
+ *  \return 1 on success and 0 otherwise
+ */
+int 	  ECDSA_set_precompute(EC_KEY *eckey, int num);
+
 /** Computes ECDSA signature of a given hash value using the supplied
  *  private key (note: sig must point to ECDSA_size(eckey) bytes of memory).
  *  \param  type     this parameter is ignored
@@ -264,7 +303,9 @@ void ECDSA_METHOD_set_sign(ECDSA_METHOD *ecdsa_method,
         ECDSA_SIG *(*ecdsa_do_sign)(const unsigned char *dgst, int dgst_len,
                 const BIGNUM *inv, const BIGNUM *rp, EC_KEY *eckey));
 
-/**  Set the  ECDSA_sign_setup function in the ECDSA_METHOD
+/**  Set the  ECDSA_sign_setup function in the ECDSA_METHOD. This also
+ *   removes the ECDSA_sign_setup_batch function, set it afterwards if the
+ *   method has one.
  *   \param  ecdsa_method  pointer to existing ECDSA_METHOD
  *   \param  ecdsa_sign_setup a funtion of type ECDSA_sign_setup
  */
@@ -273,7 +314,20 @@ void ECDSA_METHOD_set_sign_setup(ECDSA_METHOD *ecdsa_method,
         int (*ecdsa_sign_setup)(EC_KEY *eckey, BN_CTX *ctx, BIGNUM **kinv,
                 BIGNUM **r));
 
-/**  Set the ECDSA_do_verify function in the ECDSA_METHOD
+/**  Set the ECDSA_sign_setup_batch function in the ECDSA_METHOD
+ *   \param  ecdsa_method  pointer to existing ECDSA_METHOD
+ *   \param  ecdsa_sign_setup_batch a function of type
+ *           ECDSA_sign_setup_batch, or NULL to compute the pairs of a
+ *           batch one at a time
+ */
+
+void ECDSA_METHOD_set_sign_setup_batch(ECDSA_METHOD *ecdsa_method,
+        int (*ecdsa_sign_setup_batch)(EC_KEY *eckey, BN_CTX *ctx,
+                BIGNUM **kinv, BIGNUM **r, int num));
+
+/**  Set the ECDSA_do_verify function in the ECDSA_METHOD. This also
+ *   removes the ECDSA_do_verify_batch function, set it afterwards if the
+ *   method has one.
  *   \param  ecdsa_method  pointer to existing ECDSA_METHOD
  *   \param  ecdsa_do_verify a funtion of type ECDSA_do_verify
  */
@@ -282,6 +336,17 @@ void ECDSA_METHOD_set_verify(ECDSA_METHOD *ecdsa_method,
         int (*ecdsa_do_verify)(const unsigned char *dgst, int dgst_len,
                 const ECDSA_SIG *sig, EC_KEY *eckey));
 
+/**  Set the ECDSA_do_verify_batch function in the ECDSA_METHOD
+ *   \param  ecdsa_method  pointer to existing ECDSA_METHOD
+ *   \param  ecdsa_do_verify_batch a function of type ECDSA_do_verify_batch,
+ *           or NULL to verify the signatures of a batch one at a time
+ */
+
+void ECDSA_METHOD_set_verify_batch(ECDSA_METHOD *ecdsa_method,
+        int (*ecdsa_do_verify_batch)(const unsigned char **dgsts,
+                const int *dgst_lens, ECDSA_SIG **sigs, EC_KEY **eckeys,
+                int *results, int num));
+
 void ECDSA_METHOD_set_flags(ECDSA_METHOD *ecdsa_method, int flags);
 
 /**  Set the flags field in the ECDSA_METHOD
@@ -308,8 +373,11 @@ void ERR_load_ECDSA_strings(void);
 #define ECDSA_F_ECDSA_DATA_NEW_METHOD			 100
 #define ECDSA_F_ECDSA_DO_SIGN				 101
 #define ECDSA_F_ECDSA_DO_VERIFY				 102
+#define ECDSA_F_ECDSA_DO_VERIFY_BATCH			 104
 #define ECDSA_F_ECDSA_METHOD_NEW			 105
+#define ECDSA_F_ECDSA_SET_PRECOMPUTE			 106
 #define ECDSA_F_ECDSA_SIGN_SETUP			 103
+#define ECDSA_F_ECDSA_SIGN_SETUP_BATCH			 107
 
 /* Reason codes. */
 #define ECDSA_R_BAD_SIGNATURE				 100
@@ -94,6 +94,12 @@ int main(int argc, char * argv[])
 #include <openssl/err.h>
 #include <openssl/rand.h>
 
+#ifdef OPENSSL_SYS_UNIX
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
 static const char rnd_seed[] = "string to make the random number generator "
 	"think it has entropy";
 
@@ -101,6 +107,12 @@ static const char rnd_seed[] = "string to make the random number generator "
 int x9_62_tests(BIO *);
 int x9_62_test_internal(BIO *out, int nid, const char *r, const char *s);
 int test_builtin(BIO *);
+int test_batch(BIO *);
+int test_precompute(BIO *);
+#ifdef OPENSSL_SYS_UNIX
+int test_fork(BIO *);
+#endif
+int test_method_override(BIO *);
 
 /* functions to change the RAND_METHOD */
 int change_rand(void);
@@ -538,6 +550,350 @@ builtin_err:
 	return ret;
 	}
 
+/* verify signatures made with keys on a mix of curves with
+ * ECDSA_do_verify_batch(), and check that each result is the one
+ * ECDSA_do_verify() gives */
+#define BATCH_NUM	12
+
+int test_batch(BIO *out)
+	{
+	static const int nids[] = {
+		NID_X9_62_prime256v1, NID_secp384r1,
+#ifndef OPENSSL_NO_EC2M
+		NID_sect233k1,
+#endif
+		};
+	const int ncurves = sizeof(nids) / sizeof(nids[0]);
+	EC_KEY		*keys[2 * sizeof(nids) / sizeof(nids[0])];
+	EC_KEY		*eckeys[BATCH_NUM];
+	ECDSA_SIG	*sigs[BATCH_NUM];
+	unsigned char	digests[BATCH_NUM][32];
+	const unsigned char *dgsts[BATCH_NUM];
+	int		dgst_lens[BATCH_NUM], results[BATCH_NUM];
+	int		i, nkeys = 2 * ncurves, ret = 0, pass;
+
+	BIO_printf(out, "\ntesting ECDSA_do_verify_batch(): ");
+	memset(keys, 0, sizeof(keys));
+	memset(sigs, 0, sizeof(sigs));
+	for (i = 0; i < nkeys; i++)
+		{
+		if ((keys[i] = EC_KEY_new_by_curve_name(nids[i / 2])) == NULL)
+			goto err;
+		if (!EC_KEY_generate_key(keys[i]))
+			goto err;
+		}
+	for (i = 0; i < BATCH_NUM; i++)
+		{
+		/* mostly runs of signatures on the same curve */
+		eckeys[i] = keys[(i / 4) * 2 % nkeys + i % 2];
+		if (!RAND_pseudo_bytes(digests[i], 32))
+			goto err;
+		dgsts[i] = digests[i];
+		dgst_lens[i] = 32;
+		if ((sigs[i] = ECDSA_do_sign(digests[i], 32, eckeys[i])) == NULL)
+			goto err;
+		}
+
+	for (pass = 0; pass < 2; pass++)
+		{
+		if (pass == 1)
+			{
+			/* a wrong digest, a wrong key, s out of range and
+			 * a wrong r */
+			digests[1][0] ^= 1;
+			eckeys[2] = eckeys[3];
+			if (!EC_GROUP_get_order(EC_KEY_get0_group(eckeys[5]),
+							sigs[5]->s, NULL))
+				goto err;
+			if (!BN_add_word(sigs[6]->r, 1))
+				goto err;
+			}
+		if (ECDSA_do_verify_batch(dgsts, dgst_lens, sigs, eckeys,
+						results, BATCH_NUM) != !pass)
+			{
+			BIO_printf(out, " failed\n");
+			goto err;
+			}
+		for (i = 0; i < BATCH_NUM; i++)
+			{
+			if (results[i] != ECDSA_do_verify(dgsts[i], 32,
+						sigs[i], eckeys[i])
+			    || results[i] != (pass == 0 || (i != 1 && i != 2
+						&& i != 5 && i != 6)))
+				{
+				BIO_printf(out, " failed\n");
+				goto err;
+				}
+			}
+		BIO_printf(out, ".");
+		(void)BIO_flush(out);
+		}
+	BIO_printf(out, " ok\n");
+	ERR_clear_error();
+	ret = 1;
+err:
+	for (i = 0; i < nkeys; i++)
+		if (keys[i])
+			EC_KEY_free(keys[i]);
+	for (i = 0; i < BATCH_NUM; i++)
+		if (sigs[i])
+			ECDSA_SIG_free(sigs[i]);
+	return ret;
+	}
+
+/* sign with (kinv, r) pairs from ECDSA_sign_setup_batch() and from the
+ * queue of ECDSA_set_precompute(), and check EC_KEY_generate_key_batch() */
+#define SETUP_NUM	5
+
+int test_precompute(BIO *out)
+	{
+	static const int nids[] = {
+		NID_X9_62_prime256v1, NID_secp384r1,
+#ifndef OPENSSL_NO_EC2M
+		NID_sect233k1,
+#endif
+		};
+	EC_KEY		*keys[SETUP_NUM];
+	BIGNUM		*kinv[SETUP_NUM], *rp[SETUP_NUM];
+	ECDSA_SIG	*sig = NULL;
+	unsigned char	digest[32];
+	int		i, n, ret = 0;
+
+	BIO_printf(out, "\ntesting ECDSA_sign_setup_batch(): ");
+	memset(keys, 0, sizeof(keys));
+	memset(kinv, 0, sizeof(kinv));
+	memset(rp, 0, sizeof(rp));
+	for (n = 0; n < (int)(sizeof(nids) / sizeof(nids[0])); n++)
+		{
+		for (i = 0; i < SETUP_NUM; i++)
+			if ((keys[i] = EC_KEY_new_by_curve_name(nids[n])) == NULL)
+				goto err;
+		if (!EC_KEY_generate_key_batch(keys, SETUP_NUM))
+			goto err;
+		for (i = 0; i < SETUP_NUM; i++)
+			if (!EC_KEY_check_key(keys[i]))
+				{
+				BIO_printf(out, " failed\n");
+				goto err;
+				}
+
+		/* old values are replaced */
+		if ((rp[1] = BN_new()) == NULL)
+			goto err;
+		if (!ECDSA_sign_setup_batch(keys[0], NULL, kinv, rp, SETUP_NUM))
+			goto err;
+		for (i = 0; i < SETUP_NUM; i++)
+			{
+			if (!RAND_pseudo_bytes(digest, 32))
+				goto err;
+			sig = ECDSA_do_sign_ex(digest, 32, kinv[i], rp[i], keys[0]);
+			if (sig == NULL || BN_cmp(sig->r, rp[i]) != 0 ||
+			    ECDSA_do_verify(digest, 32, sig, keys[0]) != 1)
+				{
+				BIO_printf(out, " failed\n");
+				goto err;
+				}
+			ECDSA_SIG_free(sig);
+			sig = NULL;
+			}
+
+		/* enough signatures to empty the queue twice */
+		if (!ECDSA_set_precompute(keys[1], 3))
+			goto err;
+		for (i = 0; i < 7; i++)
+			{
+			if (!RAND_pseudo_bytes(digest, 32))
+				goto err;
+			sig = ECDSA_do_sign(digest, 32, keys[1]);
+			if (sig == NULL ||
+			    ECDSA_do_verify(digest, 32, sig, keys[1]) != 1)
+				{
+				BIO_printf(out, " failed\n");
+				goto err;
+				}
+			ECDSA_SIG_free(sig);
+			sig = NULL;
+			}
+
+		for (i = 0; i < SETUP_NUM; i++)
+			{
+			EC_KEY_free(keys[i]);
+			BN_clear_free(kinv[i]);
+			BN_clear_free(rp[i]);
+			keys[i] = NULL;
+			kinv[i] = rp[i] = NULL;
+			}
+		BIO_printf(out, ".");
+		(void)BIO_flush(out);
+		}
+	BIO_printf(out, " ok\n");
+	ret = 1;
+err:
+	for (i = 0; i < SETUP_NUM; i++)
+		{
+		if (keys[i])
+			EC_KEY_free(keys[i]);
+		BN_clear_free(kinv[i]);
+		BN_clear_free(rp[i]);
+		}
+	if (sig)
+		ECDSA_SIG_free(sig);
+	return ret;
+	}
+
+#ifdef OPENSSL_SYS_UNIX
+/* the child of a fork() must not take the pairs the parent precomputed:
+ * both signing the same digest would give the same signature */
+int test_fork(BIO *out)
+	{
+	EC_KEY		*key = NULL;
+	unsigned char	digest[32], parent[256], child[256];
+	int		fd[2], n, plen, clen = 0, status, ret = 0;
+	pid_t		pid;
+
+	BIO_printf(out, "\ntesting precomputed pairs after fork(): ");
+	memset(digest, 0x5a, sizeof(digest));
+	if ((key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) == NULL ||
+	    !EC_KEY_generate_key(key) || !ECDSA_set_precompute(key, 4) ||
+	    ECDSA_size(key) > (int)sizeof(parent))
+		goto err;
+	/* leaves three pairs in the queue */
+	if (!ECDSA_sign(0, digest, 32, parent, (unsigned int *)&plen, key))
+		goto err;
+
+	(void)BIO_flush(out);
+	if (pipe(fd) != 0 || (pid = fork()) < 0)
+		goto err;
+	if (pid == 0)
+		{
+		close(fd[0]);
+		if (!ECDSA_sign(0, digest, 32, child, (unsigned int *)&clen,
+									key) ||
+		    write(fd[1], child, clen) != clen)
+			_exit(1);
+		_exit(0);
+		}
+	close(fd[1]);
+	n = 0;
+	while (n < (int)sizeof(child) &&
+	       (clen = read(fd[0], child + n, sizeof(child) - n)) > 0)
+		n += clen;
+	close(fd[0]);
+	if (waitpid(pid, &status, 0) != pid || status != 0 || n == 0)
+		{
+		BIO_printf(out, "child failed\n");
+		goto err;
+		}
+	clen = n;
+
+	if (!ECDSA_sign(0, digest, 32, parent, (unsigned int *)&plen, key))
+		goto err;
+	if (ECDSA_verify(0, digest, 32, child, clen, key) != 1)
+		{
+		BIO_printf(out, "failed\n");
+		goto err;
+		}
+	if (plen == clen && memcmp(parent, child, plen) == 0)
+		{
+		BIO_printf(out, "failed, parent and child signatures match\n");
+		goto err;
+		}
+	BIO_printf(out, "ok\n");
+	ret = 1;
+err:
+	if (key)
+		EC_KEY_free(key);
+	return ret;
+	}
+#endif
+
+/* a method that replaces verify and sign_setup must not have batches
+ * handled by the built-in batch functions it was copied from */
+static int override_calls;
+
+static int override_verify(const unsigned char *dgst, int dgst_len,
+		const ECDSA_SIG *sig, EC_KEY *eckey)
+	{
+	override_calls++;
+	return 1;
+	}
+
+static int override_sign_setup(EC_KEY *eckey, BN_CTX *ctx, BIGNUM **kinv,
+		BIGNUM **r)
+	{
+	override_calls++;
+	return 0;
+	}
+
+int test_method_override(BIO *out)
+	{
+	ECDSA_METHOD	*meth = NULL;
+	EC_KEY		*key = NULL, *eckeys[4];
+	ECDSA_SIG	*sigs[4];
+	BIGNUM		*kinv[3], *rp[3];
+	unsigned char	digests[4][32];
+	const unsigned char *dgsts[4];
+	int		dgst_lens[4], results[4];
+	int		i, ret = 0;
+
+	BIO_printf(out, "\ntesting overridden ECDSA_METHOD: ");
+	memset(sigs, 0, sizeof(sigs));
+	memset(kinv, 0, sizeof(kinv));
+	memset(rp, 0, sizeof(rp));
+	if ((meth = ECDSA_METHOD_new((ECDSA_METHOD *)ECDSA_OpenSSL())) == NULL)
+		goto err;
+	ECDSA_METHOD_set_verify(meth, override_verify);
+	ECDSA_METHOD_set_sign_setup(meth, override_sign_setup);
+	if ((key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1)) == NULL ||
+	    !EC_KEY_generate_key(key))
+		goto err;
+	for (i = 0; i < 4; i++)
+		{
+		if (!RAND_pseudo_bytes(digests[i], 32))
+			goto err;
+		dgsts[i] = digests[i];
+		dgst_lens[i] = 32;
+		eckeys[i] = key;
+		if ((sigs[i] = ECDSA_do_sign(digests[i], 32, key)) == NULL)
+			goto err;
+		}
+	/* the override accepts a signature of another digest */
+	digests[2][0] ^= 1;
+	if (!ECDSA_set_method(key, meth))
+		goto err;
+
+	override_calls = 0;
+	if (ECDSA_do_verify_batch(dgsts, dgst_lens, sigs, eckeys, results, 4)
+			!= 1 || override_calls != 4)
+		{
+		BIO_printf(out, " failed\n");
+		goto err;
+		}
+	override_calls = 0;
+	if (ECDSA_sign_setup_batch(key, NULL, kinv, rp, 3) ||
+	    override_calls != 1)
+		{
+		BIO_printf(out, " failed\n");
+		goto err;
+		}
+	BIO_printf(out, "ok\n");
+	ret = 1;
+err:
+	for (i = 0; i < 4; i++)
+		if (sigs[i])
+			ECDSA_SIG_free(sigs[i]);
+	for (i = 0; i < 3; i++)
+		{
+		BN_clear_free(kinv[i]);
+		BN_clear_free(rp[i]);
+		}
+	if (key)
+		EC_KEY_free(key);
+	if (meth)
+		ECDSA_METHOD_free(meth);
+	return ret;
+	}
+
 int main(void)
 	{
 	int 	ret = 1;
@@ -567,6 +923,12 @@ int main(void)
 	/* the tests */
 	if (!x9_62_tests(out))  goto err;
 	if (!test_builtin(out)) goto err;
+	if (!test_batch(out)) goto err;
+	if (!test_precompute(out)) goto err;
+#ifdef OPENSSL_SYS_UNIX
+	if (!test_fork(out)) goto err;
+#endif
+	if (!test_method_override(out)) goto err;
 	
 	ret = 0;
 err:	
@@ -73,8 +73,11 @@ static ERR_STRING_DATA ECDSA_str_functs[]=
 {ERR_FUNC(ECDSA_F_ECDSA_DATA_NEW_METHOD),	"ECDSA_DATA_NEW_METHOD"},
 {ERR_FUNC(ECDSA_F_ECDSA_DO_SIGN),	"ECDSA_do_sign"},
 {ERR_FUNC(ECDSA_F_ECDSA_DO_VERIFY),	"ECDSA_do_verify"},
+{ERR_FUNC(ECDSA_F_ECDSA_DO_VERIFY_BATCH),	"ECDSA_do_verify_batch"},
 {ERR_FUNC(ECDSA_F_ECDSA_METHOD_NEW),	"ECDSA_METHOD_new"},
+{ERR_FUNC(ECDSA_F_ECDSA_SET_PRECOMPUTE),	"ECDSA_set_precompute"},
 {ERR_FUNC(ECDSA_F_ECDSA_SIGN_SETUP),	"ECDSA_sign_setup"},
+{ERR_FUNC(ECDSA_F_ECDSA_SIGN_SETUP_BATCH),	"ECDSA_sign_setup_batch"},
 {0,NULL}
 	};
 
@@ -114,6 +114,7 @@ static ECDSA_DATA *ECDSA_DATA_new_method(ENGINE *engine)
 	}
 
 	ret->init = NULL;
+	ret->precomp = NULL;
 
 	ret->meth = ECDSA_get_default_method();
 	ret->engine = engine;
@@ -171,6 +172,7 @@ static void ecdsa_data_free(void *data)
 		ENGINE_finish(r->engine);
 #endif
 	CRYPTO_free_ex_data(CRYPTO_EX_INDEX_ECDSA, r, &r->ex_data);
+	ecdsa_precomp_free(r->precomp);
 
 	OPENSSL_cleanse((void *)r, sizeof(ECDSA_DATA));
 
@@ -283,6 +285,8 @@ ECDSA_METHOD *ECDSA_METHOD_new(ECDSA_METHOD *ecdsa_meth)
 		ret->ecdsa_sign_setup = 0;
 		ret->ecdsa_do_sign = 0;
 		ret->ecdsa_do_verify = 0;
+		ret->ecdsa_do_verify_batch = 0;
+		ret->ecdsa_sign_setup_batch = 0;
 		ret->name = NULL;
 		ret->flags = 0;
 		}
@@ -303,6 +307,15 @@ void ECDSA_METHOD_set_sign_setup(ECDSA_METHOD *ecdsa_method,
 		BIGNUM **r))
 	{
 	ecdsa_method->ecdsa_sign_setup = ecdsa_sign_setup;
+	/* A batch setup inherited from another method would bypass it */
+	ecdsa_method->ecdsa_sign_setup_batch = 0;
+	}
+
+void ECDSA_METHOD_set_sign_setup_batch(ECDSA_METHOD *ecdsa_method,
+	int (*ecdsa_sign_setup_batch)(EC_KEY *eckey, BN_CTX *ctx,
+		BIGNUM **kinv, BIGNUM **r, int num))
+	{
+	ecdsa_method->ecdsa_sign_setup_batch = ecdsa_sign_setup_batch;
 	}
 
 void ECDSA_METHOD_set_verify(ECDSA_METHOD *ecdsa_method,
@@ -310,6 +323,16 @@ void ECDSA_METHOD_set_verify(ECDSA_METHOD *ecdsa_method,
 		const ECDSA_SIG *sig, EC_KEY *eckey))
 	{
 	ecdsa_method->ecdsa_do_verify = ecdsa_do_verify;
+	/* A batch verify inherited from another method would bypass it */
+	ecdsa_method->ecdsa_do_verify_batch = 0;
+	}
+
+void ECDSA_METHOD_set_verify_batch(ECDSA_METHOD *ecdsa_method,
+	int (*ecdsa_do_verify_batch)(const unsigned char **dgsts,
+		const int *dgst_lens, ECDSA_SIG **sigs, EC_KEY **eckeys,
+		int *results, int num))
+	{
+	ecdsa_method->ecdsa_do_verify_batch = ecdsa_do_verify_batch;
 	}
 
 void ECDSA_METHOD_set_flags(ECDSA_METHOD *ecdsa_method, int flags)
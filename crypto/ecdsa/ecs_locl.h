@@ -80,6 +80,11 @@ struct ecdsa_method
 #endif
 	int flags;
 	void *app_data;
+	int (*ecdsa_do_verify_batch)(const unsigned char **dgsts,
+			const int *dgst_lens, ECDSA_SIG **sigs,
+			EC_KEY **eckeys, int *results, int num);
+	int (*ecdsa_sign_setup_batch)(EC_KEY *eckey, BN_CTX *ctx,
+			BIGNUM **kinv, BIGNUM **r, int num);
 	};
 
 /* The ECDSA_METHOD was allocated and can be freed */
@@ -95,6 +100,18 @@ struct ecdsa_method
 
 #define ECDSA_FLAG_FIPS_METHOD	0x1
 
+/* Queue of (k^-1, r) pairs computed in advance for a key, see
+ * ECDSA_set_precompute(). All fields are protected by CRYPTO_LOCK_ECDSA.
+ */
+typedef struct ecdsa_precomp_st {
+	int	max;		/* number of pairs computed at a time */
+	int	num;		/* number of pairs left */
+	BIGNUM	*order;		/* order of the group they were computed for */
+	int	generation;	/* CRYPTO_fork_generation() they were computed in */
+	BIGNUM	**kinv;
+	BIGNUM	**r;
+} ECDSA_PRECOMP;
+
 typedef struct ecdsa_data_st {
 	/* EC_KEY_METH_DATA part */
 	int (*init)(EC_KEY *);
@@ -103,6 +120,7 @@ typedef struct ecdsa_data_st {
 	int	flags;
 	const ECDSA_METHOD *meth;
 	CRYPTO_EX_DATA ex_data;
+	ECDSA_PRECOMP *precomp;
 } ECDSA_DATA;
 
 /** ecdsa_check
@@ -113,6 +131,8 @@ typedef struct ecdsa_data_st {
  */
 ECDSA_DATA *ecdsa_check(EC_KEY *eckey);
 
+void ecdsa_precomp_free(ECDSA_PRECOMP *precomp);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -58,6 +58,7 @@
 
 
 
+#include <string.h>
 #include "ecs_locl.h"
 #include <openssl/err.h>
 #include <openssl/obj_mac.h>
@@ -73,6 +74,11 @@ static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
 					const unsigned char *dgst, int dlen);
 static int ecdsa_do_verify(const unsigned char *dgst, int dgst_len, 
 		const ECDSA_SIG *sig, EC_KEY *eckey);
+static int ecdsa_do_verify_batch(const unsigned char **dgsts,
+		const int *dgst_lens, ECDSA_SIG **sigs, EC_KEY **eckeys,
+		int *results, int num);
+static int ecdsa_sign_setup_batch(EC_KEY *eckey, BN_CTX *ctx_in,
+		BIGNUM **kinvp, BIGNUM **rp, int num);
 
 static ECDSA_METHOD openssl_ecdsa_meth = {
 	"OpenSSL ECDSA method",
@@ -84,7 +90,9 @@ static ECDSA_METHOD openssl_ecdsa_meth = {
 	NULL, /* finish   */
 #endif
 	ECDSA_FLAG_FIPS_METHOD,    /* flags    */
-	NULL  /* app_data */
+	NULL, /* app_data */
+	ecdsa_do_verify_batch,
+	ecdsa_sign_setup_batch
 };
 
 const ECDSA_METHOD *ECDSA_OpenSSL(void)
@@ -97,6 +105,85 @@ static int ecdsa_sign_setup_no_digest(EC_KEY *eckey,
 	return ecdsa_sign_setup(eckey, ctx_in, kinvp, rp, NULL, 0);
 }
 
+/* Picks a random k, returned in a form of fixed bit-length, and sets point
+ * to k * generator. */
+static int ecdsa_k_point(EC_KEY *eckey, const EC_GROUP *group,
+		const BIGNUM *order, BIGNUM *k, EC_POINT *point,
+		const unsigned char *dgst, int dlen, BN_CTX *ctx)
+{
+	/* get random k */	
+	do
+#ifndef OPENSSL_NO_SHA512
+		if (dgst != NULL)
+		{
+			if (!BN_generate_dsa_nonce(k, order, EC_KEY_get0_private_key(eckey),
+						   dgst, dlen, ctx))
+				{
+				ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,
+					 ECDSA_R_RANDOM_NUMBER_GENERATION_FAILED);
+				return 0;
+				}
+		}
+		else
+#endif
+		{
+			if (!BN_rand_range(k, order))
+			{
+				ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,
+					 ECDSA_R_RANDOM_NUMBER_GENERATION_FAILED);
+				return 0;
+			}
+		}
+	while (BN_is_zero(k));
+
+	/* We do not want timing information to leak the length of k,
+	 * so we compute G*k using an equivalent scalar of fixed
+	 * bit-length. */
+
+	if (!BN_add(k, k, order)) return 0;
+	if (BN_num_bits(k) <= BN_num_bits(order))
+		if (!BN_add(k, k, order)) return 0;
+
+	if (!EC_POINT_mul(group, point, k, NULL, NULL, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_EC_LIB);
+		return 0;
+	}
+	return 1;
+}
+
+/* Sets r to the x-coordinate of point reduced modulo order */
+static int ecdsa_point_r(const EC_GROUP *group, const EC_POINT *point,
+		const BIGNUM *order, BIGNUM *r, BIGNUM *X, BN_CTX *ctx)
+{
+	if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field)
+	{
+		if (!EC_POINT_get_affine_coordinates_GFp(group,
+			point, X, NULL, ctx))
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,ERR_R_EC_LIB);
+			return 0;
+		}
+	}
+#ifndef OPENSSL_NO_EC2M
+	else /* NID_X9_62_characteristic_two_field */
+	{
+		if (!EC_POINT_get_affine_coordinates_GF2m(group,
+			point, X, NULL, ctx))
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,ERR_R_EC_LIB);
+			return 0;
+		}
+	}
+#endif
+	if (!BN_nnmod(r, X, order, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
+		return 0;
+	}
+	return 1;
+}
+
 static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
 					BIGNUM **kinvp, BIGNUM **rp,
 					const unsigned char *dgst, int dlen)
@@ -146,104 +233,21 @@ static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
 
 	do
 	{
-		/* get random k */	
-		do
-#ifndef OPENSSL_NO_SHA512
-			if (dgst != NULL)
-			{
-				if (!BN_generate_dsa_nonce(k, order, EC_KEY_get0_private_key(eckey),
-							   dgst, dlen, ctx))
-					{
-					ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,
-						 ECDSA_R_RANDOM_NUMBER_GENERATION_FAILED);
-					goto err;
-					}
-			}
-			else
-#endif
-			{
-				if (!BN_rand_range(k, order))
-				{
-					ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,
-						 ECDSA_R_RANDOM_NUMBER_GENERATION_FAILED);
-					goto err;
-				}
-			}
-		while (BN_is_zero(k));
-
-		/* We do not want timing information to leak the length of k,
-		 * so we compute G*k using an equivalent scalar of fixed
-		 * bit-length. */
-
-		if (!BN_add(k, k, order)) goto err;
-		if (BN_num_bits(k) <= BN_num_bits(order))
-			if (!BN_add(k, k, order)) goto err;
-
 		/* compute r the x-coordinate of generator * k */
-		if (!EC_POINT_mul(group, tmp_point, k, NULL, NULL, ctx))
-		{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_EC_LIB);
+		if (!ecdsa_k_point(eckey, group, order, k, tmp_point,
+							dgst, dlen, ctx))
 			goto err;
-		}
-		if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field)
-		{
-			if (!EC_POINT_get_affine_coordinates_GFp(group,
-				tmp_point, X, NULL, ctx))
-			{
-				ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,ERR_R_EC_LIB);
-				goto err;
-			}
-		}
-#ifndef OPENSSL_NO_EC2M
-		else /* NID_X9_62_characteristic_two_field */
-		{
-			if (!EC_POINT_get_affine_coordinates_GF2m(group,
-				tmp_point, X, NULL, ctx))
-			{
-				ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP,ERR_R_EC_LIB);
-				goto err;
-			}
-		}
-#endif
-		if (!BN_nnmod(r, X, order, ctx))
-		{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
+		if (!ecdsa_point_r(group, tmp_point, order, r, X, ctx))
 			goto err;
-		}
 	}
 	while (BN_is_zero(r));
 
 	/* compute the inverse of k */
-	if (EC_GROUP_get_mont_data(group) != NULL)
-		{
-		/* We want inverse in constant time, therefore we utilize the
-		 * fact order must be prime and use Fermats Little Theorem
-		 * instead. */
-		if (!BN_set_word(X, 2) )
-			{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
-			goto err;
-			}
-		if (!BN_mod_sub(X, order, X, order, ctx))
-			{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
-			goto err;
-			}
-		BN_set_flags(X, BN_FLG_CONSTTIME);
-		if (!BN_mod_exp_mont_consttime(k, k, X, order, ctx, EC_GROUP_get_mont_data(group)))
-			{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
-			goto err;
-			}
-		}
-	else
-		{
-		if (!BN_mod_inverse(k, k, order, ctx))
-			{
-			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_BN_LIB);
-			goto err;	
-			}
-		}
+	if (!EC_GROUP_do_inverse_ord(group, k, k, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP, ERR_R_EC_LIB);
+		goto err;
+	}
 
 	/* clear old values if necessary */
 	if (*rp != NULL)
@@ -271,6 +275,173 @@ err:
 	return(ret);
 }
 
+/* Computes num (kinv, r) pairs together: the points k * generator are
+ * converted to affine coordinates with a single field inversion, and the
+ * k are inverted with a single inversion modulo the order, using
+ * Montgomery's trick for both.
+ */
+static int ecdsa_sign_setup_batch(EC_KEY *eckey, BN_CTX *ctx_in,
+		BIGNUM **kinvp, BIGNUM **rp, int num)
+{
+	BN_CTX   *ctx = NULL;
+	BIGNUM	 **k = NULL, **r = NULL, **prod = NULL;
+	BIGNUM	 *order = NULL, *X = NULL, *inv = NULL, *tmp = NULL;
+	EC_POINT **points = NULL;
+	const EC_GROUP *group;
+	int 	 i, ret = 0;
+
+	if (eckey == NULL || (group = EC_KEY_get0_group(eckey)) == NULL)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	if (num <= 0)
+		return 1;
+
+	if (ctx_in == NULL) 
+	{
+		if ((ctx = BN_CTX_new()) == NULL)
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH,ERR_R_MALLOC_FAILURE);
+			return 0;
+		}
+	}
+	else
+		ctx = ctx_in;
+
+	k = OPENSSL_malloc(num * (3 * sizeof(BIGNUM *) + sizeof(EC_POINT *)));
+	if (k == NULL)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	memset(k, 0, num * (3 * sizeof(BIGNUM *) + sizeof(EC_POINT *)));
+	/* k[i] and r[i] are later returned in kinvp[i] and rp[i] */
+	r      = k + num;
+	prod   = r + num;
+	points = (EC_POINT **)(prod + num);
+
+	order = BN_new();
+	X     = BN_new();
+	inv   = BN_new();
+	tmp   = BN_new();
+	if (!order || !X || !inv || !tmp)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	for (i = 0; i < num; i++)
+	{
+		k[i] = BN_new();
+		r[i] = BN_new();
+		prod[i] = BN_new();
+		points[i] = EC_POINT_new(group);
+		if (!k[i] || !r[i] || !prod[i] || !points[i])
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_MALLOC_FAILURE);
+			goto err;
+		}
+	}
+	if (!EC_GROUP_get_order(group, order, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_EC_LIB);
+		goto err;
+	}
+
+	for (i = 0; i < num; i++)
+		if (!ecdsa_k_point(eckey, group, order, k[i], points[i],
+							NULL, 0, ctx))
+			goto err;
+	if (!EC_POINTs_make_affine(group, num, points, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_EC_LIB);
+		goto err;
+	}
+	for (i = 0; i < num; i++)
+	{
+		if (!ecdsa_point_r(group, points[i], order, r[i], X, ctx))
+			goto err;
+		/* r == 0 is too unlikely to be worth batching again */
+		while (BN_is_zero(r[i]))
+		{
+			if (!ecdsa_k_point(eckey, group, order, k[i],
+						points[i], NULL, 0, ctx))
+				goto err;
+			if (!ecdsa_point_r(group, points[i], order, r[i],
+								X, ctx))
+				goto err;
+		}
+	}
+
+	/* prod[i] is the product of k[0] .. k[i] */
+	if (!BN_nnmod(prod[0], k[0], order, ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_BN_LIB);
+		goto err;
+	}
+	for (i = 1; i < num; i++)
+		if (!BN_mod_mul(prod[i], prod[i - 1], k[i], order, ctx))
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_BN_LIB);
+			goto err;
+		}
+
+	if (!EC_GROUP_do_inverse_ord(group, inv, prod[num - 1], ctx))
+	{
+		ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_EC_LIB);
+		goto err;
+	}
+
+	for (i = num - 1; i > 0; i--)
+	{
+		/* inv is the inverse of prod[i] */
+		if (!BN_mod_mul(tmp, inv, k[i], order, ctx) ||
+		    !BN_mod_mul(k[i], inv, prod[i - 1], order, ctx))
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SIGN_SETUP_BATCH, ERR_R_BN_LIB);
+			goto err;
+		}
+		BN_swap(inv, tmp);
+	}
+	BN_swap(k[0], inv);
+
+	/* clear old values if necessary and save the pre-computed values */
+	for (i = 0; i < num; i++)
+	{
+		if (rp[i] != NULL)
+			BN_clear_free(rp[i]);
+		if (kinvp[i] != NULL)
+			BN_clear_free(kinvp[i]);
+		rp[i]    = r[i];
+		kinvp[i] = k[i];
+		r[i] = k[i] = NULL;
+	}
+	ret = 1;
+err:
+	if (k != NULL)
+	{
+		for (i = 0; i < num; i++)
+		{
+			BN_clear_free(k[i]);
+			BN_clear_free(r[i]);
+			BN_clear_free(prod[i]);
+			EC_POINT_clear_free(points[i]);
+		}
+		OPENSSL_free(k);
+	}
+	if (ctx_in == NULL) 
+		BN_CTX_free(ctx);
+	if (order != NULL)
+		BN_free(order);
+	if (X)
+		BN_clear_free(X);
+	if (inv)
+		BN_clear_free(inv);
+	if (tmp)
+		BN_clear_free(tmp);
+	return(ret);
+}
+
 
 static ECDSA_SIG *ecdsa_do_sign(const unsigned char *dgst, int dgst_len, 
 		const BIGNUM *in_kinv, const BIGNUM *in_r, EC_KEY *eckey)
@@ -455,9 +626,9 @@ static int ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
 		goto err;
 	}
 	/* calculate tmp1 = inv(S) mod order */
-	if (!BN_mod_inverse(u2, sig->s, order, ctx))
+	if (!EC_GROUP_do_inverse_ord(group, u2, sig->s, ctx))
 	{
-		ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY, ERR_R_BN_LIB);
+		ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY, ERR_R_EC_LIB);
 		goto err;
 	}
 	/* digest -> m */
@@ -535,3 +706,193 @@ err:
 		EC_POINT_free(point);
 	return ret;
 }
+
+/* Verifies the signatures on the group of the first one with a single
+ * inversion modulo the order, using Montgomery's trick, and converts all
+ * the points u1 * G + u2 * Q to affine coordinates with a single field
+ * inversion. Signatures on other groups, and those that could not be
+ * verified for any reason, are passed to the verify function of the
+ * method of their key, which need not be ecdsa_do_verify().
+ */
+static int ecdsa_do_verify_batch(const unsigned char **dgsts,
+		const int *dgst_lens, ECDSA_SIG **sigs, EC_KEY **eckeys,
+		int *results, int num)
+{
+	int ret = 1, i, k, n = 0, bits, dgst_len;
+	BN_CTX   *ctx = NULL;
+	BIGNUM   *order, *m, *X, *inv, **w = NULL;
+	EC_POINT **points = NULL;
+	const EC_GROUP *group = NULL, *g;
+	int      *idx = NULL;
+
+	/* -2 marks the signatures still to be verified */
+	for (i = 0; i < num; i++)
+		results[i] = -2;
+
+	ctx = BN_CTX_new();
+	if (!ctx)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	BN_CTX_start(ctx);
+	idx = OPENSSL_malloc(num * sizeof(int));
+	w = OPENSSL_malloc(num * sizeof(BIGNUM *));
+	points = OPENSSL_malloc(num * sizeof(EC_POINT *));
+	if (!idx || !w || !points)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+		goto err;
+	}
+	order = BN_CTX_get(ctx);
+	m     = BN_CTX_get(ctx);
+	X     = BN_CTX_get(ctx);
+	inv   = BN_CTX_get(ctx);
+	if (!inv)
+	{
+		ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY_BATCH, ERR_R_BN_LIB);
+		goto err;
+	}
+
+	for (i = 0; i < num; i++)
+	{
+		if (eckeys[i] == NULL || sigs[i] == NULL ||
+		    (g = EC_KEY_get0_group(eckeys[i])) == NULL ||
+		    EC_KEY_get0_public_key(eckeys[i]) == NULL)
+			continue;
+		if (group == NULL)
+		{
+			if (!EC_GROUP_get_order(g, order, ctx))
+				continue;
+			group = g;
+		}
+		else if (g != group && EC_GROUP_cmp(group, g, ctx) != 0)
+			continue;
+
+		if (BN_is_zero(sigs[i]->r)          ||
+		    BN_is_negative(sigs[i]->r)      ||
+		    BN_ucmp(sigs[i]->r, order) >= 0 ||
+		    BN_is_zero(sigs[i]->s)          ||
+		    BN_is_negative(sigs[i]->s)      ||
+		    BN_ucmp(sigs[i]->s, order) >= 0)
+		{
+			ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY_BATCH,
+				ECDSA_R_BAD_SIGNATURE);
+			results[i] = 0;	/* signature is invalid */
+			continue;
+		}
+		idx[n] = i;
+		points[n] = NULL;
+		n++;
+	}
+	if (n < 2)
+		goto err;
+
+	/* w[k] = s[0] * ... * s[k] mod order */
+	for (k = 0; k < n; k++)
+	{
+		if ((w[k] = BN_CTX_get(ctx)) == NULL)
+			goto err;
+		if (k == 0)
+		{
+			if (!BN_copy(w[k], sigs[idx[k]]->s))
+				goto err;
+		}
+		else if (!BN_mod_mul(w[k], w[k - 1], sigs[idx[k]]->s,
+							order, ctx))
+			goto err;
+	}
+	if (!EC_GROUP_do_inverse_ord(group, inv, w[n - 1], ctx))
+		goto err;
+	/* then, from the last one, w[k] = inv(s[k]) mod order */
+	for (k = n - 1; k > 0; k--)
+	{
+		if (!BN_mod_mul(w[k], inv, w[k - 1], order, ctx) ||
+		    !BN_mod_mul(inv, inv, sigs[idx[k]]->s, order, ctx))
+			goto err;
+	}
+	if (!BN_copy(w[0], inv))
+		goto err;
+
+	bits = BN_num_bits(order);
+	for (k = 0; k < n; k++)
+	{
+		i = idx[k];
+		/* digest -> m, truncated as in ecdsa_do_verify() */
+		dgst_len = dgst_lens[i];
+		if (8 * dgst_len > bits)
+			dgst_len = (bits + 7)/8;
+		if (!BN_bin2bn(dgsts[i], dgst_len, m))
+			goto err;
+		if ((8 * dgst_len > bits) && !BN_rshift(m, m, 8 - (bits & 0x7)))
+			goto err;
+		/* u1 = m * w mod order, u2 = r * w mod order */
+		if (!BN_mod_mul(m, m, w[k], order, ctx) ||
+		    !BN_mod_mul(w[k], sigs[i]->r, w[k], order, ctx))
+			goto err;
+		if ((points[k] = EC_POINT_new(group)) == NULL)
+			goto err;
+		if (!EC_POINT_mul(group, points[k], m,
+				EC_KEY_get0_public_key(eckeys[i]), w[k], ctx))
+			goto err;
+	}
+	if (!EC_POINTs_make_affine(group, n, points, ctx))
+		goto err;
+
+	for (k = 0; k < n; k++)
+	{
+		if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field)
+		{
+			if (!EC_POINT_get_affine_coordinates_GFp(group,
+				points[k], X, NULL, ctx))
+				continue;
+		}
+#ifndef OPENSSL_NO_EC2M
+		else /* NID_X9_62_characteristic_two_field */
+		{
+			if (!EC_POINT_get_affine_coordinates_GF2m(group,
+				points[k], X, NULL, ctx))
+				continue;
+		}
+#endif
+		if (!BN_nnmod(m, X, order, ctx))
+			goto err;
+		/* if the signature is correct m is equal to sig->r */
+		results[idx[k]] = (BN_ucmp(m, sigs[idx[k]]->r) == 0);
+	}
+err:
+	if (ctx)
+	{
+		BN_CTX_end(ctx);
+		BN_CTX_free(ctx);
+	}
+	if (points)
+	{
+		for (k = 0; k < n; k++)
+			if (points[k])
+				EC_POINT_free(points[k]);
+		OPENSSL_free(points);
+	}
+	if (w)
+		OPENSSL_free(w);
+	if (idx)
+		OPENSSL_free(idx);
+	for (i = 0; i < num; i++)
+	{
+		if (results[i] == -2)
+		{
+			if (eckeys[i] == NULL)
+			{
+				ECDSAerr(ECDSA_F_ECDSA_DO_VERIFY_BATCH,
+					ERR_R_PASSED_NULL_PARAMETER);
+				results[i] = -1;
+			}
+			else
+				results[i] = ECDSA_do_verify(dgsts[i],
+					dgst_lens[i], sigs[i], eckeys[i]);
+		}
+		if (results[i] != 1)
+			ret = 0;
+	}
+	return ret;
+}
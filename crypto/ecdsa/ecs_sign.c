@@ -53,11 +53,17 @@
  *
  */
 
+#include <string.h>
 #include "ecs_locl.h"
 #ifndef OPENSSL_NO_ENGINE
 #include <openssl/engine.h>
 #endif
 #include <openssl/rand.h>
+#include <openssl/err.h>
+#include <openssl/bn.h>
+
+static int ecdsa_precomp_get(ECDSA_DATA *ecdsa, EC_KEY *eckey,
+		BIGNUM **kinvp, BIGNUM **rp);
 
 ECDSA_SIG *ECDSA_do_sign(const unsigned char *dgst, int dlen, EC_KEY *eckey)
 {
@@ -68,8 +74,30 @@ ECDSA_SIG *ECDSA_do_sign_ex(const unsigned char *dgst, int dlen,
 	const BIGNUM *kinv, const BIGNUM *rp, EC_KEY *eckey)
 {
 	ECDSA_DATA *ecdsa = ecdsa_check(eckey);
+	BIGNUM *pkinv = NULL, *pr = NULL;
+	ECDSA_SIG *ret;
+
 	if (ecdsa == NULL)
 		return NULL;
+	if (kinv == NULL && rp == NULL && ecdsa->precomp != NULL)
+	{
+		/* Any failure here is dealt with by signing without the
+		 * queue: in particular a pair giving s == 0 cannot be used. */
+		ERR_set_mark();
+		if (ecdsa_precomp_get(ecdsa, eckey, &pkinv, &pr))
+		{
+			ret = ecdsa->meth->ecdsa_do_sign(dgst, dlen,
+						pkinv, pr, eckey);
+			BN_clear_free(pkinv);
+			BN_clear_free(pr);
+			if (ret != NULL)
+			{
+				ERR_pop_to_mark();
+				return ret;
+			}
+		}
+		ERR_pop_to_mark();
+	}
 	return ecdsa->meth->ecdsa_do_sign(dgst, dlen, kinv, rp, eckey);
 }
 
@@ -104,3 +132,199 @@ int ECDSA_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in, BIGNUM **kinvp,
 		return 0;
 	return ecdsa->meth->ecdsa_sign_setup(eckey, ctx_in, kinvp, rp);
 }
+
+int ECDSA_sign_setup_batch(EC_KEY *eckey, BN_CTX *ctx_in, BIGNUM **kinvp,
+		BIGNUM **rp, int num)
+{
+	ECDSA_DATA *ecdsa = ecdsa_check(eckey);
+	int i;
+
+	if (ecdsa == NULL)
+		return 0;
+	if (ecdsa->meth->ecdsa_sign_setup_batch != NULL)
+		return ecdsa->meth->ecdsa_sign_setup_batch(eckey, ctx_in,
+					kinvp, rp, num);
+	for (i = 0; i < num; i++)
+		if (!ecdsa->meth->ecdsa_sign_setup(eckey, ctx_in,
+					&kinvp[i], &rp[i]))
+			return 0;
+	return 1;
+}
+
+void ecdsa_precomp_free(ECDSA_PRECOMP *precomp)
+{
+	int i;
+
+	if (precomp == NULL)
+		return;
+	for (i = 0; i < precomp->num; i++)
+	{
+		BN_clear_free(precomp->kinv[i]);
+		BN_clear_free(precomp->r[i]);
+	}
+	if (precomp->kinv != NULL)
+		OPENSSL_free(precomp->kinv);
+	if (precomp->r != NULL)
+		OPENSSL_free(precomp->r);
+	if (precomp->order != NULL)
+		BN_free(precomp->order);
+	OPENSSL_free(precomp);
+}
+
+int ECDSA_set_precompute(EC_KEY *eckey, int num)
+{
+	ECDSA_DATA *ecdsa = ecdsa_check(eckey);
+	ECDSA_PRECOMP *precomp = NULL, *old;
+	int max;
+
+	if (ecdsa == NULL)
+		return 0;
+	if (num < 0)
+		num = 0;
+
+	/* Keep the pairs already computed if the size does not change */
+	CRYPTO_r_lock(CRYPTO_LOCK_ECDSA);
+	max = ecdsa->precomp != NULL ? ecdsa->precomp->max : 0;
+	CRYPTO_r_unlock(CRYPTO_LOCK_ECDSA);
+	if (max == num)
+		return 1;
+
+	if (num > 0)
+	{
+		precomp = OPENSSL_malloc(sizeof(ECDSA_PRECOMP));
+		if (precomp == NULL)
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SET_PRECOMPUTE,
+						ERR_R_MALLOC_FAILURE);
+			return 0;
+		}
+		precomp->max = num;
+		precomp->num = 0;
+		precomp->order = BN_new();
+		precomp->kinv = OPENSSL_malloc(num * sizeof(BIGNUM *));
+		precomp->r = OPENSSL_malloc(num * sizeof(BIGNUM *));
+		if (precomp->order == NULL || precomp->kinv == NULL ||
+		    precomp->r == NULL)
+		{
+			ECDSAerr(ECDSA_F_ECDSA_SET_PRECOMPUTE,
+						ERR_R_MALLOC_FAILURE);
+			ecdsa_precomp_free(precomp);
+			return 0;
+		}
+	}
+
+	CRYPTO_w_lock(CRYPTO_LOCK_ECDSA);
+	old = ecdsa->precomp;
+	ecdsa->precomp = precomp;
+	CRYPTO_w_unlock(CRYPTO_LOCK_ECDSA);
+
+	ecdsa_precomp_free(old);
+	return 1;
+}
+
+/* Frees the pairs of precomp unless they were computed for order in this
+ * process: after a fork() parent and child would otherwise sign with the
+ * same k, which gives away the private key. */
+static void ecdsa_precomp_check(ECDSA_PRECOMP *precomp, const BIGNUM *order,
+		int generation)
+{
+	int i;
+
+	if (precomp->num == 0 || (precomp->generation == generation &&
+	    BN_cmp(precomp->order, order) == 0))
+		return;
+	for (i = 0; i < precomp->num; i++)
+	{
+		BN_clear_free(precomp->kinv[i]);
+		BN_clear_free(precomp->r[i]);
+	}
+	precomp->num = 0;
+}
+
+/* Takes a pair from the queue of eckey, first computing a new batch if
+ * the queue is empty. The batch is computed without holding the lock, so
+ * other threads may be refilling the queue at the same time: the pairs
+ * that do not fit any more are simply freed.
+ */
+static int ecdsa_precomp_get(ECDSA_DATA *ecdsa, EC_KEY *eckey,
+		BIGNUM **kinvp, BIGNUM **rp)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(eckey);
+	ECDSA_PRECOMP *precomp;
+	BIGNUM *order = NULL, **kinv = NULL, **r = NULL;
+	int i, max = 0, ret = 0, generation = CRYPTO_fork_generation();
+
+	if (group == NULL || (order = BN_new()) == NULL ||
+	    !EC_GROUP_get_order(group, order, NULL))
+		goto err;
+
+	CRYPTO_w_lock(CRYPTO_LOCK_ECDSA);
+	precomp = ecdsa->precomp;
+	if (precomp != NULL)
+	{
+		ecdsa_precomp_check(precomp, order, generation);
+		if (precomp->num > 0)
+		{
+			precomp->num--;
+			*kinvp = precomp->kinv[precomp->num];
+			*rp = precomp->r[precomp->num];
+			ret = 1;
+		}
+		max = precomp->max;
+	}
+	CRYPTO_w_unlock(CRYPTO_LOCK_ECDSA);
+	if (ret || max == 0)
+		goto err;
+
+	kinv = OPENSSL_malloc(max * sizeof(BIGNUM *));
+	r = OPENSSL_malloc(max * sizeof(BIGNUM *));
+	if (kinv == NULL || r == NULL)
+	{
+		max = 0;
+		goto err;
+	}
+	memset(kinv, 0, max * sizeof(BIGNUM *));
+	memset(r, 0, max * sizeof(BIGNUM *));
+	if (!ECDSA_sign_setup_batch(eckey, NULL, kinv, r, max))
+		goto err;
+
+	*kinvp = kinv[0];
+	*rp = r[0];
+	kinv[0] = r[0] = NULL;
+	ret = 1;
+
+	CRYPTO_w_lock(CRYPTO_LOCK_ECDSA);
+	precomp = ecdsa->precomp;
+	if (precomp != NULL)
+		ecdsa_precomp_check(precomp, order, generation);
+	if (precomp != NULL && (precomp->num > 0 ||
+	    BN_copy(precomp->order, order) != NULL))
+	{
+		precomp->generation = generation;
+		for (i = 1; i < max && precomp->num < precomp->max; i++)
+		{
+			precomp->kinv[precomp->num] = kinv[i];
+			precomp->r[precomp->num] = r[i];
+			precomp->num++;
+			kinv[i] = r[i] = NULL;
+		}
+	}
+	CRYPTO_w_unlock(CRYPTO_LOCK_ECDSA);
+
+err:
+	if (kinv != NULL)
+	{
+		for (i = 0; i < max; i++)
+			BN_clear_free(kinv[i]);
+		OPENSSL_free(kinv);
+	}
+	if (r != NULL)
+	{
+		for (i = 0; i < max; i++)
+			BN_clear_free(r[i]);
+		OPENSSL_free(r);
+	}
+	if (order != NULL)
+		BN_free(order);
+	return ret;
+}
@@ -75,6 +75,54 @@ int ECDSA_do_verify(const unsigned char *dgst, int dgst_len,
 	return ecdsa->meth->ecdsa_do_verify(dgst, dgst_len, sig, eckey);
 	}
 
+/* Signatures are passed to the batch function of the method of their
+ * key together with all the following ones with the same method; the
+ * others are verified one at a time.
+ */
+int ECDSA_do_verify_batch(const unsigned char **dgsts, const int *dgst_lens,
+		ECDSA_SIG **sigs, EC_KEY **eckeys, int *results, int num)
+	{
+	ECDSA_DATA *ecdsa;
+	int i, j, ret = 1;
+
+	for (i = 0; i < num; i += j)
+		{
+		ecdsa = ecdsa_check(eckeys[i]);
+		if (ecdsa == NULL)
+			{
+			results[i] = 0;
+			j = 1;
+			}
+		else if (ecdsa->meth->ecdsa_do_verify_batch == NULL)
+			{
+			results[i] = ecdsa->meth->ecdsa_do_verify(dgsts[i],
+					dgst_lens[i], sigs[i], eckeys[i]);
+			j = 1;
+			}
+		else
+			{
+			for (j = 1; i + j < num; j++)
+				{
+				ECDSA_DATA *next = ecdsa_check(eckeys[i + j]);
+				if (next == NULL || next->meth != ecdsa->meth)
+					break;
+				}
+			if (j == 1)
+				results[i] = ecdsa->meth->ecdsa_do_verify(
+					dgsts[i], dgst_lens[i], sigs[i],
+					eckeys[i]);
+			else
+				ecdsa->meth->ecdsa_do_verify_batch(dgsts + i,
+					dgst_lens + i, sigs + i, eckeys + i,
+					results + i, j);
+			}
+		}
+	for (i = 0; i < num; i++)
+		if (results[i] != 1)
+			ret = 0;
+	return ret;
+	}
+
 /* returns
  *      1: correct signature
  *      0: incorrect signature
@@ -69,7 +69,7 @@ int engine_unlocked_init(ENGINE *e)
 		{
 		/* OK, we return a functional reference which is also a
 		 * structural reference. */
-		e->struct_ref++;
+		CRYPTO_add_locked(&e->struct_ref,1);
 		e->funct_ref++;
 		engine_ref_debug(e, 0, 1)
 		engine_ref_debug(e, 1, 1)
@@ -132,6 +132,40 @@ int ENGINE_init(ENGINE *e)
 	return ret;
 	}
 
+/* Release a functional reference that is not the last one, with
+ * CRYPTO_LOCK_ENGINE only held for reading so that, for example, the
+ * ENGINE_finish() of every EVP_CIPHER_CTX using an ENGINE does not
+ * serialise. Writers change the counts with the lock held for writing, so
+ * only readers doing the same race with this. Returns 0 if the write lock
+ * is needed. */
+static int engine_shared_finish(ENGINE *e)
+	{
+	int ret = 0;
+#ifdef CRYPTO_ATOMIC_CAS
+	int n;
+
+	/* Checks that struct_ref can be changed atomically */
+	if(!CRYPTO_add_atomic(&e->struct_ref, 0, &n))
+		return 0;
+	CRYPTO_r_lock(CRYPTO_LOCK_ENGINE);
+	while((n = e->funct_ref) > 1)
+		{
+		if(CRYPTO_ATOMIC_CAS(&e->funct_ref, n, n - 1))
+			{
+			/* The structural reference that goes with it is not
+			 * the last one either. */
+			CRYPTO_add_atomic(&e->struct_ref, -1, &n);
+			engine_ref_debug(e, 1, -1)
+			engine_ref_debug(e, 0, -1)
+			ret = 1;
+			break;
+			}
+		}
+	CRYPTO_r_unlock(CRYPTO_LOCK_ENGINE);
+#endif
+	return ret;
+	}
+
 /* The API (locked) version of "finish" */
 int ENGINE_finish(ENGINE *e)
 	{
@@ -142,6 +176,8 @@ int ENGINE_finish(ENGINE *e)
 		ENGINEerr(ENGINE_F_ENGINE_FINISH,ERR_R_PASSED_NULL_PARAMETER);
 		return 0;
 		}
+	if(engine_shared_finish(e))
+		return 1;
 	CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
 	to_return = engine_unlocked_finish(e, 1);
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -115,7 +115,7 @@ int engine_free_util(ENGINE *e, int locked)
 	if(locked)
 		i = CRYPTO_add(&e->struct_ref,-1,CRYPTO_LOCK_ENGINE);
 	else
-		i = --e->struct_ref;
+		i = CRYPTO_add_locked(&e->struct_ref,-1);
 	engine_ref_debug(e, 0, -1)
 	if (i > 0) return 1;
 #ifdef REF_CHECK
@@ -146,7 +146,7 @@ static int engine_list_add(ENGINE *e)
 		}
 	/* Having the engine in the list assumes a structural
 	 * reference. */
-	e->struct_ref++;
+	CRYPTO_add_locked(&e->struct_ref,1);
 	engine_ref_debug(e, 0, 1)
 	/* However it came to be, e is the last item in the list. */
 	engine_list_tail = e;
@@ -197,7 +197,7 @@ ENGINE *ENGINE_get_first(void)
 	ret = engine_list_head;
 	if(ret)
 		{
-		ret->struct_ref++;
+		CRYPTO_add_locked(&ret->struct_ref,1);
 		engine_ref_debug(ret, 0, 1)
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -212,7 +212,7 @@ ENGINE *ENGINE_get_last(void)
 	ret = engine_list_tail;
 	if(ret)
 		{
-		ret->struct_ref++;
+		CRYPTO_add_locked(&ret->struct_ref,1);
 		engine_ref_debug(ret, 0, 1)
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -234,7 +234,7 @@ ENGINE *ENGINE_get_next(ENGINE *e)
 	if(ret)
 		{
 		/* Return a valid structural refernce to the next ENGINE */
-		ret->struct_ref++;
+		CRYPTO_add_locked(&ret->struct_ref,1);
 		engine_ref_debug(ret, 0, 1)
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -257,7 +257,7 @@ ENGINE *ENGINE_get_prev(ENGINE *e)
 	if(ret)
 		{
 		/* Return a valid structural reference to the next ENGINE */
-		ret->struct_ref++;
+		CRYPTO_add_locked(&ret->struct_ref,1);
 		engine_ref_debug(ret, 0, 1)
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -379,7 +379,7 @@ ENGINE *ENGINE_by_id(const char *id)
 			}
 		else
 			{
-			iterator->struct_ref++;
+			CRYPTO_add_locked(&iterator->struct_ref,1);
 			engine_ref_debug(iterator, 0, 1)
 			}
 		}
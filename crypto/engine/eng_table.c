@@ -72,10 +72,23 @@ typedef struct st_engine_pile
 
 DECLARE_LHASH_OF(ENGINE_PILE);
 
+/* The piles of a table sorted by nid. An index is not modified once it is
+ * published, so engine_table_select() can search it without a lock. Piles
+ * are only freed with the table. Indexes that were replaced are kept until
+ * no lookup is searching without a lock, see int_index_reclaim(). */
+typedef struct st_engine_pile_index
+	{
+	/* The index this one replaced */
+	struct st_engine_pile_index *prev;
+	int num;
+	ENGINE_PILE **piles;
+	} ENGINE_PILE_INDEX;
+
 /* The type exposed in eng_int.h */
 struct st_engine_table
 	{
-	LHASH_OF(ENGINE_PILE) piles;
+	LHASH_OF(ENGINE_PILE) *piles;
+	ENGINE_PILE_INDEX *index;
 	}; /* ENGINE_TABLE */
 
 
@@ -86,6 +99,13 @@ typedef struct st_engine_pile_doall
 	} ENGINE_PILE_DOALL;
 	
 
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+/* The number of engine_table_select() calls searching an index without a
+ * lock. Replaced indexes and the tables themselves are only freed when it is
+ * zero. */
+static int index_readers = 0;
+#endif
+
 /* Global flags (ENGINE_TABLE_FLAG_***). */
 static unsigned int table_flags = 0;
 
@@ -115,22 +135,113 @@ static IMPLEMENT_LHASH_COMP_FN(engine_pile, ENGINE_PILE)
 
 static int int_table_check(ENGINE_TABLE **t, int create)
 	{
-	LHASH_OF(ENGINE_PILE) *lh;
+	ENGINE_TABLE *ret;
 
 	if(*t) return 1;
 	if(!create) return 0;
-	if((lh = lh_ENGINE_PILE_new()) == NULL)
+	if((ret = OPENSSL_malloc(sizeof(ENGINE_TABLE))) == NULL)
+		return 0;
+	if((ret->piles = lh_ENGINE_PILE_new()) == NULL)
+		{
+		OPENSSL_free(ret);
+		return 0;
+		}
+	ret->index = NULL;
+	/* Lookups read '*t' without a lock, publish it only once set up */
+#ifdef CRYPTO_ATOMIC_STORE_PTR
+	CRYPTO_ATOMIC_STORE_PTR(t, ret);
+#else
+	*t = ret;
+#endif
+	return 1;
+	}
+
+static void int_index_cb_doall_arg(ENGINE_PILE *pile, ENGINE_PILE_INDEX *idx)
+	{
+	idx->piles[idx->num++] = pile;
+	}
+static IMPLEMENT_LHASH_DOALL_ARG_FN(int_index_cb, ENGINE_PILE, ENGINE_PILE_INDEX)
+
+static int int_index_cmp(const void *a, const void *b)
+	{
+	return (*(ENGINE_PILE * const *)a)->nid -
+		(*(ENGINE_PILE * const *)b)->nid;
+	}
+
+/* Free the indexes the current one of 't' replaced, unless a lookup may
+ * still be searching them: those are left for the next update or for
+ * ENGINE_cleanup(). Lookups without a lock count themselves in
+ * 'index_readers' before they load an index, and the addition below reads
+ * the count after the new index was published, so any lookup it misses
+ * finds the new index. Called with CRYPTO_LOCK_ENGINE held. */
+static void int_index_reclaim(ENGINE_TABLE *t)
+	{
+	ENGINE_PILE_INDEX *idx, *prev;
+
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+	if(CRYPTO_ATOMIC_ADD(&index_readers, 0) != 0)
+		return;
+#endif
+	for(idx = t->index->prev; idx; idx = prev)
+		{
+		prev = idx->prev;
+		OPENSSL_free(idx);
+		}
+	t->index->prev = NULL;
+	}
+
+/* Replace the index of 't' after piles were added. Called with
+ * CRYPTO_LOCK_ENGINE held. */
+static int int_index_update(ENGINE_TABLE *t)
+	{
+	ENGINE_PILE_INDEX *idx;
+	unsigned long num = lh_ENGINE_PILE_num_items(t->piles);
+
+	idx = OPENSSL_malloc(sizeof(ENGINE_PILE_INDEX) +
+				num * sizeof(ENGINE_PILE *));
+	if(!idx)
 		return 0;
-	*t = (ENGINE_TABLE *)lh;
+	idx->prev = t->index;
+	idx->num = 0;
+	idx->piles = (ENGINE_PILE **)(idx + 1);
+	lh_ENGINE_PILE_doall_arg(t->piles, LHASH_DOALL_ARG_FN(int_index_cb),
+				 ENGINE_PILE_INDEX, idx);
+	qsort(idx->piles, idx->num, sizeof(ENGINE_PILE *), int_index_cmp);
+#ifdef CRYPTO_ATOMIC_STORE_PTR
+	CRYPTO_ATOMIC_STORE_PTR(&t->index, idx);
+#else
+	t->index = idx;
+#endif
+	int_index_reclaim(t);
 	return 1;
 	}
 
+static ENGINE_PILE *int_index_find(const ENGINE_PILE_INDEX *idx, int nid)
+	{
+	int lo = 0, hi, mid;
+
+	if(!idx)
+		return NULL;
+	hi = idx->num;
+	while(lo < hi)
+		{
+		mid = lo + (hi - lo) / 2;
+		if(idx->piles[mid]->nid == nid)
+			return idx->piles[mid];
+		if(idx->piles[mid]->nid < nid)
+			lo = mid + 1;
+		else
+			hi = mid;
+		}
+	return NULL;
+	}
+
 /* Privately exposed (via eng_int.h) functions for adding and/or removing
  * ENGINEs from the implementation table */
 int engine_table_register(ENGINE_TABLE **table, ENGINE_CLEANUP_CB *cleanup,
 		ENGINE *e, const int *nids, int num_nids, int setdefault)
 	{
-	int ret = 0, added = 0;
+	int ret = 0, added = 0, new_piles = 0;
 	ENGINE_PILE tmplate, *fnd;
 	CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
 	if(!(*table))
@@ -143,7 +254,7 @@ int engine_table_register(ENGINE_TABLE **table, ENGINE_CLEANUP_CB *cleanup,
 	while(num_nids--)
 		{
 		tmplate.nid = *nids;
-		fnd = lh_ENGINE_PILE_retrieve(&(*table)->piles, &tmplate);
+		fnd = lh_ENGINE_PILE_retrieve((*table)->piles, &tmplate);
 		if(!fnd)
 			{
 			fnd = OPENSSL_malloc(sizeof(ENGINE_PILE));
@@ -157,7 +268,14 @@ int engine_table_register(ENGINE_TABLE **table, ENGINE_CLEANUP_CB *cleanup,
 				goto end;
 				}
 			fnd->funct = NULL;
-			(void)lh_ENGINE_PILE_insert(&(*table)->piles, fnd);
+			(void)lh_ENGINE_PILE_insert((*table)->piles, fnd);
+			if(lh_ENGINE_PILE_error((*table)->piles))
+				{
+				sk_ENGINE_free(fnd->sk);
+				OPENSSL_free(fnd);
+				goto end;
+				}
+			new_piles = 1;
 			}
 		/* A registration shouldn't add duplciate entries */
 		(void)sk_ENGINE_delete_ptr(fnd->sk, e);
@@ -183,6 +301,8 @@ int engine_table_register(ENGINE_TABLE **table, ENGINE_CLEANUP_CB *cleanup,
 		}
 	ret = 1;
 end:
+	if(new_piles && !int_index_update(*table))
+		ret = 0;
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
 	return ret;
 	}
@@ -207,7 +327,7 @@ void engine_table_unregister(ENGINE_TABLE **table, ENGINE *e)
 	{
 	CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
 	if(int_table_check(table, 0))
-		lh_ENGINE_PILE_doall_arg(&(*table)->piles,
+		lh_ENGINE_PILE_doall_arg((*table)->piles,
 					 LHASH_DOALL_ARG_FN(int_unregister_cb),
 					 ENGINE, e);
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -224,17 +344,50 @@ static IMPLEMENT_LHASH_DOALL_FN(int_cleanup_cb, ENGINE_PILE)
 
 void engine_table_cleanup(ENGINE_TABLE **table)
 	{
+	ENGINE_TABLE *t;
+	ENGINE_PILE_INDEX *idx, *prev;
+
 	CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
-	if(*table)
+	t = *table;
+	if(t)
 		{
-		lh_ENGINE_PILE_doall(&(*table)->piles,
-				     LHASH_DOALL_FN(int_cleanup_cb));
-		lh_ENGINE_PILE_free(&(*table)->piles);
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+		/* Unpublish the table, then wait for the lookups that may
+		 * have found it before: they hold no lock and only search an
+		 * index, so they finish promptly. */
+		CRYPTO_ATOMIC_STORE_PTR(table, NULL);
+		while(CRYPTO_ATOMIC_ADD(&index_readers, 0) != 0)
+			continue;
+#else
 		*table = NULL;
+#endif
+		lh_ENGINE_PILE_doall(t->piles, LHASH_DOALL_FN(int_cleanup_cb));
+		lh_ENGINE_PILE_free(t->piles);
+		for(idx = t->index; idx; idx = prev)
+			{
+			prev = idx->prev;
+			OPENSSL_free(idx);
+			}
+		OPENSSL_free(t);
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
 	}
 
+/* Take another functional reference to 'e', to which the table holds one,
+ * with CRYPTO_LOCK_ENGINE held for reading. Only possible if reference
+ * counts can be updated atomically. */
+static int int_shared_init(ENGINE *e)
+	{
+	int n;
+
+	if(!CRYPTO_add_atomic(&e->funct_ref, 1, &n))
+		return 0;
+	CRYPTO_add_atomic(&e->struct_ref, 1, &n);
+	engine_ref_debug(e, 0, 1)
+	engine_ref_debug(e, 1, 1)
+	return 1;
+	}
+
 /* return a functional reference for a given 'nid' */
 #ifndef ENGINE_TABLE_DEBUG
 ENGINE *engine_table_select(ENGINE_TABLE **table, int nid)
@@ -244,23 +397,67 @@ ENGINE *engine_table_select_tmp(ENGINE_TABLE **table, int nid, const char *f, in
 	{
 	ENGINE *ret = NULL;
 	ENGINE_PILE tmplate, *fnd=NULL;
-	int initres, loop = 0;
+	ENGINE_TABLE *t;
+	int initres, loop = 0, done = 0;
 
-	if(!(*table))
+	/* Most lookups are for a 'nid' that no ENGINE registered, or find the
+	 * default cached by an earlier lookup. Neither needs the write lock,
+	 * and with atomic operations the first needs no lock at all: while
+	 * the lookup is counted in 'index_readers', neither the table nor the
+	 * index it finds is freed. */
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+	CRYPTO_ATOMIC_ADD(&index_readers, 1);
+	t = CRYPTO_ATOMIC_LOAD_PTR(table);
+	if(t && !int_index_find(CRYPTO_ATOMIC_LOAD_PTR(&t->index), nid))
+		done = 1;
+	CRYPTO_ATOMIC_ADD(&index_readers, -1);
+#else
+	t = *table;
+#endif
+	if(!t || done)
 		{
 #ifdef ENGINE_TABLE_DEBUG
-		fprintf(stderr, "engine_table_dbg: %s:%d, nid=%d, nothing "
-			"registered!\n", f, l, nid);
+		if(!t)
+			fprintf(stderr, "engine_table_dbg: %s:%d, nid=%d, "
+				"nothing registered!\n", f, l, nid);
 #endif
 		return NULL;
 		}
+	CRYPTO_r_lock(CRYPTO_LOCK_ENGINE);
+	/* Look the pile up again now that the table cannot be freed */
+	if(int_table_check(table, 0))
+		fnd = int_index_find((*table)->index, nid);
+	if(!fnd)
+		done = 1;
+	else if(fnd->funct)
+		{
+		if(int_shared_init(fnd->funct))
+			{
+			ret = fnd->funct;
+			done = 1;
+			}
+		}
+	else if(fnd->uptodate)
+		done = 1;
+	CRYPTO_r_unlock(CRYPTO_LOCK_ENGINE);
+	if(done)
+		{
+#ifdef ENGINE_TABLE_DEBUG
+		fprintf(stderr, "engine_table_dbg: %s:%d, nid=%d, using "
+			"cached %s%s\n", f, l, nid, ret ? "ENGINE " : "no ENGINE",
+			ret ? ret->id : "");
+#endif
+		return ret;
+		}
+	fnd = NULL;
+
 	ERR_set_mark();
 	CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
 	/* Check again inside the lock otherwise we could race against cleanup
 	 * operations. But don't worry about a fprintf(stderr). */
 	if(!int_table_check(table, 0)) goto end;
 	tmplate.nid = nid;
-	fnd = lh_ENGINE_PILE_retrieve(&(*table)->piles, &tmplate);
+	fnd = lh_ENGINE_PILE_retrieve((*table)->piles, &tmplate);
 	if(!fnd) goto end;
 	if(fnd->funct && engine_unlocked_init(fnd->funct))
 		{
@@ -347,7 +544,7 @@ void engine_table_doall(ENGINE_TABLE *table, engine_table_doall_cb *cb,
 	dall.cb = cb;
 	dall.arg = arg;
 	if (table)
-		lh_ENGINE_PILE_doall_arg(&table->piles,
+		lh_ENGINE_PILE_doall_arg(table->piles,
 				LHASH_DOALL_ARG_FN(int_cb),
 				ENGINE_PILE_DOALL, &dall);
 	}
@@ -71,6 +71,7 @@ int main(int argc, char *argv[])
 #include <openssl/crypto.h>
 #include <openssl/engine.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
 
 static void display_engine_list(void)
 	{
@@ -92,6 +93,102 @@ static void display_engine_list(void)
 	ENGINE_free(h);
 	}
 
+static int test_digest_nids[] = { NID_sha1 };
+
+static int test_digests(ENGINE *e, const EVP_MD **digest,
+			const int **nids, int nid)
+	{
+	if(!digest)
+		{
+		*nids = test_digest_nids;
+		return 1;
+		}
+	if(nid != NID_sha1)
+		{
+		*digest = NULL;
+		return 0;
+		}
+	*digest = EVP_sha1();
+	return 1;
+	}
+
+/* Selects the ENGINE for a digest through each path of the table lookup:
+ * no table, a nid nobody registered, a registered one and the cached
+ * default. Every functional reference handed out is released with
+ * ENGINE_finish(), an imbalance leaves the ENGINE to the leak check. */
+static int engine_select_test(void)
+	{
+	ENGINE *e, *sel;
+	int loop, ret = 0;
+
+	if((e = ENGINE_new()) == NULL ||
+			!ENGINE_set_id(e, "test_select") ||
+			!ENGINE_set_name(e, "Digest select test") ||
+			!ENGINE_set_digests(e, test_digests) ||
+			!ENGINE_add(e))
+		{
+		printf("Couldn't set up digest ENGINE\n");
+		goto end;
+		}
+	if(ENGINE_get_digest_engine(NID_sha1) != NULL)
+		{
+		printf("Select found an ENGINE before registration!\n");
+		goto end;
+		}
+	if(!ENGINE_register_digests(e))
+		{
+		printf("Register failed!\n");
+		goto end;
+		}
+	for(loop = 0; loop < 2; loop++)
+		{
+		/* The second round is served by the cached default */
+		if((sel = ENGINE_get_digest_engine(NID_sha1)) != e)
+			{
+			printf("Select returned the wrong ENGINE!\n");
+			goto end;
+			}
+		if(!ENGINE_finish(sel))
+			{
+			printf("Finish failed!\n");
+			goto end;
+			}
+		if(ENGINE_get_digest_engine(NID_md5) != NULL)
+			{
+			printf("Select found an ENGINE for an unregistered "
+				"nid!\n");
+			goto end;
+			}
+		}
+	if(!ENGINE_set_default_digests(e))
+		{
+		printf("Set default failed!\n");
+		goto end;
+		}
+	if((sel = ENGINE_get_digest_engine(NID_sha1)) != e ||
+			!ENGINE_finish(sel))
+		{
+		printf("Select of the default failed!\n");
+		goto end;
+		}
+	ENGINE_unregister_digests(e);
+	if(ENGINE_get_digest_engine(NID_sha1) != NULL)
+		{
+		printf("Select found an unregistered ENGINE!\n");
+		goto end;
+		}
+	printf("Select and finish tests passed\n");
+	ret = 1;
+end:
+	if(e)
+		{
+		ENGINE_remove(e);
+		ENGINE_free(e);
+		}
+	ERR_clear_error();
+	return ret;
+	}
+
 int main(int argc, char *argv[])
 	{
 	ENGINE *block[512];
@@ -261,6 +358,9 @@ cleanup_loop:
 		OPENSSL_free((void *)ENGINE_get_id(block[loop]));
 		OPENSSL_free((void *)ENGINE_get_name(block[loop]));
 		}
+	printf("\n");
+	if(!engine_select_test())
+		goto end;
 	printf("\nTests completed happily\n");
 	to_return = 0;
 end:
@@ -237,7 +237,7 @@ const EVP_PKEY_ASN1_METHOD *ENGINE_pkey_asn1_find_str(ENGINE **pe,
 	/* If found obtain a structural reference to engine */
 	if (fstr.e)
 		{
-		fstr.e->struct_ref++;
+		CRYPTO_add_locked(&fstr.e->struct_ref,1);
 		engine_ref_debug(fstr.e, 0, 1)
 		}
 	*pe = fstr.e;
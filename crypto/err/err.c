@@ -259,6 +259,11 @@ static ERR_STATE *int_thread_get_item(const ERR_STATE *);
 static ERR_STATE *int_thread_set_item(ERR_STATE *);
 static void int_thread_del_item(const ERR_STATE *);
 static int int_err_get_next_lib(void);
+static LHASH_OF(ERR_STATE) *tls_thread_get(int create);
+static void tls_thread_release(LHASH_OF(ERR_STATE) **hash);
+static ERR_STATE *tls_thread_get_item(const ERR_STATE *);
+static ERR_STATE *tls_thread_set_item(ERR_STATE *);
+static void tls_thread_del_item(const ERR_STATE *);
 /* The static ERR_FNS table using these defaults functions */
 static const ERR_FNS err_defaults =
 	{
@@ -275,6 +280,23 @@ static const ERR_FNS err_defaults =
 	int_err_get_next_lib
 	};
 
+/* The same table, except that the error states are kept in thread-local
+ * storage rather than in "int_thread_hash" */
+static const ERR_FNS err_tls =
+	{
+	int_err_get,
+	int_err_del,
+	int_err_get_item,
+	int_err_set_item,
+	int_err_del_item,
+	tls_thread_get,
+	tls_thread_release,
+	tls_thread_get_item,
+	tls_thread_set_item,
+	tls_thread_del_item,
+	int_err_get_next_lib
+	};
+
 /* The replacable table of ERR_FNS functions we use at run-time */
 static const ERR_FNS *err_fns = NULL;
 
@@ -290,6 +312,7 @@ static LHASH_OF(ERR_STRING_DATA) *int_error_hash = NULL;
 static LHASH_OF(ERR_STATE) *int_thread_hash = NULL;
 static int int_thread_hash_references = 0;
 static int int_err_library_number= ERR_LIB_USER;
+static CRYPTO_THREAD_LOCAL *err_tls_key = NULL;
 
 /* Internal function that checks whether "err_fns" is set and if not, sets it to
  * the defaults. */
@@ -327,6 +350,33 @@ int ERR_set_implementation(const ERR_FNS *fns)
 	return ret;
 	}
 
+static void err_tls_cleanup(void *p)
+	{
+	ERR_STATE_free((ERR_STATE *)p);
+	}
+
+const ERR_FNS *ERR_get_tls_implementation(void)
+	{
+	CRYPTO_THREAD_LOCAL *key;
+
+	if (err_tls_key)
+		return &err_tls;
+	/* Create the key without holding CRYPTO_LOCK_ERR, it may allocate */
+	key = CRYPTO_THREAD_LOCAL_new(err_tls_cleanup);
+	if (key == NULL)
+		return NULL;
+	CRYPTO_w_lock(CRYPTO_LOCK_ERR);
+	if (!err_tls_key)
+		{
+		err_tls_key = key;
+		key = NULL;
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_ERR);
+	if (key)
+		CRYPTO_THREAD_LOCAL_free(key);
+	return &err_tls;
+	}
+
 /* These are the callbacks provided to "lh_new()" when creating the LHASH tables
  * internal to the "err_defaults" implementation. */
 
@@ -457,7 +507,7 @@ static LHASH_OF(ERR_STATE) *int_thread_get(int create)
 		}
 	if (int_thread_hash)
 		{
-		int_thread_hash_references++;
+		CRYPTO_add_locked(&int_thread_hash_references, 1);
 		ret = int_thread_hash;
 		}
 	CRYPTO_w_unlock(CRYPTO_LOCK_ERR);
@@ -549,6 +599,51 @@ static void int_thread_del_item(const ERR_STATE *d)
 		ERR_STATE_free(p);
 	}
 
+/* The "err_tls" functions. Each thread only ever sees its own ERR_STATE, so
+ * no locking is needed and there is no table of all error states. */
+
+static LHASH_OF(ERR_STATE) *tls_thread_get(int create)
+	{
+	return NULL;
+	}
+
+static void tls_thread_release(LHASH_OF(ERR_STATE) **hash)
+	{
+	if (hash)
+		*hash = NULL;
+	}
+
+static ERR_STATE *tls_thread_get_item(const ERR_STATE *d)
+	{
+	return (ERR_STATE *)CRYPTO_THREAD_LOCAL_get(err_tls_key);
+	}
+
+static ERR_STATE *tls_thread_set_item(ERR_STATE *d)
+	{
+	ERR_STATE *p;
+
+	p = (ERR_STATE *)CRYPTO_THREAD_LOCAL_get(err_tls_key);
+	if (!CRYPTO_THREAD_LOCAL_set(err_tls_key, d))
+		return NULL;
+	return p == d ? NULL : p;
+	}
+
+static void tls_thread_del_item(const ERR_STATE *d)
+	{
+	ERR_STATE *p;
+	CRYPTO_THREADID cur;
+
+	/* The states of other threads are released when those threads exit */
+	CRYPTO_THREADID_current(&cur);
+	if (CRYPTO_THREADID_cmp(&d->tid, &cur))
+		return;
+	p = (ERR_STATE *)CRYPTO_THREAD_LOCAL_get(err_tls_key);
+	if (p == NULL)
+		return;
+	CRYPTO_THREAD_LOCAL_set(err_tls_key, NULL);
+	ERR_STATE_free(p);
+	}
+
 static int int_err_get_next_lib(void)
 	{
 	int ret;
@@ -1060,8 +1155,6 @@ void ERR_set_error_data(char *data, int flags)
 	es=ERR_get_state();
 
 	i=es->top;
-	if (i == 0)
-		i=ERR_NUM_ERRORS-1;
 
 	err_clear_data(es,i);
 	es->err_data[i]=data;
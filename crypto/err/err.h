@@ -378,6 +378,10 @@ const ERR_FNS *ERR_get_implementation(void);
 /* A loaded module should call this function prior to any ERR operations using
  * the application's "ERR_FNS". */
 int ERR_set_implementation(const ERR_FNS *fns);
+/* Returns an "ERR_FNS" that keeps the error state of each thread in
+ * thread-local storage instead of a locked global table, or NULL if the
+ * platform has no thread-local storage. */
+const ERR_FNS *ERR_get_tls_implementation(void);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,256 @@
+/* crypto/err/err_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/* Tests for the thread-local ERR_STATE implementation: several threads
+ * push and pop errors and must only ever see their own, and the states
+ * must be released by ERR_remove_thread_state() or when threads exit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+
+#if !defined(OPENSSL_THREADS) || !defined(OPENSSL_SYS_UNIX)
+int main(int argc, char *argv[])
+	{
+	printf("No thread support, skipped\n");
+	return 0;
+	}
+#else
+
+#include <pthread.h>
+
+#define NUM_THREADS	8
+#define NUM_ROUNDS	500
+
+static pthread_mutex_t *lock_cs;
+static CRYPTO_THREADID main_tid;
+
+static void locking_cb(int mode, int type, const char *file, int line)
+	{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&lock_cs[type]);
+	else
+		pthread_mutex_unlock(&lock_cs[type]);
+	}
+
+static void thread_id_cb(CRYPTO_THREADID *tid)
+	{
+	CRYPTO_THREADID_set_numeric(tid, (unsigned long)pthread_self());
+	}
+
+/* Push n errors of thread id, with data on every other one */
+static void push_errors(int id, int n)
+	{
+	char buf[20];
+	int i;
+
+	for (i = 1; i <= n; i++)
+		{
+		ERR_put_error(ERR_LIB_USER, id, i, __FILE__, i);
+		if (i % 2 == 0)
+			{
+			BIO_snprintf(buf, sizeof(buf), "%d/%d", id, i);
+			ERR_add_error_data(1, buf);
+			}
+		}
+	}
+
+/* Pop the errors push_errors(id, n) left and check there are no others */
+static int pop_errors(int id, int n)
+	{
+	const char *file, *data;
+	char buf[20];
+	unsigned long e;
+	int i, line, flags;
+
+	/* The oldest errors are lost once the queue is full */
+	i = n < ERR_NUM_ERRORS ? 1 : n - ERR_NUM_ERRORS + 2;
+	if (ERR_peek_error() != ERR_PACK(ERR_LIB_USER, id, i)
+		|| ERR_peek_last_error() != ERR_PACK(ERR_LIB_USER, id, n))
+		{
+		fprintf(stderr, "thread %d: wrong first or last error\n", id);
+		return 0;
+		}
+	for (; i <= n; i++)
+		{
+		e = ERR_get_error_line_data(&file, &line, &data, &flags);
+		if (e != ERR_PACK(ERR_LIB_USER, id, i) || line != i
+			|| strcmp(file, __FILE__) != 0)
+			{
+			fprintf(stderr, "thread %d: error %d is %lx at line "
+						"%d\n", id, i, e, line);
+			return 0;
+			}
+		BIO_snprintf(buf, sizeof(buf), "%d/%d", id, i);
+		if ((i % 2 == 0) != ((flags & ERR_TXT_STRING) != 0)
+			|| (i % 2 == 0 && strcmp(data, buf) != 0))
+			{
+			fprintf(stderr, "thread %d: error %d has data \"%s\"\n",
+							id, i, data);
+			return 0;
+			}
+		}
+	if ((e = ERR_get_error()) != 0)
+		{
+		fprintf(stderr, "thread %d: unexpected error %lx\n", id, e);
+		return 0;
+		}
+	return 1;
+	}
+
+static void *err_thread(void *arg)
+	{
+	int id = (int)(size_t)arg, round, n;
+
+	for (round = 0; round < NUM_ROUNDS; round++)
+		{
+		n = (round + id) % (ERR_NUM_ERRORS + 4) + 1;
+		push_errors(id, n);
+		if (round % 10 == 9)
+			{
+			/* Dropping the state drops its errors */
+			ERR_remove_thread_state(NULL);
+			if (ERR_peek_error() != 0)
+				{
+				fprintf(stderr, "thread %d: errors left after "
+					"ERR_remove_thread_state()\n", id);
+				return (void *)1;
+				}
+			continue;
+			}
+		/* The state of another thread is not the caller's to remove */
+		if (id == 1)
+			ERR_remove_thread_state(&main_tid);
+		if (!pop_errors(id, n))
+			return (void *)1;
+		}
+
+	/* Half the threads leave their state for the exit of the thread */
+	push_errors(id, 3);
+	if (id % 2 == 0)
+		ERR_remove_thread_state(NULL);
+	return NULL;
+	}
+
+int main(int argc, char *argv[])
+	{
+	pthread_t tid[NUM_THREADS];
+	BIO *leaks;
+	void *res;
+	int i, ret = 0;
+
+	lock_cs = malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+	if (lock_cs == NULL)
+		return 1;
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_init(&lock_cs[i], NULL);
+	CRYPTO_THREADID_set_callback(thread_id_cb);
+	CRYPTO_set_locking_callback(locking_cb);
+	CRYPTO_THREADID_current(&main_tid);
+
+	/* The key lives as long as the process, so make it before checking
+	 * for leaks */
+	if (!ERR_set_implementation(ERR_get_tls_implementation())
+		|| ERR_get_implementation() != ERR_get_tls_implementation())
+		{
+		fprintf(stderr, "cannot use the thread-local implementation\n");
+		return 1;
+		}
+
+	CRYPTO_malloc_debug_init();
+	CRYPTO_dbg_set_options(V_CRYPTO_MDEBUG_ALL);
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+
+	/* An error of the main thread that the others must not disturb */
+	ERR_put_error(ERR_LIB_USER, 0, 1, __FILE__, 1);
+	for (i = 0; i < NUM_THREADS; i++)
+		{
+		if (pthread_create(&tid[i], NULL, err_thread,
+						(void *)(size_t)(i + 1)) != 0)
+			{
+			fprintf(stderr, "cannot create threads\n");
+			return 1;
+			}
+		}
+	for (i = 0; i < NUM_THREADS; i++)
+		{
+		pthread_join(tid[i], &res);
+		if (res != NULL)
+			ret = 1;
+		}
+	if (ret == 0 && !pop_errors(0, 1))
+		ret = 1;
+	ERR_remove_thread_state(NULL);
+
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_OFF);
+	leaks = BIO_new(BIO_s_mem());
+	CRYPTO_mem_leaks(leaks);
+	if (BIO_ctrl_pending(leaks))
+		{
+		fprintf(stderr, "memory leaks:\n");
+		CRYPTO_mem_leaks_fp(stderr);
+		ret = 1;
+		}
+	BIO_free(leaks);
+
+	CRYPTO_set_locking_callback(NULL);
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_destroy(&lock_cs[i]);
+	free(lock_cs);
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
+#endif
@@ -0,0 +1,269 @@
+/* crypto/evp/aead_record_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/* Tests for EVP_CTRL_AEAD_TLS1_RECORD: records it seals must be those of
+ * EVP_CTRL_AEAD_TLS1_AAD followed by EVP_Cipher(), each must open records
+ * sealed by the other, and both must reject tampered records. Run with
+ * OPENSSL_ia32cap=0 as well to cover the code without AES-NI.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+/* Payload sizes around the blocks of the stitched AES-NI GCM code, which
+ * handles records of 288 bytes or more, and the largest record */
+static const int sizes[] = { 0, 1, 15, 16, 17, 95, 96, 97, 287, 288, 289,
+			     1024, 16384 };
+
+#define MAX_RECORD	(16384 + 8 + 16)
+
+static unsigned char msg[MAX_RECORD];
+static unsigned char rec1[MAX_RECORD], rec2[MAX_RECORD];
+
+static int init_ctx(EVP_CIPHER_CTX *ctx, const EVP_CIPHER *cipher, int enc)
+	{
+	static const unsigned char key[32] =
+		{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		  0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
+		  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+	static unsigned char iv[12] =
+		{ 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+		  0xde, 0xca, 0xf8, 0x88 };
+
+	EVP_CIPHER_CTX_init(ctx);
+	if (!EVP_CipherInit_ex(ctx, cipher, NULL, key, NULL, enc))
+		return 0;
+	/* As TLS sets up GCM: the whole nonce, later records increment the
+	 * explicit part */
+	if (EVP_CIPHER_mode(cipher) == EVP_CIPH_GCM_MODE)
+		return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IV_FIXED,
+								-1, iv) > 0;
+	return EVP_CipherInit_ex(ctx, NULL, NULL, NULL, iv, enc);
+	}
+
+static void set_aad(unsigned char *aad, int seq, int len)
+	{
+	memset(aad, 0, 8);
+	aad[7] = (unsigned char)seq;
+	aad[8] = 23;			/* application data */
+	aad[9] = 3;
+	aad[10] = 3;
+	aad[11] = (unsigned char)(len >> 8);
+	aad[12] = (unsigned char)len;
+	}
+
+/* Seal or open the record in buf in place with EVP_CTRL_AEAD_TLS1_RECORD,
+ * returning the length of the result or -1 */
+static int record_ctrl(EVP_CIPHER_CTX *ctx, unsigned char *buf, int len,
+						const unsigned char *aad)
+	{
+	EVP_CTRL_AEAD_TLS1_RECORD_PARAM param;
+
+	param.out = buf;
+	param.inp = buf;
+	param.len = len;
+	param.aad = aad;
+	if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_TLS1_RECORD, 0, &param) <= 0)
+		return -1;
+	return (int)param.len;
+	}
+
+/* The same with EVP_CTRL_AEAD_TLS1_AAD and EVP_Cipher(), as TLS did */
+static int record_cipher(EVP_CIPHER_CTX *ctx, unsigned char *buf, int len,
+						const unsigned char *aad)
+	{
+	unsigned char tmp[13];
+	int pad;
+
+	memcpy(tmp, aad, 13);
+	pad = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_TLS1_AAD, 13, tmp);
+	if (pad <= 0)
+		return -1;
+	if (ctx->encrypt)
+		len += pad;
+	return EVP_Cipher(ctx, buf, buf, len);
+	}
+
+/* Records of len bytes sealed both ways must match and open both ways */
+static int test_record(const char *name, const EVP_CIPHER *cipher, int len)
+	{
+	EVP_CIPHER_CTX seal1, seal2, open1, open2;
+	unsigned char aad[13];
+	int xiv, n1, n2, i, ok = 0;
+
+	xiv = EVP_CIPHER_mode(cipher) == EVP_CIPH_GCM_MODE ?
+					EVP_GCM_TLS_EXPLICIT_IV_LEN : 0;
+	if (!init_ctx(&seal1, cipher, 1) || !init_ctx(&seal2, cipher, 1)
+		|| !init_ctx(&open1, cipher, 0) || !init_ctx(&open2, cipher, 0))
+		{
+		fprintf(stderr, "%s: cannot set up the cipher\n", name);
+		goto err;
+		}
+
+	for (i = 0; i < len; i++)
+		msg[i] = (unsigned char)(i * 7 + len);
+	memcpy(rec1 + xiv, msg, len);
+	memcpy(rec2 + xiv, msg, len);
+	set_aad(aad, len & 0xff, xiv + len);
+	n1 = record_ctrl(&seal1, rec1, xiv + len, aad);
+	n2 = record_cipher(&seal2, rec2, xiv + len, aad);
+	if (n1 != xiv + len + 16 || n2 != n1 || memcmp(rec1, rec2, n1))
+		{
+		fprintf(stderr, "%s: %d byte records differ (%d and %d)\n",
+							name, len, n1, n2);
+		goto err;
+		}
+
+	/* Tampering with any part of a record must be detected both ways */
+	set_aad(aad, len & 0xff, n1);
+	for (i = 0; i < n1; i += (i < xiv || i >= n1 - 17) ? 1 : 97)
+		{
+		memcpy(rec2, rec1, n1);
+		rec2[i] ^= 0x20;
+		if (record_ctrl(&open1, rec2, n1, aad) != -1)
+			{
+			fprintf(stderr, "%s: %d byte record with byte %d "
+					"changed opened\n", name, len, i);
+			goto err;
+			}
+		memcpy(rec2, rec1, n1);
+		rec2[i] ^= 0x20;
+		if (record_cipher(&open2, rec2, n1, aad) != -1)
+			{
+			fprintf(stderr, "%s: %d byte record with byte %d "
+				"changed opened the old way\n", name, len, i);
+			goto err;
+			}
+		}
+	aad[7] ^= 1;
+	memcpy(rec2, rec1, n1);
+	if (record_ctrl(&open1, rec2, n1, aad) != -1
+		|| record_cipher(&open2, rec2, n1, aad) != -1)
+		{
+		fprintf(stderr, "%s: %d byte record with another sequence "
+						"number opened\n", name, len);
+		goto err;
+		}
+	aad[7] ^= 1;
+	if (record_ctrl(&open1, rec2, xiv + 15, aad) != -1)
+		{
+		fprintf(stderr, "%s: short record opened\n", name);
+		goto err;
+		}
+
+	/* What one seals, the other opens */
+	memcpy(rec2, rec1, n1);
+	n1 = record_cipher(&open2, rec1, n1, aad);
+	n2 = record_ctrl(&open1, rec2, n2, aad);
+	if (n1 != len || n2 != len || memcmp(rec1 + xiv, msg, len)
+		|| memcmp(rec2 + xiv, msg, len))
+		{
+		fprintf(stderr, "%s: %d byte record opened as %d and %d\n",
+							name, len, n1, n2);
+		goto err;
+		}
+	ok = 1;
+
+	err:
+	EVP_CIPHER_CTX_cleanup(&seal1);
+	EVP_CIPHER_CTX_cleanup(&seal2);
+	EVP_CIPHER_CTX_cleanup(&open1);
+	EVP_CIPHER_CTX_cleanup(&open2);
+	return ok;
+	}
+
+static int test_cipher(const char *name, const EVP_CIPHER *cipher)
+	{
+	int i;
+
+	if (!(EVP_CIPHER_flags(cipher) & EVP_CIPH_FLAG_TLS1_AEAD_RECORD))
+		{
+		fprintf(stderr, "%s: no EVP_CTRL_AEAD_TLS1_RECORD\n", name);
+		return 0;
+		}
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+		{
+		if (!test_record(name, cipher, sizes[i]))
+			return 0;
+		}
+	return 1;
+	}
+
+int main(int argc, char *argv[])
+	{
+	int ret = 1;
+
+	CRYPTO_malloc_debug_init();
+	CRYPTO_dbg_set_options(V_CRYPTO_MDEBUG_ALL);
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+	ERR_load_crypto_strings();
+
+	if (test_cipher("aes-128-gcm", EVP_aes_128_gcm())
+		&& test_cipher("aes-256-gcm", EVP_aes_256_gcm())
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+		&& test_cipher("chacha20-poly1305", EVP_chacha20_poly1305())
+#endif
+		)
+		ret = 0;
+	else
+		ERR_print_errors_fp(stderr);
+
+	ERR_free_strings();
+	ERR_remove_thread_state(NULL);
+	CRYPTO_mem_leaks_fp(stderr);
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
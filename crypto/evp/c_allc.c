@@ -122,6 +122,13 @@ void OpenSSL_add_all_ciphers(void)
 	EVP_add_cipher_alias(SN_seed_cbc,"seed");
 #endif
 
+#ifndef OPENSSL_NO_CHACHA
+	EVP_add_cipher(EVP_chacha20());
+# ifndef OPENSSL_NO_POLY1305
+	EVP_add_cipher(EVP_chacha20_poly1305());
+# endif
+#endif
+
 #ifndef OPENSSL_NO_RC2
 	EVP_add_cipher(EVP_rc2_ecb());
 	EVP_add_cipher(EVP_rc2_cfb());
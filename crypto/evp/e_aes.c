@@ -1312,6 +1312,9 @@ static void ctr64_inc(unsigned char *counter) {
 	} while (n);
 }
 
+static int aes_gcm_tls_record(EVP_CIPHER_CTX *ctx,
+		EVP_CTRL_AEAD_TLS1_RECORD_PARAM *param);
+
 static int aes_gcm_ctrl(EVP_CIPHER_CTX *c, int type, int arg, void *ptr)
 	{
 	EVP_AES_GCM_CTX *gctx = c->cipher_data;
@@ -1418,6 +1421,9 @@ static int aes_gcm_ctrl(EVP_CIPHER_CTX *c, int type, int arg, void *ptr)
 		/* Extra padding: tag appended to record */
 		return EVP_GCM_TLS_TAG_LEN;
 
+	case EVP_CTRL_AEAD_TLS1_RECORD:
+		return aes_gcm_tls_record(c, ptr);
+
 	case EVP_CTRL_COPY:
 		{
 			EVP_CIPHER_CTX *out = ptr;
@@ -1672,6 +1678,207 @@ static int aes_gcm_tls_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
 	return rv;
 	}
 
+#if defined(AES_GCM_ASM)
+/* Records shorter than this, the least aesni_gcm_encrypt takes, are done
+ * through a buffer on the stack */
+#define AESNI_GCM_TLS_SMALL	(3*96)
+
+/* Seal or open a TLS record with AES-NI and the AVX GHASH in one pass.
+ * The counter block is built from the fixed and explicit IV directly.
+ * A short record is copied behind a zero block so that one CTR call
+ * yields both the tag mask and the payload, and behind the AAD block so
+ * that one GHASH call covers AAD, ciphertext and lengths. Longer ones
+ * go through the stitched aesni_gcm_encrypt/decrypt.
+ */
+static int aesni_gcm_tls_record(EVP_AES_GCM_CTX *gctx, int enc,
+		EVP_CTRL_AEAD_TLS1_RECORD_PARAM *param)
+	{
+	GCM128_CONTEXT *gcm = &gctx->gcm;
+	unsigned char *out = param->out;
+	unsigned char tag[EVP_GCM_TLS_TAG_LEN];
+	size_t len = param->len, done, n, i;
+	u64 alen, clen;
+	unsigned int ctr;
+	int rv = 0;
+
+	if (len < EVP_GCM_TLS_EXPLICIT_IV_LEN +
+			(enc ? 0 : EVP_GCM_TLS_TAG_LEN))
+		goto err;
+	len -= EVP_GCM_TLS_EXPLICIT_IV_LEN;
+	if (!enc)
+		len -= EVP_GCM_TLS_TAG_LEN;
+
+	/* IV: generate the explicit part or take it from the record */
+	if (!enc)
+		memcpy(gctx->iv + 4, out, EVP_GCM_TLS_EXPLICIT_IV_LEN);
+	memcpy(gcm->Yi.c, gctx->iv, 12);
+	if (enc)
+		{
+		memcpy(out, gctx->iv + 4, EVP_GCM_TLS_EXPLICIT_IV_LEN);
+		ctr64_inc(gctx->iv + 4);
+		}
+	gcm->Yi.c[12] = gcm->Yi.c[13] = gcm->Yi.c[14] = 0;
+	gcm->Yi.c[15] = 1;
+	out += EVP_GCM_TLS_EXPLICIT_IV_LEN;
+
+	/* AAD block, with the length corrected for explicit IV and tag */
+	memcpy(gcm->Xi.c, param->aad, 11);
+	gcm->Xi.c[11] = (unsigned char)(len >> 8);
+	gcm->Xi.c[12] = (unsigned char)len;
+	gcm->Xi.c[13] = gcm->Xi.c[14] = gcm->Xi.c[15] = 0;
+
+	/* Length block */
+	alen = (u64)13 << 3;
+	clen = (u64)len << 3;
+	for (i = 0; i < 8; i++)
+		{
+		gcm->len.c[7 - i] = (unsigned char)(alen >> (8 * i));
+		gcm->len.c[15 - i] = (unsigned char)(clen >> (8 * i));
+		}
+
+	if (len < AESNI_GCM_TLS_SMALL)
+		{
+		union { u64 align; unsigned char c[16+AESNI_GCM_TLS_SMALL+16]; } buf;
+		size_t padded = (len + 15) & ~(size_t)15;
+
+		if (!enc)
+			{
+			memcpy(buf.c, gcm->Xi.c, 16);
+			memcpy(buf.c + 16, out, len);
+			memset(buf.c + 16 + len, 0, padded - len);
+			memcpy(buf.c + 16 + padded, gcm->len.c, 16);
+			gcm->Xi.u[0] = gcm->Xi.u[1] = 0;
+			(*gcm->ghash)(gcm->Xi.u, gcm->Htable, buf.c,
+					16 + padded + 16);
+			}
+		memset(buf.c, 0, 16);
+		if (enc)
+			memcpy(buf.c + 16, out, len);
+		(*gctx->ctr)(buf.c, buf.c, 1 + padded / 16, gcm->key,
+				gcm->Yi.c);
+		memcpy(gcm->EK0.c, buf.c, 16);
+		if (enc)
+			{
+			memcpy(out, buf.c + 16, len);
+			memcpy(buf.c, gcm->Xi.c, 16);
+			memset(buf.c + 16 + len, 0, padded - len);
+			memcpy(buf.c + 16 + padded, gcm->len.c, 16);
+			gcm->Xi.u[0] = gcm->Xi.u[1] = 0;
+			(*gcm->ghash)(gcm->Xi.u, gcm->Htable, buf.c,
+					16 + padded + 16);
+			}
+		for (i = 0; i < EVP_GCM_TLS_TAG_LEN; i++)
+			tag[i] = gcm->Xi.c[i] ^ gcm->EK0.c[i];
+		if (enc)
+			memcpy(out + len, tag, EVP_GCM_TLS_TAG_LEN);
+		else if (CRYPTO_memcmp(tag, out + len, EVP_GCM_TLS_TAG_LEN) == 0)
+			memcpy(out, buf.c + 16, len);
+		else
+			{
+			OPENSSL_cleanse(buf.c, 16 + padded);
+			goto err;
+			}
+		OPENSSL_cleanse(buf.c, 16 + padded);
+		}
+	else
+		{
+		(*gcm->block)(gcm->Yi.c, gcm->EK0.c, gcm->key);
+		gcm->Yi.c[15] = 2;
+		(*gcm->gmult)(gcm->Xi.u, gcm->Htable);
+
+		if (enc)
+			done = aesni_gcm_encrypt(out, out, len, gcm->key,
+						gcm->Yi.c, gcm->Xi.u);
+		else
+			done = aesni_gcm_decrypt(out, out, len, gcm->key,
+						gcm->Yi.c, gcm->Xi.u);
+		ctr = (unsigned int)gcm->Yi.c[12] << 24 | gcm->Yi.c[13] << 16 |
+			gcm->Yi.c[14] << 8 | gcm->Yi.c[15];
+
+		/* Blocks left over by the stitched code, then the partial
+		 * block and the lengths */
+		if ((n = (len - done) & ~(size_t)15))
+			{
+			if (!enc)
+				(*gcm->ghash)(gcm->Xi.u, gcm->Htable,
+						out + done, n);
+			(*gctx->ctr)(out + done, out + done, n / 16, gcm->key,
+					gcm->Yi.c);
+			if (enc)
+				(*gcm->ghash)(gcm->Xi.u, gcm->Htable,
+						out + done, n);
+			ctr += (unsigned int)(n / 16);
+			gcm->Yi.c[12] = (unsigned char)(ctr >> 24);
+			gcm->Yi.c[13] = (unsigned char)(ctr >> 16);
+			gcm->Yi.c[14] = (unsigned char)(ctr >> 8);
+			gcm->Yi.c[15] = (unsigned char)ctr;
+			done += n;
+			}
+		if (done < len)
+			{
+			(*gcm->block)(gcm->Yi.c, gcm->EKi.c, gcm->key);
+			for (i = 0; done + i < len; i++)
+				{
+				if (!enc)
+					gcm->Xi.c[i] ^= out[done + i];
+				out[done + i] ^= gcm->EKi.c[i];
+				if (enc)
+					gcm->Xi.c[i] ^= out[done + i];
+				}
+			(*gcm->gmult)(gcm->Xi.u, gcm->Htable);
+			}
+		(*gcm->ghash)(gcm->Xi.u, gcm->Htable, gcm->len.c, 16);
+
+		for (i = 0; i < EVP_GCM_TLS_TAG_LEN; i++)
+			tag[i] = gcm->Xi.c[i] ^ gcm->EK0.c[i];
+		if (enc)
+			memcpy(out + len, tag, EVP_GCM_TLS_TAG_LEN);
+		/* If tag mismatch wipe buffer */
+		else if (CRYPTO_memcmp(tag, out + len, EVP_GCM_TLS_TAG_LEN))
+			{
+			OPENSSL_cleanse(out, len);
+			goto err;
+			}
+		}
+
+	if (enc)
+		param->len = len + EVP_GCM_TLS_EXPLICIT_IV_LEN +
+				EVP_GCM_TLS_TAG_LEN;
+	else
+		param->len = len;
+	rv = 1;
+
+	err:
+	gctx->iv_set = 0;
+	gctx->tls_aad_len = -1;
+	return rv;
+	}
+#endif
+
+static int aes_gcm_tls_record(EVP_CIPHER_CTX *ctx,
+		EVP_CTRL_AEAD_TLS1_RECORD_PARAM *param)
+	{
+	EVP_AES_GCM_CTX *gctx = ctx->cipher_data;
+	int rv;
+
+	/* Encrypt/decrypt must be performed in place */
+	if (param->out != param->inp || !gctx->key_set || !gctx->iv_gen)
+		return 0;
+#if defined(AES_GCM_ASM)
+	if (gctx->ivlen == 12 && AES_GCM_ASM(gctx))
+		return aesni_gcm_tls_record(gctx, ctx->encrypt, param);
+#endif
+	if (aes_gcm_ctrl(ctx, EVP_CTRL_AEAD_TLS1_AAD, EVP_AEAD_TLS1_AAD_LEN,
+			(void *)param->aad) <= 0)
+		return 0;
+	rv = aes_gcm_tls_cipher(ctx, param->out, param->inp,
+		param->len + (ctx->encrypt ? EVP_GCM_TLS_TAG_LEN : 0));
+	if (rv < 0)
+		return 0;
+	param->len = rv;
+	return 1;
+	}
+
 static int aes_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
 		const unsigned char *in, size_t len)
 	{
@@ -1833,11 +2040,11 @@ static int aes_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
 		| EVP_CIPH_CUSTOM_COPY)
 
 BLOCK_CIPHER_custom(NID_aes,128,1,12,gcm,GCM,
-		EVP_CIPH_FLAG_AEAD_CIPHER|CUSTOM_FLAGS)
+		EVP_CIPH_FLAG_AEAD_CIPHER|EVP_CIPH_FLAG_TLS1_AEAD_RECORD|CUSTOM_FLAGS)
 BLOCK_CIPHER_custom(NID_aes,192,1,12,gcm,GCM,
-		EVP_CIPH_FLAG_AEAD_CIPHER|CUSTOM_FLAGS)
+		EVP_CIPH_FLAG_AEAD_CIPHER|EVP_CIPH_FLAG_TLS1_AEAD_RECORD|CUSTOM_FLAGS)
 BLOCK_CIPHER_custom(NID_aes,256,1,12,gcm,GCM,
-		EVP_CIPH_FLAG_AEAD_CIPHER|CUSTOM_FLAGS)
+		EVP_CIPH_FLAG_AEAD_CIPHER|EVP_CIPH_FLAG_TLS1_AEAD_RECORD|CUSTOM_FLAGS)
 
 static int aes_xts_ctrl(EVP_CIPHER_CTX *c, int type, int arg, void *ptr)
 	{
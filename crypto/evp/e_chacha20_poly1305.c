@@ -0,0 +1,540 @@
+/* crypto/evp/e_chacha20_poly1305.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ */
+
+
+#include <openssl/opensslconf.h>
+#ifndef OPENSSL_NO_CHACHA
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/crypto.h>
+
+#include "internal/chacha.h"
+
+typedef struct
+	{
+	union { double align; unsigned int d[CHACHA_KEY_SIZE / 4]; } key;
+	unsigned int counter[CHACHA_CTR_SIZE / 4];
+	unsigned char buf[CHACHA_BLK_SIZE];
+	unsigned int partial_len;
+	} EVP_CHACHA_KEY;
+
+#define data(ctx)	((EVP_CHACHA_KEY *)(ctx)->cipher_data)
+
+#define CHACHA_U8TOU32(p)	( \
+		((unsigned int)(p)[0])     | ((unsigned int)(p)[1] << 8) | \
+		((unsigned int)(p)[2] << 16) | ((unsigned int)(p)[3] << 24)  )
+
+static int chacha_init_key(EVP_CIPHER_CTX *ctx,
+			const unsigned char user_key[CHACHA_KEY_SIZE],
+			const unsigned char iv[CHACHA_CTR_SIZE], int enc)
+	{
+	EVP_CHACHA_KEY *key = data(ctx);
+	unsigned int i;
+
+	if (user_key)
+		for (i = 0; i < CHACHA_KEY_SIZE; i += 4)
+			key->key.d[i/4] = CHACHA_U8TOU32(user_key+i);
+
+	if (iv)
+		for (i = 0; i < CHACHA_CTR_SIZE; i += 4)
+			key->counter[i/4] = CHACHA_U8TOU32(iv+i);
+
+	key->partial_len = 0;
+
+	return 1;
+	}
+
+static int chacha_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+			const unsigned char *inp, size_t len)
+	{
+	EVP_CHACHA_KEY *key = data(ctx);
+	unsigned int n, rem, ctr32;
+
+	if ((n = key->partial_len))
+		{
+		while (len && n < CHACHA_BLK_SIZE)
+			{
+			*out++ = *inp++ ^ key->buf[n++];
+			len--;
+			}
+		key->partial_len = n;
+
+		if (len == 0)
+			return 1;
+
+		if (n == CHACHA_BLK_SIZE)
+			{
+			key->partial_len = 0;
+			key->counter[0]++;
+			if (key->counter[0] == 0)
+				key->counter[1]++;
+			}
+		}
+
+	rem = (unsigned int)(len % CHACHA_BLK_SIZE);
+	len -= rem;
+	ctr32 = key->counter[0];
+	while (len >= CHACHA_BLK_SIZE)
+		{
+		size_t blocks = len / CHACHA_BLK_SIZE;
+
+		/* ChaCha20_ctr32 takes a size_t length but the count of
+		 * blocks has to fit the 32-bit counter: cap it first. */
+		if (sizeof(size_t) > sizeof(unsigned int) && blocks > (1U<<28))
+			blocks = (1U<<28);
+
+		/* ChaCha20_ctr32 does not carry out of the 32-bit counter,
+		 * so stop at the point where it wraps and carry here. */
+		ctr32 += (unsigned int)blocks;
+		if (ctr32 < blocks)
+			{
+			blocks -= ctr32;
+			ctr32 = 0;
+			}
+		blocks *= CHACHA_BLK_SIZE;
+		ChaCha20_ctr32(out, inp, blocks, key->key.d, key->counter);
+		len -= blocks;
+		inp += blocks;
+		out += blocks;
+
+		key->counter[0] = ctr32;
+		if (ctr32 == 0)
+			key->counter[1]++;
+		}
+
+	if (rem)
+		{
+		memset(key->buf, 0, sizeof(key->buf));
+		ChaCha20_ctr32(key->buf, key->buf, CHACHA_BLK_SIZE,
+				key->key.d, key->counter);
+		for (n = 0; n < rem; n++)
+			out[n] = inp[n] ^ key->buf[n];
+		key->partial_len = rem;
+		}
+
+	return 1;
+	}
+
+static const EVP_CIPHER chacha20 =
+	{
+	NID_chacha20,
+	1,			/* block_size */
+	CHACHA_KEY_SIZE,	/* key_len */
+	CHACHA_CTR_SIZE,	/* iv_len, 128-bit counter in the context */
+	EVP_CIPH_CUSTOM_IV | EVP_CIPH_ALWAYS_CALL_INIT,
+	chacha_init_key,
+	chacha_cipher,
+	NULL,
+	sizeof(EVP_CHACHA_KEY),
+	NULL,
+	NULL,
+	NULL,
+	NULL
+	};
+
+const EVP_CIPHER *EVP_chacha20(void)
+	{
+	return(&chacha20);
+	}
+
+#ifndef OPENSSL_NO_POLY1305
+#include "internal/poly1305.h"
+
+typedef struct
+	{
+	EVP_CHACHA_KEY key;
+	unsigned int nonce[12/4];
+	unsigned char tag[POLY1305_BLOCK_SIZE];
+	struct { size_t aad, text; } len;
+	int aad, mac_inited, tag_len, nonce_len;
+	size_t tls_payload_length;
+	unsigned char tls_aad[POLY1305_BLOCK_SIZE];
+	POLY1305 poly1305;
+	} EVP_CHACHA_AEAD_CTX;
+
+#define NO_TLS_PAYLOAD_LENGTH	((size_t)-1)
+#define aead_data(ctx)	((EVP_CHACHA_AEAD_CTX *)(ctx)->cipher_data)
+#define POLY1305_ctx(actx)	(&(actx)->poly1305)
+
+static const unsigned char zero[CHACHA_BLK_SIZE] = { 0 };
+
+/* Generate the one-time Poly1305 key from block 0 of the key stream;
+ * the payload starts at block 1. */
+static void chacha20_poly1305_mac_init(EVP_CHACHA_AEAD_CTX *actx)
+	{
+	actx->key.counter[0] = 0;
+	memset(actx->key.buf, 0, sizeof(actx->key.buf));
+	ChaCha20_ctr32(actx->key.buf, actx->key.buf, CHACHA_BLK_SIZE,
+			actx->key.key.d, actx->key.counter);
+	Poly1305_Init(POLY1305_ctx(actx), actx->key.buf);
+	OPENSSL_cleanse(actx->key.buf, sizeof(actx->key.buf));
+	actx->key.counter[0] = 1;
+	actx->key.partial_len = 0;
+	actx->len.aad = actx->len.text = 0;
+	actx->mac_inited = 1;
+	}
+
+/* Pad the MAC input to a block boundary, then append the two lengths
+ * as 64-bit little-endian numbers. */
+static void chacha20_poly1305_mac_final(EVP_CHACHA_AEAD_CTX *actx,
+			unsigned char tag[POLY1305_BLOCK_SIZE])
+	{
+	unsigned char temp[POLY1305_BLOCK_SIZE];
+	size_t aad = actx->len.aad, text = actx->len.text;
+	unsigned int rem, i;
+
+	if ((rem = (unsigned int)(text % POLY1305_BLOCK_SIZE)))
+		Poly1305_Update(POLY1305_ctx(actx), zero,
+				POLY1305_BLOCK_SIZE - rem);
+
+	for (i = 0; i < 8; i++, aad >>= 8, text >>= 8)
+		{
+		temp[i] = (unsigned char)aad;
+		temp[8+i] = (unsigned char)text;
+		}
+	Poly1305_Update(POLY1305_ctx(actx), temp, POLY1305_BLOCK_SIZE);
+	Poly1305_Final(POLY1305_ctx(actx), tag);
+	actx->mac_inited = 0;
+	}
+
+static int chacha20_poly1305_init_key(EVP_CIPHER_CTX *ctx,
+			const unsigned char *inkey,
+			const unsigned char *iv, int enc)
+	{
+	EVP_CHACHA_AEAD_CTX *actx = aead_data(ctx);
+
+	if (!inkey && !iv)
+		return 1;
+
+	actx->len.aad = 0;
+	actx->len.text = 0;
+	actx->aad = 0;
+	actx->mac_inited = 0;
+	actx->tls_payload_length = NO_TLS_PAYLOAD_LENGTH;
+
+	if (iv != NULL)
+		{
+		unsigned char temp[CHACHA_CTR_SIZE] = { 0 };
+
+		/* pad on the left */
+		memcpy(temp + CHACHA_CTR_SIZE - actx->nonce_len, iv,
+			actx->nonce_len);
+
+		chacha_init_key(ctx, inkey, temp, enc);
+
+		actx->nonce[0] = actx->key.counter[1];
+		actx->nonce[1] = actx->key.counter[2];
+		actx->nonce[2] = actx->key.counter[3];
+		}
+	else
+		chacha_init_key(ctx, inkey, NULL, enc);
+
+	return 1;
+	}
+
+/* Handle a TLS record, RFC 7905: the payload followed by room for the
+ * tag, with the nonce and AAD set up by EVP_CTRL_AEAD_TLS1_AAD. The
+ * whole record is done here in one call. */
+static int chacha20_poly1305_tls_cipher(EVP_CIPHER_CTX *ctx,
+			unsigned char *out, const unsigned char *in,
+			size_t len)
+	{
+	EVP_CHACHA_AEAD_CTX *actx = aead_data(ctx);
+	size_t plen = actx->tls_payload_length;
+	unsigned char tag[POLY1305_BLOCK_SIZE];
+	int rv = -1;
+
+	if (len != plen + POLY1305_BLOCK_SIZE)
+		goto err;
+
+	chacha20_poly1305_mac_init(actx);
+	Poly1305_Update(POLY1305_ctx(actx), actx->tls_aad,
+			POLY1305_BLOCK_SIZE);
+	actx->len.aad = EVP_AEAD_TLS1_AAD_LEN;
+	actx->len.text = plen;
+
+	if (ctx->encrypt)
+		{
+		ChaCha20_ctr32(out, in, plen, actx->key.key.d,
+				actx->key.counter);
+		Poly1305_Update(POLY1305_ctx(actx), out, plen);
+		chacha20_poly1305_mac_final(actx, out + plen);
+		rv = (int)len;
+		}
+	else
+		{
+		/* in and out may be the same: hash before decrypting */
+		Poly1305_Update(POLY1305_ctx(actx), in, plen);
+		chacha20_poly1305_mac_final(actx, tag);
+		if (CRYPTO_memcmp(tag, in + plen, POLY1305_BLOCK_SIZE))
+			goto err;
+		ChaCha20_ctr32(out, in, plen, actx->key.key.d,
+				actx->key.counter);
+		rv = (int)plen;
+		}
+
+err:
+	actx->tls_payload_length = NO_TLS_PAYLOAD_LENGTH;
+	return rv;
+	}
+
+static int chacha20_poly1305_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+			const unsigned char *in, size_t len)
+	{
+	EVP_CHACHA_AEAD_CTX *actx = aead_data(ctx);
+	unsigned int rem;
+
+	if (actx->tls_payload_length != NO_TLS_PAYLOAD_LENGTH)
+		return chacha20_poly1305_tls_cipher(ctx, out, in, len);
+
+	if (!actx->mac_inited)
+		chacha20_poly1305_mac_init(actx);
+
+	if (in)
+		{
+		if (out == NULL)
+			{
+			/* additional authenticated data */
+			Poly1305_Update(POLY1305_ctx(actx), in, len);
+			actx->len.aad += len;
+			actx->aad = 1;
+			return (int)len;
+			}
+
+		if (actx->aad)
+			{
+			if ((rem = (unsigned int)(actx->len.aad % POLY1305_BLOCK_SIZE)))
+				Poly1305_Update(POLY1305_ctx(actx), zero,
+						POLY1305_BLOCK_SIZE - rem);
+			actx->aad = 0;
+			}
+
+		if (ctx->encrypt)
+			{
+			chacha_cipher(ctx, out, in, len);
+			Poly1305_Update(POLY1305_ctx(actx), out, len);
+			}
+		else
+			{
+			Poly1305_Update(POLY1305_ctx(actx), in, len);
+			chacha_cipher(ctx, out, in, len);
+			}
+		actx->len.text += len;
+		return (int)len;
+		}
+	else
+		{
+		unsigned char tag[POLY1305_BLOCK_SIZE];
+
+		if (actx->aad)
+			{
+			if ((rem = (unsigned int)(actx->len.aad % POLY1305_BLOCK_SIZE)))
+				Poly1305_Update(POLY1305_ctx(actx), zero,
+						POLY1305_BLOCK_SIZE - rem);
+			actx->aad = 0;
+			}
+
+		chacha20_poly1305_mac_final(actx, tag);
+
+		if (ctx->encrypt)
+			{
+			memcpy(actx->tag, tag, POLY1305_BLOCK_SIZE);
+			actx->tag_len = POLY1305_BLOCK_SIZE;
+			}
+		else
+			{
+			if (actx->tag_len == 0 ||
+			    CRYPTO_memcmp(tag, actx->tag, actx->tag_len))
+				return -1;
+			}
+		return 0;
+		}
+	}
+
+static int chacha20_poly1305_cleanup(EVP_CIPHER_CTX *ctx)
+	{
+	EVP_CHACHA_AEAD_CTX *actx = aead_data(ctx);
+
+	if (actx)
+		OPENSSL_cleanse(actx, sizeof(*actx));
+	return 1;
+	}
+
+static int chacha20_poly1305_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg,
+				void *ptr)
+	{
+	EVP_CHACHA_AEAD_CTX *actx = aead_data(ctx);
+
+	switch (type)
+		{
+	case EVP_CTRL_INIT:
+		actx->len.aad = 0;
+		actx->len.text = 0;
+		actx->aad = 0;
+		actx->mac_inited = 0;
+		actx->tag_len = 0;
+		actx->nonce_len = 12;
+		actx->tls_payload_length = NO_TLS_PAYLOAD_LENGTH;
+		return 1;
+
+	case EVP_CTRL_SET_IVLEN:
+		if (arg <= 0 || arg > CHACHA_CTR_SIZE)
+			return 0;
+		actx->nonce_len = arg;
+		return 1;
+
+	case EVP_CTRL_SET_TAG:
+		if (arg <= 0 || arg > POLY1305_BLOCK_SIZE || ctx->encrypt)
+			return 0;
+		memcpy(actx->tag, ptr, arg);
+		actx->tag_len = arg;
+		return 1;
+
+	case EVP_CTRL_GET_TAG:
+		if (arg <= 0 || arg > POLY1305_BLOCK_SIZE || !ctx->encrypt ||
+		    actx->tag_len == 0)
+			return 0;
+		memcpy(ptr, actx->tag, arg);
+		return 1;
+
+	case EVP_CTRL_AEAD_TLS1_AAD:
+		if (arg != EVP_AEAD_TLS1_AAD_LEN)
+			return 0;
+		{
+		unsigned int len;
+		unsigned char *aad = ptr;
+
+		memcpy(actx->tls_aad, ptr, EVP_AEAD_TLS1_AAD_LEN);
+		memset(actx->tls_aad + EVP_AEAD_TLS1_AAD_LEN, 0,
+			POLY1305_BLOCK_SIZE - EVP_AEAD_TLS1_AAD_LEN);
+		len = aad[EVP_AEAD_TLS1_AAD_LEN - 2] << 8 |
+			aad[EVP_AEAD_TLS1_AAD_LEN - 1];
+		if (!ctx->encrypt)
+			{
+			/* A record too short for the tag gets a payload
+			 * length that cannot match in the cipher call. */
+			if (len < POLY1305_BLOCK_SIZE)
+				{
+				actx->tls_payload_length = len;
+				return 0;
+				}
+			len -= POLY1305_BLOCK_SIZE;
+			actx->tls_aad[EVP_AEAD_TLS1_AAD_LEN - 2] =
+				(unsigned char)(len >> 8);
+			actx->tls_aad[EVP_AEAD_TLS1_AAD_LEN - 1] =
+				(unsigned char)len;
+			}
+		actx->tls_payload_length = len;
+
+		/* The nonce is the fixed IV xored with the record sequence
+		 * number, the first 8 bytes of the AAD, left-padded. */
+		actx->key.counter[1] = actx->nonce[0];
+		actx->key.counter[2] = actx->nonce[1] ^ CHACHA_U8TOU32(aad);
+		actx->key.counter[3] = actx->nonce[2] ^ CHACHA_U8TOU32(aad+4);
+		actx->mac_inited = 0;
+
+		return POLY1305_BLOCK_SIZE;	/* tag length */
+		}
+
+	case EVP_CTRL_AEAD_TLS1_RECORD:
+		{
+		EVP_CTRL_AEAD_TLS1_RECORD_PARAM *param = ptr;
+		int len;
+
+		if (chacha20_poly1305_ctrl(ctx, EVP_CTRL_AEAD_TLS1_AAD,
+				EVP_AEAD_TLS1_AAD_LEN, (void *)param->aad) <= 0)
+			{
+			actx->tls_payload_length = NO_TLS_PAYLOAD_LENGTH;
+			return 0;
+			}
+		len = chacha20_poly1305_tls_cipher(ctx, param->out, param->inp,
+			param->len + (ctx->encrypt ? POLY1305_BLOCK_SIZE : 0));
+		if (len < 0)
+			return 0;
+		param->len = len;
+		return 1;
+		}
+
+	case EVP_CTRL_AEAD_SET_MAC_KEY:
+		/* no-op */
+		return 1;
+
+	default:
+		return -1;
+		}
+	}
+
+static const EVP_CIPHER chacha20_poly1305 =
+	{
+	NID_chacha20_poly1305,
+	1,			/* block_size */
+	CHACHA_KEY_SIZE,	/* key_len */
+	12,			/* iv_len, 96-bit nonce */
+	EVP_CIPH_FLAG_AEAD_CIPHER | EVP_CIPH_CUSTOM_IV |
+	EVP_CIPH_ALWAYS_CALL_INIT | EVP_CIPH_CTRL_INIT |
+	EVP_CIPH_FLAG_CUSTOM_CIPHER | EVP_CIPH_FLAG_TLS1_AEAD_RECORD,
+	chacha20_poly1305_init_key,
+	chacha20_poly1305_cipher,
+	chacha20_poly1305_cleanup,
+	sizeof(EVP_CHACHA_AEAD_CTX),
+	NULL,
+	NULL,
+	chacha20_poly1305_ctrl,
+	NULL
+	};
+
+const EVP_CIPHER *EVP_chacha20_poly1305(void)
+	{
+	return(&chacha20_poly1305);
+	}
+#endif
+#endif
@@ -118,6 +118,7 @@
 #define EVP_PKEY_EC	NID_X9_62_id_ecPublicKey
 #define EVP_PKEY_HMAC	NID_hmac
 #define EVP_PKEY_CMAC	NID_cmac
+#define EVP_PKEY_X25519	NID_X25519
 
 #ifdef	__cplusplus
 extern "C" {
@@ -372,6 +373,8 @@ struct evp_cipher_st
 #define 	EVP_CIPH_FLAG_CUSTOM_CIPHER	0x100000
 #define		EVP_CIPH_FLAG_AEAD_CIPHER	0x200000
 #define		EVP_CIPH_FLAG_TLS1_1_MULTIBLOCK	0x400000
+/* Cipher seals and opens whole TLS records with EVP_CTRL_AEAD_TLS1_RECORD */
+#define		EVP_CIPH_FLAG_TLS1_AEAD_RECORD	0x800000
 
 /* Cipher context flag to indicate we can handle
  * wrap mode: if allowed in older applications it could
@@ -406,6 +409,8 @@ struct evp_cipher_st
  * EVP_Cipher even appends/verifies MAC.
  */
 #define		EVP_CTRL_AEAD_TLS1_AAD		0x16
+/* Length of the AAD passed with EVP_CTRL_AEAD_TLS1_AAD */
+#define		EVP_AEAD_TLS1_AAD_LEN		13
 /* Used by composite AEAD ciphers, no-op in GCM, CCM... */
 #define		EVP_CTRL_AEAD_SET_MAC_KEY	0x17
 /* Set the GCM invocation field, decrypt only */
@@ -423,6 +428,21 @@ typedef struct {
 	unsigned int interleave;
 } EVP_CTRL_TLS1_1_MULTIBLOCK_PARAM;
 
+/* Seal or open a TLS record in one call, in place of EVP_CTRL_AEAD_TLS1_AAD
+ * followed by EVP_Cipher. aad is as for EVP_CTRL_AEAD_TLS1_AAD. On sealing
+ * len is the length of the record without the tag, on opening the length
+ * of the whole record. On success len is set to the length of the sealed
+ * record or of the opened payload, which follows any explicit IV.
+ */
+#define		EVP_CTRL_AEAD_TLS1_RECORD	0x1d
+
+typedef struct {
+	unsigned char *out;
+	const unsigned char *inp;
+	size_t len;
+	const unsigned char *aad;
+} EVP_CTRL_AEAD_TLS1_RECORD_PARAM;
+
 #define		EVP_CTRL_SET_IVLEN			EVP_CTRL_GCM_SET_IVLEN
 #define		EVP_CTRL_GET_TAG			EVP_CTRL_GCM_GET_TAG
 #define		EVP_CTRL_SET_TAG			EVP_CTRL_GCM_SET_TAG
@@ -932,6 +952,13 @@ const EVP_CIPHER *EVP_seed_cfb128(void);
 const EVP_CIPHER *EVP_seed_ofb(void);
 #endif
 
+#ifndef OPENSSL_NO_CHACHA
+const EVP_CIPHER *EVP_chacha20(void);
+# ifndef OPENSSL_NO_POLY1305
+const EVP_CIPHER *EVP_chacha20_poly1305(void);
+# endif
+#endif
+
 void OPENSSL_add_all_algorithms_noconf(void);
 void OPENSSL_add_all_algorithms_conf(void);
 
@@ -1004,6 +1031,10 @@ int EVP_PKEY_set1_EC_KEY(EVP_PKEY *pkey,struct ec_key_st *key);
 struct ec_key_st *EVP_PKEY_get1_EC_KEY(EVP_PKEY *pkey);
 #endif
 
+int EVP_PKEY_set1_tls_encodedpoint(EVP_PKEY *pkey,
+				const unsigned char *pt, size_t ptlen);
+size_t EVP_PKEY_get1_tls_encodedpoint(EVP_PKEY *pkey, unsigned char **ppt);
+
 EVP_PKEY *	EVP_PKEY_new(void);
 void		EVP_PKEY_free(EVP_PKEY *pkey);
 
@@ -1088,6 +1119,8 @@ void EVP_PBE_cleanup(void);
 #define ASN1_PKEY_CTRL_CMS_SIGN		0x5
 #define ASN1_PKEY_CTRL_CMS_ENVELOPE	0x7
 #define ASN1_PKEY_CTRL_CMS_RI_TYPE	0x8
+#define ASN1_PKEY_CTRL_SET1_TLS_ENCPT	0x9
+#define ASN1_PKEY_CTRL_GET1_TLS_ENCPT	0xa
 
 int EVP_PKEY_asn1_get_count(void);
 const EVP_PKEY_ASN1_METHOD *EVP_PKEY_asn1_get0(int idx);
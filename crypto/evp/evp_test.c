@@ -168,6 +168,11 @@ static void test1(const EVP_CIPHER *c,const unsigned char *key,int kn,
     if (tn)
     	hexdump(stdout,"Tag",tag,tn);
     mode = EVP_CIPHER_mode(c); 
+    /* Stream ciphers with a tag, such as ChaCha20-Poly1305, are driven
+     * the same way as GCM */
+    if (mode == EVP_CIPH_STREAM_CIPHER
+		&& (EVP_CIPHER_flags(c) & EVP_CIPH_FLAG_AEAD_CIPHER))
+	mode = EVP_CIPH_GCM_MODE;
     if(kn != EVP_CIPHER_key_length(c))
 	{
 	fprintf(stderr,"Key length doesn't match, got %d expected %lu\n",kn,
@@ -665,6 +670,20 @@ int main(int argc,char **argv)
 		fprintf(stdout, "Cipher disabled, skipping %s\n", cipher); 
 		continue;
 		}
+#endif
+#if defined(OPENSSL_NO_CHACHA) || defined(OPENSSL_NO_POLY1305)
+	    if (strcmp(cipher, "chacha20-poly1305") == 0)
+		{
+		fprintf(stdout, "Cipher disabled, skipping %s\n", cipher); 
+		continue;
+		}
+#endif
+#ifdef OPENSSL_NO_CHACHA
+	    if (strcmp(cipher, "chacha20") == 0)
+		{
+		fprintf(stdout, "Cipher disabled, skipping %s\n", cipher); 
+		continue;
+		}
 #endif
 	    fprintf(stderr,"Can't find %s\n",cipher);
 	    EXIT(3);
@@ -57,6 +57,7 @@
  */
 
 #include <stdio.h>
+#include <limits.h>
 #include "cryptlib.h"
 #include <openssl/bn.h>
 #include <openssl/err.h>
@@ -476,3 +477,27 @@ int EVP_PKEY_get_default_digest_nid(EVP_PKEY *pkey, int *pnid)
 						0, pnid);
 	}
 
+
+int EVP_PKEY_set1_tls_encodedpoint(EVP_PKEY *pkey,
+				const unsigned char *pt, size_t ptlen)
+	{
+	if (ptlen > INT_MAX || !pkey->ameth || !pkey->ameth->pkey_ctrl)
+		return 0;
+	if (pkey->ameth->pkey_ctrl(pkey, ASN1_PKEY_CTRL_SET1_TLS_ENCPT,
+						ptlen, (void *)pt) <= 0)
+		return 0;
+	return 1;
+	}
+
+size_t EVP_PKEY_get1_tls_encodedpoint(EVP_PKEY *pkey, unsigned char **ppt)
+	{
+	int rv;
+
+	if (!pkey->ameth || !pkey->ameth->pkey_ctrl)
+		return 0;
+	rv = pkey->ameth->pkey_ctrl(pkey, ASN1_PKEY_CTRL_GET1_TLS_ENCPT,
+								0, ppt);
+	if (rv <= 0)
+		return 0;
+	return rv;
+	}
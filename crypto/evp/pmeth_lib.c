@@ -74,7 +74,7 @@ STACK_OF(EVP_PKEY_METHOD) *app_pkey_methods = NULL;
 
 extern const EVP_PKEY_METHOD rsa_pkey_meth, dh_pkey_meth, dsa_pkey_meth;
 extern const EVP_PKEY_METHOD ec_pkey_meth, hmac_pkey_meth, cmac_pkey_meth;
-extern const EVP_PKEY_METHOD dhx_pkey_meth;
+extern const EVP_PKEY_METHOD dhx_pkey_meth, ecx25519_pkey_meth;
 
 static const EVP_PKEY_METHOD *standard_methods[] =
 	{
@@ -93,7 +93,10 @@ static const EVP_PKEY_METHOD *standard_methods[] =
 	&hmac_pkey_meth,
 	&cmac_pkey_meth,
 #ifndef OPENSSL_NO_DH
-	&dhx_pkey_meth
+	&dhx_pkey_meth,
+#endif
+#ifndef OPENSSL_NO_EC
+	&ecx25519_pkey_meth
 #endif
 	};
 
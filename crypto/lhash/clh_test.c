@@ -0,0 +1,279 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* A benchmark of shared hash tables, comparing an LHASH behind a single
+ * lock, as the library's shared tables use it, with a CLHASH. Each thread
+ * does lookups of random keys, and replaces one key in every 'w' operations
+ * by deleting it and inserting it again.
+ *
+ * It is not built by default. With POSIX threads:
+ *	cc -I../../include -o clh_test clh_test.c ../../libcrypto.a -lpthread
+ *	./clh_test [threads [operations [w]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <openssl/crypto.h>
+#include <openssl/lhash.h>
+
+#define NUM_KEYS	(1<<16)
+
+static unsigned long keys[NUM_KEYS];
+static pthread_rwlock_t *lock_cs;
+static int num_ops=1000000;
+static int write_every=10;
+
+static _LHASH *lh;
+static pthread_mutex_t lh_lock=PTHREAD_MUTEX_INITIALIZER;
+static _CLHASH *clh;
+
+struct CRYPTO_dynlock_value
+	{
+	pthread_rwlock_t lock;
+	};
+
+static void locking_cb(int mode, int type, const char *file, int line)
+	{
+	if (mode & CRYPTO_LOCK)
+		{
+		if (mode & CRYPTO_READ)
+			pthread_rwlock_rdlock(&lock_cs[type]);
+		else
+			pthread_rwlock_wrlock(&lock_cs[type]);
+		}
+	else
+		pthread_rwlock_unlock(&lock_cs[type]);
+	}
+
+static struct CRYPTO_dynlock_value *dyn_create_cb(const char *file, int line)
+	{
+	struct CRYPTO_dynlock_value *l;
+
+	l=OPENSSL_malloc(sizeof(*l));
+	if (l != NULL)
+		pthread_rwlock_init(&l->lock,NULL);
+	return l;
+	}
+
+static void dyn_lock_cb(int mode, struct CRYPTO_dynlock_value *l,
+	const char *file, int line)
+	{
+	if (mode & CRYPTO_LOCK)
+		{
+		if (mode & CRYPTO_READ)
+			pthread_rwlock_rdlock(&l->lock);
+		else
+			pthread_rwlock_wrlock(&l->lock);
+		}
+	else
+		pthread_rwlock_unlock(&l->lock);
+	}
+
+static void dyn_destroy_cb(struct CRYPTO_dynlock_value *l,
+	const char *file, int line)
+	{
+	pthread_rwlock_destroy(&l->lock);
+	OPENSSL_free(l);
+	}
+
+static unsigned long key_hash(const void *a)
+	{
+	return *(const unsigned long *)a * 2654435761UL;
+	}
+
+static int key_cmp(const void *a, const void *b)
+	{
+	return *(const unsigned long *)a != *(const unsigned long *)b;
+	}
+
+static unsigned int next_rand(unsigned int *seed)
+	{
+	*seed= *seed*1103515245U+12345U;
+	return *seed>>8;
+	}
+
+/* lh_retrieve() updates statistics, so readers need an exclusive lock */
+static void *lh_thread(void *arg)
+	{
+	unsigned int seed=(unsigned int)(size_t)arg;
+	unsigned long *k;
+	int i,found=0;
+
+	for (i=0; i<num_ops; i++)
+		{
+		k= &keys[next_rand(&seed)%NUM_KEYS];
+		pthread_mutex_lock(&lh_lock);
+		if (i%write_every == 0)
+			{
+			lh_delete(lh,k);
+			lh_insert(lh,k);
+			}
+		else if (lh_retrieve(lh,k) != NULL)
+			found++;
+		pthread_mutex_unlock(&lh_lock);
+		}
+	return (void *)(size_t)found;
+	}
+
+static void *clh_thread(void *arg)
+	{
+	unsigned int seed=(unsigned int)(size_t)arg;
+	unsigned long *k;
+	int i,found=0;
+
+	for (i=0; i<num_ops; i++)
+		{
+		k= &keys[next_rand(&seed)%NUM_KEYS];
+		if (i%write_every == 0)
+			{
+			clh_delete(clh,k);
+			clh_insert(clh,k,NULL);
+			}
+		else if (clh_retrieve(clh,k,NULL) != NULL)
+			found++;
+		}
+	return (void *)(size_t)found;
+	}
+
+static double run(const char *name, void *(*fn)(void *), int threads)
+	{
+	pthread_t *tid;
+	struct timeval start,end;
+	double secs;
+	int i;
+
+	tid=OPENSSL_malloc(threads*sizeof(pthread_t));
+	gettimeofday(&start,NULL);
+	for (i=0; i<threads; i++)
+		pthread_create(&tid[i],NULL,fn,(void *)(size_t)(i+1));
+	for (i=0; i<threads; i++)
+		pthread_join(tid[i],NULL);
+	gettimeofday(&end,NULL);
+	OPENSSL_free(tid);
+
+	secs=(end.tv_sec-start.tv_sec)+(end.tv_usec-start.tv_usec)/1e6;
+	printf("%-8s %2d threads: %10.0f ops/sec\n",name,threads,
+		(double)threads*num_ops/secs);
+	return secs;
+	}
+
+int main(int argc, char *argv[])
+	{
+	int threads=4,i;
+
+	if (argc > 1)
+		threads=atoi(argv[1]);
+	if (argc > 2)
+		num_ops=atoi(argv[2]);
+	if (argc > 3)
+		write_every=atoi(argv[3]);
+	if (threads < 1 || num_ops < 1 || write_every < 1)
+		{
+		fprintf(stderr,"usage: clh_test [threads [operations [w]]]\n");
+		exit(1);
+		}
+
+	lock_cs=OPENSSL_malloc(CRYPTO_num_locks()*sizeof(pthread_rwlock_t));
+	for (i=0; i<CRYPTO_num_locks(); i++)
+		pthread_rwlock_init(&lock_cs[i],NULL);
+	CRYPTO_set_locking_callback(locking_cb);
+	CRYPTO_set_dynlock_create_callback(dyn_create_cb);
+	CRYPTO_set_dynlock_lock_callback(dyn_lock_cb);
+	CRYPTO_set_dynlock_destroy_callback(dyn_destroy_cb);
+
+	lh=lh_new(key_hash,key_cmp);
+	clh=clh_new(key_hash,key_cmp,CRYPTO_LOCK_DYNLOCK);
+	if (lh == NULL || clh == NULL)
+		{
+		fprintf(stderr,"out of memory\n");
+		exit(1);
+		}
+	for (i=0; i<NUM_KEYS; i++)
+		{
+		keys[i]=i;
+		lh_insert(lh,&keys[i]);
+		if (!clh_insert(clh,&keys[i],NULL))
+			{
+			fprintf(stderr,"out of memory\n");
+			exit(1);
+			}
+		}
+
+	printf("%d keys, %d operations per thread, 1 in %d writes\n",
+		NUM_KEYS,num_ops,write_every);
+	run("lhash",lh_thread,1);
+	run("clhash",clh_thread,1);
+	if (threads > 1)
+		{
+		run("lhash",lh_thread,threads);
+		run("clhash",clh_thread,threads);
+		}
+
+	if (lh_num_items(lh) != NUM_KEYS || clh_num_items(clh) != NUM_KEYS)
+		{
+		fprintf(stderr,"table contents lost\n");
+		exit(1);
+		}
+	lh_free(lh);
+	clh_free(clh);
+
+	CRYPTO_set_locking_callback(NULL);
+	for (i=0; i<CRYPTO_num_locks(); i++)
+		pthread_rwlock_destroy(&lock_cs[i]);
+	OPENSSL_free(lock_cs);
+	exit(0);
+	}
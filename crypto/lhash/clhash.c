@@ -0,0 +1,479 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* A hash table that can be shared between threads without an external
+ * lock.
+ *
+ * The table is split into CLH_SEGMENTS segments by hash value. Each
+ * segment is a linear hash, as in lhash.c, with its own lock, so that
+ * inserts and deletes in different segments do not contend, and a segment
+ * grows and shrinks one bucket at a time rather than being rehashed all at
+ * once. Lookups only take the lock of their segment for reading and do
+ * not modify the table (there are no lookup statistics), so they run
+ * concurrently with each other when the lock is a reader/writer lock.
+ *
+ * Segment locks are dynamic locks if the application has set the dynamic
+ * lock callbacks. They are used through those callbacks directly, since
+ * CRYPTO_lock() takes CRYPTO_LOCK_DYNLOCK to look a dynamic lock up.
+ * Otherwise all segments share the static lock given to clh_new().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <openssl/crypto.h>
+#include <openssl/lhash.h>
+
+#define CLH_SEGMENTS	16	/* a power of 2 */
+#define MIN_NODES	16
+#define UP_LOAD		(2*LH_LOAD_MULT) /* load times 256 */
+#define DOWN_LOAD	(LH_LOAD_MULT)   /* load times 256 */
+
+typedef struct clhash_seg_st
+	{
+	LHASH_NODE **b;
+	unsigned int num_nodes;
+	unsigned int num_alloc_nodes;
+	unsigned int p;
+	unsigned int pmax;
+	unsigned long num_items;
+	struct CRYPTO_dynlock_value *dynlock;
+	} CLHASH_SEG;
+
+struct clhash_st
+	{
+	LHASH_COMP_FN_TYPE comp;
+	LHASH_HASH_FN_TYPE hash;
+	int lock;		/* static lock used without dynamic locks */
+	void (*dyn_lock)(int mode, struct CRYPTO_dynlock_value *l,
+		const char *file, int line);
+	void (*dyn_destroy)(struct CRYPTO_dynlock_value *l,
+		const char *file, int line);
+	CLHASH_SEG seg[CLH_SEGMENTS];
+	};
+
+/* The bucket index within a segment uses the low bits of the hash, so the
+ * segment is picked from a product that mixes in all of them. */
+#define CLH_SEG(ch, hash) \
+	(&(ch)->seg[((((hash) * 0x9E3779B1UL) & 0xffffffffUL) >> 16) \
+		& (CLH_SEGMENTS - 1)])
+
+static void seg_lock(_CLHASH *ch, CLHASH_SEG *seg, int mode)
+	{
+	if (seg->dynlock != NULL)
+		ch->dyn_lock(mode, seg->dynlock, __FILE__, __LINE__);
+	else
+		CRYPTO_lock(mode, ch->lock, __FILE__, __LINE__);
+	}
+
+#define seg_r_lock(ch,seg)	seg_lock(ch, seg, CRYPTO_LOCK|CRYPTO_READ)
+#define seg_r_unlock(ch,seg)	seg_lock(ch, seg, CRYPTO_UNLOCK|CRYPTO_READ)
+#define seg_w_lock(ch,seg)	seg_lock(ch, seg, CRYPTO_LOCK|CRYPTO_WRITE)
+#define seg_w_unlock(ch,seg)	seg_lock(ch, seg, CRYPTO_UNLOCK|CRYPTO_WRITE)
+
+_CLHASH *clh_new(LHASH_HASH_FN_TYPE h, LHASH_COMP_FN_TYPE c, int lock)
+	{
+	struct CRYPTO_dynlock_value *(*dyn_create)(const char *file,int line);
+	_CLHASH *ret;
+	CLHASH_SEG *seg;
+	int i;
+
+	if ((ret=OPENSSL_malloc(sizeof(_CLHASH))) == NULL)
+		return NULL;
+	memset(ret, 0, sizeof(_CLHASH));
+	ret->comp=((c == NULL)?(LHASH_COMP_FN_TYPE)strcmp:c);
+	ret->hash=((h == NULL)?(LHASH_HASH_FN_TYPE)lh_strhash:h);
+	ret->lock=lock;
+
+	dyn_create=CRYPTO_get_dynlock_create_callback();
+	ret->dyn_lock=CRYPTO_get_dynlock_lock_callback();
+	ret->dyn_destroy=CRYPTO_get_dynlock_destroy_callback();
+	if (ret->dyn_lock == NULL || ret->dyn_destroy == NULL)
+		dyn_create=NULL;
+
+	for (i=0; i<CLH_SEGMENTS; i++)
+		{
+		seg= &ret->seg[i];
+		if ((seg->b=OPENSSL_malloc(sizeof(LHASH_NODE *)*MIN_NODES))
+			== NULL)
+			goto err;
+		memset(seg->b, 0, sizeof(LHASH_NODE *)*MIN_NODES);
+		seg->num_nodes=MIN_NODES/2;
+		seg->num_alloc_nodes=MIN_NODES;
+		seg->pmax=MIN_NODES/2;
+		if (dyn_create != NULL)
+			seg->dynlock=dyn_create(__FILE__,__LINE__);
+		}
+	return ret;
+err:
+	clh_free(ret);
+	return NULL;
+	}
+
+void clh_free(_CLHASH *ch)
+	{
+	CLHASH_SEG *seg;
+	LHASH_NODE *n,*nn;
+	unsigned int i;
+	int s;
+
+	if (ch == NULL)
+		return;
+
+	for (s=0; s<CLH_SEGMENTS; s++)
+		{
+		seg= &ch->seg[s];
+		if (seg->b == NULL)
+			continue;
+		for (i=0; i<seg->num_nodes; i++)
+			{
+			for (n=seg->b[i]; n != NULL; n=nn)
+				{
+				nn=n->next;
+				OPENSSL_free(n);
+				}
+			}
+		OPENSSL_free(seg->b);
+		if (seg->dynlock != NULL)
+			ch->dyn_destroy(seg->dynlock,__FILE__,__LINE__);
+		}
+	OPENSSL_free(ch);
+	}
+
+/* Split bucket p of the segment, doubling the bucket array first if all
+ * buckets have been split. If the array cannot be grown the segment is
+ * left as it is, which only makes its chains longer. */
+static void expand(CLHASH_SEG *seg)
+	{
+	LHASH_NODE **n,**n1,**n2,*np;
+	unsigned int p,i,j;
+
+	if (seg->p+seg->pmax >= seg->num_alloc_nodes)
+		return;
+	p=seg->p;
+	n1= &(seg->b[p]);
+	n2= &(seg->b[p+seg->pmax]);
+	*n2=NULL;
+	for (np= *n1; np != NULL; np= *n1)
+		{
+		if ((np->hash%seg->num_alloc_nodes) != p)
+			{ /* move it */
+			*n1=np->next;
+			np->next= *n2;
+			*n2=np;
+			}
+		else
+			n1= &(np->next);
+		}
+	seg->num_nodes++;
+	seg->p++;
+
+	if (seg->p >= seg->pmax)
+		{
+		j=seg->num_alloc_nodes*2;
+		n=(LHASH_NODE **)OPENSSL_realloc(seg->b,
+			sizeof(LHASH_NODE *)*j);
+		if (n == NULL)
+			{
+			/* Try again when the next item is added */
+			seg->p--;
+			seg->num_nodes--;
+			n1= &(seg->b[p]);
+			while (*n1 != NULL)
+				n1= &((*n1)->next);
+			*n1=seg->b[p+seg->pmax];
+			seg->b[p+seg->pmax]=NULL;
+			return;
+			}
+		for (i=seg->num_alloc_nodes; i<j; i++)
+			n[i]=NULL;
+		seg->pmax=seg->num_alloc_nodes;
+		seg->num_alloc_nodes=j;
+		seg->p=0;
+		seg->b=n;
+		}
+	}
+
+/* Merge the last bucket of the segment back into the bucket it was split
+ * from, halving the bucket array once all buckets have been merged. */
+static void contract(CLHASH_SEG *seg)
+	{
+	LHASH_NODE **n,*n1,*np;
+
+	if (seg->p == 0)
+		{
+		n=(LHASH_NODE **)OPENSSL_realloc(seg->b,
+			sizeof(LHASH_NODE *)*seg->pmax);
+		if (n == NULL)
+			return;
+		seg->b=n;
+		seg->num_alloc_nodes/=2;
+		seg->pmax/=2;
+		seg->p=seg->pmax;
+		}
+	seg->p--;
+	np=seg->b[seg->p+seg->pmax];
+	seg->b[seg->p+seg->pmax]=NULL;
+	seg->num_nodes--;
+
+	n1=seg->b[seg->p];
+	if (n1 == NULL)
+		seg->b[seg->p]=np;
+	else
+		{
+		while (n1->next != NULL)
+			n1=n1->next;
+		n1->next=np;
+		}
+	}
+
+static LHASH_NODE **getrn(_CLHASH *ch, CLHASH_SEG *seg, const void *data,
+	unsigned long hash)
+	{
+	LHASH_NODE **ret,*n1;
+	unsigned long nn;
+
+	nn=hash%seg->pmax;
+	if (nn < seg->p)
+		nn=hash%seg->num_alloc_nodes;
+
+	ret= &(seg->b[nn]);
+	for (n1= *ret; n1 != NULL; n1=n1->next)
+		{
+		if (n1->hash == hash && ch->comp(n1->data,data) == 0)
+			break;
+		ret= &(n1->next);
+		}
+	return ret;
+	}
+
+/* Insert 'data' unless an item that compares equal to it is in the table,
+ * which is replaced if 'replace' is set. That item, or NULL, is returned in
+ * '*found'. Returns 0 if memory could not be allocated. */
+static int insert(_CLHASH *ch, void *data, int replace, void **found)
+	{
+	unsigned long hash;
+	CLHASH_SEG *seg;
+	LHASH_NODE *nn,**rn;
+	void *ret=NULL;
+
+	hash=ch->hash(data);
+	seg=CLH_SEG(ch, hash);
+	/* Allocated beforehand so that the lock is not held by malloc() */
+	if ((nn=(LHASH_NODE *)OPENSSL_malloc(sizeof(LHASH_NODE))) == NULL)
+		return 0;
+
+	seg_w_lock(ch, seg);
+	if (UP_LOAD <= (seg->num_items*LH_LOAD_MULT/seg->num_nodes))
+		expand(seg);
+	rn=getrn(ch,seg,data,hash);
+	if (*rn == NULL)
+		{
+		nn->data=data;
+		nn->next=NULL;
+		nn->hash=hash;
+		*rn=nn;
+		nn=NULL;
+		seg->num_items++;
+		}
+	else /* same key */
+		{
+		ret=(*rn)->data;
+		if (replace)
+			(*rn)->data=data;
+		}
+	seg_w_unlock(ch, seg);
+
+	if (nn != NULL)
+		OPENSSL_free(nn);
+	*found=ret;
+	return 1;
+	}
+
+/* Insert 'data', replacing an item that compares equal to it. The replaced
+ * item, or NULL, is returned in '*replaced' if 'replaced' is not NULL.
+ * Returns 0 if memory could not be allocated. */
+int clh_insert(_CLHASH *ch, void *data, void **replaced)
+	{
+	void *ret;
+
+	if (!insert(ch,data,1,&ret))
+		return 0;
+	if (replaced != NULL)
+		*replaced=ret;
+	return 1;
+	}
+
+/* Insert 'data' unless an item that compares equal to it is already in the
+ * table. Returns the item in the table, which is 'data' if it was inserted,
+ * or NULL if memory could not be allocated. */
+void *clh_insert_new(_CLHASH *ch, void *data)
+	{
+	void *ret;
+
+	if (!insert(ch,data,0,&ret))
+		return NULL;
+	return ret != NULL ? ret : data;
+	}
+
+void *clh_delete(_CLHASH *ch, const void *data)
+	{
+	unsigned long hash;
+	CLHASH_SEG *seg;
+	LHASH_NODE *nn=NULL,**rn;
+	void *ret=NULL;
+
+	hash=ch->hash(data);
+	seg=CLH_SEG(ch, hash);
+
+	seg_w_lock(ch, seg);
+	rn=getrn(ch,seg,data,hash);
+	if (*rn != NULL)
+		{
+		nn= *rn;
+		*rn=nn->next;
+		ret=nn->data;
+		seg->num_items--;
+		if ((seg->num_nodes > MIN_NODES) &&
+		    (DOWN_LOAD >= (seg->num_items*LH_LOAD_MULT/seg->num_nodes)))
+			contract(seg);
+		}
+	seg_w_unlock(ch, seg);
+
+	if (nn != NULL)
+		OPENSSL_free(nn);
+	return ret;
+	}
+
+/* Look up the item that compares equal to 'data'. If 'hit' is not NULL it
+ * is called with the item while the table is still locked, for example to
+ * take a reference to it before another thread can delete it. */
+void *clh_retrieve(_CLHASH *ch, const void *data, LHASH_DOALL_FN_TYPE hit)
+	{
+	unsigned long hash;
+	CLHASH_SEG *seg;
+	LHASH_NODE **rn;
+	void *ret=NULL;
+
+	hash=ch->hash(data);
+	seg=CLH_SEG(ch, hash);
+
+	seg_r_lock(ch, seg);
+	rn=getrn(ch,seg,data,hash);
+	if (*rn != NULL)
+		{
+		ret=(*rn)->data;
+		if (hit != NULL)
+			hit(ret);
+		}
+	seg_r_unlock(ch, seg);
+	return ret;
+	}
+
+static void doall_util_fn(_CLHASH *ch, int use_arg, LHASH_DOALL_FN_TYPE func,
+			  LHASH_DOALL_ARG_FN_TYPE func_arg, void *arg)
+	{
+	CLHASH_SEG *seg;
+	LHASH_NODE *a;
+	unsigned int i;
+	int s;
+
+	if (ch == NULL)
+		return;
+
+	for (s=0; s<CLH_SEGMENTS; s++)
+		{
+		seg= &ch->seg[s];
+		seg_r_lock(ch, seg);
+		for (i=0; i<seg->num_nodes; i++)
+			{
+			for (a=seg->b[i]; a != NULL; a=a->next)
+				{
+				if (use_arg)
+					func_arg(a->data,arg);
+				else
+					func(a->data);
+				}
+			}
+		seg_r_unlock(ch, seg);
+		}
+	}
+
+/* The callbacks of clh_doall() and clh_doall_arg() are called with a
+ * segment locked, so they must not call any clh_ function on the table. */
+void clh_doall(_CLHASH *ch, LHASH_DOALL_FN_TYPE func)
+	{
+	doall_util_fn(ch, 0, func, (LHASH_DOALL_ARG_FN_TYPE)0, NULL);
+	}
+
+void clh_doall_arg(_CLHASH *ch, LHASH_DOALL_ARG_FN_TYPE func, void *arg)
+	{
+	doall_util_fn(ch, 1, (LHASH_DOALL_FN_TYPE)0, func, arg);
+	}
+
+unsigned long clh_num_items(_CLHASH *ch)
+	{
+	unsigned long ret=0;
+	int s;
+
+	if (ch == NULL)
+		return 0;
+	for (s=0; s<CLH_SEGMENTS; s++)
+		{
+		seg_r_lock(ch, &ch->seg[s]);
+		ret+=ch->seg[s].num_items;
+		seg_r_unlock(ch, &ch->seg[s]);
+		}
+	return ret;
+	}
@@ -233,6 +233,51 @@ void lh_node_usage_stats_bio(const _LHASH *lh, BIO *out);
 DECLARE_LHASH_OF(OPENSSL_STRING);
 DECLARE_LHASH_OF(OPENSSL_CSTRING);
 
+/* A hash table that does its own locking and can be shared between
+ * threads, see clhash.c. */
+typedef struct clhash_st _CLHASH;	/* Do not use _CLHASH directly, use
+					 * CLHASH_OF and friends */
+
+_CLHASH *clh_new(LHASH_HASH_FN_TYPE h, LHASH_COMP_FN_TYPE c, int lock);
+void clh_free(_CLHASH *ch);
+int clh_insert(_CLHASH *ch, void *data, void **replaced);
+void *clh_insert_new(_CLHASH *ch, void *data);
+void *clh_delete(_CLHASH *ch, const void *data);
+void *clh_retrieve(_CLHASH *ch, const void *data, LHASH_DOALL_FN_TYPE hit);
+void clh_doall(_CLHASH *ch, LHASH_DOALL_FN_TYPE func);
+void clh_doall_arg(_CLHASH *ch, LHASH_DOALL_ARG_FN_TYPE func, void *arg);
+unsigned long clh_num_items(_CLHASH *ch);
+
+#define CLHASH_OF(type) struct clhash_st_##type
+
+#define DECLARE_CLHASH_OF(type) CLHASH_OF(type) { int dummy; }
+
+#define CHECKED_CLHASH_OF(type,ch) \
+  ((_CLHASH *)CHECKED_PTR_OF(CLHASH_OF(type),ch))
+
+#define CLHM_clh_new(type, name, lock) \
+  ((CLHASH_OF(type) *)clh_new(LHASH_HASH_FN(name), LHASH_COMP_FN(name), \
+			      lock))
+#define CLHM_clh_insert(type, ch, inst, replaced) \
+  clh_insert(CHECKED_CLHASH_OF(type, ch), CHECKED_PTR_OF(type, inst), \
+	     (void **)CHECKED_PTR_OF(type *, replaced))
+#define CLHM_clh_insert_new(type, ch, inst) \
+  ((type *)clh_insert_new(CHECKED_CLHASH_OF(type, ch), \
+			  CHECKED_PTR_OF(type, inst)))
+#define CLHM_clh_retrieve(type, ch, inst, hit) \
+  ((type *)clh_retrieve(CHECKED_CLHASH_OF(type, ch), \
+			CHECKED_PTR_OF(type, inst), hit))
+#define CLHM_clh_delete(type, ch, inst) \
+  ((type *)clh_delete(CHECKED_CLHASH_OF(type, ch), \
+		      CHECKED_PTR_OF(type, inst)))
+#define CLHM_clh_doall(type, ch, fn) clh_doall(CHECKED_CLHASH_OF(type, ch), fn)
+#define CLHM_clh_doall_arg(type, ch, fn, arg_type, arg) \
+  clh_doall_arg(CHECKED_CLHASH_OF(type, ch), fn, \
+		CHECKED_PTR_OF(arg_type, arg))
+#define CLHM_clh_num_items(type, ch) \
+  clh_num_items(CHECKED_CLHASH_OF(type, ch))
+#define CLHM_clh_free(type, ch) clh_free(CHECKED_CLHASH_OF(type, ch))
+
 #ifdef  __cplusplus
 }
 #endif
@@ -167,7 +167,26 @@ static const char* const lock_names[CRYPTO_NUM_LOCKS] =
 	"comp",
 	"fips",
 	"fips2",
-#if CRYPTO_NUM_LOCKS != 41
+	"ssl_sess_shard0",
+	"ssl_sess_shard1",
+	"ssl_sess_shard2",
+	"ssl_sess_shard3",
+	"ssl_sess_shard4",
+	"ssl_sess_shard5",
+	"ssl_sess_shard6",
+	"ssl_sess_shard7",
+	"ssl_sess_shard8",
+	"ssl_sess_shard9",
+	"ssl_sess_shard10",
+	"ssl_sess_shard11",
+	"ssl_sess_shard12",
+	"ssl_sess_shard13",
+	"ssl_sess_shard14",
+	"ssl_sess_shard15",
+	"ssl_buf",
+	"asn1_arena",
+	"fork",
+#if CRYPTO_NUM_LOCKS != 60
 # error "Inconsistency between crypto.h and cryptlib.c"
 #endif
 	};
@@ -489,6 +508,23 @@ int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
 		}
 #endif
 		}
+#ifdef CRYPTO_ATOMIC_ADD
+	else
+		{
+		ret=CRYPTO_ATOMIC_ADD(pointer,amount);
+#ifdef LOCK_DEBUG
+		{
+		CRYPTO_THREADID id;
+		CRYPTO_THREADID_current(&id);
+		fprintf(stderr,"ladd:%08lx:%2d+%2d->%2d %-18s %s:%d\n",
+			CRYPTO_THREADID_hash(&id),
+			ret-amount,amount,ret,
+			CRYPTO_get_lock_name(type),
+			file,line);
+		}
+#endif
+		}
+#else
 	else
 		{
 		CRYPTO_lock(CRYPTO_LOCK|CRYPTO_WRITE,type,file,line);
@@ -508,9 +544,38 @@ int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
 		*pointer=ret;
 		CRYPTO_lock(CRYPTO_UNLOCK|CRYPTO_WRITE,type,file,line);
 		}
+#endif
 	return(ret);
 	}
 
+/* Add to a reference count whose lock the caller already holds. Counts
+ * that are also changed by CRYPTO_add() must be changed with this rather
+ * than directly, since CRYPTO_add() may not take the lock. */
+int CRYPTO_add_locked(int *pointer, int amount)
+	{
+#ifdef CRYPTO_ATOMIC_ADD
+	if (add_lock_callback == NULL)
+		return CRYPTO_ATOMIC_ADD(pointer,amount);
+#endif
+	*pointer+=amount;
+	return *pointer;
+	}
+
+/* Add to a reference count atomically, which callers holding its lock only
+ * for reading must do. Returns 0, leaving the count unchanged, if it
+ * cannot be done; the caller then has to take the lock for writing. */
+int CRYPTO_add_atomic(int *pointer, int amount, int *ret)
+	{
+#ifdef CRYPTO_ATOMIC_ADD
+	if (add_lock_callback == NULL)
+		{
+		*ret=CRYPTO_ATOMIC_ADD(pointer,amount);
+		return 1;
+		}
+#endif
+	return 0;
+	}
+
 const char *CRYPTO_get_lock_name(int type)
 	{
 	if (type < 0)
@@ -62,12 +62,12 @@
  * [including the GNU Public Licence.]
  */
 
-#define NUM_NID 961
-#define NUM_SN 954
-#define NUM_LN 954
-#define NUM_OBJ 890
+#define NUM_NID 964
+#define NUM_SN 957
+#define NUM_LN 957
+#define NUM_OBJ 891
 
-static const unsigned char lvalues[6255]={
+static const unsigned char lvalues[6258]={
 0x2A,0x86,0x48,0x86,0xF7,0x0D,               /* [  0] OBJ_rsadsi */
 0x2A,0x86,0x48,0x86,0xF7,0x0D,0x01,          /* [  6] OBJ_pkcs */
 0x2A,0x86,0x48,0x86,0xF7,0x0D,0x02,0x02,     /* [ 13] OBJ_md2 */
@@ -952,6 +952,7 @@ static const unsigned char lvalues[6255]={
 0x2B,0x06,0x01,0x04,0x01,0x82,0x37,0x3C,0x02,0x01,0x01,/* [6221] OBJ_jurisdictionLocalityName */
 0x2B,0x06,0x01,0x04,0x01,0x82,0x37,0x3C,0x02,0x01,0x02,/* [6232] OBJ_jurisdictionStateOrProvinceName */
 0x2B,0x06,0x01,0x04,0x01,0x82,0x37,0x3C,0x02,0x01,0x03,/* [6243] OBJ_jurisdictionCountryName */
+0x2B,0x65,0x6E,                              /* [6254] OBJ_X25519 */
 };
 
 static const ASN1_OBJECT nid_objs[NUM_NID]={
@@ -2517,6 +2518,9 @@ static const ASN1_OBJECT nid_objs[NUM_NID]={
 {"AES-128-OCB","aes-128-ocb",NID_aes_128_ocb,0,NULL,0},
 {"AES-192-OCB","aes-192-ocb",NID_aes_192_ocb,0,NULL,0},
 {"AES-256-OCB","aes-256-ocb",NID_aes_256_ocb,0,NULL,0},
+{"X25519","X25519",NID_X25519,3,&(lvalues[6254]),0},
+{"ChaCha20","chacha20",NID_chacha20,0,NULL,0},
+{"ChaCha20-Poly1305","chacha20-poly1305",NID_chacha20_poly1305,0,NULL,0},
 };
 
 static const unsigned int sn_objs[NUM_SN]={
@@ -2584,6 +2588,8 @@ static const unsigned int sn_objs[NUM_SN]={
 13,	/* "CN" */
 141,	/* "CRLReason" */
 417,	/* "CSPName" */
+962,	/* "ChaCha20" */
+963,	/* "ChaCha20-Poly1305" */
 367,	/* "CrlID" */
 391,	/* "DC" */
 31,	/* "DES-CBC" */
@@ -2710,6 +2716,7 @@ static const unsigned int sn_objs[NUM_SN]={
 143,	/* "SXNetID" */
 458,	/* "UID" */
  0,	/* "UNDEF" */
+961,	/* "X25519" */
 11,	/* "X500" */
 378,	/* "X500algorithms" */
 12,	/* "X509" */
@@ -3589,6 +3596,7 @@ static const unsigned int ln_objs[NUM_LN]={
 129,	/* "TLS Web Server Authentication" */
 133,	/* "Time Stamping" */
 375,	/* "Trust Root" */
+961,	/* "X25519" */
 12,	/* "X509" */
 402,	/* "X509v3 AC Targeting" */
 746,	/* "X509v3 Any Policy" */
@@ -3737,6 +3745,8 @@ static const unsigned int ln_objs[NUM_LN]={
 677,	/* "certicom-arc" */
 517,	/* "certificate extensions" */
 883,	/* "certificateRevocationList" */
+962,	/* "chacha20" */
+963,	/* "chacha20-poly1305" */
 54,	/* "challengePassword" */
 407,	/* "characteristic-two-field" */
 395,	/* "clearance" */
@@ -4455,6 +4465,7 @@ static const unsigned int obj_objs[NUM_OBJ]={
 435,	/* OBJ_pss                          0 9 2342 */
 183,	/* OBJ_ISO_US                       1 2 840 */
 381,	/* OBJ_iana                         1 3 6 1 */
+961,	/* OBJ_X25519                       1 3 101 110 */
 677,	/* OBJ_certicom_arc                 1 3 132 */
 394,	/* OBJ_selected_attribute_types     2 5 1 5 */
 13,	/* OBJ_commonName                   2 5 4 3 */
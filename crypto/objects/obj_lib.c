@@ -70,7 +70,8 @@ ASN1_OBJECT *OBJ_dup(const ASN1_OBJECT *o)
 	unsigned char *data=NULL;
 
 	if (o == NULL) return(NULL);
-	if (!(o->flags & ASN1_OBJECT_FLAG_DYNAMIC))
+	/* Objects in an arena go away with it, so they are copied */
+	if (!(o->flags & (ASN1_OBJECT_FLAG_DYNAMIC|ASN1_OBJECT_FLAG_ARENA)))
 		return((ASN1_OBJECT *)o); /* XXX: ugh! Why? What kind of
 					     duplication is this??? */
 
@@ -107,7 +108,7 @@ ASN1_OBJECT *OBJ_dup(const ASN1_OBJECT *o)
 		memcpy(sn,o->sn,i);
 		r->sn=sn;
 		}
-	r->flags=o->flags|(ASN1_OBJECT_FLAG_DYNAMIC|
+	r->flags=(o->flags & ~ASN1_OBJECT_FLAG_ARENA)|(ASN1_OBJECT_FLAG_DYNAMIC|
 		ASN1_OBJECT_FLAG_DYNAMIC_STRINGS|ASN1_OBJECT_FLAG_DYNAMIC_DATA);
 	return(r);
 err:
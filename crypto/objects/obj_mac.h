@@ -4205,3 +4205,15 @@
 #define NID_jurisdictionCountryName		957
 #define OBJ_jurisdictionCountryName		1L,3L,6L,1L,4L,1L,311L,60L,2L,1L,3L
 
+#define SN_X25519		"X25519"
+#define NID_X25519		961
+#define OBJ_X25519		1L,3L,101L,110L
+
+#define SN_chacha20		"ChaCha20"
+#define LN_chacha20		"chacha20"
+#define NID_chacha20		962
+
+#define SN_chacha20_poly1305		"ChaCha20-Poly1305"
+#define LN_chacha20_poly1305		"chacha20-poly1305"
+#define NID_chacha20_poly1305		963
+
@@ -468,6 +468,7 @@ DECLARE_PEM_rw(X509_REQ, X509_REQ)
 DECLARE_PEM_write(X509_REQ_NEW, X509_REQ)
 
 DECLARE_PEM_rw(X509_CRL, X509_CRL)
+DECLARE_PEM_read(X509_CRL_compact, X509_CRL)
 
 DECLARE_PEM_rw(PKCS7, PKCS7)
 
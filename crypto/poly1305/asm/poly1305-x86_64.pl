@@ -0,0 +1,178 @@
+#!/usr/bin/env perl
+#
+# ====================================================================
+# Written for the OpenSSL project.
+# ====================================================================
+#
+# Poly1305 for x86_64.
+#
+# The accumulator is kept in base 2^64, two full limbs and a few bits
+# above them, and each 16-byte block costs four 64x64->128-bit mulq
+# multiplications instead of the sixteen 32x32->64-bit ones in
+# poly1305.c. Clamping makes the low two bits of r1 zero, so that
+# r1*2^128 can be folded as 5*(r1/4) and the product needs no separate
+# reduction step: it is left partially reduced, below 2^130 plus a
+# little, until poly1305_emit.
+#
+# This is about 3 times as fast as the C code on long inputs; the
+# limiting factor is the latency of the mulq chain through h0 and h1.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+# Layout of the context: h0, h1, h2, r0, r1, 8 bytes each.
+my ($ctx,$inp,$len,$padbit)=("%rdi","%rsi","%rdx","%rcx");
+my ($r0,$r1,$s1)=("%r11","%r12","%r13");
+my ($h0,$h1,$h2)=("%r14","%rbx","%rbp");
+my ($d0,$d0hi,$d1)=("%r8","%r9","%r10");
+
+$code.=<<___;
+.text
+
+.globl	poly1305_init
+.type	poly1305_init,\@function,2
+.align	32
+poly1305_init:
+	xor	%rax,%rax
+	mov	%rax,0($ctx)		# h = 0
+	mov	%rax,8($ctx)
+	mov	%rax,16($ctx)
+
+	mov	\$0x0ffffffc0fffffff,%rax
+	mov	\$0x0ffffffc0ffffffc,%rcx
+	and	0(%rsi),%rax		# r &= 0xffffffc0ffffffc0ffffffc0fffffff
+	and	8(%rsi),%rcx
+	mov	%rax,24($ctx)
+	mov	%rcx,32($ctx)
+	ret
+.size	poly1305_init,.-poly1305_init
+
+.globl	poly1305_blocks
+.type	poly1305_blocks,\@function,4
+.align	32
+poly1305_blocks:
+	shr	\$4,$len		# number of blocks
+	jz	.Lno_data
+
+	push	%rbx
+	push	%rbp
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+
+	mov	$len,%r15
+	mov	%ecx,%ecx		# padbit is unsigned int
+	mov	24($ctx),$r0
+	mov	32($ctx),$r1
+	mov	$r1,$s1
+	shr	\$2,$s1
+	add	$r1,$s1			# s1 = r1 + (r1 >> 2)
+
+	mov	0($ctx),$h0
+	mov	8($ctx),$h1
+	mov	16($ctx),$h2
+	jmp	.Loop
+
+.align	32
+.Loop:
+	add	0($inp),$h0		# h += m[i]
+	adc	8($inp),$h1
+	adc	$padbit,$h2
+	lea	16($inp),$inp
+
+	mov	$r0,%rax		# d0 = h0*r0 + h1*s1
+	mulq	$h0
+	mov	%rax,$d0
+	mov	%rdx,$d0hi
+	mov	$s1,%rax
+	mulq	$h1
+	add	%rax,$d0
+	adc	%rdx,$d0hi
+
+	mov	$r1,%rax		# d1 = h0*r1 + h1*r0 + h2*s1
+	mulq	$h0
+	mov	%rax,$d1
+	mov	%rdx,$h0		# h0 is dead, reuse it for d1 high
+	mov	$r0,%rax
+	mulq	$h1
+	add	%rax,$d1
+	adc	%rdx,$h0
+	mov	$s1,%rax
+	imul	$h2,%rax
+	add	%rax,$d1
+	adc	\$0,$h0
+
+	imul	$r0,$h2			# d2 = h2*r0
+
+	add	$d1,$d0hi		# h = d0 + d1*2^64 + d2*2^128
+	adc	$h0,$h2
+	mov	$d0,$h0
+	mov	$d0hi,$h1
+
+	mov	$h2,%rax		# h %= 2^130 partially: carry what
+	mov	$h2,%rdx		# is above it back in times 5
+	and	\$-4,%rax
+	shr	\$2,%rdx
+	and	\$3,$h2
+	add	%rdx,%rax
+	add	%rax,$h0
+	adc	\$0,$h1
+	adc	\$0,$h2
+
+	dec	%r15
+	jnz	.Loop
+
+	mov	$h0,0($ctx)
+	mov	$h1,8($ctx)
+	mov	$h2,16($ctx)
+
+	pop	%r15
+	pop	%r14
+	pop	%r13
+	pop	%r12
+	pop	%rbp
+	pop	%rbx
+.Lno_data:
+	ret
+.size	poly1305_blocks,.-poly1305_blocks
+
+.globl	poly1305_emit
+.type	poly1305_emit,\@function,3
+.align	32
+poly1305_emit:
+	mov	0($ctx),%r8
+	mov	8($ctx),%r9
+	mov	16($ctx),%r10
+
+	mov	%r8,%rax		# compare to modulus by computing h + -p
+	add	\$5,%r8
+	mov	%r9,%rcx
+	adc	\$0,%r9
+	adc	\$0,%r10
+	shr	\$2,%r10		# did it carry into 131st bit?
+	cmovz	%rax,%r8
+	cmovz	%rcx,%r9
+
+	add	0(%rdx),%r8		# mac = (h + nonce) % 2^128
+	adc	8(%rdx),%r9
+	mov	%r8,0(%rsi)
+	mov	%r9,8(%rsi)
+	ret
+.size	poly1305_emit,.-poly1305_emit
+___
+
+$code =~ s/\`([^\`]*)\`/eval $1/gem;
+print $code;
+close STDOUT;
@@ -0,0 +1,342 @@
+/* crypto/poly1305/poly1305.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ */
+
+
+/*
+ * Poly1305 one-time authenticator, as specified in RFC 7539.
+ *
+ * The C code here keeps the accumulator in base 2^32 and works with
+ * 32x32->64-bit multiplications only; assembly modules in asm/ provide
+ * poly1305_init, poly1305_blocks and poly1305_emit where available and
+ * the build defines POLY1305_ASM for them.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "internal/poly1305.h"
+
+typedef unsigned char u8;
+typedef unsigned int u32;
+
+/* pick 32-bit unsigned integer in little endian order */
+static unsigned int U8TOU32(const unsigned char *p)
+	{
+	return (((unsigned int)(p[0] & 0xff)) |
+		((unsigned int)(p[1] & 0xff) << 8) |
+		((unsigned int)(p[2] & 0xff) << 16) |
+		((unsigned int)(p[3] & 0xff) << 24));
+	}
+
+/*
+ * Each call to poly1305_blocks processes |len| bytes, a multiple of
+ * POLY1305_BLOCK_SIZE, with |padbit| added above each 16-byte block:
+ * 1 for complete blocks, 0 for the already padded final one.
+ */
+void poly1305_init(void *ctx, const unsigned char key[16]);
+void poly1305_blocks(void *ctx, const unsigned char *inp, size_t len,
+			unsigned int padbit);
+void poly1305_emit(void *ctx, unsigned char mac[16],
+			const unsigned int nonce[4]);
+
+#ifndef POLY1305_ASM
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+typedef unsigned __int64 u64;
+#else
+typedef unsigned long long u64;
+#endif
+
+/*
+ * Constant-time conditional carry: to leave no trace of whether the
+ * accumulator exceeded the modulus, the final reduction adds or keeps
+ * with a mask rather than a branch.
+ */
+#define CONSTANT_TIME_CARRY(a,b) ( \
+	(a ^ ((a ^ b) | ((a - b) ^ b))) >> (sizeof(a) * 8 - 1) \
+	)
+
+typedef struct
+	{
+	u32 h[5];
+	u32 r[4];
+	} poly1305_internal;
+
+void poly1305_init(void *ctx, const unsigned char key[16])
+	{
+	poly1305_internal *st = (poly1305_internal *) ctx;
+
+	/* h = 0 */
+	st->h[0] = 0;
+	st->h[1] = 0;
+	st->h[2] = 0;
+	st->h[3] = 0;
+	st->h[4] = 0;
+
+	/* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+	st->r[0] = U8TOU32(&key[0]) & 0x0fffffff;
+	st->r[1] = U8TOU32(&key[4]) & 0x0ffffffc;
+	st->r[2] = U8TOU32(&key[8]) & 0x0ffffffc;
+	st->r[3] = U8TOU32(&key[12]) & 0x0ffffffc;
+	}
+
+void poly1305_blocks(void *ctx, const unsigned char *inp, size_t len,
+			unsigned int padbit)
+	{
+	poly1305_internal *st = (poly1305_internal *)ctx;
+	u32 r0, r1, r2, r3;
+	u32 s1, s2, s3;
+	u32 h0, h1, h2, h3, h4, c;
+	u64 d0, d1, d2, d3;
+
+	r0 = st->r[0];
+	r1 = st->r[1];
+	r2 = st->r[2];
+	r3 = st->r[3];
+
+	/* r is clamped, so s_i = r_i * 5/4 fits and is exact */
+	s1 = r1 + (r1 >> 2);
+	s2 = r2 + (r2 >> 2);
+	s3 = r3 + (r3 >> 2);
+
+	h0 = st->h[0];
+	h1 = st->h[1];
+	h2 = st->h[2];
+	h3 = st->h[3];
+	h4 = st->h[4];
+
+	while (len >= POLY1305_BLOCK_SIZE)
+		{
+		/* h += m[i] */
+		h0 = (u32)(d0 = (u64)h0 + U8TOU32(inp + 0));
+		h1 = (u32)(d1 = (u64)h1 + (d0 >> 32) + U8TOU32(inp + 4));
+		h2 = (u32)(d2 = (u64)h2 + (d1 >> 32) + U8TOU32(inp + 8));
+		h3 = (u32)(d3 = (u64)h3 + (d2 >> 32) + U8TOU32(inp + 12));
+		h4 += (u32)(d3 >> 32) + padbit;
+
+		/* h *= r "%" p, where "%" stands for "partial remainder" */
+		d0 = ((u64)h0 * r0) +
+		     ((u64)h1 * s3) +
+		     ((u64)h2 * s2) +
+		     ((u64)h3 * s1);
+		d1 = ((u64)h0 * r1) +
+		     ((u64)h1 * r0) +
+		     ((u64)h2 * s3) +
+		     ((u64)h3 * s2) +
+		     (h4 * s1);
+		d2 = ((u64)h0 * r2) +
+		     ((u64)h1 * r1) +
+		     ((u64)h2 * r0) +
+		     ((u64)h3 * s3) +
+		     (h4 * s2);
+		d3 = ((u64)h0 * r3) +
+		     ((u64)h1 * r2) +
+		     ((u64)h2 * r1) +
+		     ((u64)h3 * r0) +
+		     (h4 * s3);
+		h4 = (h4 * r0);
+
+		/* last reduction step: */
+		/* a) h4:h0 = h4<<128 + d3<<96 + d2<<64 + d1<<32 + d0 */
+		h0 = (u32)d0;
+		h1 = (u32)(d1 += d0 >> 32);
+		h2 = (u32)(d2 += d1 >> 32);
+		h3 = (u32)(d3 += d2 >> 32);
+		h4 += (u32)(d3 >> 32);
+		/* b) (h4:h0 += (h4:h0>>130) * 5) %= 2^130 */
+		c = (h4 >> 2) + (h4 & ~3U);
+		h4 &= 3;
+		h0 += c;
+		h1 += (c = CONSTANT_TIME_CARRY(h0,c));
+		h2 += (c = CONSTANT_TIME_CARRY(h1,c));
+		h3 += (c = CONSTANT_TIME_CARRY(h2,c));
+		h4 += CONSTANT_TIME_CARRY(h3,c);
+		/*
+		 * Occasional overflows to 3rd bit of h4 are taken care of
+		 * "naturally". If after this point we end up at the top of
+		 * this loop, then the overflow bit will be accounted for
+		 * in next iteration. If we end up in poly1305_emit, then
+		 * comparison to modulus below will still count as "carry
+		 * into 131st bit", so that properly reduced value will be
+		 * picked in conditional move.
+		 */
+
+		inp += POLY1305_BLOCK_SIZE;
+		len -= POLY1305_BLOCK_SIZE;
+		}
+
+	st->h[0] = h0;
+	st->h[1] = h1;
+	st->h[2] = h2;
+	st->h[3] = h3;
+	st->h[4] = h4;
+	}
+
+void poly1305_emit(void *ctx, unsigned char mac[16],
+			const unsigned int nonce[4])
+	{
+	poly1305_internal *st = (poly1305_internal *) ctx;
+	u32 h0, h1, h2, h3, h4;
+	u32 g0, g1, g2, g3, g4;
+	u64 t;
+	u32 mask;
+
+	h0 = st->h[0];
+	h1 = st->h[1];
+	h2 = st->h[2];
+	h3 = st->h[3];
+	h4 = st->h[4];
+
+	/* compare to modulus by computing h + -p */
+	g0 = (u32)(t = (u64)h0 + 5);
+	g1 = (u32)(t = (u64)h1 + (t >> 32));
+	g2 = (u32)(t = (u64)h2 + (t >> 32));
+	g3 = (u32)(t = (u64)h3 + (t >> 32));
+	g4 = h4 + (u32)(t >> 32);
+
+	/* if there was carry into 131st bit, h3:h0 = g3:g0 */
+	mask = 0 - (g4 >> 2);
+	g0 &= mask;
+	g1 &= mask;
+	g2 &= mask;
+	g3 &= mask;
+	mask = ~mask;
+	h0 = (h0 & mask) | g0;
+	h1 = (h1 & mask) | g1;
+	h2 = (h2 & mask) | g2;
+	h3 = (h3 & mask) | g3;
+
+	/* mac = (h + nonce) % (2^128) */
+	h0 = (u32)(t = (u64)h0 + nonce[0]);
+	h1 = (u32)(t = (u64)h1 + (t >> 32) + nonce[1]);
+	h2 = (u32)(t = (u64)h2 + (t >> 32) + nonce[2]);
+	h3 = (u32)(t = (u64)h3 + (t >> 32) + nonce[3]);
+
+	mac[0] = (u8)h0; mac[1] = (u8)(h0 >> 8);
+	mac[2] = (u8)(h0 >> 16); mac[3] = (u8)(h0 >> 24);
+	mac[4] = (u8)h1; mac[5] = (u8)(h1 >> 8);
+	mac[6] = (u8)(h1 >> 16); mac[7] = (u8)(h1 >> 24);
+	mac[8] = (u8)h2; mac[9] = (u8)(h2 >> 8);
+	mac[10] = (u8)(h2 >> 16); mac[11] = (u8)(h2 >> 24);
+	mac[12] = (u8)h3; mac[13] = (u8)(h3 >> 8);
+	mac[14] = (u8)(h3 >> 16); mac[15] = (u8)(h3 >> 24);
+	}
+#endif
+
+void Poly1305_Init(POLY1305 *ctx, const unsigned char key[32])
+	{
+	ctx->nonce[0] = U8TOU32(&key[16]);
+	ctx->nonce[1] = U8TOU32(&key[20]);
+	ctx->nonce[2] = U8TOU32(&key[24]);
+	ctx->nonce[3] = U8TOU32(&key[28]);
+
+	poly1305_init(ctx->opaque, key);
+
+	ctx->num = 0;
+	}
+
+void Poly1305_Update(POLY1305 *ctx, const unsigned char *inp, size_t len)
+	{
+	size_t rem, num;
+
+	if ((num = ctx->num))
+		{
+		rem = POLY1305_BLOCK_SIZE - num;
+		if (len >= rem)
+			{
+			memcpy(ctx->data + num, inp, rem);
+			poly1305_blocks(ctx->opaque, ctx->data,
+					POLY1305_BLOCK_SIZE, 1);
+			inp += rem;
+			len -= rem;
+			}
+		else
+			{
+			/* Still not enough data to process a block. */
+			memcpy(ctx->data + num, inp, len);
+			ctx->num = num + len;
+			return;
+			}
+		}
+
+	rem = len % POLY1305_BLOCK_SIZE;
+	len -= rem;
+
+	if (len >= POLY1305_BLOCK_SIZE)
+		{
+		poly1305_blocks(ctx->opaque, inp, len, 1);
+		inp += len;
+		}
+
+	if (rem)
+		memcpy(ctx->data, inp, rem);
+
+	ctx->num = rem;
+	}
+
+void Poly1305_Final(POLY1305 *ctx, unsigned char mac[16])
+	{
+	size_t num;
+
+	if ((num = ctx->num))
+		{
+		ctx->data[num++] = 1;	/* pad bit */
+		while (num < POLY1305_BLOCK_SIZE)
+			ctx->data[num++] = 0;
+		poly1305_blocks(ctx->opaque, ctx->data,
+				POLY1305_BLOCK_SIZE, 0);
+		}
+
+	poly1305_emit(ctx->opaque, mac, ctx->nonce);
+
+	/* zero out the state */
+	OPENSSL_cleanse(ctx, sizeof(*ctx));
+	}
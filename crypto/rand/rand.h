@@ -94,6 +94,9 @@ const RAND_METHOD *RAND_get_rand_method(void);
 int RAND_set_rand_engine(ENGINE *engine);
 #endif
 RAND_METHOD *RAND_SSLeay(void);
+#ifndef OPENSSL_NO_AES
+RAND_METHOD *RAND_thread_drbg(void);
+#endif
 void RAND_cleanup(void );
 int  RAND_bytes(unsigned char *buf,int num);
 int  RAND_pseudo_bytes(unsigned char *buf,int num);
@@ -128,6 +131,9 @@ void ERR_load_RAND_strings(void);
 /* Error codes for the RAND functions. */
 
 /* Function codes. */
+#define RAND_F_DRBG_GENERATE				 107
+#define RAND_F_DRBG_GET_STATE				 108
+#define RAND_F_DRBG_RESEED				 109
 #define RAND_F_FIPS_RAND				 102
 #define RAND_F_FIPS_RAND_SET_DT				 103
 #define RAND_F_FIPS_SET_PRNG_SEED			 104
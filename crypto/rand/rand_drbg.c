@@ -0,0 +1,380 @@
+/* crypto/rand/rand_drbg.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* A RAND_METHOD that gives every thread its own CTR_DRBG (NIST SP 800-90A,
+ * AES-256, no derivation function). Generating output only touches the
+ * state of the calling thread, so no lock is taken. The generators are
+ * seeded from, and periodically reseeded from, the md_rand pool, which
+ * remains the only place that collects entropy. */
+
+#include <stdio.h>
+#include "cryptlib.h"
+#include <openssl/rand.h>
+#include "rand_lcl.h"
+
+#ifndef OPENSSL_NO_AES
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+/* The child of a fork() is told apart from the parent by an atfork
+ * handler, so that generating output does not need a getpid() call */
+# define DRBG_ATFORK
+# include <pthread.h>
+#endif
+
+#define DRBG_KEYLEN		32
+#define DRBG_BLOCKLEN		16
+#define DRBG_SEEDLEN		(DRBG_KEYLEN+DRBG_BLOCKLEN)
+/* Number of generate requests before new seed is taken from md_rand */
+#define DRBG_RESEED_INTERVAL	(1<<12)
+/* Largest output of one generate request, 2^19 bits */
+#define DRBG_MAX_REQUEST	(1<<16)
+
+typedef struct drbg_state_st
+	{
+	EVP_CIPHER_CTX cipher;		/* AES-256-ECB keyed with Key */
+	unsigned char V[DRBG_BLOCKLEN];
+	unsigned long reseed_counter;
+	int seeded;
+	int strong;	/* seeded from bytes() rather than pseudorand() */
+	int seed_generation;
+#ifndef GETPID_IS_MEANINGLESS
+	pid_t pid;
+#endif
+	} DRBG_STATE;
+
+static CRYPTO_THREAD_LOCAL *drbg_key = NULL;
+/* Changed whenever entropy is added to md_rand, and in the child after a
+ * fork(), so that every generator reseeds on its next request. It is
+ * updated with CRYPTO_add() and read without a lock. */
+static int drbg_seed_generation = 0;
+#ifdef DRBG_ATFORK
+static int drbg_atfork = 0;
+#endif
+
+#ifdef CRYPTO_ATOMIC_LOAD_INT
+# define drbg_generation()	CRYPTO_ATOMIC_LOAD_INT(&drbg_seed_generation)
+#else
+# define drbg_generation()	(*(volatile int *)&drbg_seed_generation)
+#endif
+
+static void drbg_new_generation(void)
+	{
+	CRYPTO_add(&drbg_seed_generation, 1, CRYPTO_LOCK_RAND2);
+	}
+
+#ifdef DRBG_ATFORK
+/* The child has a single thread, and a lock may have been held by another
+ * thread of the parent, so no lock is taken */
+static void drbg_fork_child(void)
+	{
+	drbg_seed_generation++;
+	}
+#endif
+
+static void drbg_state_free(void *p)
+	{
+	DRBG_STATE *d = p;
+
+	if (d == NULL)
+		return;
+	EVP_CIPHER_CTX_cleanup(&d->cipher);
+	OPENSSL_cleanse(d, sizeof(*d));
+	OPENSSL_free(d);
+	}
+
+static DRBG_STATE *drbg_get_state(void)
+	{
+	static const unsigned char zero_key[DRBG_KEYLEN];
+	CRYPTO_THREAD_LOCAL *key;
+	DRBG_STATE *d;
+
+	if (drbg_key == NULL)
+		{
+		if ((key = CRYPTO_THREAD_LOCAL_new(drbg_state_free)) == NULL)
+			return NULL;
+		CRYPTO_w_lock(CRYPTO_LOCK_RAND2);
+		if (drbg_key == NULL)
+			{
+			drbg_key = key;
+			key = NULL;
+			}
+#ifdef DRBG_ATFORK
+		/* Registered once, a failure leaves the getpid() check */
+		if (!drbg_atfork)
+			drbg_atfork = pthread_atfork(NULL, NULL,
+						     drbg_fork_child) == 0;
+#endif
+		CRYPTO_w_unlock(CRYPTO_LOCK_RAND2);
+		if (key)
+			CRYPTO_THREAD_LOCAL_free(key);
+		}
+
+	if ((d = CRYPTO_THREAD_LOCAL_get(drbg_key)) != NULL)
+		return d;
+
+	if ((d = OPENSSL_malloc(sizeof(*d))) == NULL)
+		{
+		RANDerr(RAND_F_DRBG_GET_STATE,ERR_R_MALLOC_FAILURE);
+		return NULL;
+		}
+	memset(d, 0, sizeof(*d));
+	EVP_CIPHER_CTX_init(&d->cipher);
+	if (!EVP_EncryptInit_ex(&d->cipher, EVP_aes_256_ecb(), NULL,
+				zero_key, NULL)
+		|| !CRYPTO_THREAD_LOCAL_set(drbg_key, d))
+		{
+		RANDerr(RAND_F_DRBG_GET_STATE,ERR_R_EVP_LIB);
+		drbg_state_free(d);
+		return NULL;
+		}
+	EVP_CIPHER_CTX_set_padding(&d->cipher, 0);
+	return d;
+	}
+
+/* Encrypts the next nblocks values of the counter V into out */
+static int drbg_ctr_blocks(DRBG_STATE *d, unsigned char *out, size_t nblocks)
+	{
+	unsigned char *p = out;
+	size_t i;
+	int j, outl;
+
+	for (i = 0; i < nblocks; i++, p += DRBG_BLOCKLEN)
+		{
+		for (j = DRBG_BLOCKLEN-1; j >= 0; j--)
+			if (++d->V[j] != 0)
+				break;
+		memcpy(p, d->V, DRBG_BLOCKLEN);
+		}
+	return EVP_EncryptUpdate(&d->cipher, out, &outl, out,
+				 nblocks*DRBG_BLOCKLEN);
+	}
+
+/* CTR_DRBG_Update(): derives a new Key and V, mixing in provided_data */
+static int drbg_update(DRBG_STATE *d, const unsigned char *provided_data)
+	{
+	unsigned char temp[DRBG_SEEDLEN];
+	int i, ok = 0;
+
+	if (!drbg_ctr_blocks(d, temp, DRBG_SEEDLEN/DRBG_BLOCKLEN))
+		goto err;
+	if (provided_data)
+		for (i = 0; i < DRBG_SEEDLEN; i++)
+			temp[i] ^= provided_data[i];
+	if (!EVP_EncryptInit_ex(&d->cipher, NULL, NULL, temp, NULL))
+		goto err;
+	memcpy(d->V, temp+DRBG_KEYLEN, DRBG_BLOCKLEN);
+	ok = 1;
+err:
+	OPENSSL_cleanse(temp, sizeof(temp));
+	return ok;
+	}
+
+/* Takes new seed from md_rand. As with RAND_pseudo_bytes(), 0 means that
+ * md_rand was not seeded well enough: the generator is still usable for
+ * pseudo-random output, but it is reseeded before bytes() is served. */
+static int drbg_reseed(DRBG_STATE *d, int pseudo)
+	{
+	unsigned char seed[DRBG_SEEDLEN];
+	const RAND_METHOD *pool = RAND_SSLeay();
+	int ret;
+
+	if (pseudo)
+		ret = pool->pseudorand(seed, sizeof(seed));
+	else
+		ret = pool->bytes(seed, sizeof(seed));
+	if (ret < 0 || (ret == 0 && !pseudo))
+		goto err;
+	if (!drbg_update(d, seed))
+		{
+		RANDerr(RAND_F_DRBG_RESEED,ERR_R_EVP_LIB);
+		ret = -1;
+		goto err;
+		}
+	d->seeded = 1;
+	d->strong = ret;
+	d->reseed_counter = 0;
+	d->seed_generation = drbg_generation();
+#ifndef GETPID_IS_MEANINGLESS
+# ifdef DRBG_ATFORK
+	if (!drbg_atfork)
+# endif
+		d->pid = getpid();
+#endif
+err:
+	OPENSSL_cleanse(seed, sizeof(seed));
+	return ret;
+	}
+
+static int drbg_generate(unsigned char *buf, int num, int pseudo)
+	{
+	unsigned char last[DRBG_BLOCKLEN];
+	DRBG_STATE *d;
+	int req, full, ret;
+
+	if ((d = drbg_get_state()) == NULL)
+		{
+		/* No thread-local storage: fall back to the shared pool */
+		if (pseudo)
+			return RAND_SSLeay()->pseudorand(buf, num);
+		return RAND_SSLeay()->bytes(buf, num);
+		}
+
+	while (num > 0)
+		{
+		if (!d->seeded || (!pseudo && !d->strong)
+			|| d->reseed_counter >= DRBG_RESEED_INTERVAL
+			|| d->seed_generation != drbg_generation()
+#ifndef GETPID_IS_MEANINGLESS
+			/* Parent and child must not share output after fork */
+# ifdef DRBG_ATFORK
+			|| (!drbg_atfork && d->pid != getpid())
+# else
+			|| d->pid != getpid()
+# endif
+#endif
+			)
+			{
+			ret = drbg_reseed(d, pseudo);
+			if (ret < 0 || (ret == 0 && !pseudo))
+				return ret;
+			}
+
+		req = num > DRBG_MAX_REQUEST ? DRBG_MAX_REQUEST : num;
+		full = req & ~(DRBG_BLOCKLEN-1);
+		if (full && !drbg_ctr_blocks(d, buf, full/DRBG_BLOCKLEN))
+			goto err;
+		if (full < req)
+			{
+			if (!drbg_ctr_blocks(d, last, 1))
+				goto err;
+			memcpy(buf+full, last, req-full);
+			OPENSSL_cleanse(last, sizeof(last));
+			}
+		if (!drbg_update(d, NULL))
+			goto err;
+		d->reseed_counter++;
+		buf += req;
+		num -= req;
+		}
+	return pseudo ? d->strong : 1;
+err:
+	RANDerr(RAND_F_DRBG_GENERATE,ERR_R_EVP_LIB);
+	/* Do not hand out anything from a state in an unknown condition */
+	d->seeded = 0;
+	return pseudo ? -1 : 0;
+	}
+
+static int drbg_rand_bytes(unsigned char *buf, int num)
+	{
+	return drbg_generate(buf, num, 0);
+	}
+
+static int drbg_rand_pseudo_bytes(unsigned char *buf, int num)
+	{
+	return drbg_generate(buf, num, 1);
+	}
+
+static int drbg_rand_seed(const void *buf, int num)
+	{
+	int ret = RAND_SSLeay()->seed(buf, num);
+
+	drbg_new_generation();
+	return ret;
+	}
+
+static int drbg_rand_add(const void *buf, int num, double entropy)
+	{
+	int ret = RAND_SSLeay()->add(buf, num, entropy);
+
+	/* Mixing in data that has no entropy, such as the time on each
+	 * handshake, is no reason to reseed every generator */
+	if (entropy > 0)
+		drbg_new_generation();
+	return ret;
+	}
+
+static int drbg_rand_status(void)
+	{
+	return RAND_SSLeay()->status();
+	}
+
+/* Only the generator of the calling thread is freed here, the others are
+ * freed as their threads exit, as long as the method is still in use. */
+static void drbg_rand_cleanup(void)
+	{
+	if (drbg_key)
+		{
+		CRYPTO_THREAD_LOCAL_free(drbg_key);
+		drbg_key = NULL;
+		}
+	RAND_SSLeay()->cleanup();
+	}
+
+static RAND_METHOD rand_drbg_meth=
+	{
+	drbg_rand_seed,
+	drbg_rand_bytes,
+	drbg_rand_cleanup,
+	drbg_rand_add,
+	drbg_rand_pseudo_bytes,
+	drbg_rand_status
+	};
+
+RAND_METHOD *RAND_thread_drbg(void)
+	{
+	return &rand_drbg_meth;
+	}
+
+#endif
@@ -70,6 +70,9 @@
 
 static ERR_STRING_DATA RAND_str_functs[]=
 	{
+{ERR_FUNC(RAND_F_DRBG_GENERATE),	"DRBG_GENERATE"},
+{ERR_FUNC(RAND_F_DRBG_GET_STATE),	"DRBG_GET_STATE"},
+{ERR_FUNC(RAND_F_DRBG_RESEED),	"DRBG_RESEED"},
 {ERR_FUNC(RAND_F_FIPS_RAND),	"FIPS_RAND"},
 {ERR_FUNC(RAND_F_FIPS_RAND_SET_DT),	"FIPS_RAND_SET_DT"},
 {ERR_FUNC(RAND_F_FIPS_SET_PRNG_SEED),	"FIPS_SET_PRNG_SEED"},
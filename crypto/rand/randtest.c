@@ -58,14 +58,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <openssl/rand.h>
 
 #include "../e_os.h"
 
+#if !defined(OPENSSL_NO_AES) && defined(OPENSSL_SYS_UNIX)
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
 /* some FIPS 140-1 random number test */
 /* some simple tests */
 
-int main(int argc,char **argv)
+static int fips_test(void)
 	{
 	unsigned char buf[2500];
 	int i,j,k,s,sign,nsign,err=0;
@@ -210,6 +217,65 @@ int main(int argc,char **argv)
 		}
 	printf("test 4 done\n");
  err:
+	return err;
+	}
+
+#if !defined(OPENSSL_NO_AES) && defined(OPENSSL_SYS_UNIX)
+/* Parent and child must not produce the same output after a fork() */
+static int fork_test(void)
+	{
+	unsigned char parent[32], child[32];
+	int fd[2], n, status;
+	pid_t pid;
+
+	if (RAND_bytes(parent, sizeof(parent)) <= 0 || pipe(fd) != 0)
+		return 1;
+	if ((pid = fork()) < 0)
+		return 1;
+	if (pid == 0)
+		{
+		close(fd[0]);
+		if (RAND_bytes(child, sizeof(child)) <= 0
+			|| write(fd[1], child, sizeof(child)) != sizeof(child))
+			_exit(1);
+		_exit(0);
+		}
+	close(fd[1]);
+	n = read(fd[0], child, sizeof(child));
+	close(fd[0]);
+	if (waitpid(pid, &status, 0) != pid || status != 0
+		|| n != sizeof(child))
+		{
+		printf("fork test: child failed\n");
+		return 1;
+		}
+	if (RAND_bytes(parent, sizeof(parent)) <= 0)
+		return 1;
+	if (memcmp(parent, child, sizeof(parent)) == 0)
+		{
+		printf("fork test failed, parent and child output match\n");
+		return 1;
+		}
+	printf("fork test done\n");
+	return 0;
+	}
+#endif
+
+int main(int argc,char **argv)
+	{
+	int err;
+
+	err=fips_test();
+#ifndef OPENSSL_NO_AES
+	printf("testing per-thread DRBG\n");
+	RAND_set_rand_method(RAND_thread_drbg());
+	err+=fips_test();
+#ifdef OPENSSL_SYS_UNIX
+	err+=fork_test();
+#endif
+	RAND_cleanup();
+#endif
+
 	err=((err)?1:0);
 #ifdef OPENSSL_SYS_NETWARE
     if (err) printf("ERROR: %d\n", err);
@@ -124,8 +124,15 @@ struct rsa_meth_st
  * it would be nice to assume there are no such things as "builtin software"
  * implementations. */
 	int (*rsa_keygen)(RSA *rsa, int bits, BIGNUM *e, BN_GENCB *cb);
+/* Public key decryption of a batch of inputs, as for RSA_public_decrypt_batch().
+ * If this callback is NULL rsa_pub_dec is called for each of them. */
+	int (*rsa_pub_dec_batch)(const int *flens,
+		const unsigned char **from, unsigned char **to, RSA **rsa,
+		int padding, int *results, int num);
 	};
 
+DECLARE_STACK_OF(BN_BLINDING)
+
 struct rsa_st
 	{
 	/* The first parameter is used to pickup errors where
@@ -157,7 +164,10 @@ struct rsa_st
 	 * NULL */
 	char *bignum_data;
 	BN_BLINDING *blinding;
-	BN_BLINDING *mt_blinding;
+	BN_BLINDING *mt_blinding;	/* no longer used */
+	/* blinding structures for threads other than the one that created
+	 * 'blinding', see rsa_eay.c */
+	STACK_OF(BN_BLINDING) *blinding_pool;
 	};
 
 #ifndef OPENSSL_RSA_MAX_MODULUS_BITS
@@ -335,6 +345,9 @@ int	RSA_public_decrypt(int flen, const unsigned char *from,
 		unsigned char *to, RSA *rsa,int padding);
 int	RSA_private_decrypt(int flen, const unsigned char *from, 
 		unsigned char *to, RSA *rsa,int padding);
+int	RSA_public_decrypt_batch(const int *flens,
+		const unsigned char **from, unsigned char **to, RSA **rsa,
+		int padding, int *results, int num);
 void	RSA_free (RSA *r);
 /* "up" the RSA object's reference count */
 int	RSA_up_ref(RSA *r);
@@ -528,6 +541,7 @@ void ERR_load_RSA_strings(void);
 #define RSA_F_RSA_EAY_PRIVATE_DECRYPT			 101
 #define RSA_F_RSA_EAY_PRIVATE_ENCRYPT			 102
 #define RSA_F_RSA_EAY_PUBLIC_DECRYPT			 103
+#define RSA_F_RSA_EAY_PUBLIC_DECRYPT_BATCH		 161
 #define RSA_F_RSA_EAY_PUBLIC_ENCRYPT			 104
 #define RSA_F_RSA_GENERATE_KEY				 105
 #define RSA_F_RSA_ITEM_VERIFY				 148
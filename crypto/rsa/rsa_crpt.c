@@ -95,6 +95,38 @@ int RSA_public_decrypt(int flen, const unsigned char *from, unsigned char *to,
 	return(rsa->meth->rsa_pub_dec(flen, from, to, rsa, padding));
 	}
 
+/* Inputs are passed to the batch function of the method of their key
+ * together with all the following ones with the same method; the others
+ * are decrypted one at a time. results[i] is set to what
+ * RSA_public_decrypt() would have returned for input i.
+ */
+int RSA_public_decrypt_batch(const int *flens, const unsigned char **from,
+	     unsigned char **to, RSA **rsa, int padding, int *results, int num)
+	{
+	const RSA_METHOD *meth;
+	int i, j, ret = 1;
+
+	for (i = 0; i < num; i += j)
+		{
+		meth = rsa[i]->meth;
+		for (j = 1; i + j < num && rsa[i + j]->meth == meth; j++)
+			;
+		if (meth->rsa_pub_dec_batch == NULL || j == 1)
+			{
+			results[i] = meth->rsa_pub_dec(flens[i], from[i],
+					to[i], rsa[i], padding);
+			j = 1;
+			}
+		else
+			meth->rsa_pub_dec_batch(flens + i, from + i, to + i,
+				rsa + i, padding, results + i, j);
+		}
+	for (i = 0; i < num; i++)
+		if (results[i] < 0)
+			ret = 0;
+	return ret;
+	}
+
 int RSA_flags(const RSA *r)
 	{
 	return((r == NULL)?0:r->meth->flags);
@@ -126,6 +126,9 @@ static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
 		unsigned char *to, RSA *rsa,int padding);
 static int RSA_eay_private_decrypt(int flen, const unsigned char *from,
 		unsigned char *to, RSA *rsa,int padding);
+static int RSA_eay_public_decrypt_batch(const int *flens,
+		const unsigned char **from, unsigned char **to, RSA **rsa,
+		int padding, int *results, int num);
 static int RSA_eay_mod_exp(BIGNUM *r0, const BIGNUM *i, RSA *rsa, BN_CTX *ctx);
 static int RSA_eay_init(RSA *rsa);
 static int RSA_eay_finish(RSA *rsa);
@@ -143,7 +146,8 @@ static RSA_METHOD rsa_pkcs1_eay_meth={
 	NULL,
 	0, /* rsa_sign */
 	0, /* rsa_verify */
-	NULL /* rsa_keygen */
+	NULL, /* rsa_keygen */
+	RSA_eay_public_decrypt_batch
 	};
 
 const RSA_METHOD *RSA_PKCS1_SSLeay(void)
@@ -253,98 +257,79 @@ err:
 	return(r);
 	}
 
-static BN_BLINDING *rsa_get_blinding(RSA *rsa, int *local, BN_CTX *ctx)
+/* A blinding structure is never used by two threads at once, so no lock is
+ * held while it is in use. rsa->blinding belongs to the thread that created
+ * it. Other threads take one from rsa->blinding_pool, or set up a new one
+ * if the pool is empty, and return it with rsa_put_blinding(). The pool
+ * holds at most one structure for each thread that used the key at the
+ * same time, and CRYPTO_LOCK_RSA_BLINDING is only held to take or return
+ * one. */
+static BN_BLINDING *rsa_get_blinding(RSA *rsa, int *pooled, BN_CTX *ctx)
 {
 	BN_BLINDING *ret;
-	int got_write_lock = 0;
 	CRYPTO_THREADID cur;
 
+	/* rsa->blinding is set up once, so like the Montgomery contexts it
+	 * is read without the lock where its store is atomic. */
+#ifdef CRYPTO_ATOMIC_LOAD_PTR
+	ret = CRYPTO_ATOMIC_LOAD_PTR(&rsa->blinding);
+#else
 	CRYPTO_r_lock(CRYPTO_LOCK_RSA);
-
-	if (rsa->blinding == NULL)
+	ret = rsa->blinding;
+	CRYPTO_r_unlock(CRYPTO_LOCK_RSA);
+#endif
+	if (ret == NULL)
 		{
-		CRYPTO_r_unlock(CRYPTO_LOCK_RSA);
 		CRYPTO_w_lock(CRYPTO_LOCK_RSA);
-		got_write_lock = 1;
-
 		if (rsa->blinding == NULL)
-			rsa->blinding = RSA_setup_blinding(rsa, ctx);
+			{
+			ret = RSA_setup_blinding(rsa, ctx);
+#ifdef CRYPTO_ATOMIC_STORE_PTR
+			CRYPTO_ATOMIC_STORE_PTR(&rsa->blinding, ret);
+#else
+			rsa->blinding = ret;
+#endif
+			}
+		else
+			ret = rsa->blinding;
+		CRYPTO_w_unlock(CRYPTO_LOCK_RSA);
+		if (ret == NULL)
+			return NULL;
 		}
 
-	ret = rsa->blinding;
-	if (ret == NULL)
-		goto err;
-
 	CRYPTO_THREADID_current(&cur);
-	if (!CRYPTO_THREADID_cmp(&cur, BN_BLINDING_thread_id(ret)))
-		{
-		/* rsa->blinding is ours! */
-
-		*local = 1;
-		}
-	else
-		{
-		/* resort to rsa->mt_blinding instead */
+	/* rsa->blinding is ours if the thread IDs match */
+	*pooled = CRYPTO_THREADID_cmp(&cur, BN_BLINDING_thread_id(ret));
+	if (!*pooled)
+		return ret;
 
-		*local = 0; /* instructs rsa_blinding_convert(), rsa_blinding_invert()
-		             * that the BN_BLINDING is shared, meaning that accesses
-		             * require locks, and that the blinding factor must be
-		             * stored outside the BN_BLINDING
-		             */
+	CRYPTO_w_lock(CRYPTO_LOCK_RSA_BLINDING);
+	ret = NULL;
+	if (rsa->blinding_pool != NULL)
+		ret = sk_BN_BLINDING_pop(rsa->blinding_pool);
+	CRYPTO_w_unlock(CRYPTO_LOCK_RSA_BLINDING);
 
-		if (rsa->mt_blinding == NULL)
-			{
-			if (!got_write_lock)
-				{
-				CRYPTO_r_unlock(CRYPTO_LOCK_RSA);
-				CRYPTO_w_lock(CRYPTO_LOCK_RSA);
-				got_write_lock = 1;
-				}
-			
-			if (rsa->mt_blinding == NULL)
-				rsa->mt_blinding = RSA_setup_blinding(rsa, ctx);
-			}
-		ret = rsa->mt_blinding;
+	if (ret == NULL)
+		{
+		ret = RSA_setup_blinding(rsa, ctx);
+		if (ret == NULL)
+			*pooled = 0;
 		}
-
- err:
-	if (got_write_lock)
-		CRYPTO_w_unlock(CRYPTO_LOCK_RSA);
-	else
-		CRYPTO_r_unlock(CRYPTO_LOCK_RSA);
 	return ret;
 }
 
-static int rsa_blinding_convert(BN_BLINDING *b, BIGNUM *f, BIGNUM *unblind,
-	BN_CTX *ctx)
+static void rsa_put_blinding(RSA *rsa, BN_BLINDING *b)
 	{
-	if (unblind == NULL)
-		/* Local blinding: store the unblinding factor
-		 * in BN_BLINDING. */
-		return BN_BLINDING_convert_ex(f, NULL, b, ctx);
-	else
-		{
-		/* Shared blinding: store the unblinding factor
-		 * outside BN_BLINDING. */
-		int ret;
-		CRYPTO_w_lock(CRYPTO_LOCK_RSA_BLINDING);
-		ret = BN_BLINDING_convert_ex(f, unblind, b, ctx);
-		CRYPTO_w_unlock(CRYPTO_LOCK_RSA_BLINDING);
-		return ret;
-		}
-	}
-
-static int rsa_blinding_invert(BN_BLINDING *b, BIGNUM *f, BIGNUM *unblind,
-	BN_CTX *ctx)
-	{
-	/* For local blinding, unblind is set to NULL, and BN_BLINDING_invert_ex
-	 * will use the unblinding factor stored in BN_BLINDING.
-	 * If BN_BLINDING is shared between threads, unblind must be non-null:
-	 * BN_BLINDING_invert_ex will then use the local unblinding factor,
-	 * and will only read the modulus from BN_BLINDING.
-	 * In both cases it's safe to access the blinding without a lock.
-	 */
-	return BN_BLINDING_invert_ex(f, unblind, b, ctx);
+	CRYPTO_w_lock(CRYPTO_LOCK_RSA_BLINDING);
+	if (rsa->blinding_pool == NULL)
+		rsa->blinding_pool = sk_BN_BLINDING_new_null();
+	if (rsa->blinding_pool != NULL
+		&& sk_BN_BLINDING_push(rsa->blinding_pool, b))
+		b = NULL;
+	CRYPTO_w_unlock(CRYPTO_LOCK_RSA_BLINDING);
+
+	if (b != NULL)
+		BN_BLINDING_free(b);
 	}
 
 /* signing */
@@ -355,11 +340,7 @@ static int RSA_eay_private_encrypt(int flen, const unsigned char *from,
 	int i,j,k,num=0,r= -1;
 	unsigned char *buf=NULL;
 	BN_CTX *ctx=NULL;
-	int local_blinding = 0;
-	/* Used only if the blinding structure is shared. A non-NULL unblind
-	 * instructs rsa_blinding_convert() and rsa_blinding_invert() to store
-	 * the unblinding factor outside the blinding structure. */
-	BIGNUM *unblind = NULL;
+	int pooled_blinding = 0;
 	BN_BLINDING *blinding = NULL;
 
 	if ((ctx=BN_CTX_new()) == NULL) goto err;
@@ -403,22 +384,13 @@ static int RSA_eay_private_encrypt(int flen, const unsigned char *from,
 
 	if (!(rsa->flags & RSA_FLAG_NO_BLINDING))
 		{
-		blinding = rsa_get_blinding(rsa, &local_blinding, ctx);
+		blinding = rsa_get_blinding(rsa, &pooled_blinding, ctx);
 		if (blinding == NULL)
 			{
 			RSAerr(RSA_F_RSA_EAY_PRIVATE_ENCRYPT, ERR_R_INTERNAL_ERROR);
 			goto err;
 			}
-		}
-	
-	if (blinding != NULL)
-		{
-		if (!local_blinding && ((unblind = BN_CTX_get(ctx)) == NULL))
-			{
-			RSAerr(RSA_F_RSA_EAY_PRIVATE_ENCRYPT,ERR_R_MALLOC_FAILURE);
-			goto err;
-			}
-		if (!rsa_blinding_convert(blinding, f, unblind, ctx))
+		if (!BN_BLINDING_convert(f, blinding, ctx))
 			goto err;
 		}
 
@@ -465,7 +437,7 @@ static int RSA_eay_private_encrypt(int flen, const unsigned char *from,
 		}
 
 	if (blinding)
-		if (!rsa_blinding_invert(blinding, ret, unblind, ctx))
+		if (!BN_BLINDING_invert(ret, blinding, ctx))
 			goto err;
 
 	if (padding == RSA_X931_PADDING)
@@ -498,6 +470,8 @@ err:
 		OPENSSL_cleanse(buf,num);
 		OPENSSL_free(buf);
 		}
+	if (pooled_blinding)
+		rsa_put_blinding(rsa, blinding);
 	return(r);
 	}
 
@@ -509,11 +483,7 @@ static int RSA_eay_private_decrypt(int flen, const unsigned char *from,
 	unsigned char *p;
 	unsigned char *buf=NULL;
 	BN_CTX *ctx=NULL;
-	int local_blinding = 0;
-	/* Used only if the blinding structure is shared. A non-NULL unblind
-	 * instructs rsa_blinding_convert() and rsa_blinding_invert() to store
-	 * the unblinding factor outside the blinding structure. */
-	BIGNUM *unblind = NULL;
+	int pooled_blinding = 0;
 	BN_BLINDING *blinding = NULL;
 
 	if((ctx = BN_CTX_new()) == NULL) goto err;
@@ -547,22 +517,13 @@ static int RSA_eay_private_decrypt(int flen, const unsigned char *from,
 
 	if (!(rsa->flags & RSA_FLAG_NO_BLINDING))
 		{
-		blinding = rsa_get_blinding(rsa, &local_blinding, ctx);
+		blinding = rsa_get_blinding(rsa, &pooled_blinding, ctx);
 		if (blinding == NULL)
 			{
 			RSAerr(RSA_F_RSA_EAY_PRIVATE_DECRYPT, ERR_R_INTERNAL_ERROR);
 			goto err;
 			}
-		}
-	
-	if (blinding != NULL)
-		{
-		if (!local_blinding && ((unblind = BN_CTX_get(ctx)) == NULL))
-			{
-			RSAerr(RSA_F_RSA_EAY_PRIVATE_DECRYPT,ERR_R_MALLOC_FAILURE);
-			goto err;
-			}
-		if (!rsa_blinding_convert(blinding, f, unblind, ctx))
+		if (!BN_BLINDING_convert(f, blinding, ctx))
 			goto err;
 		}
 
@@ -609,7 +570,7 @@ static int RSA_eay_private_decrypt(int flen, const unsigned char *from,
 		}
 
 	if (blinding)
-		if (!rsa_blinding_invert(blinding, ret, unblind, ctx))
+		if (!BN_BLINDING_invert(ret, blinding, ctx))
 			goto err;
 
 	p=buf;
@@ -649,29 +610,25 @@ err:
 		OPENSSL_cleanse(buf,num);
 		OPENSSL_free(buf);
 		}
+	if (pooled_blinding)
+		rsa_put_blinding(rsa, blinding);
 	return(r);
 	}
 
 /* signature verification */
-static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
-	     unsigned char *to, RSA *rsa, int padding)
+/* Checks on the key common to single and batch public key decryption */
+static int rsa_eay_public_check(RSA *rsa)
 	{
-	BIGNUM *f,*ret;
-	int i,num=0,r= -1;
-	unsigned char *p;
-	unsigned char *buf=NULL;
-	BN_CTX *ctx=NULL;
-
 	if (BN_num_bits(rsa->n) > OPENSSL_RSA_MAX_MODULUS_BITS)
 		{
 		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT, RSA_R_MODULUS_TOO_LARGE);
-		return -1;
+		return 0;
 		}
 
 	if (BN_ucmp(rsa->n, rsa->e) <= 0)
 		{
 		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT, RSA_R_BAD_E_VALUE);
-		return -1;
+		return 0;
 		}
 
 	/* for large moduli, enforce exponent limit */
@@ -680,50 +637,52 @@ static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
 		if (BN_num_bits(rsa->e) > OPENSSL_RSA_MAX_PUBEXP_BITS)
 			{
 			RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT, RSA_R_BAD_E_VALUE);
-			return -1;
+			return 0;
 			}
 		}
-	
-	if((ctx = BN_CTX_new()) == NULL) goto err;
-	BN_CTX_start(ctx);
-	f = BN_CTX_get(ctx);
-	ret = BN_CTX_get(ctx);
-	num=BN_num_bytes(rsa->n);
-	buf = OPENSSL_malloc(num);
-	if(!f || !ret || !buf)
-		{
-		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,ERR_R_MALLOC_FAILURE);
-		goto err;
-		}
+	return 1;
+	}
 
+static int rsa_eay_public_input(BIGNUM *f, int flen,
+	     const unsigned char *from, RSA *rsa)
+	{
 	/* This check was for equality but PGP does evil things
 	 * and chops off the top '0' bytes */
-	if (flen > num)
+	if (flen > BN_num_bytes(rsa->n))
 		{
 		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,RSA_R_DATA_GREATER_THAN_MOD_LEN);
-		goto err;
+		return 0;
 		}
 
-	if (BN_bin2bn(from,flen,f) == NULL) goto err;
+	if (BN_bin2bn(from,flen,f) == NULL) return 0;
 
 	if (BN_ucmp(f, rsa->n) >= 0)
 		{
 		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,RSA_R_DATA_TOO_LARGE_FOR_MODULUS);
-		goto err;
+		return 0;
 		}
+	return 1;
+	}
 
-	if (rsa->flags & RSA_FLAG_CACHE_PUBLIC)
-		if (!BN_MONT_CTX_set_locked(&rsa->_method_mod_n, CRYPTO_LOCK_RSA, rsa->n, ctx))
-			goto err;
+/* Removes the padding from ret, the result of the exponentiation */
+static int rsa_eay_public_decrypt_finish(BIGNUM *ret, unsigned char *to,
+	     RSA *rsa, int padding)
+	{
+	int i,num,r= -1;
+	unsigned char *buf;
 
-	if (!rsa->meth->bn_mod_exp(ret,f,rsa->e,rsa->n,ctx,
-		rsa->_method_mod_n)) goto err;
+	num=BN_num_bytes(rsa->n);
+	buf = OPENSSL_malloc(num);
+	if (buf == NULL)
+		{
+		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,ERR_R_MALLOC_FAILURE);
+		return -1;
+		}
 
 	if ((padding == RSA_X931_PADDING) && ((bn_get_words(ret)[0] & 0xf) != 12))
 		if (!BN_sub(ret, rsa->n, ret)) goto err;
 
-	p=buf;
-	i=BN_bn2bin(ret,p);
+	i=BN_bn2bin(ret,buf);
 
 	switch (padding)
 		{
@@ -743,18 +702,142 @@ static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
 	if (r < 0)
 		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,RSA_R_PADDING_CHECK_FAILED);
 
+err:
+	OPENSSL_cleanse(buf,num);
+	OPENSSL_free(buf);
+	return(r);
+	}
+
+static int RSA_eay_public_decrypt(int flen, const unsigned char *from,
+	     unsigned char *to, RSA *rsa, int padding)
+	{
+	BIGNUM *f,*ret;
+	int r= -1;
+	BN_CTX *ctx=NULL;
+
+	if (!rsa_eay_public_check(rsa))
+		return -1;
+	
+	if((ctx = BN_CTX_new()) == NULL) goto err;
+	BN_CTX_start(ctx);
+	f = BN_CTX_get(ctx);
+	ret = BN_CTX_get(ctx);
+	if(!f || !ret)
+		{
+		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT,ERR_R_MALLOC_FAILURE);
+		goto err;
+		}
+
+	if (!rsa_eay_public_input(f,flen,from,rsa)) goto err;
+
+	if (rsa->flags & RSA_FLAG_CACHE_PUBLIC)
+		if (!BN_MONT_CTX_set_locked(&rsa->_method_mod_n, CRYPTO_LOCK_RSA, rsa->n, ctx))
+			goto err;
+
+	if (!rsa->meth->bn_mod_exp(ret,f,rsa->e,rsa->n,ctx,
+		rsa->_method_mod_n)) goto err;
+
+	r=rsa_eay_public_decrypt_finish(ret,to,rsa,padding);
+
 err:
 	if (ctx != NULL)
 		{
 		BN_CTX_end(ctx);
 		BN_CTX_free(ctx);
 		}
-	if (buf != NULL)
+	return(r);
+	}
+
+/* Maximum number of inputs exponentiated together */
+#define RSA_EAY_BATCH	16
+
+/* Inputs whose key uses BN_mod_exp_mont() are exponentiated together by
+ * BN_mod_exp_mont_batch(), up to RSA_EAY_BATCH of them at a time; the
+ * others go through RSA_eay_public_decrypt().
+ */
+static int RSA_eay_public_decrypt_batch(const int *flens,
+	     const unsigned char **from, unsigned char **to, RSA **rsa,
+	     int padding, int *results, int num)
+	{
+	BIGNUM *f[RSA_EAY_BATCH],*ret[RSA_EAY_BATCH];
+	const BIGNUM *e[RSA_EAY_BATCH],*n[RSA_EAY_BATCH];
+	BN_MONT_CTX *mont[RSA_EAY_BATCH];
+	int idx[RSA_EAY_BATCH],local[RSA_EAY_BATCH];
+	int i,k,nlanes;
+	RSA *r;
+	BN_CTX *ctx;
+
+	for (i = 0; i < num; i++)
+		results[i] = -1;
+	if ((ctx = BN_CTX_new()) == NULL)
 		{
-		OPENSSL_cleanse(buf,num);
-		OPENSSL_free(buf);
+		RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT_BATCH,ERR_R_MALLOC_FAILURE);
+		return 0;
 		}
-	return(r);
+
+	for (i = 0; i < num; )
+		{
+		BN_CTX_start(ctx);
+		for (nlanes = 0; i < num && nlanes < RSA_EAY_BATCH; i++)
+			{
+			r = rsa[i];
+			if (r->meth->bn_mod_exp != BN_mod_exp_mont)
+				{
+				results[i] = RSA_eay_public_decrypt(flens[i],
+					from[i], to[i], r, padding);
+				continue;
+				}
+			if (!rsa_eay_public_check(r))
+				continue;
+			f[nlanes] = BN_CTX_get(ctx);
+			ret[nlanes] = BN_CTX_get(ctx);
+			if (ret[nlanes] == NULL)
+				{
+				RSAerr(RSA_F_RSA_EAY_PUBLIC_DECRYPT_BATCH,
+					ERR_R_MALLOC_FAILURE);
+				continue;
+				}
+			if (!rsa_eay_public_input(f[nlanes], flens[i], from[i],
+					r))
+				continue;
+
+			if (r->flags & RSA_FLAG_CACHE_PUBLIC)
+				{
+				if (!BN_MONT_CTX_set_locked(&r->_method_mod_n,
+						CRYPTO_LOCK_RSA, r->n, ctx))
+					continue;
+				mont[nlanes] = r->_method_mod_n;
+				local[nlanes] = 0;
+				}
+			else
+				{
+				if ((mont[nlanes] = BN_MONT_CTX_new()) == NULL)
+					continue;
+				if (!BN_MONT_CTX_set(mont[nlanes], r->n, ctx))
+					{
+					BN_MONT_CTX_free(mont[nlanes]);
+					continue;
+					}
+				local[nlanes] = 1;
+				}
+			e[nlanes] = r->e;
+			n[nlanes] = r->n;
+			idx[nlanes++] = i;
+			}
+
+		if (nlanes > 0 && BN_mod_exp_mont_batch(ret,
+				(const BIGNUM **)f, e, n, ctx, mont, nlanes))
+			for (k = 0; k < nlanes; k++)
+				results[idx[k]] = rsa_eay_public_decrypt_finish(
+					ret[k], to[idx[k]], rsa[idx[k]],
+					padding);
+		for (k = 0; k < nlanes; k++)
+			if (local[k])
+				BN_MONT_CTX_free(mont[k]);
+		BN_CTX_end(ctx);
+		}
+	BN_CTX_free(ctx);
+	return 1;
 	}
 
 static int RSA_eay_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
@@ -176,6 +176,7 @@ RSA *RSA_new_method(ENGINE *engine)
 	ret->_method_mod_q=NULL;
 	ret->blinding=NULL;
 	ret->mt_blinding=NULL;
+	ret->blinding_pool=NULL;
 	ret->bignum_data=NULL;
 	ret->flags=ret->meth->flags & ~RSA_FLAG_NON_FIPS_ALLOW;
 	if (!CRYPTO_new_ex_data(CRYPTO_EX_INDEX_RSA, ret, &ret->ex_data))
@@ -239,6 +240,8 @@ void RSA_free(RSA *r)
 	if (r->iqmp != NULL) BN_clear_free(r->iqmp);
 	if (r->blinding != NULL) BN_BLINDING_free(r->blinding);
 	if (r->mt_blinding != NULL) BN_BLINDING_free(r->mt_blinding);
+	if (r->blinding_pool != NULL)
+		sk_BN_BLINDING_pop_free(r->blinding_pool, BN_BLINDING_free);
 	if (r->bignum_data != NULL) OPENSSL_free_locked(r->bignum_data);
 	OPENSSL_free(r);
 	}
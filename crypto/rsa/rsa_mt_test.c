@@ -0,0 +1,304 @@
+/* crypto/rsa/rsa_mt_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/* Tests for the pool of RSA blinding structures: threads sharing a key
+ * take structures from the pool and return them, the pool only grows with
+ * the number of threads using the key at once, and RSA_free() frees it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+
+#if !defined(OPENSSL_THREADS) || !defined(OPENSSL_SYS_UNIX)
+int main(int argc, char *argv[])
+	{
+	printf("No thread support, skipped\n");
+	return 0;
+	}
+#else
+
+#include <pthread.h>
+
+#define NUM_THREADS	8
+#define NUM_OPS		40
+
+static pthread_mutex_t *lock_cs;
+static RSA *key;
+
+static void locking_cb(int mode, int type, const char *file, int line)
+	{
+	if (mode & CRYPTO_LOCK)
+		pthread_mutex_lock(&lock_cs[type]);
+	else
+		pthread_mutex_unlock(&lock_cs[type]);
+	}
+
+static void thread_id_cb(CRYPTO_THREADID *tid)
+	{
+	CRYPTO_THREADID_set_numeric(tid, (unsigned long)pthread_self());
+	}
+
+/* Sign and decrypt messages with the shared key and check the results */
+static void *rsa_thread(void *arg)
+	{
+	unsigned char msg[32], sig[128], out[128];
+	int id = (int)(size_t)arg, i, n, ok = 0;
+
+	for (i = 0; i < NUM_OPS; i++)
+		{
+		BIO_snprintf((char *)msg, sizeof(msg), "thread %d op %d", id, i);
+
+		n = RSA_private_encrypt(sizeof(msg), msg, sig, key,
+							RSA_PKCS1_PADDING);
+		if (n != RSA_size(key)
+			|| RSA_public_decrypt(n, sig, out, key,
+				RSA_PKCS1_PADDING) != (int)sizeof(msg)
+			|| memcmp(out, msg, sizeof(msg)) != 0)
+			{
+			fprintf(stderr, "thread %d: signature %d wrong\n",
+									id, i);
+			goto err;
+			}
+
+		n = RSA_public_encrypt(sizeof(msg), msg, sig, key,
+							RSA_PKCS1_OAEP_PADDING);
+		if (n != RSA_size(key)
+			|| RSA_private_decrypt(n, sig, out, key,
+				RSA_PKCS1_OAEP_PADDING) != (int)sizeof(msg)
+			|| memcmp(out, msg, sizeof(msg)) != 0)
+			{
+			fprintf(stderr, "thread %d: decryption %d wrong\n",
+									id, i);
+			goto err;
+			}
+		}
+	ok = 1;
+
+	err:
+	if (!ok)
+		ERR_print_errors_fp(stderr);
+	ERR_remove_thread_state(NULL);
+	return ok ? NULL : (void *)1;
+	}
+
+/* Run threads using the key, all at once or one after the other */
+static int run_threads(int num, int together)
+	{
+	pthread_t tid[NUM_THREADS];
+	void *res;
+	int i, ok = 1;
+
+	for (i = 0; i < num; i++)
+		{
+		if (pthread_create(&tid[i], NULL, rsa_thread,
+						(void *)(size_t)(i + 1)) != 0)
+			{
+			fprintf(stderr, "cannot create threads\n");
+			return 0;
+			}
+		if (!together)
+			{
+			pthread_join(tid[i], &res);
+			if (res != NULL)
+				ok = 0;
+			}
+		}
+	for (i = 0; together && i < num; i++)
+		{
+		pthread_join(tid[i], &res);
+		if (res != NULL)
+			ok = 0;
+		}
+	return ok;
+	}
+
+/* Check the pool holds between min and max distinct structures, none of
+ * them the one of the thread that set up blinding for the key */
+static int check_pool(const char *test, int min, int max)
+	{
+	int i, j, num;
+
+	num = key->blinding_pool ? sk_BN_BLINDING_num(key->blinding_pool) : 0;
+	if (num < min || num > max)
+		{
+		fprintf(stderr, "%s: %d structures in the pool, expected "
+					"%d to %d\n", test, num, min, max);
+		return 0;
+		}
+	for (i = 0; i < num; i++)
+		{
+		BN_BLINDING *b = sk_BN_BLINDING_value(key->blinding_pool, i);
+
+		if (b == key->blinding)
+			{
+			fprintf(stderr, "%s: the key's own structure is in the "
+							"pool\n", test);
+			return 0;
+			}
+		for (j = 0; j < i; j++)
+			{
+			if (b == sk_BN_BLINDING_value(key->blinding_pool, j))
+				{
+				fprintf(stderr, "%s: structure in the pool "
+							"twice\n", test);
+				return 0;
+				}
+			}
+		}
+	return 1;
+	}
+
+static int test_pool(void)
+	{
+	BIGNUM *e;
+	unsigned char msg[16], sig[128];
+	int num, ok = 0;
+
+	key = RSA_new();
+	e = BN_new();
+	if (key == NULL || e == NULL || !BN_set_word(e, RSA_F4)
+		|| !RSA_generate_key_ex(key, 1024, e, NULL))
+		goto err;
+
+	/* The main thread sets up the key's own blinding, so that all the
+	 * others have to use the pool */
+	memset(msg, 0, sizeof(msg));
+	if (RSA_private_encrypt(sizeof(msg), msg, sig, key,
+						RSA_PKCS1_PADDING) <= 0
+		|| key->blinding == NULL || !check_pool("setup", 0, 0))
+		goto err;
+
+	/* Threads one at a time share a single pooled structure */
+	if (!run_threads(NUM_THREADS, 0) || !check_pool("serial", 1, 1))
+		goto err;
+
+	/* Threads at once need up to one each, and return them all */
+	if (!run_threads(NUM_THREADS, 1)
+		|| !check_pool("parallel", 1, NUM_THREADS))
+		goto err;
+	num = sk_BN_BLINDING_num(key->blinding_pool);
+	if (!run_threads(NUM_THREADS, 0) || !check_pool("again", num, num))
+		goto err;
+
+	/* The main thread still uses its own structure */
+	if (RSA_private_encrypt(sizeof(msg), msg, sig, key,
+						RSA_PKCS1_PADDING) <= 0
+		|| !check_pool("main", num, num))
+		goto err;
+	ok = 1;
+
+	err:
+	if (!ok)
+		ERR_print_errors_fp(stderr);
+	/* This frees the pool, the leak check below shows it */
+	RSA_free(key);
+	BN_free(e);
+	return ok;
+	}
+
+int main(int argc, char *argv[])
+	{
+	BIO *leaks;
+	unsigned char buf[16];
+	int i, ret = 1;
+
+	lock_cs = malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+	if (lock_cs == NULL)
+		return 1;
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_init(&lock_cs[i], NULL);
+	CRYPTO_THREADID_set_callback(thread_id_cb);
+	CRYPTO_set_locking_callback(locking_cb);
+
+	/* Seed the generator before checking for leaks, its state lives as
+	 * long as the process */
+	if (RAND_bytes(buf, sizeof(buf)) <= 0)
+		{
+		fprintf(stderr, "cannot seed the random number generator\n");
+		return 1;
+		}
+
+	CRYPTO_malloc_debug_init();
+	CRYPTO_dbg_set_options(V_CRYPTO_MDEBUG_ALL);
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+
+	if (test_pool())
+		ret = 0;
+	CRYPTO_cleanup_all_ex_data();
+	ERR_remove_thread_state(NULL);
+
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_OFF);
+	leaks = BIO_new(BIO_s_mem());
+	CRYPTO_mem_leaks(leaks);
+	if (BIO_ctrl_pending(leaks))
+		{
+		fprintf(stderr, "memory leaks:\n");
+		CRYPTO_mem_leaks_fp(stderr);
+		ret = 1;
+		}
+	BIO_free(leaks);
+
+	CRYPTO_set_locking_callback(NULL);
+	for (i = 0; i < CRYPTO_num_locks(); i++)
+		pthread_mutex_destroy(&lock_cs[i]);
+	free(lock_cs);
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
+#endif
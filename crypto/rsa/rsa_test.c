@@ -264,6 +264,45 @@ int main(int argc, char *argv[])
 	else
 	    printf("PKCS #1 v1.5 encryption/decryption ok\n");
 
+	/* Batch of signatures, the second of them corrupted */
+	num = RSA_private_encrypt(plen, ptext_ex, ctext, key,
+				  RSA_PKCS1_PADDING);
+	if (num != clen)
+	    {
+	    printf("PKCS#1 v1.5 signing failed!\n");
+	    err=1;
+	    }
+	else
+	    {
+	    unsigned char bad[256], out[3][256];
+	    const unsigned char *from[3];
+	    unsigned char *to[3];
+	    int flens[3], results[3];
+	    RSA *keys[3];
+
+	    memcpy(bad, ctext, num);
+	    bad[num - 1] ^= 1;
+	    for (n = 0; n < 3; n++)
+		{
+		from[n] = n == 1 ? bad : ctext;
+		flens[n] = num;
+		to[n] = out[n];
+		keys[n] = key;
+		}
+	    if (RSA_public_decrypt_batch(flens, from, to, keys,
+				RSA_PKCS1_PADDING, results, 3) != 0
+		|| results[0] != plen || memcmp(out[0], ptext_ex, plen) != 0
+		|| results[1] != -1
+		|| results[2] != plen || memcmp(out[2], ptext_ex, plen) != 0)
+		{
+		printf("PKCS#1 v1.5 batch verification failed!\n");
+		err=1;
+		}
+	    else
+		printf("PKCS #1 v1.5 batch verification ok\n");
+	    ERR_clear_error();
+	    }
+
     oaep:
 	ERR_clear_error();
 	num = RSA_public_encrypt(plen, ptext_ex, ctext, key,
@@ -441,6 +441,29 @@ DECLARE_SPECIAL_STACK_OF(OPENSSL_BLOCK, void)
 #define sk_BIO_sort(st) SKM_sk_sort(BIO, (st))
 #define sk_BIO_is_sorted(st) SKM_sk_is_sorted(BIO, (st))
 
+#define sk_BN_BLINDING_new(cmp) SKM_sk_new(BN_BLINDING, (cmp))
+#define sk_BN_BLINDING_new_null() SKM_sk_new_null(BN_BLINDING)
+#define sk_BN_BLINDING_free(st) SKM_sk_free(BN_BLINDING, (st))
+#define sk_BN_BLINDING_num(st) SKM_sk_num(BN_BLINDING, (st))
+#define sk_BN_BLINDING_value(st, i) SKM_sk_value(BN_BLINDING, (st), (i))
+#define sk_BN_BLINDING_set(st, i, val) SKM_sk_set(BN_BLINDING, (st), (i), (val))
+#define sk_BN_BLINDING_zero(st) SKM_sk_zero(BN_BLINDING, (st))
+#define sk_BN_BLINDING_push(st, val) SKM_sk_push(BN_BLINDING, (st), (val))
+#define sk_BN_BLINDING_unshift(st, val) SKM_sk_unshift(BN_BLINDING, (st), (val))
+#define sk_BN_BLINDING_find(st, val) SKM_sk_find(BN_BLINDING, (st), (val))
+#define sk_BN_BLINDING_find_ex(st, val) SKM_sk_find_ex(BN_BLINDING, (st), (val))
+#define sk_BN_BLINDING_delete(st, i) SKM_sk_delete(BN_BLINDING, (st), (i))
+#define sk_BN_BLINDING_delete_ptr(st, ptr) SKM_sk_delete_ptr(BN_BLINDING, (st), (ptr))
+#define sk_BN_BLINDING_insert(st, val, i) SKM_sk_insert(BN_BLINDING, (st), (val), (i))
+#define sk_BN_BLINDING_set_cmp_func(st, cmp) SKM_sk_set_cmp_func(BN_BLINDING, (st), (cmp))
+#define sk_BN_BLINDING_dup(st) SKM_sk_dup(BN_BLINDING, st)
+#define sk_BN_BLINDING_pop_free(st, free_func) SKM_sk_pop_free(BN_BLINDING, (st), (free_func))
+#define sk_BN_BLINDING_deep_copy(st, copy_func, free_func) SKM_sk_deep_copy(BN_BLINDING, (st), (copy_func), (free_func))
+#define sk_BN_BLINDING_shift(st) SKM_sk_shift(BN_BLINDING, (st))
+#define sk_BN_BLINDING_pop(st) SKM_sk_pop(BN_BLINDING, (st))
+#define sk_BN_BLINDING_sort(st) SKM_sk_sort(BN_BLINDING, (st))
+#define sk_BN_BLINDING_is_sorted(st) SKM_sk_is_sorted(BN_BLINDING, (st))
+
 #define sk_BY_DIR_ENTRY_new(cmp) SKM_sk_new(BY_DIR_ENTRY, (cmp))
 #define sk_BY_DIR_ENTRY_new_null() SKM_sk_new_null(BY_DIR_ENTRY)
 #define sk_BY_DIR_ENTRY_free(st) SKM_sk_free(BY_DIR_ENTRY, (st))
@@ -116,6 +116,13 @@
 
 #include "cryptlib.h"
 
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+/* As for the per-thread DRBGs, the child of a fork() is told apart by an
+ * atfork handler, so that the check does not need a getpid() call */
+# define FORK_ATFORK
+# include <pthread.h>
+#endif
+
 #ifndef OPENSSL_NO_DEPRECATED
 static unsigned long (MS_FAR *id_callback)(void)=0;
 #endif
@@ -252,3 +259,44 @@ unsigned long CRYPTO_thread_id(void)
 	return(ret);
 	}
 #endif
+
+#ifdef FORK_ATFORK
+static int fork_generation = 0;
+static int fork_atfork = -1;	/* not registered yet */
+
+/* The child has a single thread, and a lock may have been held by another
+ * thread of the parent, so no lock is taken */
+static void fork_child(void)
+	{
+	fork_generation++;
+	}
+#endif
+
+/* Returns a number that differs between a process and its children. Queues
+ * of values that must be used only once, such as precomputed ECDSA nonces,
+ * record it when filled and are flushed when it no longer matches. */
+int CRYPTO_fork_generation(void)
+	{
+#ifdef FORK_ATFORK
+	if (fork_atfork < 0)
+		{
+		CRYPTO_w_lock(CRYPTO_LOCK_FORK);
+		/* Registered once, a failure leaves the getpid() check */
+		if (fork_atfork < 0)
+			fork_atfork = pthread_atfork(NULL, NULL,
+						     fork_child) == 0;
+		CRYPTO_w_unlock(CRYPTO_LOCK_FORK);
+		}
+	if (fork_atfork)
+# ifdef CRYPTO_ATOMIC_LOAD_INT
+		return CRYPTO_ATOMIC_LOAD_INT(&fork_generation);
+# else
+		return *(volatile int *)&fork_generation;
+# endif
+#endif
+#ifdef GETPID_IS_MEANINGLESS
+	return 0;
+#else
+	return (int)getpid();
+#endif
+	}
@@ -0,0 +1,159 @@
+/* crypto/thr_local.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include "cryptlib.h"
+
+/* Pick the thread-local storage primitive of the platform. Without thread
+ * support a single value per key is all that is needed. */
+#if !defined(OPENSSL_THREADS)
+# define THREAD_LOCAL_SINGLE
+#elif defined(OPENSSL_SYS_WIN32)
+# define THREAD_LOCAL_WIN32
+# include <windows.h>
+#elif defined(OPENSSL_SYS_UNIX)
+# define THREAD_LOCAL_PTHREAD
+# include <pthread.h>
+#endif
+
+struct crypto_thread_local_st
+	{
+#if defined(THREAD_LOCAL_PTHREAD)
+	pthread_key_t key;
+#elif defined(THREAD_LOCAL_WIN32)
+	DWORD index;
+#else
+	void *value;
+#endif
+	void (*cleanup)(void *);
+	};
+
+CRYPTO_THREAD_LOCAL *CRYPTO_THREAD_LOCAL_new(void (*cleanup)(void *))
+	{
+	CRYPTO_THREAD_LOCAL *ret;
+
+#if !defined(THREAD_LOCAL_PTHREAD) && !defined(THREAD_LOCAL_WIN32) && \
+    !defined(THREAD_LOCAL_SINGLE)
+	/* No thread-local storage on this platform */
+	return NULL;
+#endif
+	ret=(CRYPTO_THREAD_LOCAL *)OPENSSL_malloc(sizeof(CRYPTO_THREAD_LOCAL));
+	if (ret == NULL)
+		return NULL;
+	ret->cleanup = cleanup;
+#if defined(THREAD_LOCAL_PTHREAD)
+	if (pthread_key_create(&ret->key, cleanup) != 0)
+		{
+		OPENSSL_free(ret);
+		return NULL;
+		}
+#elif defined(THREAD_LOCAL_WIN32)
+	/* TLS slots have no destructor, values of exiting threads are only
+	 * released if the thread clears them itself. */
+	if ((ret->index = TlsAlloc()) == TLS_OUT_OF_INDEXES)
+		{
+		OPENSSL_free(ret);
+		return NULL;
+		}
+#else
+	ret->value = NULL;
+#endif
+	return ret;
+	}
+
+void CRYPTO_THREAD_LOCAL_free(CRYPTO_THREAD_LOCAL *key)
+	{
+	void *val;
+
+	if (key == NULL)
+		return;
+	/* Only the value of the calling thread can be reached from here */
+	val = CRYPTO_THREAD_LOCAL_get(key);
+	if (val != NULL && key->cleanup != NULL)
+		key->cleanup(val);
+#if defined(THREAD_LOCAL_PTHREAD)
+	pthread_key_delete(key->key);
+#elif defined(THREAD_LOCAL_WIN32)
+	TlsFree(key->index);
+#endif
+	OPENSSL_free(key);
+	}
+
+void *CRYPTO_THREAD_LOCAL_get(CRYPTO_THREAD_LOCAL *key)
+	{
+#if defined(THREAD_LOCAL_PTHREAD)
+	return pthread_getspecific(key->key);
+#elif defined(THREAD_LOCAL_WIN32)
+	/* TlsGetValue() clobbers the last error on success */
+	DWORD err = GetLastError();
+	void *ret = TlsGetValue(key->index);
+
+	SetLastError(err);
+	return ret;
+#else
+	return key->value;
+#endif
+	}
+
+int CRYPTO_THREAD_LOCAL_set(CRYPTO_THREAD_LOCAL *key, void *val)
+	{
+#if defined(THREAD_LOCAL_PTHREAD)
+	return pthread_setspecific(key->key, val) == 0;
+#elif defined(THREAD_LOCAL_WIN32)
+	return TlsSetValue(key->index, val) != 0;
+#else
+	key->value = val;
+	return 1;
+#endif
+	}
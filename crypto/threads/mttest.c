@@ -65,6 +65,8 @@
 #endif
 #ifdef OPENSSL_SYS_WIN32
 #include <windows.h>
+#else
+#include <sys/time.h>
 #endif
 #ifdef SOLARIS
 #include <synch.h>
@@ -119,10 +121,10 @@ void pthreads_locking_callback(int mode,int type,char *file,int line);
 void netware_locking_callback(int mode,int type,char *file,int line);
 void beos_locking_callback(int mode,int type,const char *file,int line);
 
-unsigned long irix_thread_id(void );
-unsigned long solaris_thread_id(void );
-unsigned long pthreads_thread_id(void );
-unsigned long netware_thread_id(void );
+void irix_thread_id(CRYPTO_THREADID *tid);
+void solaris_thread_id(CRYPTO_THREADID *tid);
+void pthreads_thread_id(CRYPTO_THREADID *tid);
+void netware_thread_id(CRYPTO_THREADID *tid);
 unsigned long beos_thread_id(void );
 
 #if defined(OPENSSL_SYS_NETWARE)
@@ -144,6 +146,8 @@ int thread_number=10;
 int number_of_loops=10;
 int reconnect=0;
 int cache_stats=0;
+int ref_loops=0;
+int lock_refs=0;
 
 static const char rnd_seed[] = "string to make the random number generator think it has entropy";
 
@@ -181,6 +185,42 @@ static void sv_usage(void)
 	fprintf(stderr," -cert arg     - server certificate/key\n");
 	fprintf(stderr," -ccert arg    - client certificate/key\n");
 	fprintf(stderr," -ssl3         - just SSLv3n\n");
+	fprintf(stderr," -refs arg     - instead of connecting, take and release arg\n");
+	fprintf(stderr,"                 references to shared objects per loop\n");
+	fprintf(stderr," -lock_refs    - update reference counts under a lock\n");
+	}
+
+static unsigned long thread_id(void)
+	{
+	CRYPTO_THREADID tid;
+
+	CRYPTO_THREADID_current(&tid);
+	return(CRYPTO_THREADID_hash(&tid));
+	}
+
+static double get_time(void)
+	{
+#ifdef OPENSSL_SYS_WIN32
+	return(GetTickCount()/1000.0);
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv,NULL);
+	return(tv.tv_sec+tv.tv_usec/1e6);
+#endif
+	}
+
+/* Reference counting as done without built-in atomic operations, for
+ * comparison with them. */
+static int locked_add_callback(int *pointer, int amount, int type,
+	const char *file, int line)
+	{
+	int ret;
+
+	CRYPTO_lock(CRYPTO_LOCK|CRYPTO_WRITE,type,file,line);
+	ret= *pointer+=amount;
+	CRYPTO_lock(CRYPTO_UNLOCK|CRYPTO_WRITE,type,file,line);
+	return(ret);
 	}
 
 int main(int argc, char *argv[])
@@ -195,6 +235,7 @@ int main(int argc, char *argv[])
 	char *scert=TEST_SERVER_CERT;
 	char *ccert=TEST_CLIENT_CERT;
 	SSL_METHOD *ssl_method=SSLv23_method();
+	double start;
 
 	RAND_seed(rnd_seed, sizeof rnd_seed);
 
@@ -251,6 +292,13 @@ int main(int argc, char *argv[])
 			number_of_loops= atoi(*(++argv));
 			if (number_of_loops == 0) number_of_loops=1;
 			}
+		else if	(strcmp(*argv,"-refs") == 0)
+			{
+			if (--argc < 1) goto bad;
+			ref_loops= atoi(*(++argv));
+			}
+		else if	(strcmp(*argv,"-lock_refs") == 0)
+			lock_refs=1;
 		else
 			{
 			fprintf(stderr,"unknown option %s\n",*argv);
@@ -267,6 +315,9 @@ bad:
 		goto end;
 		}
 
+	if (lock_refs)
+		CRYPTO_set_add_lock_callback(locked_add_callback);
+
 	if (cipher == NULL && OPENSSL_issetugid() == 0)
 		cipher=getenv("SSL_CIPHER");
 
@@ -329,7 +380,12 @@ bad:
 		}
 
 	thread_setup();
+	start=get_time();
 	do_threads(s_ctx,c_ctx);
+	if (ref_loops)
+		fprintf(stderr,"%d reference updates in %.2fs\n",
+			thread_number*number_of_loops*ref_loops*6,
+			get_time()-start);
 	thread_cleanup();
 end:
 	
@@ -343,7 +399,7 @@ end:
 		{
 		fprintf(stderr,"Server SSL_CTX stats then free it\n");
 		print_stats(stderr,s_ctx);
-		if (cache_stats)
+		if (cache_stats && SSL_CTX_sessions(s_ctx) != NULL)
 			{
 			fprintf(stderr,"-----\n");
 			lh_stats(SSL_CTX_sessions(s_ctx),stderr);
@@ -365,6 +421,27 @@ end:
 #define C_DONE	1
 #define S_DONE	2
 
+/* Take and drop references to objects that every connection shares */
+static int do_refs(SSL_CTX *ssl_ctx[2])
+	{
+	X509 *x=SSL_CTX_get0_certificate(ssl_ctx[0]);
+	EVP_PKEY *pkey=SSL_CTX_get0_privatekey(ssl_ctx[0]);
+	int i;
+
+	if ((x == NULL) || (pkey == NULL))
+		return(1);
+	for (i=0; i<ref_loops; i++)
+		{
+		CRYPTO_add(&x->references,1,CRYPTO_LOCK_X509);
+		CRYPTO_add(&pkey->references,1,CRYPTO_LOCK_EVP_PKEY);
+		CRYPTO_add(&ssl_ctx[1]->references,1,CRYPTO_LOCK_SSL_CTX);
+		SSL_CTX_free(ssl_ctx[1]);
+		EVP_PKEY_free(pkey);
+		X509_free(x);
+		}
+	return(0);
+	}
+
 int ndoit(SSL_CTX *ssl_ctx[2])
 	{
 	int i;
@@ -385,7 +462,7 @@ int ndoit(SSL_CTX *ssl_ctx[2])
 		ctx[3]=NULL;
 		}
 
-	fprintf(stdout,"started thread %lu\n",CRYPTO_thread_id());
+	fprintf(stdout,"started thread %lu\n",thread_id());
 	for (i=0; i<number_of_loops; i++)
 		{
 /*		fprintf(stderr,"%4d %2d ctx->ref (%3d,%3d)\n",
@@ -394,15 +471,18 @@ int ndoit(SSL_CTX *ssl_ctx[2])
 			ssl_ctx[1]->references); */
 	/*	pthread_delay_np(&tm);*/
 
-		ret=doit(ctx);
+		if (ref_loops)
+			ret=do_refs(ssl_ctx);
+		else
+			ret=doit(ctx);
 		if (ret != 0)
 			{
 			fprintf(stdout,"error[%d] %lu - %d\n",
-				i,CRYPTO_thread_id(),ret);
+				i,thread_id(),ret);
 			return(ret);
 			}
 		}
-	fprintf(stdout,"DONE %lu\n",CRYPTO_thread_id());
+	fprintf(stdout,"DONE %lu\n",thread_id());
 	if (reconnect)
 		{
 		SSL_free((SSL *)ctx[2]);
@@ -829,7 +909,7 @@ void thread_setup(void)
 		mutex_init(&(lock_cs[i]),USYNC_THREAD,NULL);
 		}
 
-	CRYPTO_set_id_callback((unsigned long (*)())solaris_thread_id);
+	CRYPTO_THREADID_set_callback(solaris_thread_id);
 	CRYPTO_set_locking_callback((void (*)())solaris_locking_callback);
 	}
 
@@ -915,12 +995,9 @@ void do_threads(SSL_CTX *s_ctx, SSL_CTX *c_ctx)
 		s_ctx->references,c_ctx->references);
 	}
 
-unsigned long solaris_thread_id(void)
+void solaris_thread_id(CRYPTO_THREADID *tid)
 	{
-	unsigned long ret;
-
-	ret=(unsigned long)thr_self();
-	return(ret);
+	CRYPTO_THREADID_set_numeric(tid, (unsigned long)thr_self());
 	}
 #endif /* SOLARIS */
 
@@ -951,7 +1028,7 @@ void thread_setup(void)
 		lock_cs[i]=usnewsema(arena,1);
 		}
 
-	CRYPTO_set_id_callback((unsigned long (*)())irix_thread_id);
+	CRYPTO_THREADID_set_callback(irix_thread_id);
 	CRYPTO_set_locking_callback((void (*)())irix_locking_callback);
 	}
 
@@ -1010,33 +1087,30 @@ void do_threads(SSL_CTX *s_ctx, SSL_CTX *c_ctx)
 		s_ctx->references,c_ctx->references);
 	}
 
-unsigned long irix_thread_id(void)
+void irix_thread_id(CRYPTO_THREADID *tid)
 	{
-	unsigned long ret;
-
-	ret=(unsigned long)getpid();
-	return(ret);
+	CRYPTO_THREADID_set_numeric(tid, (unsigned long)getpid());
 	}
 #endif /* IRIX */
 
 #ifdef PTHREADS
 
-static pthread_mutex_t *lock_cs;
+static pthread_rwlock_t *lock_cs;
 static long *lock_count;
 
 void thread_setup(void)
 	{
 	int i;
 
-	lock_cs=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+	lock_cs=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(pthread_rwlock_t));
 	lock_count=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(long));
 	for (i=0; i<CRYPTO_num_locks(); i++)
 		{
 		lock_count[i]=0;
-		pthread_mutex_init(&(lock_cs[i]),NULL);
+		pthread_rwlock_init(&(lock_cs[i]),NULL);
 		}
 
-	CRYPTO_set_id_callback((unsigned long (*)())pthreads_thread_id);
+	CRYPTO_THREADID_set_callback(pthreads_thread_id);
 	CRYPTO_set_locking_callback((void (*)())pthreads_locking_callback);
 	}
 
@@ -1048,7 +1122,7 @@ void thread_cleanup(void)
 	fprintf(stderr,"cleanup\n");
 	for (i=0; i<CRYPTO_num_locks(); i++)
 		{
-		pthread_mutex_destroy(&(lock_cs[i]));
+		pthread_rwlock_destroy(&(lock_cs[i]));
 		fprintf(stderr,"%8ld:%s\n",lock_count[i],
 			CRYPTO_get_lock_name(i));
 		}
@@ -1073,14 +1147,18 @@ void pthreads_locking_callback(int mode, int type, char *file,
 		CRYPTO_thread_id(),
 		mode,file,line);
 */
+	/* Locks requested for reading may be shared */
 	if (mode & CRYPTO_LOCK)
 		{
-		pthread_mutex_lock(&(lock_cs[type]));
+		if (mode & CRYPTO_READ)
+			pthread_rwlock_rdlock(&(lock_cs[type]));
+		else
+			pthread_rwlock_wrlock(&(lock_cs[type]));
 		lock_count[type]++;
 		}
 	else
 		{
-		pthread_mutex_unlock(&(lock_cs[type]));
+		pthread_rwlock_unlock(&(lock_cs[type]));
 		}
 	}
 
@@ -1112,12 +1190,9 @@ void do_threads(SSL_CTX *s_ctx, SSL_CTX *c_ctx)
 		s_ctx->references,c_ctx->references);
 	}
 
-unsigned long pthreads_thread_id(void)
+void pthreads_thread_id(CRYPTO_THREADID *tid)
 	{
-	unsigned long ret;
-
-	ret=(unsigned long)pthread_self();
-	return(ret);
+	CRYPTO_THREADID_set_numeric(tid, (unsigned long)pthread_self());
 	}
 
 #endif /* PTHREADS */
@@ -1140,7 +1215,7 @@ void thread_setup(void)
 
    ThreadSem = MPKSemaphoreAlloc("OpenSSL mttest semaphore", 0 );
 
-   CRYPTO_set_id_callback((unsigned long (*)())netware_thread_id);
+   CRYPTO_THREADID_set_callback(netware_thread_id);
    CRYPTO_set_locking_callback((void (*)())netware_locking_callback);
 }
 
@@ -1201,11 +1276,8 @@ void do_threads(SSL_CTX *s_ctx, SSL_CTX *c_ctx)
          s_ctx->references,c_ctx->references);
 }
 
-unsigned long netware_thread_id(void)
+void netware_thread_id(CRYPTO_THREADID *tid)
 {
-   unsigned long ret;
-
-   ret=(unsigned long)GetThreadID();
-   return(ret);
+   CRYPTO_THREADID_set_numeric(tid, (unsigned long)GetThreadID());
 }
 #endif /* NETWARE */
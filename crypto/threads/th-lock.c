@@ -317,19 +317,19 @@ unsigned long irix_thread_id(void)
 /* Linux and a few others */
 #ifdef PTHREADS
 
-static pthread_mutex_t *lock_cs;
+static pthread_rwlock_t *lock_cs;
 static long *lock_count;
 
 void CRYPTO_thread_setup(void)
 	{
 	int i;
 
-	lock_cs=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(pthread_mutex_t));
+	lock_cs=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(pthread_rwlock_t));
 	lock_count=OPENSSL_malloc(CRYPTO_num_locks() * sizeof(long));
 	for (i=0; i<CRYPTO_num_locks(); i++)
 		{
 		lock_count[i]=0;
-		pthread_mutex_init(&(lock_cs[i]),NULL);
+		pthread_rwlock_init(&(lock_cs[i]),NULL);
 		}
 
 	CRYPTO_set_id_callback((unsigned long (*)())pthreads_thread_id);
@@ -343,7 +343,7 @@ void thread_cleanup(void)
 	CRYPTO_set_locking_callback(NULL);
 	for (i=0; i<CRYPTO_num_locks(); i++)
 		{
-		pthread_mutex_destroy(&(lock_cs[i]));
+		pthread_rwlock_destroy(&(lock_cs[i]));
 		}
 	OPENSSL_free(lock_cs);
 	OPENSSL_free(lock_count);
@@ -364,14 +364,18 @@ void pthreads_locking_callback(int mode, int type, char *file,
 		CRYPTO_thread_id(),
 		mode,file,line);
 #endif
+	/* Locks requested for reading may be shared */
 	if (mode & CRYPTO_LOCK)
 		{
-		pthread_mutex_lock(&(lock_cs[type]));
+		if (mode & CRYPTO_READ)
+			pthread_rwlock_rdlock(&(lock_cs[type]));
+		else
+			pthread_rwlock_wrlock(&(lock_cs[type]));
 		lock_count[type]++;
 		}
 	else
 		{
-		pthread_mutex_unlock(&(lock_cs[type]));
+		pthread_rwlock_unlock(&(lock_cs[type]));
 		}
 	}
 
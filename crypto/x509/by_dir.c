@@ -418,11 +418,11 @@ static int get_cert_by_subject(X509_LOOKUP *xl, int type, X509_NAME *name,
 
 		/* we have added it to the cache so now pull
 		 * it out again */
-		CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+		CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 		j = sk_X509_OBJECT_find(xl->store_ctx->objs,&stmp);
 		if(j != -1) tmp=sk_X509_OBJECT_value(xl->store_ctx->objs,j);
 		else tmp = NULL;
-		CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+		CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 
 
 		/* If a CRL, update the last file suffix added for this */
@@ -460,6 +460,9 @@ static int get_cert_by_subject(X509_LOOKUP *xl, int type, X509_NAME *name,
 					ok = 0;
 					goto finish;
 					}
+				/* Keep the hashes sorted for the lookup
+				 * above, which only holds a read lock */
+				sk_BY_DIR_HASH_sort(ent->hashes);
 				}
 			else if (hent->suffix < k)
 				hent->suffix = k;
@@ -0,0 +1,550 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Lookup method backed by a single index file, built by the "certindex"
+ * utility with X509_LOOKUP_write_index().
+ *
+ * The file starts with a header and a table of entries, all numbers in it
+ * being four byte big endian:
+ *
+ *	"OSSLXIDX"	magic
+ *	version		INDEX_VERSION
+ *	count		number of entries
+ *
+ * followed by count entries of:
+ *
+ *	hash		X509_NAME_hash() of the subject or CRL issuer
+ *	type		X509_LU_X509 or X509_LU_CRL
+ *	offset		of the DER encoding, from the start of the file
+ *	length		of the DER encoding
+ *
+ * sorted by hash and type. The encodings follow the table.
+ *
+ * Where possible the file is mapped read only, so that the processes using
+ * it share its pages, and nothing is read from it before a lookup needs it.
+ * A lookup binary searches the table and decodes the entries with the hash
+ * it wants into the store, like by_dir.c does with files: each entry is
+ * decoded at most once.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cryptlib.h"
+
+#if defined(OPENSSL_SYS_UNIX) && !defined(OPENSSL_NO_POSIX_IO)
+# define INDEX_MMAP
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include <openssl/buffer.h>
+#include <openssl/x509.h>
+
+#define INDEX_MAGIC		"OSSLXIDX"
+#define INDEX_MAGIC_LEN		8
+#define INDEX_VERSION		1
+#define INDEX_HEADER_LEN	16
+#define INDEX_ENTRY_LEN		16
+
+#define index_get32(p) \
+	(((unsigned long)(p)[0] << 24) | ((unsigned long)(p)[1] << 16) | \
+	((unsigned long)(p)[2] << 8) | (unsigned long)(p)[3])
+
+#define index_put32(p, v) \
+	((p)[0] = (unsigned char)((v) >> 24), \
+	(p)[1] = (unsigned char)((v) >> 16), \
+	(p)[2] = (unsigned char)((v) >> 8), \
+	(p)[3] = (unsigned char)(v))
+
+typedef struct lookup_index_st
+	{
+	const unsigned char *data;	/* The whole file */
+	size_t length;
+	int mapped;
+	unsigned long num;		/* Number of entries */
+	unsigned char *loaded;		/* Bit set for entries decoded */
+	} BY_INDEX;
+
+static int index_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
+	char **ret);
+static int new_index(X509_LOOKUP *lu);
+static void free_index(X509_LOOKUP *lu);
+static int get_cert_by_subject(X509_LOOKUP *xl, int type, X509_NAME *name,
+	X509_OBJECT *ret);
+X509_LOOKUP_METHOD x509_index_lookup=
+	{
+	"Load certs from an index file",
+	new_index,		/* new */
+	free_index,		/* free */
+	NULL, 			/* init */
+	NULL,			/* shutdown */
+	index_ctrl,		/* ctrl */
+	get_cert_by_subject,	/* get_by_subject */
+	NULL,			/* get_by_issuer_serial */
+	NULL,			/* get_by_fingerprint */
+	NULL,			/* get_by_alias */
+	};
+
+X509_LOOKUP_METHOD *X509_LOOKUP_index_file(void)
+	{
+	return(&x509_index_lookup);
+	}
+
+static int new_index(X509_LOOKUP *lu)
+	{
+	BY_INDEX *a;
+
+	if ((a=(BY_INDEX *)OPENSSL_malloc(sizeof(BY_INDEX))) == NULL)
+		return(0);
+	a->data=NULL;
+	a->length=0;
+	a->mapped=0;
+	a->num=0;
+	a->loaded=NULL;
+	lu->method_data=(char *)a;
+	return(1);
+	}
+
+static void index_release(BY_INDEX *a)
+	{
+	if (a->data == NULL)
+		return;
+#ifdef INDEX_MMAP
+	if (a->mapped)
+		munmap((void *)a->data, a->length);
+	else
+#endif
+		OPENSSL_free((void *)a->data);
+	if (a->loaded != NULL)
+		OPENSSL_free(a->loaded);
+	a->data=NULL;
+	a->loaded=NULL;
+	}
+
+static void free_index(X509_LOOKUP *lu)
+	{
+	BY_INDEX *a;
+
+	a=(BY_INDEX *)lu->method_data;
+	index_release(a);
+	OPENSSL_free(a);
+	}
+
+/* Read the whole of file into *pdata, mapping it if possible */
+static int index_read(const char *file, const unsigned char **pdata,
+					size_t *plength, int *pmapped)
+	{
+	BIO *in;
+	BUF_MEM *b;
+	int i;
+#ifdef INDEX_MMAP
+	struct stat st;
+	void *p;
+	int fd;
+
+	fd=open(file,O_RDONLY);
+	if (fd < 0)
+		{
+		SYSerr(SYS_F_FOPEN,get_last_sys_error());
+		ERR_add_error_data(2,"file=",file);
+		return 0;
+		}
+	if (fstat(fd,&st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+		p=mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+		if (p != MAP_FAILED)
+			{
+			close(fd);
+			*pdata=p;
+			*plength=(size_t)st.st_size;
+			*pmapped=1;
+			return 1;
+			}
+		}
+	close(fd);
+#endif
+	/* Not a mappable file: read it into memory instead */
+	if ((in=BIO_new_file(file,"rb")) == NULL)
+		return 0;
+	if ((b=BUF_MEM_new()) == NULL)
+		{
+		BIO_free(in);
+		return 0;
+		}
+	for (;;)
+		{
+		if (!BUF_MEM_grow(b,b->length+4096))
+			goto err;
+		i=BIO_read(in,b->data+b->length-4096,4096);
+		if (i <= 0)
+			break;
+		b->length-=4096-i;
+		}
+	b->length-=4096;
+	BIO_free(in);
+	*pdata=(unsigned char *)b->data;
+	*plength=b->length;
+	*pmapped=0;
+	b->data=NULL;
+	BUF_MEM_free(b);
+	return 1;
+err:
+	BIO_free(in);
+	BUF_MEM_free(b);
+	return 0;
+	}
+
+/* Compare the key of an entry with hash and type */
+static int index_entry_cmp(const unsigned char *ent, unsigned long hash,
+							int type)
+	{
+	unsigned long h=index_get32(ent);
+	unsigned long t=index_get32(ent+4);
+	if (h != hash)
+		return h < hash ? -1 : 1;
+	if (t != (unsigned long)type)
+		return t < (unsigned long)type ? -1 : 1;
+	return 0;
+	}
+
+static int load_index(BY_INDEX *ctx, const char *file)
+	{
+	BY_INDEX a;
+	const unsigned char *ent;
+	unsigned long i,off,len,start;
+
+	if (file == NULL || !*file)
+		{
+		X509err(X509_F_LOAD_INDEX,X509_R_INVALID_INDEX_FILE);
+		return 0;
+		}
+	a.loaded=NULL;
+	if (!index_read(file,&a.data,&a.length,&a.mapped))
+		{
+		X509err(X509_F_LOAD_INDEX,ERR_R_SYS_LIB);
+		return 0;
+		}
+
+	/* Check everything a lookup relies on once, here */
+	if (a.length < INDEX_HEADER_LEN
+		|| memcmp(a.data,INDEX_MAGIC,INDEX_MAGIC_LEN)
+		|| index_get32(a.data+8) != INDEX_VERSION)
+		goto bad;
+	a.num=index_get32(a.data+12);
+	if (a.num > (a.length-INDEX_HEADER_LEN)/INDEX_ENTRY_LEN)
+		goto bad;
+	start=INDEX_HEADER_LEN+a.num*INDEX_ENTRY_LEN;
+	for (i=0; i < a.num; i++)
+		{
+		ent=a.data+INDEX_HEADER_LEN+i*INDEX_ENTRY_LEN;
+		off=index_get32(ent+8);
+		len=index_get32(ent+12);
+		if (index_get32(ent+4) != X509_LU_X509
+			&& index_get32(ent+4) != X509_LU_CRL)
+			goto bad;
+		if (off < start || off > a.length || len > a.length-off
+			|| len > 0x7fffffffUL)
+			goto bad;
+		if (i > 0 && index_entry_cmp(ent-INDEX_ENTRY_LEN,
+				index_get32(ent),(int)index_get32(ent+4)) > 0)
+			goto bad;
+		}
+
+	a.loaded=OPENSSL_malloc(a.num/8+1);
+	if (a.loaded == NULL)
+		{
+		X509err(X509_F_LOAD_INDEX,ERR_R_MALLOC_FAILURE);
+		index_release(&a);
+		return 0;
+		}
+	memset(a.loaded,0,a.num/8+1);
+
+	/* Loading another index replaces the previous one, so this must not
+	 * happen while the store is in use. Objects already decoded from it
+	 * stay in the store.
+	 */
+	index_release(ctx);
+	*ctx=a;
+	return 1;
+bad:
+	X509err(X509_F_LOAD_INDEX,X509_R_INVALID_INDEX_FILE);
+	ERR_add_error_data(2,"file=",file);
+	index_release(&a);
+	return 0;
+	}
+
+static int index_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
+	     char **retp)
+	{
+	int ret=0;
+	BY_INDEX *ld;
+
+	ld=(BY_INDEX *)ctx->method_data;
+
+	switch (cmd)
+		{
+	case X509_L_LOAD_INDEX:
+		ret=load_index(ld,argp);
+		break;
+		}
+	return(ret);
+	}
+
+/* Decode an entry into the store */
+static void index_decode(X509_LOOKUP *xl, const unsigned char *ent)
+	{
+	BY_INDEX *ctx=(BY_INDEX *)xl->method_data;
+	const unsigned char *p=ctx->data+index_get32(ent+8);
+	long len=(long)index_get32(ent+12);
+	X509 *x;
+	X509_CRL *crl;
+
+	/* Objects already in the store are not errors */
+	ERR_set_mark();
+	if (index_get32(ent+4) == X509_LU_X509)
+		{
+		x=d2i_X509(NULL,&p,len);
+		if (x != NULL)
+			{
+			X509_STORE_add_cert(xl->store_ctx,x);
+			X509_free(x);
+			}
+		}
+	else
+		{
+		crl=d2i_X509_CRL_compact(NULL,&p,len);
+		if (crl != NULL)
+			{
+			X509_STORE_add_crl(xl->store_ctx,crl);
+			X509_CRL_free(crl);
+			}
+		}
+	ERR_pop_to_mark();
+	}
+
+static int get_cert_by_subject(X509_LOOKUP *xl, int type, X509_NAME *name,
+	     X509_OBJECT *ret)
+	{
+	BY_INDEX *ctx;
+	X509_OBJECT *tmp;
+	const unsigned char *ent;
+	unsigned long h,lo,hi,mid,i;
+	int decode;
+
+	if (name == NULL) return(0);
+
+	if (type != X509_LU_X509 && type != X509_LU_CRL)
+		{
+		X509err(X509_F_INDEX_GET_CERT_BY_SUBJECT,X509_R_WRONG_LOOKUP_TYPE);
+		return(0);
+		}
+
+	ctx=(BY_INDEX *)xl->method_data;
+	if (ctx->data == NULL)
+		return(0);
+
+	h=X509_NAME_hash(name);
+	lo=0;
+	hi=ctx->num;
+	while (lo < hi)
+		{
+		mid=lo+(hi-lo)/2;
+		ent=ctx->data+INDEX_HEADER_LEN+mid*INDEX_ENTRY_LEN;
+		if (index_entry_cmp(ent,h,type) < 0)
+			lo=mid+1;
+		else
+			hi=mid;
+		}
+
+	for (i=lo; i < ctx->num; i++)
+		{
+		ent=ctx->data+INDEX_HEADER_LEN+i*INDEX_ENTRY_LEN;
+		if (index_entry_cmp(ent,h,type) != 0)
+			break;
+		CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+		decode=!(ctx->loaded[i/8] & (1 << (i%8)));
+		CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+		if (!decode)
+			continue;
+		/* Threads racing here both add the object, which the store
+		 * keeps once.
+		 */
+		index_decode(xl,ent);
+		CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+		ctx->loaded[i/8] |= 1 << (i%8);
+		CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+		}
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+	tmp=X509_OBJECT_retrieve_by_subject(xl->store_ctx->objs,type,name);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+	if (tmp == NULL)
+		return(0);
+	ret->type=tmp->type;
+	memcpy(&ret->data,&tmp->data,sizeof(ret->data));
+	return(1);
+	}
+
+typedef struct
+	{
+	unsigned long hash;
+	int type;
+	int seq;
+	X509_INFO *info;
+	int length;
+	} INDEX_OUT;
+
+static int index_out_cmp(const void *a, const void *b)
+	{
+	const INDEX_OUT *x=a, *y=b;
+	if (x->hash != y->hash)
+		return x->hash < y->hash ? -1 : 1;
+	if (x->type != y->type)
+		return x->type < y->type ? -1 : 1;
+	return x->seq - y->seq;
+	}
+
+/* Write the certificates and CRLs of objs as an index file */
+int X509_LOOKUP_write_index(BIO *out, STACK_OF(X509_INFO) *objs)
+	{
+	INDEX_OUT *ents=NULL;
+	X509_INFO *xi;
+	unsigned char hdr[INDEX_ENTRY_LEN], *buf=NULL, *p;
+	unsigned long off;
+	int i,j,n=0,len,maxlen=0,ret=0;
+
+	ents=OPENSSL_malloc(sizeof(INDEX_OUT)*(2*sk_X509_INFO_num(objs)+1));
+	if (ents == NULL)
+		goto memerr;
+	for (i=0; i < sk_X509_INFO_num(objs); i++)
+		{
+		xi=sk_X509_INFO_value(objs,i);
+		for (j=X509_LU_X509; j <= X509_LU_CRL; j++)
+			{
+			if (j == X509_LU_X509 && xi->x509 != NULL)
+				{
+				ents[n].hash=X509_subject_name_hash(xi->x509);
+				len=i2d_X509(xi->x509,NULL);
+				}
+			else if (j == X509_LU_CRL && xi->crl != NULL)
+				{
+				ents[n].hash=X509_NAME_hash(
+					X509_CRL_get_issuer(xi->crl));
+				len=i2d_X509_CRL(xi->crl,NULL);
+				}
+			else
+				continue;
+			if (len <= 0)
+				goto err;
+			ents[n].type=j;
+			ents[n].seq=n;
+			ents[n].info=xi;
+			ents[n].length=len;
+			if (len > maxlen)
+				maxlen=len;
+			n++;
+			}
+		}
+	qsort(ents,n,sizeof(INDEX_OUT),index_out_cmp);
+
+	memcpy(hdr,INDEX_MAGIC,INDEX_MAGIC_LEN);
+	index_put32(hdr+8,INDEX_VERSION);
+	index_put32(hdr+12,(unsigned long)n);
+	if (BIO_write(out,hdr,INDEX_HEADER_LEN) != INDEX_HEADER_LEN)
+		goto err;
+	off=INDEX_HEADER_LEN+(unsigned long)n*INDEX_ENTRY_LEN;
+	for (i=0; i < n; i++)
+		{
+		index_put32(hdr,ents[i].hash);
+		index_put32(hdr+4,(unsigned long)ents[i].type);
+		index_put32(hdr+8,off);
+		index_put32(hdr+12,(unsigned long)ents[i].length);
+		if ((unsigned long)ents[i].length > 0xffffffffUL-off)
+			{
+			X509err(X509_F_X509_LOOKUP_WRITE_INDEX,
+						X509_R_INDEX_TOO_LARGE);
+			goto err;
+			}
+		if (BIO_write(out,hdr,INDEX_ENTRY_LEN) != INDEX_ENTRY_LEN)
+			goto err;
+		off+=ents[i].length;
+		}
+
+	buf=OPENSSL_malloc(maxlen+1);
+	if (buf == NULL)
+		goto memerr;
+	for (i=0; i < n; i++)
+		{
+		p=buf;
+		if (ents[i].type == X509_LU_X509)
+			len=i2d_X509(ents[i].info->x509,&p);
+		else
+			len=i2d_X509_CRL(ents[i].info->crl,&p);
+		if (len != ents[i].length || BIO_write(out,buf,len) != len)
+			goto err;
+		}
+	ret=1;
+	goto err;
+memerr:
+	X509err(X509_F_X509_LOOKUP_WRITE_INDEX,ERR_R_MALLOC_FAILURE);
+err:
+	if (ents != NULL)
+		OPENSSL_free(ents);
+	if (buf != NULL)
+		OPENSSL_free(buf);
+	return(ret);
+	}
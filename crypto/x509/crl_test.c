@@ -0,0 +1,606 @@
+/* crypto/x509/crl_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Tests for d2i_X509_CRL_compact(): the CRLs it decodes must behave as
+ * those of d2i_X509_CRL() do, whether or not they can be indexed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#ifdef OPENSSL_NO_EC
+int main(int argc, char *argv[])
+	{
+	puts("Elliptic curves are disabled.");
+	return 0;
+	}
+#else
+
+#include <openssl/ec.h>
+
+/* Revoked entry of a test CRL */
+typedef struct
+	{
+	long serial;
+	int reason;		/* CRL_REASON_*, or -1 for no extension */
+	int flags;
+	} CRL_ENTRY;
+
+#define ENTRY_CRITICAL	1	/* Add a critical invalidity date */
+#define ENTRY_ISSUER	2	/* Add a certificate issuer */
+
+static const long probes[] =
+	{ -5, 0, 1, 2, 3, 4, 7, 9, 10, 11, 39, 40, 127, 128, 255, 256,
+	  65535, 65536, 1000000, 0x7fffffffL };
+
+static EVP_PKEY *ca_key;
+static X509 *ca_cert;
+static X509_NAME *other_name;
+
+static EVP_PKEY *make_key(void)
+	{
+	EVP_PKEY *pkey = EVP_PKEY_new();
+	EC_KEY *ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+	if (pkey == NULL || ec == NULL || !EC_KEY_generate_key(ec)
+		|| !EVP_PKEY_assign_EC_KEY(pkey, ec))
+		{
+		EC_KEY_free(ec);
+		EVP_PKEY_free(pkey);
+		return NULL;
+		}
+	return pkey;
+	}
+
+/* Certificate with the given serial number issued by the test CA, or the
+ * self-signed CA certificate if pkey is NULL.
+ */
+static X509 *make_cert(long serial, EVP_PKEY *pkey)
+	{
+	X509 *x = X509_new();
+	X509_NAME *name = X509_NAME_new();
+	X509_EXTENSION *ext = NULL;
+	int ok;
+
+	ok = x != NULL && name != NULL
+		&& X509_set_version(x, 2)
+		&& ASN1_INTEGER_set(X509_get_serialNumber(x), serial)
+		&& X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+			(unsigned char *)(pkey ? "Leaf" : "Test CA"), -1, -1, 0)
+		&& X509_set_subject_name(x, name)
+		&& X509_set_issuer_name(x, pkey ?
+				X509_get_subject_name(ca_cert) : name)
+		&& X509_gmtime_adj(X509_get_notBefore(x), -86400)
+		&& X509_gmtime_adj(X509_get_notAfter(x), 86400)
+		&& X509_set_pubkey(x, pkey ? pkey : ca_key);
+	if (ok && pkey == NULL)
+		{
+		ext = X509V3_EXT_conf_nid(NULL, NULL, NID_basic_constraints,
+							"critical,CA:TRUE");
+		ok = ext != NULL && X509_add_ext(x, ext, -1);
+		}
+	ok = ok && X509_sign(x, ca_key, EVP_sha256());
+	X509_EXTENSION_free(ext);
+	X509_NAME_free(name);
+	if (!ok)
+		{
+		X509_free(x);
+		return NULL;
+		}
+	return x;
+	}
+
+static int add_entry(X509_CRL *crl, const CRL_ENTRY *e, ASN1_TIME *tm)
+	{
+	X509_REVOKED *rev = X509_REVOKED_new();
+	ASN1_INTEGER *serial = ASN1_INTEGER_new();
+	ASN1_ENUMERATED *reason = NULL;
+	GENERAL_NAMES *gens = NULL;
+	GENERAL_NAME *gen;
+	int ok;
+
+	ok = rev != NULL && serial != NULL
+		&& ASN1_INTEGER_set(serial, e->serial)
+		&& X509_REVOKED_set_serialNumber(rev, serial)
+		&& X509_REVOKED_set_revocationDate(rev, tm);
+	if (ok && e->reason >= 0)
+		{
+		reason = ASN1_ENUMERATED_new();
+		ok = reason != NULL && ASN1_ENUMERATED_set(reason, e->reason)
+			&& X509_REVOKED_add1_ext_i2d(rev, NID_crl_reason,
+							reason, 0, 0);
+		}
+	if (ok && (e->flags & ENTRY_CRITICAL))
+		ok = X509_REVOKED_add1_ext_i2d(rev, NID_invalidity_date, tm,
+									1, 0);
+	if (ok && (e->flags & ENTRY_ISSUER))
+		{
+		gens = GENERAL_NAMES_new();
+		gen = GENERAL_NAME_new();
+		ok = gens != NULL && gen != NULL
+			&& sk_GENERAL_NAME_push(gens, gen);
+		if (ok)
+			{
+			gen->type = GEN_DIRNAME;
+			gen->d.directoryName = X509_NAME_dup(other_name);
+			ok = gen->d.directoryName != NULL
+				&& X509_REVOKED_add1_ext_i2d(rev,
+					NID_certificate_issuer, gens, 1, 0);
+			}
+		else
+			GENERAL_NAME_free(gen);
+		}
+	ok = ok && X509_CRL_add0_revoked(crl, rev);
+	if (!ok)
+		X509_REVOKED_free(rev);
+	ASN1_INTEGER_free(serial);
+	ASN1_ENUMERATED_free(reason);
+	GENERAL_NAMES_free(gens);
+	return ok;
+	}
+
+/* Signed CRL of the test CA listing the entries in the order given */
+static int make_crl(const CRL_ENTRY *entries, int n, unsigned char **out)
+	{
+	X509_CRL *crl = X509_CRL_new();
+	ASN1_TIME *last = X509_gmtime_adj(NULL, -3600);
+	ASN1_TIME *next = X509_gmtime_adj(NULL, 86400);
+	int i, ok, len = 0;
+
+	ok = crl != NULL && last != NULL && next != NULL
+		&& X509_CRL_set_version(crl, 1)
+		&& X509_CRL_set_issuer_name(crl,
+					X509_get_subject_name(ca_cert))
+		&& X509_CRL_set_lastUpdate(crl, last)
+		&& X509_CRL_set_nextUpdate(crl, next);
+	for (i = 0; ok && i < n; i++)
+		ok = add_entry(crl, entries + i, last);
+	*out = NULL;
+	if (ok && X509_CRL_sign(crl, ca_key, EVP_sha256()))
+		len = i2d_X509_CRL(crl, out);
+	X509_CRL_free(crl);
+	ASN1_TIME_free(last);
+	ASN1_TIME_free(next);
+	return len;
+	}
+
+/* Certificate carrying just a serial number and an issuer name */
+static X509 *make_stub(long serial, X509_NAME *issuer)
+	{
+	X509 *x = X509_new();
+	if (x == NULL || !ASN1_INTEGER_set(X509_get_serialNumber(x), serial)
+		|| !X509_set_issuer_name(x, issuer))
+		{
+		X509_free(x);
+		return NULL;
+		}
+	return x;
+	}
+
+static int same_entry(X509_REVOKED *a, X509_REVOKED *b)
+	{
+	return !ASN1_INTEGER_cmp(a->serialNumber, b->serialNumber)
+		&& !ASN1_STRING_cmp(a->revocationDate, b->revocationDate)
+		&& a->reason == b->reason;
+	}
+
+/* Check that the compact decoding c of a CRL behaves as its full decoding
+ * f: same encoding, flags, hash, signature and lookups.
+ */
+static int compare_crls(const char *test, X509_CRL *f, X509_CRL *c)
+	{
+	unsigned char *fenc = NULL, *cenc = NULL;
+	X509_REVOKED *frev, *crev;
+	X509_NAME *issuers[2];
+	X509 *stub;
+	int flen, clen, fr, cr, i, j, ok = 1;
+
+	flen = i2d_X509_CRL(f, &fenc);
+	clen = i2d_X509_CRL(c, &cenc);
+	if (flen <= 0 || flen != clen || memcmp(fenc, cenc, flen))
+		{
+		fprintf(stderr, "%s: encodings differ\n", test);
+		ok = 0;
+		}
+	if (fenc)
+		OPENSSL_free(fenc);
+	if (cenc)
+		OPENSSL_free(cenc);
+	if (f->flags != c->flags || f->idp_flags != c->idp_flags
+		|| memcmp(f->sha1_hash, c->sha1_hash, sizeof(f->sha1_hash)))
+		{
+		fprintf(stderr, "%s: flags or hash differ\n", test);
+		ok = 0;
+		}
+	if (X509_CRL_verify(f, ca_key) != X509_CRL_verify(c, ca_key))
+		{
+		fprintf(stderr, "%s: signature checks differ\n", test);
+		ok = 0;
+		}
+	/* Such CRLs are rejected, and d2i_X509_CRL() leaves the reasons of
+	 * the entries after an invalid one unset.
+	 */
+	if (f->flags & EXFLAG_INVALID)
+		return ok;
+
+	issuers[0] = X509_get_subject_name(ca_cert);
+	issuers[1] = other_name;
+	for (i = 0; i < (int)(sizeof(probes) / sizeof(probes[0])); i++)
+		{
+		for (j = 0; j < 2; j++)
+			{
+			stub = make_stub(probes[i], issuers[j]);
+			if (stub == NULL)
+				return 0;
+			crev = NULL;
+			cr = X509_CRL_get0_by_cert(c, &crev, stub);
+			/* Looking the entry up again must find the same one */
+			if (cr > 0 && (X509_CRL_get0_by_cert(c, &frev, stub)
+							!= cr || frev != crev))
+				{
+				fprintf(stderr, "%s: serial %ld found twice "
+						"differently\n", test, probes[i]);
+				ok = 0;
+				}
+			frev = NULL;
+			fr = X509_CRL_get0_by_cert(f, &frev, stub);
+			if (fr != cr || (fr > 0 && !same_entry(frev, crev)))
+				{
+				fprintf(stderr, "%s: lookup of serial %ld "
+					"issuer %d gives %d and %d\n", test,
+						probes[i], j, fr, cr);
+				ok = 0;
+				}
+			X509_free(stub);
+			}
+		}
+	return ok;
+	}
+
+/* Decode der both ways and compare, then again after an ordinary decode
+ * into the compact CRL. indexed says whether the compact decoding is
+ * expected to have indexed the entries.
+ */
+static int check_crl(const char *test, const unsigned char *der, int len,
+								int indexed)
+	{
+	const unsigned char *p;
+	X509_CRL *f, *c;
+	int ok;
+
+	p = der;
+	f = d2i_X509_CRL(NULL, &p, len);
+	p = der;
+	c = d2i_X509_CRL_compact(NULL, &p, len);
+	if (f == NULL || c == NULL || p != der + len)
+		{
+		fprintf(stderr, "%s: decoding failed\n", test);
+		X509_CRL_free(f);
+		X509_CRL_free(c);
+		return 0;
+		}
+	ok = compare_crls(test, f, c);
+	if ((X509_CRL_get_meth_data(c) != NULL) != indexed)
+		{
+		fprintf(stderr, "%s: CRL %s indexed\n", test,
+						indexed ? "not" : "unexpectedly");
+		ok = 0;
+		}
+	/* An ordinary decode into a compact CRL drops its index */
+	p = der;
+	if (d2i_X509_CRL(&c, &p, len) != c || X509_CRL_get_meth_data(c) != NULL)
+		{
+		fprintf(stderr, "%s: reuse failed\n", test);
+		ok = 0;
+		}
+	else if (!compare_crls(test, f, c))
+		ok = 0;
+	X509_CRL_free(f);
+	X509_CRL_free(c);
+	return ok;
+	}
+
+static int test_crl(const char *test, const CRL_ENTRY *entries, int n,
+								int indexed)
+	{
+	unsigned char *der;
+	int len, ok;
+
+	len = make_crl(entries, n, &der);
+	if (len <= 0)
+		{
+		fprintf(stderr, "%s: cannot make CRL\n", test);
+		return 0;
+		}
+	ok = check_crl(test, der, len, indexed);
+	OPENSSL_free(der);
+	return ok;
+	}
+
+static const CRL_ENTRY sorted[] =
+	{
+	{ 2, -1, 0 }, { 4, CRL_REASON_KEY_COMPROMISE, 0 }, { 7, -1, 0 },
+	{ 10, CRL_REASON_SUPERSEDED, 0 }, { 40, -1, 0 }, { 127, -1, 0 },
+	{ 128, -1, 0 }, { 255, -1, 0 }, { 256, -1, 0 },
+	{ 65536, CRL_REASON_CESSATION_OF_OPERATION, 0 },
+	{ 0x7fffffffL, -1, 0 }
+	};
+
+static const CRL_ENTRY unsorted[] =
+	{
+	{ 65536, -1, 0 }, { 128, CRL_REASON_KEY_COMPROMISE, 0 }, { 4, -1, 0 },
+	{ 0x7fffffffL, -1, 0 }, { 0, -1, 0 }, { 256, -1, 0 }, { 10, -1, 0 },
+	{ 127, CRL_REASON_AFFILIATION_CHANGED, 0 }, { 2, -1, 0 }
+	};
+
+static const CRL_ENTRY duplicates[] =
+	{
+	{ 7, CRL_REASON_KEY_COMPROMISE, 0 }, { 3, -1, 0 },
+	{ 7, CRL_REASON_KEY_COMPROMISE, 0 }, { 1, -1, 0 },
+	{ 7, CRL_REASON_KEY_COMPROMISE, 0 }
+	};
+
+static const CRL_ENTRY extensions[] =
+	{
+	{ 2, CRL_REASON_REMOVE_FROM_CRL, 0 }, { 3, CRL_REASON_CERTIFICATE_HOLD, 0 },
+	{ 9, CRL_REASON_CA_COMPROMISE, ENTRY_CRITICAL }
+	};
+
+static const CRL_ENTRY indirect[] =
+	{
+	{ 2, -1, 0 }, { 3, CRL_REASON_KEY_COMPROMISE, ENTRY_ISSUER },
+	{ 4, -1, 0 }
+	};
+
+static const CRL_ENTRY negative[] =
+	{
+	{ 2, -1, 0 }, { -5, -1, 0 }
+	};
+
+#define NENTRIES(a)	(int)(sizeof(a) / sizeof(a[0]))
+
+static int test_entries(void)
+	{
+	return test_crl("sorted", sorted, NENTRIES(sorted), 1)
+		&& test_crl("unsorted", unsorted, NENTRIES(unsorted), 1)
+		&& test_crl("duplicates", duplicates, NENTRIES(duplicates), 1)
+		&& test_crl("extensions", extensions, NENTRIES(extensions), 1)
+		&& test_crl("indirect", indirect, NENTRIES(indirect), 0)
+		&& test_crl("negative", negative, NENTRIES(negative), 0)
+		&& test_crl("empty", NULL, 0, 0);
+	}
+
+/* Truncated and corrupted CRLs must be rejected when d2i_X509_CRL()
+ * rejects them, and behave the same otherwise.
+ */
+static int test_malformed(void)
+	{
+	const unsigned char *p;
+	unsigned char *der, *bad;
+	X509_CRL *f, *c;
+	char test[40];
+	int len, i, j, ok = 1;
+	static const unsigned char xors[] = { 0x01, 0x80, 0xff };
+
+	len = make_crl(unsorted, NENTRIES(unsorted), &der);
+	bad = OPENSSL_malloc(len);
+	if (len <= 0 || bad == NULL)
+		{
+		fprintf(stderr, "malformed: cannot make CRL\n");
+		return 0;
+		}
+	for (i = 0; ok && i < len; i++)
+		{
+		p = der;
+		c = d2i_X509_CRL_compact(NULL, &p, i);
+		if (c != NULL)
+			{
+			fprintf(stderr, "malformed: CRL truncated to %d "
+							"decoded\n", i);
+			X509_CRL_free(c);
+			ok = 0;
+			}
+		}
+	ERR_clear_error();
+	for (i = 0; ok && i < len; i++)
+		{
+		for (j = 0; ok && j < (int)sizeof(xors); j++)
+			{
+			memcpy(bad, der, len);
+			bad[i] ^= xors[j];
+			p = bad;
+			f = d2i_X509_CRL(NULL, &p, len);
+			p = bad;
+			c = d2i_X509_CRL_compact(NULL, &p, len);
+			BIO_snprintf(test, sizeof(test),
+					"malformed %d^0x%02x", i, xors[j]);
+			if ((f == NULL) != (c == NULL))
+				{
+				fprintf(stderr, "%s: decoded by %s only\n",
+					test, f ? "d2i_X509_CRL" :
+						"d2i_X509_CRL_compact");
+				ok = 0;
+				}
+			else if (f != NULL)
+				ok = compare_crls(test, f, c);
+			X509_CRL_free(f);
+			X509_CRL_free(c);
+			}
+		}
+	ERR_clear_error();
+	OPENSSL_free(bad);
+	OPENSSL_free(der);
+	return ok;
+	}
+
+/* Verify a certificate against a CRL, returning the verify error */
+static int verify_with_crl(X509 *x, X509_CRL *crl)
+	{
+	X509_STORE *store = X509_STORE_new();
+	X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+	int ret = -1;
+
+	if (store != NULL && ctx != NULL
+		&& X509_STORE_add_cert(store, ca_cert)
+		&& X509_STORE_add_crl(store, crl)
+		&& X509_STORE_CTX_init(ctx, store, x, NULL))
+		{
+		X509_STORE_CTX_set_flags(ctx, X509_V_FLAG_CRL_CHECK);
+		if (X509_verify_cert(ctx) > 0)
+			ret = X509_V_OK;
+		else
+			ret = X509_STORE_CTX_get_error(ctx);
+		}
+	X509_STORE_CTX_free(ctx);
+	X509_STORE_free(store);
+	return ret;
+	}
+
+static int test_verify(void)
+	{
+	const unsigned char *p;
+	unsigned char *der;
+	EVP_PKEY *pkey = make_key();
+	X509 *revoked, *good;
+	X509_CRL *crl;
+	int len, r1, r2, ok = 1;
+
+	revoked = pkey ? make_cert(4, pkey) : NULL;
+	good = pkey ? make_cert(5, pkey) : NULL;
+	len = make_crl(sorted, NENTRIES(sorted), &der);
+	p = der;
+	crl = len > 0 ? d2i_X509_CRL_compact(NULL, &p, len) : NULL;
+	if (revoked == NULL || good == NULL || crl == NULL
+		|| X509_CRL_get_meth_data(crl) == NULL)
+		{
+		fprintf(stderr, "verify: cannot make certificates or CRL\n");
+		ok = 0;
+		}
+	else
+		{
+		r1 = verify_with_crl(revoked, crl);
+		r2 = verify_with_crl(good, crl);
+		if (r1 != X509_V_ERR_CERT_REVOKED || r2 != X509_V_OK)
+			{
+			fprintf(stderr, "verify: got %d and %d\n", r1, r2);
+			ok = 0;
+			}
+		}
+	if (der)
+		OPENSSL_free(der);
+	X509_CRL_free(crl);
+	X509_free(revoked);
+	X509_free(good);
+	EVP_PKEY_free(pkey);
+	return ok;
+	}
+
+int main(int argc, char *argv[])
+	{
+	BIO *leaks;
+	int ret = 1;
+
+	CRYPTO_malloc_debug_init();
+	CRYPTO_dbg_set_options(V_CRYPTO_MDEBUG_ALL);
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+	ERR_load_crypto_strings();
+	OpenSSL_add_all_digests();
+
+	ca_key = make_key();
+	ca_cert = ca_key ? make_cert(1, NULL) : NULL;
+	other_name = X509_NAME_new();
+	if (ca_cert == NULL || other_name == NULL
+		|| !X509_NAME_add_entry_by_txt(other_name, "CN", MBSTRING_ASC,
+				(unsigned char *)"Other CA", -1, -1, 0))
+		{
+		fprintf(stderr, "cannot make test CA\n");
+		ERR_print_errors_fp(stderr);
+		return 1;
+		}
+
+	if (test_entries() && test_malformed() && test_verify())
+		ret = 0;
+	else
+		ERR_print_errors_fp(stderr);
+
+	X509_NAME_free(other_name);
+	X509_free(ca_cert);
+	EVP_PKEY_free(ca_key);
+	EVP_cleanup();
+	CRYPTO_cleanup_all_ex_data();
+	ERR_free_strings();
+	ERR_remove_thread_state(NULL);
+
+	CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_OFF);
+	leaks = BIO_new(BIO_s_mem());
+	CRYPTO_mem_leaks(leaks);
+	if (BIO_ctrl_pending(leaks))
+		{
+		fprintf(stderr, "memory leaks:\n");
+		CRYPTO_mem_leaks_fp(stderr);
+		ret = 1;
+		}
+	BIO_free(leaks);
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
+#endif
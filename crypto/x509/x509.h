@@ -306,6 +306,7 @@ struct x509_st
 	unsigned char sha1_hash[SHA_DIGEST_LENGTH];
 #endif
 	X509_CERT_AUX *aux;
+	ASN1_ARENA *arena;	/* arena of d2i_X509_arena(), if any */
 	} /* X509 */;
 
 DECLARE_STACK_OF(X509)
@@ -482,6 +483,7 @@ struct X509_crl_st
 	STACK_OF(GENERAL_NAMES) *issuers;
 	const X509_CRL_METHOD *meth;
 	void *meth_data;
+	ASN1_ARENA *arena;	/* arena of d2i_X509_CRL_buffer(), if any */
 	} /* X509_CRL */;
 
 DECLARE_STACK_OF(X509_CRL)
@@ -646,6 +648,7 @@ const char *X509_verify_cert_error_string(long n);
 
 #ifndef OPENSSL_NO_EVP
 int X509_verify(X509 *a, EVP_PKEY *r);
+int X509_verify_batch(X509 **certs, EVP_PKEY **pkeys, int *results, int num);
 
 int X509_REQ_verify(X509_REQ *a, EVP_PKEY *r);
 int X509_CRL_verify(X509_CRL *a, EVP_PKEY *r);
@@ -851,6 +854,9 @@ int X509_set_ex_data(X509 *r, int idx, void *arg);
 void *X509_get_ex_data(X509 *r, int idx);
 int		i2d_X509_AUX(X509 *a,unsigned char **pp);
 X509 *		d2i_X509_AUX(X509 **a,const unsigned char **pp,long length);
+X509 *		d2i_X509_arena(X509 **a,const unsigned char **in,long len);
+X509 *		d2i_X509_buffer(X509 **a,const unsigned char **in,long len,
+							ASN1_BUFFER *buf);
 
 int i2d_re_X509_tbs(X509 *x, unsigned char **pp);
 
@@ -872,6 +878,10 @@ void X509_reject_clear(X509 *x);
 DECLARE_ASN1_FUNCTIONS(X509_REVOKED)
 DECLARE_ASN1_FUNCTIONS(X509_CRL_INFO)
 DECLARE_ASN1_FUNCTIONS(X509_CRL)
+X509_CRL *d2i_X509_CRL_buffer(X509_CRL **a, const unsigned char **in,
+					long len, ASN1_BUFFER *buf);
+X509_CRL *d2i_X509_CRL_compact(X509_CRL **a, const unsigned char **in,
+								long len);
 
 int X509_CRL_add0_revoked(X509_CRL *crl, X509_REVOKED *rev);
 int X509_CRL_get0_by_serial(X509_CRL *crl,
@@ -1241,6 +1251,8 @@ void ERR_load_X509_strings(void);
 #define X509_F_CHECK_POLICY				 145
 #define X509_F_DIR_CTRL					 102
 #define X509_F_GET_CERT_BY_SUBJECT			 103
+#define X509_F_INDEX_GET_CERT_BY_SUBJECT		 107
+#define X509_F_LOAD_INDEX				 148
 #define X509_F_NETSCAPE_SPKI_B64_DECODE			 129
 #define X509_F_NETSCAPE_SPKI_B64_ENCODE			 130
 #define X509_F_X509AT_ADD1_ATTR				 135
@@ -1259,6 +1271,7 @@ void ERR_load_X509_strings(void);
 #define X509_F_X509_LOAD_CERT_CRL_FILE			 132
 #define X509_F_X509_LOAD_CERT_FILE			 111
 #define X509_F_X509_LOAD_CRL_FILE			 112
+#define X509_F_X509_LOOKUP_WRITE_INDEX			 149
 #define X509_F_X509_NAME_ADD_ENTRY			 113
 #define X509_F_X509_NAME_ENTRY_CREATE_BY_NID		 114
 #define X509_F_X509_NAME_ENTRY_CREATE_BY_TXT		 131
@@ -1278,6 +1291,7 @@ void ERR_load_X509_strings(void);
 #define X509_F_X509_STORE_CTX_INIT			 143
 #define X509_F_X509_STORE_CTX_NEW			 142
 #define X509_F_X509_STORE_CTX_PURPOSE_INHERIT		 134
+#define X509_F_X509_STORE_SET_VERIFY_CACHE_SIZE		 106
 #define X509_F_X509_TO_X509_REQ				 126
 #define X509_F_X509_TRUST_ADD				 133
 #define X509_F_X509_TRUST_SET				 141
@@ -1293,8 +1307,10 @@ void ERR_load_X509_strings(void);
 #define X509_R_CRL_VERIFY_FAILURE			 131
 #define X509_R_ERR_ASN1_LIB				 102
 #define X509_R_IDP_MISMATCH				 128
+#define X509_R_INDEX_TOO_LARGE				 133
 #define X509_R_INVALID_DIRECTORY			 113
 #define X509_R_INVALID_FIELD_NAME			 119
+#define X509_R_INVALID_INDEX_FILE			 134
 #define X509_R_INVALID_TRUST				 123
 #define X509_R_ISSUER_MISMATCH				 129
 #define X509_R_KEY_TYPE_MISMATCH			 115
@@ -0,0 +1,334 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Batch verification of certificate signatures.
+ *
+ * X509_verify_batch() passes the ECDSA signatures among the certificates
+ * it is given to a single ECDSA_do_verify_batch() call, which shares the
+ * modular inversions between them, and checks the others one at a time
+ * with X509_verify().
+ *
+ * internal_verify() uses x509_verify_chain_batch() to check all the
+ * signatures of a chain before it walks it, when asked to with
+ * X509_V_FLAG_BATCH_SIGNATURES or when the application has set a thread
+ * pool with X509_STORE_CTX_set_verify_pool(); with a pool the signatures
+ * are checked in parallel on it. The walk itself is unchanged, so the
+ * verify callback sees the same errors in the same order as without
+ * batching.
+ */
+
+#include <stdio.h>
+#include "cryptlib.h"
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+#ifndef OPENSSL_NO_ECDSA
+#include <openssl/ecdsa.h>
+#endif
+#ifndef OPENSSL_NO_ENGINE
+#include <openssl/engine.h>
+#endif
+#include "x509_lcl.h"
+
+#ifndef OPENSSL_NO_ECDSA
+/* If the signature of x would be checked by ASN1_item_verify() with the
+ * built-in EC EVP_PKEY_METHOD, return the digest of x in md and the
+ * decoded signature.
+ */
+static ECDSA_SIG *x509_ecdsa_prepare(X509 *x, EVP_PKEY *pkey,
+					unsigned char *md, int *mdlen)
+	{
+	const EVP_MD *type;
+	const unsigned char *p;
+	unsigned int len;
+	int mdnid, pknid;
+#ifndef OPENSSL_NO_ENGINE
+	ENGINE *e;
+#endif
+
+	if (pkey->type != EVP_PKEY_EC)
+		return NULL;
+#ifndef OPENSSL_NO_ENGINE
+	if (pkey->engine != NULL)
+		return NULL;
+	if ((e = ENGINE_get_pkey_meth_engine(EVP_PKEY_EC)) != NULL)
+		{
+		ENGINE_finish(e);
+		return NULL;
+		}
+#endif
+	if (!OBJ_find_sigid_algs(OBJ_obj2nid(x->sig_alg->algorithm),
+							&mdnid, &pknid))
+		return NULL;
+	if (EVP_PKEY_type(pknid) != EVP_PKEY_EC)
+		return NULL;
+	/* The digests accepted by the EC EVP_PKEY_METHOD */
+	switch (mdnid)
+		{
+	case NID_sha1:
+	case NID_sha224:
+	case NID_sha256:
+	case NID_sha384:
+	case NID_sha512:
+		break;
+	default:
+		return NULL;
+		}
+	if ((type = EVP_get_digestbynid(mdnid)) == NULL)
+		return NULL;
+	if (!ASN1_item_digest(ASN1_ITEM_rptr(X509_CINF), type, x->cert_info,
+								md, &len))
+		return NULL;
+	*mdlen = len;
+	p = x->signature->data;
+	return d2i_ECDSA_SIG(NULL, &p, x->signature->length);
+	}
+#endif
+
+int X509_verify_batch(X509 **certs, EVP_PKEY **pkeys, int *results, int num)
+	{
+	int i, ret = 1;
+#ifndef OPENSSL_NO_ECDSA
+	const unsigned char **dgsts = NULL;
+	unsigned char *mds = NULL;
+	int *dgst_lens = NULL, *idx = NULL, *ecresults = NULL;
+	ECDSA_SIG **sigs = NULL;
+	EC_KEY **eckeys = NULL;
+	int k, n = 0;
+
+	/* -2 marks the signatures left to X509_verify() */
+	for (i = 0; i < num; i++)
+		results[i] = -2;
+
+	dgsts = OPENSSL_malloc(num * sizeof(unsigned char *));
+	mds = OPENSSL_malloc(num * EVP_MAX_MD_SIZE);
+	dgst_lens = OPENSSL_malloc(num * sizeof(int));
+	idx = OPENSSL_malloc(num * sizeof(int));
+	ecresults = OPENSSL_malloc(num * sizeof(int));
+	sigs = OPENSSL_malloc(num * sizeof(ECDSA_SIG *));
+	eckeys = OPENSSL_malloc(num * sizeof(EC_KEY *));
+	if (dgsts && mds && dgst_lens && idx && ecresults && sigs && eckeys)
+		{
+		for (i = 0; i < num; i++)
+			{
+			dgsts[n] = mds + n * EVP_MAX_MD_SIZE;
+			sigs[n] = x509_ecdsa_prepare(certs[i], pkeys[i],
+					mds + n * EVP_MAX_MD_SIZE,
+					&dgst_lens[n]);
+			if (sigs[n] == NULL)
+				continue;
+			eckeys[n] = pkeys[i]->pkey.ec;
+			idx[n] = i;
+			n++;
+			}
+		if (n > 1)
+			{
+			ECDSA_do_verify_batch(dgsts, dgst_lens, sigs, eckeys,
+							ecresults, n);
+			/* X509_verify() returns 0 whenever the signature
+			 * check fails, with the error ASN1_item_verify()
+			 * raises */
+			for (k = 0; k < n; k++)
+				{
+				results[idx[k]] = ecresults[k] == 1;
+				if (!results[idx[k]])
+					ASN1err(ASN1_F_ASN1_ITEM_VERIFY,
+							ERR_R_EVP_LIB);
+				}
+			}
+		for (k = 0; k < n; k++)
+			ECDSA_SIG_free(sigs[k]);
+		}
+	if (dgsts)
+		OPENSSL_free(dgsts);
+	if (mds)
+		OPENSSL_free(mds);
+	if (dgst_lens)
+		OPENSSL_free(dgst_lens);
+	if (idx)
+		OPENSSL_free(idx);
+	if (ecresults)
+		OPENSSL_free(ecresults);
+	if (sigs)
+		OPENSSL_free(sigs);
+	if (eckeys)
+		OPENSSL_free(eckeys);
+#endif
+
+	for (i = 0; i < num; i++)
+		{
+#ifndef OPENSSL_NO_ECDSA
+		if (results[i] == -2)
+#endif
+			results[i] = X509_verify(certs[i], pkeys[i]);
+		if (results[i] <= 0)
+			ret = 0;
+		}
+	return ret;
+	}
+
+typedef struct x509_sig_task_st
+	{
+	X509 *cert;
+	EVP_PKEY *pkey;		/* of the issuer */
+	int depth;		/* of cert in the chain */
+	int result;
+	} X509_SIG_TASK;
+
+static void x509_sig_task_run(void *arg)
+	{
+	X509_SIG_TASK *task = arg;
+	/* Do not leave errors in the queue of a pool thread */
+	ERR_set_mark();
+	task->result = X509_verify(task->cert, task->pkey);
+	ERR_pop_to_mark();
+	}
+
+static int x509_sig_tasks_batch(X509_SIG_TASK *tasks, int n)
+	{
+	X509 **certs;
+	EVP_PKEY **pkeys;
+	int *results;
+	int i, ret = 0;
+
+	certs = OPENSSL_malloc(n * sizeof(X509 *));
+	pkeys = OPENSSL_malloc(n * sizeof(EVP_PKEY *));
+	results = OPENSSL_malloc(n * sizeof(int));
+	if (certs && pkeys && results)
+		{
+		for (i = 0; i < n; i++)
+			{
+			certs[i] = tasks[i].cert;
+			pkeys[i] = tasks[i].pkey;
+			}
+		X509_verify_batch(certs, pkeys, results, n);
+		for (i = 0; i < n; i++)
+			tasks[i].result = results[i];
+		ret = 1;
+		}
+	if (certs)
+		OPENSSL_free(certs);
+	if (pkeys)
+		OPENSSL_free(pkeys);
+	if (results)
+		OPENSSL_free(results);
+	return ret;
+	}
+
+static int x509_sig_tasks_pool(X509_STORE_CTX *ctx, X509_SIG_TASK *tasks,
+									int n)
+	{
+	void **args;
+	int i;
+
+	if ((args = OPENSSL_malloc(n * sizeof(void *))) == NULL)
+		return 0;
+	for (i = 0; i < n; i++)
+		args[i] = &tasks[i];
+	ctx->verify_pool_run(ctx->verify_pool, x509_sig_task_run, args, n);
+	OPENSSL_free(args);
+	return 1;
+	}
+
+/* Check the signatures of all the certificates of the chain of ctx but
+ * the last one. Return an array giving, for the certificate at each
+ * depth, 1 if its signature is valid, 0 if it is not and -1 if it was
+ * not checked, or NULL if there were fewer than two signatures to check.
+ * A certificate is not checked if it is already known to be valid or if
+ * the key of its issuer cannot be decoded: internal_verify() then does
+ * what it would do without batching.
+ */
+int *x509_verify_chain_batch(X509_STORE_CTX *ctx)
+	{
+	int i, n = 0, num = sk_X509_num(ctx->chain), ok;
+	int *ret = NULL;
+	X509_SIG_TASK *tasks;
+	X509 *x;
+
+	if (num < 3)
+		return NULL;
+	if ((tasks = OPENSSL_malloc((num - 1) * sizeof(X509_SIG_TASK))) == NULL)
+		return NULL;
+	for (i = 0; i < num - 1; i++)
+		{
+		x = sk_X509_value(ctx->chain, i);
+		if (x->valid)
+			continue;
+		tasks[n].pkey = X509_get_pubkey(sk_X509_value(ctx->chain, i+1));
+		if (tasks[n].pkey == NULL)
+			continue;
+		tasks[n].cert = x;
+		tasks[n].depth = i;
+		n++;
+		}
+	if (n < 2)
+		goto err;
+
+	if (ctx->verify_pool_run != NULL)
+		ok = x509_sig_tasks_pool(ctx, tasks, n);
+	else
+		ok = x509_sig_tasks_batch(tasks, n);
+	if (!ok || (ret = OPENSSL_malloc(num * sizeof(int))) == NULL)
+		goto err;
+	for (i = 0; i < num; i++)
+		ret[i] = -1;
+	for (i = 0; i < n; i++)
+		ret[tasks[i].depth] = tasks[i].result > 0;
+err:
+	for (i = 0; i < n; i++)
+		EVP_PKEY_free(tasks[i].pkey);
+	OPENSSL_free(tasks);
+	return ret;
+	}
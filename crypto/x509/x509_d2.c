@@ -104,4 +104,15 @@ int X509_STORE_load_locations(X509_STORE *ctx, const char *file,
 	return(1);
 	}
 
+int X509_STORE_load_index(X509_STORE *ctx, const char *file)
+	{
+	X509_LOOKUP *lookup;
+
+	lookup=X509_STORE_add_lookup(ctx,X509_LOOKUP_index_file());
+	if (lookup == NULL) return(0);
+	if (X509_LOOKUP_load_index(lookup,file) != 1)
+		return(0);
+	return(1);
+	}
+
 #endif
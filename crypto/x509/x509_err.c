@@ -75,6 +75,8 @@ static ERR_STRING_DATA X509_str_functs[]=
 {ERR_FUNC(X509_F_CHECK_POLICY),	"CHECK_POLICY"},
 {ERR_FUNC(X509_F_DIR_CTRL),	"DIR_CTRL"},
 {ERR_FUNC(X509_F_GET_CERT_BY_SUBJECT),	"GET_CERT_BY_SUBJECT"},
+{ERR_FUNC(X509_F_INDEX_GET_CERT_BY_SUBJECT),	"INDEX_GET_CERT_BY_SUBJECT"},
+{ERR_FUNC(X509_F_LOAD_INDEX),	"LOAD_INDEX"},
 {ERR_FUNC(X509_F_NETSCAPE_SPKI_B64_DECODE),	"NETSCAPE_SPKI_b64_decode"},
 {ERR_FUNC(X509_F_NETSCAPE_SPKI_B64_ENCODE),	"NETSCAPE_SPKI_b64_encode"},
 {ERR_FUNC(X509_F_X509AT_ADD1_ATTR),	"X509at_add1_attr"},
@@ -93,6 +95,7 @@ static ERR_STRING_DATA X509_str_functs[]=
 {ERR_FUNC(X509_F_X509_LOAD_CERT_CRL_FILE),	"X509_load_cert_crl_file"},
 {ERR_FUNC(X509_F_X509_LOAD_CERT_FILE),	"X509_load_cert_file"},
 {ERR_FUNC(X509_F_X509_LOAD_CRL_FILE),	"X509_load_crl_file"},
+{ERR_FUNC(X509_F_X509_LOOKUP_WRITE_INDEX),	"X509_LOOKUP_write_index"},
 {ERR_FUNC(X509_F_X509_NAME_ADD_ENTRY),	"X509_NAME_add_entry"},
 {ERR_FUNC(X509_F_X509_NAME_ENTRY_CREATE_BY_NID),	"X509_NAME_ENTRY_create_by_NID"},
 {ERR_FUNC(X509_F_X509_NAME_ENTRY_CREATE_BY_TXT),	"X509_NAME_ENTRY_create_by_txt"},
@@ -112,6 +115,7 @@ static ERR_STRING_DATA X509_str_functs[]=
 {ERR_FUNC(X509_F_X509_STORE_CTX_INIT),	"X509_STORE_CTX_init"},
 {ERR_FUNC(X509_F_X509_STORE_CTX_NEW),	"X509_STORE_CTX_new"},
 {ERR_FUNC(X509_F_X509_STORE_CTX_PURPOSE_INHERIT),	"X509_STORE_CTX_purpose_inherit"},
+{ERR_FUNC(X509_F_X509_STORE_SET_VERIFY_CACHE_SIZE),	"X509_STORE_set_verify_cache_size"},
 {ERR_FUNC(X509_F_X509_TO_X509_REQ),	"X509_to_X509_REQ"},
 {ERR_FUNC(X509_F_X509_TRUST_ADD),	"X509_TRUST_add"},
 {ERR_FUNC(X509_F_X509_TRUST_SET),	"X509_TRUST_set"},
@@ -130,8 +134,10 @@ static ERR_STRING_DATA X509_str_reasons[]=
 {ERR_REASON(X509_R_CRL_VERIFY_FAILURE)   ,"crl verify failure"},
 {ERR_REASON(X509_R_ERR_ASN1_LIB)         ,"err asn1 lib"},
 {ERR_REASON(X509_R_IDP_MISMATCH)         ,"idp mismatch"},
+{ERR_REASON(X509_R_INDEX_TOO_LARGE)      ,"index too large"},
 {ERR_REASON(X509_R_INVALID_DIRECTORY)    ,"invalid directory"},
 {ERR_REASON(X509_R_INVALID_FIELD_NAME)   ,"invalid field name"},
+{ERR_REASON(X509_R_INVALID_INDEX_FILE)   ,"invalid index file"},
 {ERR_REASON(X509_R_INVALID_TRUST)        ,"invalid trust"},
 {ERR_REASON(X509_R_ISSUER_MISMATCH)      ,"issuer mismatch"},
 {ERR_REASON(X509_R_KEY_TYPE_MISMATCH)    ,"key type mismatch"},
@@ -70,3 +70,14 @@ struct X509_VERIFY_PARAM_ID_st
 	};
 
 int x509_check_cert_time(X509_STORE_CTX *ctx, X509 *x, int quiet);
+
+/* Batch signature checks, see x509_batch.c */
+int *x509_verify_chain_batch(X509_STORE_CTX *ctx);
+
+/* Verified chain cache, see x509_vcache.c */
+#define X509_VCACHE_KEYLEN	SHA256_DIGEST_LENGTH
+
+int x509_verify_cache_key(X509_STORE_CTX *ctx, unsigned char *key);
+int x509_verify_cache_lookup(X509_STORE *store, const unsigned char *key);
+void x509_verify_cache_add(X509_STORE *store, const unsigned char *key);
+void x509_verify_cache_free(struct x509_verify_cache_st *cache);
@@ -200,6 +200,7 @@ X509_STORE *X509_STORE_new(void)
 	ret->lookup_certs = 0;
 	ret->lookup_crls = 0;
 	ret->cleanup = 0;
+	ret->verify_cache = NULL;
 
 	if (!CRYPTO_new_ex_data(CRYPTO_EX_INDEX_X509_STORE, ret, &ret->ex_data))
 		{
@@ -265,6 +266,8 @@ void X509_STORE_free(X509_STORE *vfy)
 	CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE, vfy, &vfy->ex_data);
 	if (vfy->param)
 		X509_VERIFY_PARAM_free(vfy->param);
+	if (vfy->verify_cache)
+		x509_verify_cache_free(vfy->verify_cache);
 	OPENSSL_free(vfy);
 	}
 
@@ -308,9 +311,9 @@ int X509_STORE_get_by_subject(X509_STORE_CTX *vs, int type, X509_NAME *name,
 	X509_OBJECT stmp,*tmp;
 	int i,j;
 
-	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 	tmp=X509_OBJECT_retrieve_by_subject(ctx->objs,type,name);
-	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 
 	if (tmp == NULL || type == X509_LU_CRL)
 		{
@@ -345,6 +348,17 @@ int X509_STORE_get_by_subject(X509_STORE_CTX *vs, int type, X509_NAME *name,
 	return 1;
 	}
 
+/* Lookups only take CRYPTO_LOCK_X509_STORE for reading, so that they can
+ * run concurrently with a locking callback that supports shared locks.
+ * Searching an unsorted stack sorts it, which must not happen under a read
+ * lock, so the object stack is kept sorted as objects are added. Objects
+ * are only removed when the store is freed. */
+static void x509_store_insert(X509_STORE *ctx, X509_OBJECT *obj)
+	{
+	sk_X509_OBJECT_push(ctx->objs, obj);
+	sk_X509_OBJECT_sort(ctx->objs);
+	}
+
 int X509_STORE_add_cert(X509_STORE *ctx, X509 *x)
 	{
 	X509_OBJECT *obj;
@@ -371,7 +385,7 @@ int X509_STORE_add_cert(X509_STORE *ctx, X509 *x)
 		X509err(X509_F_X509_STORE_ADD_CERT,X509_R_CERT_ALREADY_IN_HASH_TABLE);
 		ret=0;
 		} 
-	else sk_X509_OBJECT_push(ctx->objs, obj);
+	else x509_store_insert(ctx, obj);
 
 	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
 
@@ -404,7 +418,7 @@ int X509_STORE_add_crl(X509_STORE *ctx, X509_CRL *x)
 		X509err(X509_F_X509_STORE_ADD_CRL,X509_R_CERT_ALREADY_IN_HASH_TABLE);
 		ret=0;
 		}
-	else sk_X509_OBJECT_push(ctx->objs, obj);
+	else x509_store_insert(ctx, obj);
 
 	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
 
@@ -506,7 +520,7 @@ STACK_OF(X509)* X509_STORE_get1_certs(X509_STORE_CTX *ctx, X509_NAME *nm)
 	X509 *x;
 	X509_OBJECT *obj;
 	sk = sk_X509_new_null();
-	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 	idx = x509_object_idx_cnt(ctx->ctx->objs, X509_LU_X509, nm, &cnt);
 	if (idx < 0)
 		{
@@ -514,18 +528,18 @@ STACK_OF(X509)* X509_STORE_get1_certs(X509_STORE_CTX *ctx, X509_NAME *nm)
 		 * objects to cache
 		 */
 		X509_OBJECT xobj;
-		CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+		CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 		if (!X509_STORE_get_by_subject(ctx, X509_LU_X509, nm, &xobj))
 			{
 			sk_X509_free(sk);
 			return NULL;
 			}
 		X509_OBJECT_free_contents(&xobj);
-		CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+		CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 		idx = x509_object_idx_cnt(ctx->ctx->objs,X509_LU_X509,nm, &cnt);
 		if (idx < 0)
 			{
-			CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+			CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 			sk_X509_free(sk);
 			return NULL;
 			}
@@ -537,13 +551,13 @@ STACK_OF(X509)* X509_STORE_get1_certs(X509_STORE_CTX *ctx, X509_NAME *nm)
 		CRYPTO_add(&x->references, 1, CRYPTO_LOCK_X509);
 		if (!sk_X509_push(sk, x))
 			{
-			CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+			CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 			X509_free(x);
 			sk_X509_pop_free(sk, X509_free);
 			return NULL;
 			}
 		}
-	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 	return sk;
 
 	}
@@ -555,24 +569,24 @@ STACK_OF(X509_CRL)* X509_STORE_get1_crls(X509_STORE_CTX *ctx, X509_NAME *nm)
 	X509_CRL *x;
 	X509_OBJECT *obj, xobj;
 	sk = sk_X509_CRL_new_null();
-	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 	/* Check cache first */
 	idx = x509_object_idx_cnt(ctx->ctx->objs, X509_LU_CRL, nm, &cnt);
 
 	/* Always do lookup to possibly add new CRLs to cache
 	 */
-	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 	if (!X509_STORE_get_by_subject(ctx, X509_LU_CRL, nm, &xobj))
 		{
 		sk_X509_CRL_free(sk);
 		return NULL;
 		}
 	X509_OBJECT_free_contents(&xobj);
-	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 	idx = x509_object_idx_cnt(ctx->ctx->objs,X509_LU_CRL, nm, &cnt);
 	if (idx < 0)
 		{
-		CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+		CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 		sk_X509_CRL_free(sk);
 		return NULL;
 		}
@@ -584,13 +598,13 @@ STACK_OF(X509_CRL)* X509_STORE_get1_crls(X509_STORE_CTX *ctx, X509_NAME *nm)
 		CRYPTO_add(&x->references, 1, CRYPTO_LOCK_X509_CRL);
 		if (!sk_X509_CRL_push(sk, x))
 			{
-			CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+			CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 			X509_CRL_free(x);
 			sk_X509_CRL_pop_free(sk, X509_CRL_free);
 			return NULL;
 			}
 		}
-	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 	return sk;
 	}
 
@@ -672,7 +686,7 @@ int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
 
 	/* Else find index of first cert accepted by 'check_issued' */
 	ret = 0;
-	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
 	idx = X509_OBJECT_idx_by_subject(ctx->ctx->objs, X509_LU_X509, xn);
 	if (idx != -1) /* should be true as we've had at least one match */
 		{
@@ -701,7 +715,7 @@ int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
 				}
 			}
 		}
-	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
 	if (*issuer)
 		CRYPTO_add(&(*issuer)->references,1,CRYPTO_LOCK_X509);
 	return ret;
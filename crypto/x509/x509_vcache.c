@@ -0,0 +1,274 @@
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer. 
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/* Cache of certificate chains whose signatures have been verified.
+ *
+ * A chain is identified by a digest over the SHA-256 digests of its
+ * certificates and the verification flags that select which signatures
+ * are checked. Whether the signatures of a chain are valid only depends
+ * on the certificates in it, so a chain found in the cache needs no
+ * signature checks. Everything else (validity periods, revocation,
+ * extensions, name constraints and policy) is still checked on every
+ * verification, and the chain itself is still built from the store, so
+ * changes to the store take effect immediately.
+ *
+ * Lookups only take CRYPTO_LOCK_X509_STORE for reading. Entries are
+ * evicted oldest first once the cache is full.
+ */
+
+#include <stdio.h>
+#include "cryptlib.h"
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "x509_lcl.h"
+
+typedef struct x509_vcache_entry_st
+	{
+	unsigned char key[X509_VCACHE_KEYLEN];
+	struct x509_vcache_entry_st *hnext;	/* in hash bucket */
+	struct x509_vcache_entry_st *prev, *next; /* newest first */
+	} X509_VCACHE_ENTRY;
+
+struct x509_verify_cache_st
+	{
+	long size;		/* maximum number of entries */
+	long num;		/* current number of entries */
+	unsigned long mask;	/* number of buckets - 1 */
+	X509_VCACHE_ENTRY **buckets;
+	X509_VCACHE_ENTRY *head, *tail;
+	};
+
+/* Flags that change which signatures of a chain are checked */
+#define X509_VCACHE_FLAGS \
+	(X509_V_FLAG_CHECK_SS_SIGNATURE|X509_V_FLAG_PARTIAL_CHAIN)
+
+/* Largest number of hash buckets */
+#define X509_VCACHE_MAX_BUCKETS	(1UL<<20)
+
+static unsigned long vcache_hash(const unsigned char *key)
+	{
+	return ((unsigned long)key[0]) | ((unsigned long)key[1] << 8) |
+		((unsigned long)key[2] << 16) | ((unsigned long)key[3] << 24);
+	}
+
+static X509_VCACHE_ENTRY **vcache_find(struct x509_verify_cache_st *cache,
+	const unsigned char *key)
+	{
+	X509_VCACHE_ENTRY **p;
+
+	p = &cache->buckets[vcache_hash(key) & cache->mask];
+	while (*p != NULL && memcmp((*p)->key, key, X509_VCACHE_KEYLEN))
+		p = &(*p)->hnext;
+	return p;
+	}
+
+static struct x509_verify_cache_st *vcache_new(long size)
+	{
+	struct x509_verify_cache_st *cache;
+	unsigned long n = 1;
+
+	while (n < (unsigned long)size && n < X509_VCACHE_MAX_BUCKETS)
+		n <<= 1;
+	if ((cache = OPENSSL_malloc(sizeof(*cache))) == NULL)
+		return NULL;
+	if ((cache->buckets = OPENSSL_malloc(n * sizeof(*cache->buckets)))
+		== NULL)
+		{
+		OPENSSL_free(cache);
+		return NULL;
+		}
+	memset(cache->buckets, 0, n * sizeof(*cache->buckets));
+	cache->size = size;
+	cache->num = 0;
+	cache->mask = n - 1;
+	cache->head = cache->tail = NULL;
+	return cache;
+	}
+
+void x509_verify_cache_free(struct x509_verify_cache_st *cache)
+	{
+	X509_VCACHE_ENTRY *ent, *next;
+
+	for (ent = cache->head; ent != NULL; ent = next)
+		{
+		next = ent->next;
+		OPENSSL_free(ent);
+		}
+	OPENSSL_free(cache->buckets);
+	OPENSSL_free(cache);
+	}
+
+/* Enable the cache with room for 'size' chains, or disable it if 'size'
+ * is 0. Any chains cached so far are discarded. */
+int X509_STORE_set_verify_cache_size(X509_STORE *store, long size)
+	{
+	struct x509_verify_cache_st *cache = NULL, *old;
+
+	if (size < 0)
+		size = 0;
+	if (size > 0 && (cache = vcache_new(size)) == NULL)
+		{
+		X509err(X509_F_X509_STORE_SET_VERIFY_CACHE_SIZE,
+			ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	old = store->verify_cache;
+	store->verify_cache = cache;
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	if (old != NULL)
+		x509_verify_cache_free(old);
+	return 1;
+	}
+
+long X509_STORE_get_verify_cache_size(X509_STORE *store)
+	{
+	long size = 0;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+	if (store->verify_cache != NULL)
+		size = store->verify_cache->size;
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+	return size;
+	}
+
+/* Compute the cache key of the chain in 'ctx'. Returns 0 if the store has
+ * no cache or the key could not be computed. */
+int x509_verify_cache_key(X509_STORE_CTX *ctx, unsigned char *key)
+	{
+#ifndef OPENSSL_NO_SHA256
+	EVP_MD_CTX mctx;
+	unsigned char md[EVP_MAX_MD_SIZE], flags[4];
+	unsigned int len;
+	unsigned long f;
+	int i, ok;
+
+	/* Only a hint: the cache is looked up again with the lock held */
+	if (ctx->ctx == NULL || ctx->ctx->verify_cache == NULL)
+		return 0;
+
+	f = ctx->param->flags & X509_VCACHE_FLAGS;
+	flags[0] = (unsigned char)(f >> 24);
+	flags[1] = (unsigned char)(f >> 16);
+	flags[2] = (unsigned char)(f >> 8);
+	flags[3] = (unsigned char)f;
+
+	EVP_MD_CTX_init(&mctx);
+	ok = EVP_DigestInit_ex(&mctx, EVP_sha256(), NULL)
+		&& EVP_DigestUpdate(&mctx, flags, sizeof(flags));
+	for (i = 0; ok && i < sk_X509_num(ctx->chain); i++)
+		{
+		ok = X509_digest(sk_X509_value(ctx->chain, i), EVP_sha256(),
+				 md, &len)
+			&& EVP_DigestUpdate(&mctx, md, len);
+		}
+	ok = ok && EVP_DigestFinal_ex(&mctx, key, NULL);
+	EVP_MD_CTX_cleanup(&mctx);
+	return ok;
+#else
+	return 0;
+#endif
+	}
+
+int x509_verify_cache_lookup(X509_STORE *store, const unsigned char *key)
+	{
+	int found = 0;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+	if (store->verify_cache != NULL)
+		found = *vcache_find(store->verify_cache, key) != NULL;
+	CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+	return found;
+	}
+
+void x509_verify_cache_add(X509_STORE *store, const unsigned char *key)
+	{
+	struct x509_verify_cache_st *cache;
+	X509_VCACHE_ENTRY *ent, **p;
+
+	if ((ent = OPENSSL_malloc(sizeof(*ent))) == NULL)
+		return;
+	memcpy(ent->key, key, X509_VCACHE_KEYLEN);
+
+	CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+	cache = store->verify_cache;
+	if (cache == NULL || *(p = vcache_find(cache, key)) != NULL)
+		goto done;
+
+	ent->hnext = NULL;
+	*p = ent;
+	ent->prev = NULL;
+	ent->next = cache->head;
+	if (cache->head != NULL)
+		cache->head->prev = ent;
+	else
+		cache->tail = ent;
+	cache->head = ent;
+	ent = NULL;
+
+	/* Evict the oldest entry if the cache is full */
+	if (++cache->num > cache->size)
+		{
+		ent = cache->tail;
+		cache->tail = ent->prev;
+		cache->tail->next = NULL;
+		p = vcache_find(cache, ent->key);
+		*p = ent->hnext;
+		cache->num--;
+		}
+done:
+	CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+	if (ent != NULL)
+		OPENSSL_free(ent);
+	}
@@ -1650,7 +1650,16 @@ static int cert_crl(X509_STORE_CTX *ctx, X509_CRL *crl, X509 *x)
 	/* Look for serial number of certificate in CRL
 	 * If found make sure reason is not removeFromCRL.
 	 */
-	if (X509_CRL_get0_by_cert(crl, &rev, x))
+	ok = X509_CRL_get0_by_cert(crl, &rev, x);
+	if (ok < 0)
+		{
+		ctx->error = X509_V_ERR_OUT_OF_MEM;
+		ok = ctx->verify_cb(0, ctx);
+		if (!ok)
+			return 0;
+		return 1;
+		}
+	if (ok)
 		{
 		if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
 			return 2;
@@ -1768,15 +1777,38 @@ int x509_check_cert_time(X509_STORE_CTX *ctx, X509 *x, int quiet)
 	return 1;
 	}
 
+/* Result of the signature check of the certificate at depth n, from
+ * x509_verify_chain_batch() if it checked it */
+static int batch_verify_result(const int *batch, int n, X509 *xs,
+							EVP_PKEY *pkey)
+	{
+	if (batch != NULL && batch[n] >= 0)
+		return batch[n];
+	return X509_verify(xs,pkey);
+	}
+
 static int internal_verify(X509_STORE_CTX *ctx)
 	{
 	int ok=0,n;
 	X509 *xs,*xi;
 	EVP_PKEY *pkey=NULL;
 	int (*cb)(int xok,X509_STORE_CTX *xctx);
+	unsigned char key[X509_VCACHE_KEYLEN];
+	int use_cache, cached=0, sigs_ok=1;
+	int *batch=NULL;
 
 	cb=ctx->verify_cb;
 
+	/* The signatures of a chain found in the verify cache have already
+	 * been checked, see X509_STORE_set_verify_cache_size() */
+	use_cache = x509_verify_cache_key(ctx, key);
+	if (use_cache)
+		cached = x509_verify_cache_lookup(ctx->ctx, key);
+
+	if (!cached && (ctx->verify_pool_run != NULL
+		|| (ctx->param->flags & X509_V_FLAG_BATCH_SIGNATURES)))
+		batch = x509_verify_chain_batch(ctx);
+
 	n=sk_X509_num(ctx->chain);
 	ctx->error_depth=n-1;
 	n--;
@@ -1815,19 +1847,21 @@ static int internal_verify(X509_STORE_CTX *ctx)
 		 * explicitly asked for. It doesn't add any security and
 		 * just wastes time.
 		 */
-		if (!xs->valid && (xs != xi || (ctx->param->flags & X509_V_FLAG_CHECK_SS_SIGNATURE)))
+		if (!cached && !xs->valid && (xs != xi || (ctx->param->flags & X509_V_FLAG_CHECK_SS_SIGNATURE)))
 			{
 			if ((pkey=X509_get_pubkey(xi)) == NULL)
 				{
 				ctx->error=X509_V_ERR_UNABLE_TO_DECODE_ISSUER_PUBLIC_KEY;
 				ctx->current_cert=xi;
+				sigs_ok=0;
 				ok=(*cb)(0,ctx);
 				if (!ok) goto end;
 				}
-			else if (X509_verify(xs,pkey) <= 0)
+			else if (batch_verify_result(batch,n,xs,pkey) <= 0)
 				{
 				ctx->error=X509_V_ERR_CERT_SIGNATURE_FAILURE;
 				ctx->current_cert=xs;
+				sigs_ok=0;
 				ok=(*cb)(0,ctx);
 				if (!ok)
 					{
@@ -1859,8 +1893,14 @@ static int internal_verify(X509_STORE_CTX *ctx)
 			xs=sk_X509_value(ctx->chain,n);
 			}
 		}
+	/* Only chains whose signatures all verified are cached, not those
+	 * accepted by the callback despite a bad signature */
+	if (use_cache && !cached && sigs_ok)
+		x509_verify_cache_add(ctx->ctx, key);
 	ok=1;
 end:
+	if (batch != NULL)
+		OPENSSL_free(batch);
 	return ok;
 	}
 
@@ -2025,7 +2065,7 @@ X509_CRL *X509_CRL_diff(X509_CRL *base, X509_CRL *newer,
 			EVP_PKEY *skey, const EVP_MD *md, unsigned int flags)
 	{
 	X509_CRL *crl = NULL;
-	int i;
+	int i, j;
 	STACK_OF(X509_REVOKED) *revs = NULL;
 	/* CRLs can't be delta already */
 	if (base->base_crl_number || newer->base_crl_number)
@@ -2112,7 +2152,10 @@ X509_CRL *X509_CRL_diff(X509_CRL *base, X509_CRL *newer,
 		 * TODO: need something cleverer here for some more complex
 		 * CRLs covering multiple CAs.
 		 */
-		if (!X509_CRL_get0_by_serial(base, &rvtmp, rvn->serialNumber))
+		j = X509_CRL_get0_by_serial(base, &rvtmp, rvn->serialNumber);
+		if (j < 0)
+			goto memerr;
+		if (j == 0)
 			{
 			rvtmp = X509_REVOKED_dup(rvn);
 			if (!rvtmp)
@@ -2329,6 +2372,8 @@ int X509_STORE_CTX_init(X509_STORE_CTX *ctx, X509_STORE *store, X509 *x509,
 	ctx->current_reasons=0;
 	ctx->tree = NULL;
 	ctx->parent = NULL;
+	ctx->verify_pool_run = NULL;
+	ctx->verify_pool = NULL;
 
 	ctx->param = X509_VERIFY_PARAM_new();
 
@@ -2487,6 +2532,14 @@ void X509_STORE_CTX_set_verify_cb(X509_STORE_CTX *ctx,
 	ctx->verify_cb=verify_cb;
 	}
 
+void X509_STORE_CTX_set_verify_pool(X509_STORE_CTX *ctx,
+	void (*run)(void *pool, void (*fn)(void *), void **args, int num),
+	void *pool)
+	{
+	ctx->verify_pool_run=run;
+	ctx->verify_pool=pool;
+	}
+
 X509_POLICY_TREE *X509_STORE_CTX_get0_policy_tree(X509_STORE_CTX *ctx)
 	{
 	return ctx->tree;
@@ -207,11 +207,16 @@ struct x509_store_st
 	STACK_OF(X509_CRL) * (*lookup_crls)(X509_STORE_CTX *ctx, X509_NAME *nm);
 	int (*cleanup)(X509_STORE_CTX *ctx);
 
+	/* Chains whose signatures have been verified, if enabled */
+	struct x509_verify_cache_st *verify_cache;
+
 	CRYPTO_EX_DATA ex_data;
 	int references;
 	} /* X509_STORE */;
 
 int X509_STORE_set_depth(X509_STORE *store, int depth);
+int X509_STORE_set_verify_cache_size(X509_STORE *store, long size);
+long X509_STORE_get_verify_cache_size(X509_STORE *store);
 
 #define X509_STORE_set_verify_cb_func(ctx,func) ((ctx)->verify_cb=(func))
 #define X509_STORE_set_verify_func(ctx,func)	((ctx)->verify=(func))
@@ -277,6 +282,11 @@ struct x509_store_ctx_st      /* X509_STORE_CTX */
 
 	X509_STORE_CTX *parent; /* For CRL path validation: parent context */
 
+	/* Thread pool to check the chain signatures on */
+	void (*verify_pool_run)(void *pool, void (*fn)(void *), void **args,
+								int num);
+	void *verify_pool;
+
 	CRYPTO_EX_DATA ex_data;
 	} /* X509_STORE_CTX */;
 
@@ -289,6 +299,7 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 
 #define X509_L_FILE_LOAD	1
 #define X509_L_ADD_DIR		2
+#define X509_L_LOAD_INDEX	3
 
 #define X509_LOOKUP_load_file(x,name,type) \
 		X509_LOOKUP_ctrl((x),X509_L_FILE_LOAD,(name),(long)(type),NULL)
@@ -296,6 +307,9 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 #define X509_LOOKUP_add_dir(x,name,type) \
 		X509_LOOKUP_ctrl((x),X509_L_ADD_DIR,(name),(long)(type),NULL)
 
+#define X509_LOOKUP_load_index(x,name) \
+		X509_LOOKUP_ctrl((x),X509_L_LOAD_INDEX,(name),0,NULL)
+
 #define		X509_V_OK					0
 /* illegal error (for uninitialized values, to avoid X509_V_OK): 1 */
 
@@ -415,6 +429,8 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 #define X509_V_FLAG_SUITEB_128_LOS		0x30000
 /* Allow partial chains if at least one certificate is in trusted store */
 #define X509_V_FLAG_PARTIAL_CHAIN		0x80000
+/* Check all chain signatures together before walking the chain */
+#define X509_V_FLAG_BATCH_SIGNATURES		0x100000
 
 
 #define X509_VP_FLAG_DEFAULT			0x1
@@ -467,6 +483,8 @@ X509_LOOKUP *X509_STORE_add_lookup(X509_STORE *v, X509_LOOKUP_METHOD *m);
 
 X509_LOOKUP_METHOD *X509_LOOKUP_hash_dir(void);
 X509_LOOKUP_METHOD *X509_LOOKUP_file(void);
+X509_LOOKUP_METHOD *X509_LOOKUP_index_file(void);
+int X509_LOOKUP_write_index(BIO *out, STACK_OF(X509_INFO) *objs);
 
 int X509_STORE_add_cert(X509_STORE *ctx, X509 *x);
 int X509_STORE_add_crl(X509_STORE *ctx, X509_CRL *x);
@@ -500,6 +518,7 @@ int X509_LOOKUP_shutdown(X509_LOOKUP *ctx);
 #ifndef OPENSSL_NO_STDIO
 int	X509_STORE_load_locations (X509_STORE *ctx,
 		const char *file, const char *dir);
+int	X509_STORE_load_index(X509_STORE *ctx, const char *file);
 int	X509_STORE_set_default_paths(X509_STORE *ctx);
 #endif
 
@@ -528,6 +547,9 @@ void X509_STORE_CTX_set_time(X509_STORE_CTX *ctx, unsigned long flags,
 								time_t t);
 void X509_STORE_CTX_set_verify_cb(X509_STORE_CTX *ctx,
 				  int (*verify_cb)(int, X509_STORE_CTX *));
+void X509_STORE_CTX_set_verify_pool(X509_STORE_CTX *ctx,
+	void (*run)(void *pool, void (*fn)(void *), void **args, int num),
+	void *pool);
   
 X509_POLICY_TREE *X509_STORE_CTX_get0_policy_tree(X509_STORE_CTX *ctx);
 int X509_STORE_CTX_get_explicit_policy(X509_STORE_CTX *ctx);
@@ -118,6 +118,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "ssl_locl.h"
+#include "cryptlib.h"
 #include <openssl/buffer.h>
 #include <openssl/rand.h>
 #include <openssl/objects.h>
@@ -600,77 +601,379 @@ int ssl_verify_alarm_type(long type)
 #ifndef OPENSSL_NO_BUF_FREELISTS
 /* On some platforms, malloc() performance is bad enough that you can't just
  * free() and malloc() buffers all the time, so we need to use freelists from
- * unused buffers.  Currently, each freelist holds memory chunks of only a
- * given size (list->chunklen); other sized chunks are freed and malloced.
- * This doesn't help much if you're using many different SSL option settings
- * with a given context.  (The options affecting buffer size are
- * max_send_fragment, read buffer vs write buffer,
- * SSL_OP_MICROSOFT_BIG_WRITE_BUFFER, SSL_OP_NO_COMPRESSION, and
- * SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS.)  Using a separate freelist for every
- * possible size is not an option, since max_send_fragment can take on many
- * different values.
+ * unused buffers.  Buffers are sized up to a multiple of SSL3_BUF_CLASS_SIZE
+ * and kept by size class, so that buffers for different SSL option settings
+ * (max_send_fragment, SSL_OP_MICROSOFT_BIG_WRITE_BUFFER, compression, empty
+ * fragments, SSL_MODE_SMALL_BUFFERS) can all be reused.
  *
- * If you are on a platform with a slow malloc(), and you're using SSL
- * connections with many different settings for these options, and you need to
- * use the SSL_MOD_RELEASE_BUFFERS feature, you have a few options:
- *    - Link against a faster malloc implementation.
- *    - Use a separate SSL_CTX for each option set.
- *    - Improve this code.
+ * Released buffers first go to a small cache of the releasing thread, which
+ * is used without locking.  Buffers that do not fit there go to the
+ * freelists of the context, which are shared by all threads and hold up to
+ * freelist_max_len buffers per class.  With compare-and-swap a buffer is
+ * taken from or put into a slot of its class without a lock, as for the
+ * ECDH key queues, otherwise CRYPTO_LOCK_SSL_BUF is held.  A context with
+ * a freelist_max_len of 0 does not keep buffers at all.
  */
+#if defined(CRYPTO_ATOMIC_CAS) && defined(CRYPTO_ATOMIC_LOAD_PTR)
+# define BUF_FREELIST_LOCKFREE
+#endif
+
+/* Limits of the per-thread cache */
+#define SSL3_BUF_CACHE_LEN	4		/* buffers per class */
+#define SSL3_BUF_CACHE_BYTES	(256*1024)	/* buffers of all classes */
+
+typedef struct ssl3_buf_cache_st
+	{
+	size_t bytes;
+	unsigned int len[SSL3_BUF_CLASSES];
+	SSL3_BUF_FREELIST_ENTRY *head[SSL3_BUF_CLASSES];
+	} SSL3_BUF_CACHE;
+
+static CRYPTO_THREAD_LOCAL *buf_cache_key = NULL;
+
+static void buf_cache_free(void *p)
+	{
+	SSL3_BUF_CACHE *cache = p;
+	SSL3_BUF_FREELIST_ENTRY *ent, *next;
+	int i;
+
+	for (i = 0; i < SSL3_BUF_CLASSES; i++)
+		{
+		for (ent = cache->head[i]; ent != NULL; ent = next)
+			{
+			next = ent->next;
+			OPENSSL_free(ent);
+			}
+		}
+	OPENSSL_free(cache);
+	}
+
+static SSL3_BUF_CACHE *buf_cache_get(int create)
+	{
+	CRYPTO_THREAD_LOCAL *key;
+	SSL3_BUF_CACHE *cache;
+
+	if (buf_cache_key == NULL)
+		{
+		if (!create)
+			return NULL;
+		/* The key is kept for the life of the process */
+		MemCheck_off();
+		key = CRYPTO_THREAD_LOCAL_new(buf_cache_free);
+		MemCheck_on();
+		if (key == NULL)
+			return NULL;
+		CRYPTO_w_lock(CRYPTO_LOCK_SSL_BUF);
+		if (buf_cache_key == NULL)
+			{
+			buf_cache_key = key;
+			key = NULL;
+			}
+		CRYPTO_w_unlock(CRYPTO_LOCK_SSL_BUF);
+		if (key)
+			CRYPTO_THREAD_LOCAL_free(key);
+		}
+
+	if ((cache = CRYPTO_THREAD_LOCAL_get(buf_cache_key)) != NULL ||
+	    !create)
+		return cache;
+
+	if ((cache = OPENSSL_malloc(sizeof(*cache))) == NULL)
+		return NULL;
+	memset(cache, 0, sizeof(*cache));
+	if (!CRYPTO_THREAD_LOCAL_set(buf_cache_key, cache))
+		{
+		OPENSSL_free(cache);
+		return NULL;
+		}
+	return cache;
+	}
+
+void SSL_free_thread_buffers(void)
+	{
+	SSL3_BUF_CACHE *cache;
+
+	if ((cache = buf_cache_get(0)) == NULL)
+		return;
+	CRYPTO_THREAD_LOCAL_set(buf_cache_key, NULL);
+	buf_cache_free(cache);
+	}
+
+/* Size class of a buffer of 'sz' bytes, or -1 for buffers not kept */
+static int freelist_class(SSL_CTX *ctx, size_t sz)
+	{
+	if (sz == 0 || sz > SSL3_BUF_CLASSES * SSL3_BUF_CLASS_SIZE ||
+	    ctx == NULL || ctx->freelist_max_len == 0)
+		return -1;
+	return (int)((sz - 1) / SSL3_BUF_CLASS_SIZE);
+	}
+
+/* Slots of class i of list, set up with max entries if there are none.
+ * Without compare-and-swap this is called with CRYPTO_LOCK_SSL_BUF held. */
+static SSL3_BUF_SLOTS *freelist_slots(SSL3_BUF_FREELIST *list, int i,
+					unsigned int max)
+	{
+	SSL3_BUF_SLOTS *slots;
+
+#ifdef BUF_FREELIST_LOCKFREE
+	if ((slots = CRYPTO_ATOMIC_LOAD_PTR(&list->slots[i])) != NULL)
+		return slots;
+#else
+	if ((slots = list->slots[i]) != NULL)
+		return slots;
+#endif
+	slots = OPENSSL_malloc(sizeof(SSL3_BUF_SLOTS) +
+					(max - 1) * sizeof(void *));
+	if (slots == NULL)
+		return NULL;
+	memset(slots, 0, sizeof(SSL3_BUF_SLOTS) + (max - 1) * sizeof(void *));
+	slots->max = max;
+#ifdef BUF_FREELIST_LOCKFREE
+	if (CRYPTO_ATOMIC_CAS(&list->slots[i], NULL, slots))
+		return slots;
+	/* Another thread set them up first */
+	OPENSSL_free(slots);
+	return CRYPTO_ATOMIC_LOAD_PTR(&list->slots[i]);
+#else
+	list->slots[i] = slots;
+	return slots;
+#endif
+	}
+
+/* Allocate a buffer of at least *sz bytes, *sz is set to its actual size */
 static void *
-freelist_extract(SSL_CTX *ctx, int for_read, int sz)
+freelist_extract(SSL_CTX *ctx, int for_read, size_t *sz)
 	{
 	SSL3_BUF_FREELIST *list;
+	SSL3_BUF_SLOTS *slots;
+	SSL3_BUF_CACHE *cache;
 	SSL3_BUF_FREELIST_ENTRY *ent = NULL;
-	void *result = NULL;
+	void *p = NULL;
+	unsigned int j;
+	int i;
+
+	if ((i = freelist_class(ctx, *sz)) < 0)
+		return OPENSSL_malloc(*sz);
+	*sz = (size_t)(i + 1) * SSL3_BUF_CLASS_SIZE;
+
+	if ((cache = buf_cache_get(0)) != NULL &&
+	    (ent = cache->head[i]) != NULL)
+		{
+		cache->head[i] = ent->next;
+		cache->len[i]--;
+		cache->bytes -= *sz;
+		return ent;
+		}
 
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
 	list = for_read ? ctx->rbuf_freelist : ctx->wbuf_freelist;
-	if (list != NULL && sz == (int)list->chunklen)
-		ent = list->head;
-	if (ent != NULL)
+#ifdef BUF_FREELIST_LOCKFREE
+	if ((slots = CRYPTO_ATOMIC_LOAD_PTR(&list->slots[i])) != NULL)
 		{
-		list->head = ent->next;
-		result = ent;
-		if (--list->len == 0)
-			list->chunklen = 0;
+		for (j = 0; j < slots->max; j++)
+			{
+			p = CRYPTO_ATOMIC_LOAD_PTR(&slots->buf[j]);
+			if (p != NULL &&
+			    CRYPTO_ATOMIC_CAS(&slots->buf[j], p, NULL))
+				return p;
+			}
 		}
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
-	if (!result)
-		result = OPENSSL_malloc(sz);
-	return result;
-}
+#else
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_BUF);
+	if ((slots = list->slots[i]) != NULL)
+		{
+		for (j = 0; j < slots->max && p == NULL; j++)
+			{
+			p = slots->buf[j];
+			slots->buf[j] = NULL;
+			}
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_BUF);
+	if (p != NULL)
+		return p;
+#endif
+	return OPENSSL_malloc(*sz);
+	}
 
 static void
 freelist_insert(SSL_CTX *ctx, int for_read, size_t sz, void *mem)
 	{
 	SSL3_BUF_FREELIST *list;
-	SSL3_BUF_FREELIST_ENTRY *ent;
+	SSL3_BUF_SLOTS *slots;
+	SSL3_BUF_CACHE *cache;
+	SSL3_BUF_FREELIST_ENTRY *ent = mem;
+	unsigned int j, max;
+	int i;
 
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	list = for_read ? ctx->rbuf_freelist : ctx->wbuf_freelist;
-	if (list != NULL &&
-	    (sz == list->chunklen || list->chunklen == 0) &&
-	    list->len < ctx->freelist_max_len &&
-	    sz >= sizeof(*ent))
+	/* Only buffers of a class size were allocated by freelist_extract() */
+	if ((i = freelist_class(ctx, sz)) < 0 ||
+	    sz != (size_t)(i + 1) * SSL3_BUF_CLASS_SIZE)
 		{
-		list->chunklen = sz;
-		ent = mem;
-		ent->next = list->head;
-		list->head = ent;
-		++list->len;
-		mem = NULL;
+		OPENSSL_free(mem);
+		return;
 		}
 
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
-	if (mem)
+	if ((cache = buf_cache_get(1)) != NULL &&
+	    cache->len[i] < SSL3_BUF_CACHE_LEN &&
+	    cache->bytes + sz <= SSL3_BUF_CACHE_BYTES)
+		{
+		ent->next = cache->head[i];
+		cache->head[i] = ent;
+		cache->len[i]++;
+		cache->bytes += sz;
+		return;
+		}
+
+	list = for_read ? ctx->rbuf_freelist : ctx->wbuf_freelist;
+	if ((max = ctx->freelist_max_len) == 0)
+		{
 		OPENSSL_free(mem);
+		return;
+		}
+#ifdef BUF_FREELIST_LOCKFREE
+	if ((slots = freelist_slots(list, i, max)) != NULL)
+		{
+		if (max > slots->max)
+			max = slots->max;
+		for (j = 0; j < max; j++)
+			{
+			if (CRYPTO_ATOMIC_CAS(&slots->buf[j], NULL, mem))
+				return;
+			}
+		}
+#else
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_BUF);
+	if ((slots = freelist_slots(list, i, max)) != NULL)
+		{
+		if (max > slots->max)
+			max = slots->max;
+		for (j = 0; j < max && mem != NULL; j++)
+			{
+			if (slots->buf[j] == NULL)
+				{
+				slots->buf[j] = mem;
+				mem = NULL;
+				}
+			}
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_BUF);
+	if (mem == NULL)
+		return;
+#endif
+	OPENSSL_free(mem);
 	}
 #else
-#define freelist_extract(c,fr,sz) OPENSSL_malloc(sz)
+#define freelist_extract(c,fr,sz) OPENSSL_malloc(*(sz))
 #define freelist_insert(c,fr,sz,m) OPENSSL_free(m)
+
+void SSL_free_thread_buffers(void)
+	{
+	}
+#endif
+
+/* Size of a read buffer that holds any record */
+static size_t ssl3_read_buffer_len(SSL *s)
+	{
+	size_t len,align=0,headerlen;
+
+	if (SSL_version(s) == DTLS1_VERSION || SSL_version(s) == DTLS1_BAD_VER)
+		headerlen = DTLS1_RT_HEADER_LENGTH;
+	else
+		headerlen = SSL3_RT_HEADER_LENGTH;
+
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+	align = (-SSL3_RT_HEADER_LENGTH)&(SSL3_ALIGN_PAYLOAD-1);
+#endif
+
+	len = SSL3_RT_MAX_PLAIN_LENGTH
+		+ SSL3_RT_MAX_ENCRYPTED_OVERHEAD
+		+ headerlen + align;
+	if (s->options & SSL_OP_MICROSOFT_BIG_SSLV3_BUFFER)
+		len += SSL3_RT_MAX_EXTRA;
+#ifndef OPENSSL_NO_COMP
+	if (ssl_allow_compression(s))
+		len += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
+#endif
+	return len;
+	}
+
+/* Size of a write buffer for a record carrying 'len' bytes of data. If
+ * 'exact' is set the buffer is only used for the next record, so room for
+ * compression and an empty fragment is only left if they are in use. */
+static size_t ssl3_write_buffer_len(SSL *s, size_t len, int exact)
+	{
+	size_t align=0,headerlen;
+
+	if (SSL_version(s) == DTLS1_VERSION || SSL_version(s) == DTLS1_BAD_VER)
+		headerlen = DTLS1_RT_HEADER_LENGTH + 1;
+	else
+		headerlen = SSL3_RT_HEADER_LENGTH;
+
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+	align = (-SSL3_RT_HEADER_LENGTH)&(SSL3_ALIGN_PAYLOAD-1);
 #endif
 
+	len += SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD
+		+ headerlen + align;
+#ifndef OPENSSL_NO_COMP
+	if (exact ? s->compress != NULL : ssl_allow_compression(s))
+		len += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
+#endif
+	if (exact ? s->s3->need_empty_fragments :
+	    !(s->options & SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS))
+		len += headerlen + align
+			+ SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD;
+	return len;
+	}
+
+/* Record buffers are accounted to the context the connection uses, see
+ * SSL_CTX_get_buffer_memory(3). DTLS keeps the read buffers of buffered
+ * records to itself, so its buffers are not accounted. The counters are
+ * longs, a context can hold more than 2GB of buffers, and need no lock
+ * where the compiler can add to a long atomically. */
+static void ssl3_buffer_counters_add(SSL_CTX *ctx, long len, long n)
+	{
+#ifdef CRYPTO_ATOMIC_ADD_LONG
+	CRYPTO_ATOMIC_ADD_LONG(&ctx->buffer_mem, len);
+	CRYPTO_ATOMIC_ADD_LONG(&ctx->buffer_count, n);
+#else
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_BUF);
+	ctx->buffer_mem += len;
+	ctx->buffer_count += n;
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_BUF);
+#endif
+	}
+
+static void ssl3_buffer_account(SSL *s, long len)
+	{
+	if (s->ctx == NULL || SSL_IS_DTLS(s))
+		return;
+	ssl3_buffer_counters_add(s->ctx, len, len > 0 ? 1 : -1);
+	}
+
+/* Allocate a buffer of at least *len bytes. The buffer may be larger,
+ * *len is set to its actual size. */
+static unsigned char *ssl3_buffer_alloc(SSL *s, int for_read, size_t *len)
+	{
+	unsigned char *p;
+
+	p = freelist_extract(s->ctx, for_read, len);
+	if (p != NULL)
+		ssl3_buffer_account(s, (long)*len);
+	return p;
+	}
+
+static void ssl3_buffer_free(SSL *s, int for_read, SSL3_BUFFER *b)
+	{
+	ssl3_buffer_account(s, -(long)b->len);
+	freelist_insert(s->ctx, for_read, b->len, b->buf);
+	b->buf = NULL;
+	}
+
+/* With SSL_MODE_SMALL_BUFFERS the read buffer starts out large enough for
+ * the record header and short records, ssl3_grow_read_buffer() makes room
+ * for longer ones once their header has been read. */
+#define SSL3_SMALL_READ_BUFFER_LEN	512
+
 int ssl3_setup_read_buffer(SSL *s)
 	{
 	unsigned char *p;
@@ -687,19 +990,13 @@ int ssl3_setup_read_buffer(SSL *s)
 
 	if (s->s3->rbuf.buf == NULL)
 		{
-		len = SSL3_RT_MAX_PLAIN_LENGTH
-			+ SSL3_RT_MAX_ENCRYPTED_OVERHEAD
-			+ headerlen + align;
 		if (s->options & SSL_OP_MICROSOFT_BIG_SSLV3_BUFFER)
-			{
 			s->s3->init_extra = 1;
-			len += SSL3_RT_MAX_EXTRA;
-			}
-#ifndef OPENSSL_NO_COMP
-		if (ssl_allow_compression(s))
-			len += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
-#endif
-		if ((p=freelist_extract(s->ctx, 1, len)) == NULL)
+		if (SSL_USE_SMALL_BUFFERS(s))
+			len = SSL3_SMALL_READ_BUFFER_LEN + headerlen + align;
+		else
+			len = ssl3_read_buffer_len(s);
+		if ((p=ssl3_buffer_alloc(s, 1, &len)) == NULL)
 			goto err;
 		s->s3->rbuf.buf = p;
 		s->s3->rbuf.len = len;
@@ -713,46 +1010,95 @@ err:
 	return 0;
 	}
 
-int ssl3_setup_write_buffer(SSL *s)
+/* Make room for a record of 'len' bytes after the header that s->packet
+ * points to, keeping what has been read so far. The buffer never grows
+ * beyond the size of a full read buffer; records that still do not fit
+ * are rejected by the caller. */
+int ssl3_grow_read_buffer(SSL *s, size_t len)
 	{
+	SSL3_BUFFER *rb = &(s->s3->rbuf);
 	unsigned char *p;
-	size_t len,align=0,headerlen;
-
-	if (SSL_version(s) == DTLS1_VERSION || SSL_version(s) == DTLS1_BAD_VER)
-		headerlen = DTLS1_RT_HEADER_LENGTH + 1;
-	else
-		headerlen = SSL3_RT_HEADER_LENGTH;
+	size_t have,need,align=0;
 
 #if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
 	align = (-SSL3_RT_HEADER_LENGTH)&(SSL3_ALIGN_PAYLOAD-1);
 #endif
 
-	if (s->s3->wbuf.buf == NULL)
+	have = s->packet_length + rb->left;
+	need = SSL3_RT_HEADER_LENGTH + len;
+	if (need < have)
+		need = have;
+	need += align;
+	if (need > ssl3_read_buffer_len(s))
+		need = ssl3_read_buffer_len(s);
+	if (need <= rb->len)
+		return 1;
+
+	if ((p=ssl3_buffer_alloc(s, 1, &need)) == NULL)
 		{
-		len = s->max_send_fragment
-			+ SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD
-			+ headerlen + align;
-#ifndef OPENSSL_NO_COMP
-		if (ssl_allow_compression(s))
-			len += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
-#endif
-		if (!(s->options & SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS))
-			len += headerlen + align
-				+ SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD;
-
-		if ((p=freelist_extract(s->ctx, 0, len)) == NULL)
-			goto err;
-		s->s3->wbuf.buf = p;
-		s->s3->wbuf.len = len;
+		SSLerr(SSL_F_SSL3_GROW_READ_BUFFER,ERR_R_MALLOC_FAILURE);
+		return 0;
 		}
+	memcpy(p + align, s->packet, have);
+	ssl3_buffer_free(s, 1, rb);
+	rb->buf = p;
+	rb->len = need;
+	rb->offset = align + s->packet_length;
+	s->packet = p + align;
+	return 1;
+	}
 
+/* Replace the write buffer, which must not hold any data, by one of 'len'
+ * bytes. */
+int ssl3_alloc_write_buffer(SSL *s, size_t len)
+	{
+	unsigned char *p;
+
+	ssl3_release_write_buffer(s);
+	if ((p=ssl3_buffer_alloc(s, 0, &len)) == NULL)
+		{
+		SSLerr(SSL_F_SSL3_ALLOC_WRITE_BUFFER,ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	s->s3->wbuf.buf = p;
+	s->s3->wbuf.len = len;
 	return 1;
+	}
 
-err:
-	SSLerr(SSL_F_SSL3_SETUP_WRITE_BUFFER,ERR_R_MALLOC_FAILURE);
-	return 0;
+int ssl3_setup_write_buffer(SSL *s)
+	{
+	unsigned char *p;
+	size_t len;
+
+	/* With SSL_MODE_SMALL_BUFFERS the buffer is allocated for each
+	 * record by ssl3_fit_write_buffer() */
+	if (s->s3->wbuf.buf != NULL || SSL_USE_SMALL_BUFFERS(s))
+		return 1;
+
+	len = ssl3_write_buffer_len(s, s->max_send_fragment, 0);
+	if ((p=ssl3_buffer_alloc(s, 0, &len)) == NULL)
+		{
+		SSLerr(SSL_F_SSL3_SETUP_WRITE_BUFFER,ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	s->s3->wbuf.buf = p;
+	s->s3->wbuf.len = len;
+	return 1;
 	}
 
+/* Make sure the write buffer can take a record of 'len' bytes of data */
+int ssl3_fit_write_buffer(SSL *s, unsigned int len)
+	{
+	size_t need;
+
+	if (!SSL_USE_SMALL_BUFFERS(s))
+		return ssl3_setup_write_buffer(s);
+
+	need = ssl3_write_buffer_len(s, len, 1);
+	if (s->s3->wbuf.buf != NULL && s->s3->wbuf.len >= need)
+		return 1;
+	return ssl3_alloc_write_buffer(s, need);
+	}
 
 int ssl3_setup_buffers(SSL *s)
 	{
@@ -766,21 +1112,67 @@ int ssl3_setup_buffers(SSL *s)
 int ssl3_release_write_buffer(SSL *s)
 	{
 	if (s->s3->wbuf.buf != NULL)
-		{
-		freelist_insert(s->ctx, 0, s->s3->wbuf.len, s->s3->wbuf.buf);
-		s->s3->wbuf.buf = NULL;
-		}
+		ssl3_buffer_free(s, 0, &s->s3->wbuf);
 	return 1;
 	}
 
 int ssl3_release_read_buffer(SSL *s)
 	{
 	if (s->s3->rbuf.buf != NULL)
+		ssl3_buffer_free(s, 1, &s->s3->rbuf);
+	return 1;
+	}
+
+/* The buffer SSL_writev() gathers short buffers into is accounted with the
+ * record buffers. */
+unsigned char *ssl3_get_writev_buffer(SSL *s)
+	{
+	if (s->writev_buf == NULL)
 		{
-		freelist_insert(s->ctx, 1, s->s3->rbuf.len, s->s3->rbuf.buf);
-		s->s3->rbuf.buf = NULL;
+		s->writev_buf = OPENSSL_malloc(SSL3_RT_MAX_PLAIN_LENGTH);
+		if (s->writev_buf != NULL)
+			ssl3_buffer_account(s, SSL3_RT_MAX_PLAIN_LENGTH);
 		}
-	return 1;
+	return s->writev_buf;
+	}
+
+void ssl3_release_writev_buffer(SSL *s)
+	{
+	if (s->writev_buf != NULL)
+		{
+		ssl3_buffer_account(s, -SSL3_RT_MAX_PLAIN_LENGTH);
+		OPENSSL_free(s->writev_buf);
+		s->writev_buf = NULL;
+		}
+	}
+
+/* Move the accounting of the buffers held by 's' over to 'ctx', which is
+ * about to become its context. */
+void ssl3_move_buffers(SSL *s, SSL_CTX *ctx)
+	{
+	long len = 0, n = 0;
+
+	if (SSL_IS_DTLS(s))
+		return;
+	if (s->s3 != NULL && s->s3->rbuf.buf != NULL)
+		{
+		len += s->s3->rbuf.len;
+		n++;
+		}
+	if (s->s3 != NULL && s->s3->wbuf.buf != NULL)
+		{
+		len += s->s3->wbuf.len;
+		n++;
+		}
+	if (s->writev_buf != NULL)
+		{
+		len += SSL3_RT_MAX_PLAIN_LENGTH;
+		n++;
+		}
+	if (n == 0)
+		return;
+	ssl3_buffer_counters_add(s->ctx, -len, -n);
+	ssl3_buffer_counters_add(ctx, len, n);
 	}
 
 int ssl_allow_compression(SSL *s)
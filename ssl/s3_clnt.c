@@ -1158,6 +1158,7 @@ int ssl3_get_server_certificate(SSL *s)
 	const unsigned char *q,*p;
 	unsigned char *d;
 	STACK_OF(X509) *sk=NULL;
+	ASN1_BUFFER *buf=NULL;
 	SESS_CERT *sc;
 	EVP_PKEY *pkey=NULL;
 	int need_cert = 1; /* VRS: 0=> will allow null cert if auth == KRB5 */
@@ -1200,6 +1201,24 @@ int ssl3_get_server_certificate(SSL *s)
 		SSLerr(SSL_F_SSL3_GET_SERVER_CERTIFICATE,SSL_R_LENGTH_MISMATCH);
 		goto f_err;
 		}
+	/* Decode the certificates from a copy of the list they keep a
+	 * reference to, so that their contents need not be copied */
+	if (llen > 0)
+		{
+		if ((d=OPENSSL_malloc(llen)) == NULL)
+			{
+			SSLerr(SSL_F_SSL3_GET_SERVER_CERTIFICATE,ERR_R_MALLOC_FAILURE);
+			goto err;
+			}
+		memcpy(d,p,llen);
+		if ((buf=ASN1_BUFFER_new(d,llen)) == NULL)
+			{
+			OPENSSL_free(d);
+			SSLerr(SSL_F_SSL3_GET_SERVER_CERTIFICATE,ERR_R_MALLOC_FAILURE);
+			goto err;
+			}
+		p=d;
+		}
 	for (nc=0; nc<llen; )
 		{
 		n2l3(p,l);
@@ -1211,7 +1230,7 @@ int ssl3_get_server_certificate(SSL *s)
 			}
 
 		q=p;
-		x=d2i_X509(NULL,&q,l);
+		x=d2i_X509_buffer(NULL,&q,l,buf);
 		if (x == NULL)
 			{
 			al=SSL_AD_BAD_CERTIFICATE;
@@ -1347,6 +1366,7 @@ err:
 	EVP_PKEY_free(pkey);
 	X509_free(x);
 	sk_X509_pop_free(sk,X509_free);
+	ASN1_BUFFER_free(buf);
 	return(ret);
 	}
 
@@ -1427,6 +1447,8 @@ int ssl3_get_key_exchange(SSL *s)
 			EC_KEY_free(s->session->sess_cert->peer_ecdh_tmp);
 			s->session->sess_cert->peer_ecdh_tmp=NULL;
 			}
+		EVP_PKEY_free(s->session->sess_cert->peer_pkey_tmp);
+		s->session->sess_cert->peer_pkey_tmp=NULL;
 #endif
 		}
 	else
@@ -1811,12 +1833,6 @@ int ssl3_get_key_exchange(SSL *s)
 		EC_GROUP *ngroup;
 		const EC_GROUP *group;
 
-		if ((ecdh=EC_KEY_new()) == NULL)
-			{
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_MALLOC_FAILURE);
-			goto err;
-			}
-
 		/* Extract elliptic curve parameters and the
 		 * server's ephemeral ECDH public key.
 		 * Keep accumulating lengths of various components in
@@ -1850,48 +1866,95 @@ int ssl3_get_key_exchange(SSL *s)
 			goto f_err;
 			}
 
-		ngroup = EC_GROUP_new_by_curve_name(curve_nid);
-		if (ngroup == NULL)
+		if (curve_nid == NID_X25519)
 			{
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_EC_LIB);
-			goto err;
+			/* X25519 is not an EC_GROUP: keep the server's
+			 * share as an EVP_PKEY.
+			 */
+			EVP_PKEY *srvr_pkey;
+
+			if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher))
+				{
+				al=SSL_AD_EXPORT_RESTRICTION;
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
+				goto f_err;
+				}
+
+			p+=3;
+			encoded_pt_len = *p;
+			p+=1;
+
+			srvr_pkey = EVP_PKEY_new();
+			if ((encoded_pt_len > n - param_len) ||
+			    (srvr_pkey == NULL) ||
+			    !EVP_PKEY_set_type(srvr_pkey, EVP_PKEY_X25519) ||
+			    !EVP_PKEY_set1_tls_encodedpoint(srvr_pkey, p,
+							encoded_pt_len))
+				{
+				EVP_PKEY_free(srvr_pkey);
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_BAD_ECPOINT);
+				goto f_err;
+				}
+			s->session->sess_cert->peer_pkey_tmp=srvr_pkey;
 			}
-		if (EC_KEY_set_group(ecdh, ngroup) == 0)
+		else
 			{
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_EC_LIB);
-			goto err;
-			}
-		EC_GROUP_free(ngroup);
+			if ((ecdh=EC_KEY_new()) == NULL)
+				{
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_MALLOC_FAILURE);
+				goto err;
+				}
 
-		group = EC_KEY_get0_group(ecdh);
+			ngroup = EC_GROUP_new_by_curve_name(curve_nid);
+			if (ngroup == NULL)
+				{
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_EC_LIB);
+				goto err;
+				}
+			if (EC_KEY_set_group(ecdh, ngroup) == 0)
+				{
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_EC_LIB);
+				goto err;
+				}
+			EC_GROUP_free(ngroup);
 
-		if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher) &&
-		    (EC_GROUP_get_degree(group) > 163))
-			{
-			al=SSL_AD_EXPORT_RESTRICTION;
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
-			goto f_err;
-			}
+			group = EC_KEY_get0_group(ecdh);
 
-		p+=3;
+			if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher) &&
+			    (EC_GROUP_get_degree(group) > 163))
+				{
+				al=SSL_AD_EXPORT_RESTRICTION;
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
+				goto f_err;
+				}
 
-		/* Next, get the encoded ECPoint */
-		if (((srvr_ecpoint = EC_POINT_new(group)) == NULL) ||
-		    ((bn_ctx = BN_CTX_new()) == NULL))
-			{
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_MALLOC_FAILURE);
-			goto err;
-			}
+			p+=3;
+
+			/* Next, get the encoded ECPoint */
+			if (((srvr_ecpoint = EC_POINT_new(group)) == NULL) ||
+			    ((bn_ctx = BN_CTX_new()) == NULL))
+				{
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,ERR_R_MALLOC_FAILURE);
+				goto err;
+				}
 
-		encoded_pt_len = *p;  /* length of encoded point */
-		p+=1;
+			encoded_pt_len = *p;  /* length of encoded point */
+			p+=1;
 
-		if ((encoded_pt_len > n - param_len) ||
-		    (EC_POINT_oct2point(group, srvr_ecpoint, 
-			p, encoded_pt_len, bn_ctx) == 0))
-			{
-			SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_BAD_ECPOINT);
-			goto f_err;
+			if ((encoded_pt_len > n - param_len) ||
+			    (EC_POINT_oct2point(group, srvr_ecpoint, 
+				p, encoded_pt_len, bn_ctx) == 0))
+				{
+				SSLerr(SSL_F_SSL3_GET_KEY_EXCHANGE,SSL_R_BAD_ECPOINT);
+				goto f_err;
+				}
+			EC_KEY_set_public_key(ecdh, srvr_ecpoint);
+			s->session->sess_cert->peer_ecdh_tmp=ecdh;
+			ecdh=NULL;
+			BN_CTX_free(bn_ctx);
+			bn_ctx = NULL;
+			EC_POINT_free(srvr_ecpoint);
+			srvr_ecpoint = NULL;
 			}
 		param_len += encoded_pt_len;
 
@@ -1912,13 +1975,6 @@ int ssl3_get_key_exchange(SSL *s)
 			pkey=X509_get_pubkey(s->session->sess_cert->peer_pkeys[SSL_PKEY_ECC].x509);
 #endif
 		/* else anonymous ECDH, so no certificate or pkey. */
-		EC_KEY_set_public_key(ecdh, srvr_ecpoint);
-		s->session->sess_cert->peer_ecdh_tmp=ecdh;
-		ecdh=NULL;
-		BN_CTX_free(bn_ctx);
-		bn_ctx = NULL;
-		EC_POINT_free(srvr_ecpoint);
-		srvr_ecpoint = NULL;
 		}
 	else if (alg_k)
 		{
@@ -2467,6 +2523,7 @@ int ssl3_send_client_key_exchange(SSL *s)
 	unsigned char *encodedPoint = NULL;
 	int encoded_pt_len = 0;
 	BN_CTX * bn_ctx = NULL;
+	EVP_PKEY *clnt_pkey = NULL;
 #endif
 
 	if (s->state == SSL3_ST_CW_KEY_EXCH_A)
@@ -2782,6 +2839,63 @@ int ssl3_send_client_key_exchange(SSL *s)
 #endif
 
 #ifndef OPENSSL_NO_ECDH 
+		else if ((alg_k & SSL_kECDHE) && s->session->sess_cert &&
+			 s->session->sess_cert->peer_pkey_tmp)
+			{
+			/* X25519: the server's share is an EVP_PKEY */
+			EVP_PKEY_CTX *pctx;
+			size_t skeylen;
+
+			pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, NULL);
+			if (pctx == NULL || EVP_PKEY_keygen_init(pctx) <= 0 ||
+			    EVP_PKEY_keygen(pctx, &clnt_pkey) <= 0)
+				{
+				EVP_PKEY_CTX_free(pctx);
+				SSLerr(SSL_F_SSL3_SEND_CLIENT_KEY_EXCHANGE,ERR_R_EVP_LIB);
+				goto err;
+				}
+			EVP_PKEY_CTX_free(pctx);
+
+			/* use the 'p' output buffer for the shared secret, but
+			 * make sure to clear it out afterwards
+			 */
+			pctx = EVP_PKEY_CTX_new(clnt_pkey, NULL);
+			skeylen = SSL3_RT_MAX_PLAIN_LENGTH;
+			if (pctx == NULL || EVP_PKEY_derive_init(pctx) <= 0 ||
+			    EVP_PKEY_derive_set_peer(pctx,
+				s->session->sess_cert->peer_pkey_tmp) <= 0 ||
+			    EVP_PKEY_derive(pctx, p, &skeylen) <= 0)
+				{
+				EVP_PKEY_CTX_free(pctx);
+				SSLerr(SSL_F_SSL3_SEND_CLIENT_KEY_EXCHANGE,ERR_R_EVP_LIB);
+				goto err;
+				}
+			EVP_PKEY_CTX_free(pctx);
+
+			/* generate master key from the result */
+			s->session->master_key_length = s->method->ssl3_enc \
+			    -> generate_master_secret(s, 
+				s->session->master_key,
+				p, skeylen);
+
+			OPENSSL_cleanse(p, skeylen);
+
+			n = EVP_PKEY_get1_tls_encodedpoint(clnt_pkey,
+							   &encodedPoint);
+			if (n == 0)
+				{
+				SSLerr(SSL_F_SSL3_SEND_CLIENT_KEY_EXCHANGE,ERR_R_EVP_LIB);
+				goto err;
+				}
+			*p = n; /* length of encoded point */
+			memcpy(p + 1, encodedPoint, n);
+			n += 1;
+
+			OPENSSL_free(encodedPoint);
+			encodedPoint = NULL;
+			EVP_PKEY_free(clnt_pkey);
+			clnt_pkey = NULL;
+			}
 		else if (alg_k & (SSL_kECDHE|SSL_kECDHr|SSL_kECDHe))
 			{
 			const EC_GROUP *srvr_group = NULL;
@@ -3211,6 +3325,7 @@ err:
 	if (clnt_ecdh != NULL) 
 		EC_KEY_free(clnt_ecdh);
 	EVP_PKEY_free(srvr_pub_pkey);
+	EVP_PKEY_free(clnt_pkey);
 #endif
 	return(-1);
 	}
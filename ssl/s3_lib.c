@@ -3156,6 +3156,59 @@ OPENSSL_GLOBAL const SSL_CIPHER ssl3_ciphers[]={
 #endif  /* OPENSSL_NO_CAMELLIA */
 #endif /* OPENSSL_NO_ECDH */
 
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+	/* ChaCha20-Poly1305 ciphersuites from RFC7905 */
+#ifndef OPENSSL_NO_ECDH
+	/* Cipher CCA8 */
+	{
+	1,
+	TLS1_TXT_ECDHE_RSA_WITH_CHACHA20_POLY1305,
+	TLS1_CK_ECDHE_RSA_WITH_CHACHA20_POLY1305,
+	SSL_kECDHE,
+	SSL_aRSA,
+	SSL_CHACHA20POLY1305,
+	SSL_AEAD,
+	SSL_TLSV1_2,
+	SSL_NOT_EXP|SSL_HIGH,
+	SSL_HANDSHAKE_MAC_SHA256|TLS1_PRF_SHA256,
+	256,
+	256,
+	},
+
+	/* Cipher CCA9 */
+	{
+	1,
+	TLS1_TXT_ECDHE_ECDSA_WITH_CHACHA20_POLY1305,
+	TLS1_CK_ECDHE_ECDSA_WITH_CHACHA20_POLY1305,
+	SSL_kECDHE,
+	SSL_aECDSA,
+	SSL_CHACHA20POLY1305,
+	SSL_AEAD,
+	SSL_TLSV1_2,
+	SSL_NOT_EXP|SSL_HIGH,
+	SSL_HANDSHAKE_MAC_SHA256|TLS1_PRF_SHA256,
+	256,
+	256,
+	},
+#endif /* OPENSSL_NO_ECDH */
+
+	/* Cipher CCAA */
+	{
+	1,
+	TLS1_TXT_DHE_RSA_WITH_CHACHA20_POLY1305,
+	TLS1_CK_DHE_RSA_WITH_CHACHA20_POLY1305,
+	SSL_kDHE,
+	SSL_aRSA,
+	SSL_CHACHA20POLY1305,
+	SSL_AEAD,
+	SSL_TLSV1_2,
+	SSL_NOT_EXP|SSL_HIGH,
+	SSL_HANDSHAKE_MAC_SHA256|TLS1_PRF_SHA256,
+	256,
+	256,
+	},
+#endif /* !OPENSSL_NO_CHACHA && !OPENSSL_NO_POLY1305 */
+
 
 #ifdef TEMP_GOST_TLS
 /* Cipher FF00 */
@@ -3329,6 +3382,7 @@ void ssl3_free(SSL *s)
 #ifndef OPENSSL_NO_ECDH
 	if (s->s3->tmp.ecdh != NULL)
 		EC_KEY_free(s->s3->tmp.ecdh);
+	EVP_PKEY_free(s->s3->tmp.pkey);
 #endif
 
 	if (s->s3->tmp.ca_names != NULL)
@@ -3387,6 +3441,8 @@ void ssl3_clear(SSL *s)
 		EC_KEY_free(s->s3->tmp.ecdh);
 		s->s3->tmp.ecdh = NULL;
 		}
+	EVP_PKEY_free(s->s3->tmp.pkey);
+	s->s3->tmp.pkey = NULL;
 #endif
 #ifndef OPENSSL_NO_TLSEXT
 #ifndef OPENSSL_NO_EC
@@ -3888,8 +3944,17 @@ long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg)
 			sc = s->session->sess_cert;
 #if !defined(OPENSSL_NO_RSA) && !defined(OPENSSL_NO_DH) && !defined(OPENSSL_NO_EC) && !defined(OPENSSL_NO_ECDH)
 			if (!sc->peer_rsa_tmp && !sc->peer_dh_tmp
-							&& !sc->peer_ecdh_tmp)
+				&& !sc->peer_ecdh_tmp && !sc->peer_pkey_tmp)
 				return 0;
+#endif
+#ifndef OPENSSL_NO_ECDH
+			if (sc->peer_pkey_tmp)
+				{
+				CRYPTO_add(&sc->peer_pkey_tmp->references, 1,
+							CRYPTO_LOCK_EVP_PKEY);
+				*(EVP_PKEY **)parg = sc->peer_pkey_tmp;
+				return 1;
+				}
 #endif
 			ptmp = EVP_PKEY_new();
 			if (!ptmp)
@@ -262,7 +262,7 @@ int ssl3_read_n(SSL *s, int n, int max, int extend)
 		if (i <= 0)
 			{
 			rb->left = left;
-			if (s->mode & SSL_MODE_RELEASE_BUFFERS &&
+			if (s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS) &&
 				!SSL_IS_DTLS(s))
 				if (len+left == 0)
 					ssl3_release_read_buffer(s);
@@ -373,6 +373,10 @@ fprintf(stderr, "Record type=%d, Length=%d\n", rr->type, rr->length);
 			goto err;
 			}
 
+		if (SSL_USE_SMALL_BUFFERS(s) &&
+		    !ssl3_grow_read_buffer(s, rr->length))
+			goto err;
+
 		if (rr->length > s->s3->rbuf.len - SSL3_RT_HEADER_LENGTH)
 			{
 			al=SSL_AD_RECORD_OVERFLOW;
@@ -701,10 +705,12 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 	 * Depending on platform multi-block can deliver several *times*
 	 * better performance. Downside is that it has to allocate
 	 * jumbo buffer to accomodate up to 8 records, but the
-	 * compromise is considered worthy.
+	 * compromise is considered worthy. Any write that would take
+	 * two or more records goes this way: below four full records
+	 * the data is sealed as four shorter records in one call.
 	 */
 	if (type==SSL3_RT_APPLICATION_DATA &&
-	    u_len >= 4*(max_send_fragment=s->max_send_fragment) &&
+	    u_len >= 2*(max_send_fragment=s->max_send_fragment) &&
 	    s->compress==NULL && s->msg_callback==NULL &&
 	    !SSL_USE_ETM(s) && SSL_USE_EXPLICIT_IV(s) &&
 	    EVP_CIPHER_flags(s->enc_write_ctx->cipher)&EVP_CIPH_FLAG_TLS1_1_MULTIBLOCK)
@@ -719,8 +725,6 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 
 		if (tot==0 || wb->buf==NULL)	/* allocate jumbo buffer */
 			{
-			ssl3_release_write_buffer(s);
-
 			packlen = EVP_CIPHER_CTX_ctrl(s->enc_write_ctx,
 					EVP_CTRL_TLS1_1_MULTIBLOCK_MAX_BUFSIZE,
 					max_send_fragment,NULL);
@@ -728,23 +732,21 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 			if (u_len >= 8*max_send_fragment)	packlen *= 8;
 			else				packlen *= 4;
 
-			wb->buf=OPENSSL_malloc(packlen);
-			wb->len=packlen;
+			if (!ssl3_alloc_write_buffer(s, packlen))
+				return -1;
 			}
 		else if (tot==len)		/* done? */
 			{
-			OPENSSL_free(wb->buf);	/* free jumbo buffer */
-			wb->buf = NULL;
+			ssl3_release_write_buffer(s);	/* free jumbo buffer */
 			return tot;
 			}
 
 		n=(len-tot);
 		for (;;)
 			{
-			if (n < 4*max_send_fragment)
+			if (n < 2*max_send_fragment)
 				{
-				OPENSSL_free(wb->buf);	/* free jumbo buffer */
-				wb->buf = NULL;
+				ssl3_release_write_buffer(s);	/* free jumbo buffer */
 				break;
 				}
 
@@ -760,8 +762,13 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 
 			if (n >= 8*max_send_fragment)
 				nw = max_send_fragment*(mb_param.interleave=8);
-			else
+			else if (n >= 4*max_send_fragment)
 				nw = max_send_fragment*(mb_param.interleave=4);
+			else
+				{
+				nw = n;
+				mb_param.interleave = 4;
+				}
 
 			memcpy(aad,s->s3->write_sequence,8);
 			aad[8]=type;
@@ -779,8 +786,7 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 
 			if (packlen<=0 || packlen>(int)wb->len)	/* never happens */
 				{
-				OPENSSL_free(wb->buf);	/* free jumbo buffer */
-				wb->buf = NULL;
+				ssl3_release_write_buffer(s);	/* free jumbo buffer */
 				break;
 				}
 
@@ -813,16 +819,14 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 				{
 				if (i<0)
 					{
-					OPENSSL_free(wb->buf);
-					wb->buf = NULL;
+					ssl3_release_write_buffer(s);
 					}
 				s->s3->wnum=tot;
 				return i;
 				}
 			if (i==(int)n)
 				{
-				OPENSSL_free(wb->buf);	/* free jumbo buffer */
-				wb->buf = NULL;
+				ssl3_release_write_buffer(s);	/* free jumbo buffer */
 				return tot+i;
 				}
 			n-=i;
@@ -833,7 +837,7 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 #endif
 	if (tot==len)		/* done? */
 		{
-		if (s->mode & SSL_MODE_RELEASE_BUFFERS &&
+		if (s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS) &&
 			!SSL_IS_DTLS(s))
 			ssl3_release_write_buffer(s);
 
@@ -865,7 +869,8 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 			 * in ciphersuites with known-IV weakness: */
 			s->s3->empty_fragment_done = 0;
 
-			if ((i==(int)n) && s->mode & SSL_MODE_RELEASE_BUFFERS &&
+			if ((i==(int)n) &&
+			    s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS) &&
 				!SSL_IS_DTLS(s))
 				ssl3_release_write_buffer(s);
 
@@ -904,9 +909,8 @@ static int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
 		/* if it went, fall through and send more stuff */
 		}
 
- 	if (wb->buf == NULL)
-		if (!ssl3_setup_write_buffer(s))
-			return -1;
+	if (!ssl3_fit_write_buffer(s, len))
+		return -1;
 
 	if (len == 0 && !create_empty_fragment)
 		return 0;
@@ -1359,7 +1363,8 @@ start:
 				{
 				s->rstate=SSL_ST_READ_HEADER;
 				rr->off=0;
-				if (s->mode & SSL_MODE_RELEASE_BUFFERS && s->s3->rbuf.left == 0)
+				if (s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS) &&
+				    s->s3->rbuf.left == 0)
 					ssl3_release_read_buffer(s);
 				}
 			}
@@ -1786,6 +1791,8 @@ int ssl3_do_change_cipher_spec(SSL *s)
 
 int ssl3_send_alert(SSL *s, int level, int desc)
 	{
+	int i;
+
 	/* Map tls/ssl alert value to correct one */
 	desc=s->method->ssl3_enc->alert_value(desc);
 	if (s->version == SSL3_VERSION && desc == SSL_AD_PROTOCOL_VERSION)
@@ -1799,7 +1806,13 @@ int ssl3_send_alert(SSL *s, int level, int desc)
 	s->s3->send_alert[0]=level;
 	s->s3->send_alert[1]=desc;
 	if (s->s3->wbuf.left == 0) /* data still being written out? */
-		return s->method->ssl_dispatch_alert(s);
+		{
+		i=s->method->ssl_dispatch_alert(s);
+		if (i > 0 && s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS) &&
+			!SSL_IS_DTLS(s))
+			ssl3_release_write_buffer(s);
+		return i;
+		}
 	/* else data is still being written out, we will get written
 	 * some time in the future */
 	return -1;
@@ -946,6 +946,8 @@ int ssl3_check_client_hello(SSL *s)
 			EC_KEY_free(s->s3->tmp.ecdh);
 			s->s3->tmp.ecdh = NULL;
 			}
+		EVP_PKEY_free(s->s3->tmp.pkey);
+		s->s3->tmp.pkey = NULL;
 #endif
 		s->s3->flags |= SSL3_FLAGS_SGC_RESTART_DONE;
 		return 2;
@@ -1785,7 +1787,53 @@ int ssl3_send_server_key_exchange(SSL *s)
 		else 
 #endif
 #ifndef OPENSSL_NO_ECDH
-			if (type & SSL_kECDHE)
+			if ((type & SSL_kECDHE) && s->cert->ecdh_tmp_auto &&
+				tls1_shared_curve(s, -2) == NID_X25519)
+			{
+			/* X25519 keys are EVP_PKEYs, not EC_KEYs: generate
+			 * one and encode its raw u-coordinate.
+			 */
+			EVP_PKEY_CTX *pctx;
+
+			if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher))
+				{
+				SSLerr(SSL_F_SSL3_SEND_SERVER_KEY_EXCHANGE,SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
+				goto err;
+				}
+			if (s->s3->tmp.pkey != NULL)
+				{
+				SSLerr(SSL_F_SSL3_SEND_SERVER_KEY_EXCHANGE, ERR_R_INTERNAL_ERROR);
+				goto err;
+				}
+
+			pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_X25519, NULL);
+			if (pctx == NULL || EVP_PKEY_keygen_init(pctx) <= 0 ||
+			    EVP_PKEY_keygen(pctx, &s->s3->tmp.pkey) <= 0)
+				{
+				EVP_PKEY_CTX_free(pctx);
+				SSLerr(SSL_F_SSL3_SEND_SERVER_KEY_EXCHANGE,ERR_R_EVP_LIB);
+				goto err;
+				}
+			EVP_PKEY_CTX_free(pctx);
+
+			encodedlen = EVP_PKEY_get1_tls_encodedpoint(s->s3->tmp.pkey,
+							&encodedPoint);
+			if (encodedlen == 0)
+				{
+				SSLerr(SSL_F_SSL3_SEND_SERVER_KEY_EXCHANGE,ERR_R_EVP_LIB);
+				goto err;
+				}
+			curve_id = tls1_ec_nid2curve_id(NID_X25519);
+
+			/* ServerECDHParams as for a named curve */
+			n = 4 + encodedlen;
+
+			r[0]=NULL;
+			r[1]=NULL;
+			r[2]=NULL;
+			r[3]=NULL;
+			}
+		else if (type & SSL_kECDHE)
 			{
 			const EC_GROUP *group;
 
@@ -1835,7 +1883,7 @@ int ssl3_send_server_key_exchange(SSL *s)
 			    (EC_KEY_get0_private_key(ecdh) == NULL) ||
 			    (s->options & SSL_OP_SINGLE_ECDH_USE))
 				{
-				if(!EC_KEY_generate_key(ecdh))
+				if(!ssl_generate_ecdh_key(s->ctx, ecdh))
 				    {
 				    SSLerr(SSL_F_SSL3_SEND_SERVER_KEY_EXCHANGE,ERR_R_ECDH_LIB);
 				    goto err;
@@ -2700,6 +2748,59 @@ int ssl3_get_client_key_exchange(SSL *s)
 #endif	/* OPENSSL_NO_KRB5 */
 
 #ifndef OPENSSL_NO_ECDH
+		if ((alg_k & SSL_kECDHE) && s->s3->tmp.pkey != NULL)
+		{
+		/* The client's X25519 share: a length byte and the
+		 * u-coordinate.
+		 */
+		EVP_PKEY *clnt_pkey = NULL;
+		EVP_PKEY_CTX *pctx = NULL;
+		size_t pmslen = 0;
+		int ok;
+
+		if (n < 1 || n != 1 + p[0])
+			{
+			al=SSL_AD_DECODE_ERROR;
+			SSLerr(SSL_F_SSL3_GET_CLIENT_KEY_EXCHANGE,SSL_R_LENGTH_MISMATCH);
+			goto f_err;
+			}
+		clnt_pkey = EVP_PKEY_new();
+		if (clnt_pkey == NULL ||
+		    !EVP_PKEY_set_type(clnt_pkey, EVP_PKEY_X25519) ||
+		    !EVP_PKEY_set1_tls_encodedpoint(clnt_pkey, p + 1, n - 1))
+			{
+			EVP_PKEY_free(clnt_pkey);
+			al=SSL_AD_DECODE_ERROR;
+			SSLerr(SSL_F_SSL3_GET_CLIENT_KEY_EXCHANGE,SSL_R_BAD_ECPOINT);
+			goto f_err;
+			}
+
+		/* The pre-master secret goes to the start of the buffer */
+		p=(unsigned char *)s->init_buf->data;
+		pctx = EVP_PKEY_CTX_new(s->s3->tmp.pkey, NULL);
+		ok = pctx != NULL && EVP_PKEY_derive_init(pctx) > 0 &&
+		     EVP_PKEY_derive_set_peer(pctx, clnt_pkey) > 0 &&
+		     EVP_PKEY_derive(pctx, NULL, &pmslen) > 0 &&
+		     EVP_PKEY_derive(pctx, p, &pmslen) > 0;
+		EVP_PKEY_CTX_free(pctx);
+		EVP_PKEY_free(clnt_pkey);
+		EVP_PKEY_free(s->s3->tmp.pkey);
+		s->s3->tmp.pkey = NULL;
+		if (!ok)
+			{
+			al=SSL_AD_HANDSHAKE_FAILURE;
+			SSLerr(SSL_F_SSL3_GET_CLIENT_KEY_EXCHANGE,ERR_R_EVP_LIB);
+			goto f_err;
+			}
+
+		/* Compute the master secret */
+		s->session->master_key_length = s->method->ssl3_enc-> \
+		    generate_master_secret(s, s->session->master_key, p, pmslen);
+
+		OPENSSL_cleanse(p, pmslen);
+		return 1;
+		}
+	else
 		if (alg_k & (SSL_kECDHE|SSL_kECDHr|SSL_kECDHe))
 		{
 		int ret = 1;
@@ -3337,6 +3438,7 @@ int ssl3_get_client_certificate(SSL *s)
 	const unsigned char *p,*q;
 	unsigned char *d;
 	STACK_OF(X509) *sk=NULL;
+	ASN1_BUFFER *buf=NULL;
 
 	n=s->method->ssl_get_message(s,
 		SSL3_ST_SR_CERT_A,
@@ -3388,6 +3490,24 @@ int ssl3_get_client_certificate(SSL *s)
 		SSLerr(SSL_F_SSL3_GET_CLIENT_CERTIFICATE,SSL_R_LENGTH_MISMATCH);
 		goto f_err;
 		}
+	/* Decode the certificates from a copy of the list they keep a
+	 * reference to, so that their contents need not be copied */
+	if (llen > 0)
+		{
+		if ((d=OPENSSL_malloc(llen)) == NULL)
+			{
+			SSLerr(SSL_F_SSL3_GET_CLIENT_CERTIFICATE,ERR_R_MALLOC_FAILURE);
+			goto err;
+			}
+		memcpy(d,p,llen);
+		if ((buf=ASN1_BUFFER_new(d,llen)) == NULL)
+			{
+			OPENSSL_free(d);
+			SSLerr(SSL_F_SSL3_GET_CLIENT_CERTIFICATE,ERR_R_MALLOC_FAILURE);
+			goto err;
+			}
+		p=d;
+		}
 	for (nc=0; nc<llen; )
 		{
 		n2l3(p,l);
@@ -3399,7 +3519,7 @@ int ssl3_get_client_certificate(SSL *s)
 			}
 
 		q=p;
-		x=d2i_X509(NULL,&p,l);
+		x=d2i_X509_buffer(NULL,&p,l,buf);
 		if (x == NULL)
 			{
 			SSLerr(SSL_F_SSL3_GET_CLIENT_CERTIFICATE,ERR_R_ASN1_LIB);
@@ -3504,6 +3624,7 @@ f_err:
 err:
 	if (x != NULL) X509_free(x);
 	if (sk != NULL) sk_X509_pop_free(sk,X509_free);
+	ASN1_BUFFER_free(buf);
 	return(ret);
 	}
 
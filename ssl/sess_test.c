@@ -0,0 +1,264 @@
+/* ssl/sess_test.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/* Tests for the internal session cache: the list of each shard must stay
+ * sorted by expiry time as sessions are added, change their timeout and
+ * are flushed with SSL_CTX_flush_sessions().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include "../ssl/ssl_locl.h"
+
+#define NUM_SESSIONS	1000
+#define BASE_TIME	1000000L
+
+static SSL_SESSION *sessions[NUM_SESSIONS];
+static unsigned long seed = 1;
+static int removed;
+
+/* Small generator, so that runs can be reproduced */
+static long next_random(long n)
+	{
+	seed = seed * 1103515245UL + 12345UL;
+	return (long)((seed >> 16) & 0x7fff) % n;
+	}
+
+static long expiry(const SSL_SESSION *s)
+	{
+	return s->time + s->timeout;
+	}
+
+static void remove_cb(SSL_CTX *ctx, SSL_SESSION *s)
+	{
+	removed++;
+	}
+
+/* Check the links and order of the list of each shard and that together
+ * they hold num sessions, none expiring before t.
+ */
+static int check_lists(const char *test, SSL_CTX *ctx, int num, long t)
+	{
+	SSL_SESS_SHARD *sh;
+	SSL_SESSION *s, *prev;
+	unsigned int i;
+	int n, total = 0;
+
+	for (i = 0; i < ctx->sess_shard_count; i++)
+		{
+		sh = &ctx->sess_shards[i];
+		prev = (SSL_SESSION *)&sh->session_cache_head;
+		n = 0;
+		for (s = sh->session_cache_head; s != NULL
+			&& s != (SSL_SESSION *)&sh->session_cache_tail;
+								s = s->next)
+			{
+			if (s->prev != prev || s->owner != ctx)
+				{
+				fprintf(stderr, "%s: shard %u: bad links\n",
+								test, i);
+				return 0;
+				}
+			if (prev != (SSL_SESSION *)&sh->session_cache_head
+				&& expiry(prev) < expiry(s))
+				{
+				fprintf(stderr, "%s: shard %u: %ld before "
+					"%ld\n", test, i, expiry(prev),
+								expiry(s));
+				return 0;
+				}
+			if (expiry(s) < t)
+				{
+				fprintf(stderr, "%s: shard %u: session "
+					"expiring at %ld not flushed\n",
+							test, i, expiry(s));
+				return 0;
+				}
+			prev = s;
+			n++;
+			}
+		if ((n == 0 && sh->session_cache_tail != NULL)
+			|| (n > 0 && sh->session_cache_tail != prev)
+			|| n != (int)lh_SSL_SESSION_num_items(sh->sessions))
+			{
+			fprintf(stderr, "%s: shard %u: bad tail or count\n",
+								test, i);
+			return 0;
+			}
+		total += n;
+		}
+	if (total != num || SSL_CTX_sess_number(ctx) != num)
+		{
+		fprintf(stderr, "%s: %d sessions cached, expected %d\n",
+							test, total, num);
+		return 0;
+		}
+	return 1;
+	}
+
+/* Number of our sessions expiring at or after t */
+static int count_valid(long t)
+	{
+	int i, n = 0;
+
+	for (i = 0; i < NUM_SESSIONS; i++)
+		if (expiry(sessions[i]) >= t)
+			n++;
+	return n;
+	}
+
+static int test_cache(unsigned int shards)
+	{
+	SSL_CTX *ctx;
+	char test[40];
+	long t;
+	int i, ok = 0;
+
+	ctx = SSL_CTX_new(SSLv23_server_method());
+	if (ctx == NULL || !SSL_CTX_set_session_cache_shards(ctx, shards))
+		goto err;
+	SSL_CTX_sess_set_remove_cb(ctx, remove_cb);
+
+	/* Mostly sessions with the same timeout, added as time goes by, and
+	 * some with other times and timeouts so that all of the list is
+	 * used for insertion.
+	 */
+	for (i = 0; i < NUM_SESSIONS; i++)
+		{
+		sessions[i] = SSL_SESSION_new();
+		if (sessions[i] == NULL)
+			goto err;
+		sessions[i]->ssl_version = TLS1_2_VERSION;
+		sessions[i]->session_id_length = 32;
+		memset(sessions[i]->session_id, 0, 32);
+		memcpy(sessions[i]->session_id, &i, sizeof(i));
+		sessions[i]->session_id[31] = (unsigned char)i;
+		SSL_SESSION_set_time(sessions[i], BASE_TIME + i / 10);
+		if (i % 4 == 3)
+			SSL_SESSION_set_timeout(sessions[i], next_random(600));
+		else if (i % 4 == 1)
+			SSL_SESSION_set_time(sessions[i],
+					BASE_TIME + next_random(200));
+		else
+			SSL_SESSION_set_timeout(sessions[i], 300);
+		if (!SSL_CTX_add_session(ctx, sessions[i]))
+			goto err;
+		}
+	BIO_snprintf(test, sizeof(test), "%u shards: add", shards);
+	if (!check_lists(test, ctx, NUM_SESSIONS, 0))
+		goto err;
+
+	/* Cached sessions move when their time or timeout change */
+	for (i = 0; i < NUM_SESSIONS; i += 7)
+		{
+		if (i % 2)
+			SSL_SESSION_set_timeout(sessions[i], next_random(900));
+		else
+			SSL_SESSION_set_time(sessions[i],
+					BASE_TIME + next_random(300));
+		}
+	BIO_snprintf(test, sizeof(test), "%u shards: requeue", shards);
+	if (!check_lists(test, ctx, NUM_SESSIONS, 0))
+		goto err;
+
+	/* Flushing removes exactly the sessions that have expired */
+	removed = 0;
+	for (t = BASE_TIME + 100; t <= BASE_TIME + 1200; t += 250)
+		{
+		SSL_CTX_flush_sessions(ctx, t);
+		BIO_snprintf(test, sizeof(test), "%u shards: flush %ld",
+							shards, t - BASE_TIME);
+		if (!check_lists(test, ctx, count_valid(t), t))
+			goto err;
+		if (removed != NUM_SESSIONS - count_valid(t))
+			{
+			fprintf(stderr, "%s: %d removed\n", test, removed);
+			goto err;
+			}
+		}
+	SSL_CTX_flush_sessions(ctx, 0);
+	if (!check_lists("flush all", ctx, 0, 0) || removed != NUM_SESSIONS)
+		goto err;
+	ok = 1;
+
+	err:
+	if (!ok)
+		ERR_print_errors_fp(stderr);
+	SSL_CTX_free(ctx);
+	for (i = 0; i < NUM_SESSIONS; i++)
+		{
+		SSL_SESSION_free(sessions[i]);
+		sessions[i] = NULL;
+		}
+	return ok;
+	}
+
+int main(int argc, char *argv[])
+	{
+	int ret = 1;
+
+	SSL_library_init();
+	SSL_load_error_strings();
+
+	if (test_cache(1) && test_cache(4))
+		ret = 0;
+
+	ERR_free_strings();
+	ERR_remove_thread_state(NULL);
+	EVP_cleanup();
+	CRYPTO_cleanup_all_ex_data();
+
+	if (ret == 0)
+		printf("PASS\n");
+	return ret;
+	}
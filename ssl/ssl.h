@@ -286,6 +286,7 @@ extern "C" {
 #define SSL_TXT_CAMELLIA128	"CAMELLIA128"
 #define SSL_TXT_CAMELLIA256	"CAMELLIA256"
 #define SSL_TXT_CAMELLIA	"CAMELLIA"
+#define SSL_TXT_CHACHA20	"CHACHA20"
 
 #define SSL_TXT_MD5		"MD5"
 #define SSL_TXT_SHA1		"SHA1"
@@ -535,7 +536,8 @@ struct ssl_session_st
 	CRYPTO_EX_DATA ex_data; /* application specific data */
 
 	/* These are used to make removal of session-ids more
-	 * efficient and to implement a maximum cache size. */
+	 * efficient and to implement a maximum cache size. The list
+	 * is kept sorted by expiry time, see SSL_CTX_flush_sessions(). */
 	struct ssl_session_st *prev,*next;
 #ifndef OPENSSL_NO_TLSEXT
 	char *tlsext_hostname;
@@ -553,6 +555,9 @@ struct ssl_session_st
 #ifndef OPENSSL_NO_SRP
 	char *srp_username;
 #endif
+	/* The SSL_CTX whose internal cache holds this session, only changed
+	 * with both its shard lock and CRYPTO_LOCK_SSL_SESSION held */
+	struct ssl_ctx_st *owner;
 	};
 
 #endif
@@ -659,8 +664,9 @@ struct ssl_session_st
 /* Don't attempt to automatically build certificate chain */
 #define SSL_MODE_NO_AUTO_CHAIN 0x00000008L
 /* Save RAM by releasing read and write buffers when they're empty. (SSL3 and
- * TLS only.)  "Released" buffers are put onto a free-list in the context
- * or just freed (depending on the context's setting for freelist_max_len). */
+ * TLS only.)  "Released" buffers are put into a cache of the calling thread,
+ * onto a free-list in the context or just freed (depending on the context's
+ * setting for freelist_max_len). */
 #define SSL_MODE_RELEASE_BUFFERS 0x00000010L
 /* Send the current time in the Random fields of the ClientHello and
  * ServerHello records for compatibility with hypothetical implementations
@@ -677,6 +683,10 @@ struct ssl_session_st
  * in draft-ietf-tls-downgrade-scsv-00.
  */
 #define SSL_MODE_SEND_FALLBACK_SCSV 0x00000080L
+/* Allocate record buffers only while a record is being read or written,
+ * sized to that record, and release them as soon as they are empty.
+ * (SSL3 and TLS only.) */
+#define SSL_MODE_SMALL_BUFFERS 0x00000100L
 
 /* Cert related flags */
 /* Many implementations ignore some aspects of the TLS standards such as
@@ -883,12 +893,19 @@ struct ssl_ctx_st
 	STACK_OF(SSL_CIPHER) *cipher_list_by_id;
 
 	struct x509_store_st /* X509_STORE */ *cert_store;
+	/* The lhash of the first cache shard, NULL if the cache is split
+	 * into more than one shard. */
 	LHASH_OF(SSL_SESSION) *sessions;
 	/* Most session-ids that will be cached, default is
 	 * SSL_SESSION_CACHE_MAX_SIZE_DEFAULT. 0 is unlimited. */
 	unsigned long session_cache_size;
+	/* No longer used: each shard of the cache has its own list */
 	struct ssl_session_st *session_cache_head;
 	struct ssl_session_st *session_cache_tail;
+	/* The internal session cache: each shard has its own lhash, LRU list,
+	 * lock and statistics, see SSL_CTX_set_session_cache_shards(3). */
+	struct ssl_sess_shard_st *sess_shards;
+	unsigned int sess_shard_count;
 
 	/* This can have one of 2 values, ored together,
 	 * SSL_SESS_CACHE_CLIENT,
@@ -1057,6 +1074,16 @@ struct ssl_ctx_st
 	unsigned int freelist_max_len;
 	struct ssl3_buf_freelist_st *wbuf_freelist;
 	struct ssl3_buf_freelist_st *rbuf_freelist;
+#endif
+	/* Number and total size of the record buffers held by connections
+	 * using this context */
+	long buffer_count;
+	long buffer_mem;
+#ifndef OPENSSL_NO_EC
+	/* Number of ephemeral ECDH keys and ECDSA signing values computed at
+	 * a time, see SSL_CTX_set_ec_precompute() */
+	int ec_precompute;
+	struct ssl_ecdh_queue_st *ecdh_queue;
 #endif
 #ifndef OPENSSL_NO_SRP
 	SRP_CTX srp_ctx; /* ctx for SRP authentication */
@@ -1135,6 +1162,9 @@ struct ssl_ctx_st
 #define SSL_SESS_CACHE_NO_INTERNAL \
 	(SSL_SESS_CACHE_NO_INTERNAL_LOOKUP|SSL_SESS_CACHE_NO_INTERNAL_STORE)
 
+/* Upper bound for SSL_CTX_set_session_cache_shards() */
+#define SSL_SESS_CACHE_MAX_SHARDS		256
+
 LHASH_OF(SSL_SESSION) *SSL_CTX_sessions(SSL_CTX *ctx);
 #define SSL_CTX_sess_number(ctx) \
 	SSL_CTX_ctrl(ctx,SSL_CTRL_SESS_NUMBER,0,NULL)
@@ -1537,6 +1567,9 @@ struct ssl_st
 	/* Callback for disabling session caching and ticket support
 	 * on a session basis, depending on the chosen cipher. */
 	int (*not_resumable_session_cb)(SSL *ssl, int is_forward_secure);
+
+	/* SSL_writev() gathers short buffers here into one record */
+	unsigned char *writev_buf;
 	};
 
 #endif
@@ -1828,6 +1861,12 @@ DECLARE_PEM_rw(SSL_SESSION, SSL_SESSION)
 #define SSL_CTRL_CHECK_PROTO_VERSION		119
 #define DTLS_CTRL_SET_LINK_MTU			120
 #define DTLS_CTRL_GET_LINK_MIN_MTU		121
+#define SSL_CTRL_SET_SESS_CACHE_SHARDS		122
+#define SSL_CTRL_GET_SESS_CACHE_SHARDS		123
+#define SSL_CTRL_GET_BUFFER_MEMORY		124
+#define SSL_CTRL_GET_BUFFER_COUNT		125
+#define SSL_CTRL_SET_EC_PRECOMPUTE		126
+#define SSL_CTRL_GET_EC_PRECOMPUTE		127
 
 
 #define SSL_CERT_SET_FIRST			1
@@ -2195,13 +2234,22 @@ char *SSL_get_srp_username(SSL *s);
 char *SSL_get_srp_userinfo(SSL *s);
 #endif
 
+/* One of the buffers written in sequence by SSL_writev() */
+typedef struct ssl_iovec_st
+	{
+	const void *base;
+	size_t len;
+	} SSL_IOVEC;
+
 void	SSL_certs_clear(SSL *s);
 void	SSL_free(SSL *ssl);
+void	SSL_free_thread_buffers(void);
 int 	SSL_accept(SSL *ssl);
 int 	SSL_connect(SSL *ssl);
 int 	SSL_read(SSL *ssl,void *buf,int num);
 int 	SSL_peek(SSL *ssl,void *buf,int num);
 int 	SSL_write(SSL *ssl,const void *buf,int num);
+int 	SSL_writev(SSL *ssl,const SSL_IOVEC *iov,int iovcnt);
 long	SSL_ctrl(SSL *ssl,int cmd, long larg, void *parg);
 long	SSL_callback_ctrl(SSL *, int, void (*)(void));
 long	SSL_CTX_ctrl(SSL_CTX *ctx,int cmd, long larg, void *parg);
@@ -2339,6 +2387,10 @@ int SSL_get_ex_data_X509_STORE_CTX_idx(void );
 	SSL_CTX_ctrl(ctx,SSL_CTRL_SET_SESS_CACHE_MODE,m,NULL)
 #define SSL_CTX_get_session_cache_mode(ctx) \
 	SSL_CTX_ctrl(ctx,SSL_CTRL_GET_SESS_CACHE_MODE,0,NULL)
+#define SSL_CTX_set_session_cache_shards(ctx,n) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_SET_SESS_CACHE_SHARDS,n,NULL)
+#define SSL_CTX_get_session_cache_shards(ctx) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_GET_SESS_CACHE_SHARDS,0,NULL)
 
 #define SSL_CTX_get_default_read_ahead(ctx) SSL_CTX_get_read_ahead(ctx)
 #define SSL_CTX_set_default_read_ahead(ctx,m) SSL_CTX_set_read_ahead(ctx,m)
@@ -2359,6 +2411,16 @@ int SSL_get_ex_data_X509_STORE_CTX_idx(void );
 	SSL_CTX_ctrl(ctx,SSL_CTRL_SET_MAX_SEND_FRAGMENT,m,NULL)
 #define SSL_set_max_send_fragment(ssl,m) \
 	SSL_ctrl(ssl,SSL_CTRL_SET_MAX_SEND_FRAGMENT,m,NULL)
+#define SSL_CTX_get_buffer_memory(ctx) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_GET_BUFFER_MEMORY,0,NULL)
+#define SSL_CTX_get_buffer_count(ctx) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_GET_BUFFER_COUNT,0,NULL)
+#define SSL_CTX_set_ec_precompute(ctx,n) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_SET_EC_PRECOMPUTE,n,NULL)
+#define SSL_CTX_get_ec_precompute(ctx) \
+	SSL_CTX_ctrl(ctx,SSL_CTRL_GET_EC_PRECOMPUTE,0,NULL)
+#define SSL_get_buffer_memory(ssl) \
+	SSL_ctrl(ssl,SSL_CTRL_GET_BUFFER_MEMORY,0,NULL)
 
      /* NB: the keylength is only applicable when is_export is true */
 #ifndef OPENSSL_NO_RSA
@@ -2571,6 +2633,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_F_SSL23_WRITE				 121
 #define SSL_F_SSL3_ACCEPT				 128
 #define SSL_F_SSL3_ADD_CERT_TO_BUF			 296
+#define SSL_F_SSL3_ALLOC_WRITE_BUFFER			 344
 #define SSL_F_SSL3_CALLBACK_CTRL			 233
 #define SSL_F_SSL3_CHANGE_CIPHER_STATE			 129
 #define SSL_F_SSL3_CHECK_CERT_AND_ALGORITHM		 130
@@ -2598,6 +2661,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_F_SSL3_GET_SERVER_CERTIFICATE		 144
 #define SSL_F_SSL3_GET_SERVER_DONE			 145
 #define SSL_F_SSL3_GET_SERVER_HELLO			 146
+#define SSL_F_SSL3_GROW_READ_BUFFER			 345
 #define SSL_F_SSL3_HANDSHAKE_MAC			 285
 #define SSL_F_SSL3_NEW_SESSION_TICKET			 287
 #define SSL_F_SSL3_OUTPUT_CERT_CHAIN			 147
@@ -2692,6 +2756,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_F_SSL_SESSION_NEW				 189
 #define SSL_F_SSL_SESSION_PRINT_FP			 190
 #define SSL_F_SSL_SESSION_SET1_ID_CONTEXT		 312
+#define SSL_F_SSL_SESS_CACHE_SET_SHARDS			 342
 #define SSL_F_SSL_SESS_CERT_NEW				 225
 #define SSL_F_SSL_SET_CERT				 191
 #define SSL_F_SSL_SET_CIPHER_LIST			 271
@@ -2721,6 +2786,7 @@ void ERR_load_SSL_strings(void);
 #define SSL_F_SSL_USE_RSAPRIVATEKEY_FILE		 206
 #define SSL_F_SSL_VERIFY_CERT_CHAIN			 207
 #define SSL_F_SSL_WRITE					 208
+#define SSL_F_SSL_WRITEV				 343
 #define SSL_F_TLS12_CHECK_PEER_SIGALG			 333
 #define SSL_F_TLS1_CERT_VERIFY_MAC			 286
 #define SSL_F_TLS1_CHANGE_CIPHER_STATE			 209
@@ -553,6 +553,7 @@ typedef struct ssl3_state_st
 
 #ifndef OPENSSL_NO_ECDH
 		EC_KEY *ecdh; /* holds short lived ECDH key */
+		EVP_PKEY *pkey; /* holds short lived X25519 key */
 #endif
 
 		/* used when SSL_ST_FLUSH_DATA is entered */
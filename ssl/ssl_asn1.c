@@ -148,11 +148,13 @@ int i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
 	 * This is a bit evil but makes things simple, no dynamic allocation
 	 * to clean up :-) */
 	a.version.length=LSIZE2;
+	a.version.flags=0;
 	a.version.type=V_ASN1_INTEGER;
 	a.version.data=ibuf1;
 	ASN1_INTEGER_set(&(a.version),SSL_SESSION_ASN1_VERSION);
 
 	a.ssl_version.length=LSIZE2;
+	a.ssl_version.flags=0;
 	a.ssl_version.type=V_ASN1_INTEGER;
 	a.ssl_version.data=ibuf2;
 	ASN1_INTEGER_set(&(a.ssl_version),in->ssl_version);
@@ -203,6 +205,7 @@ int i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
 	if (in->time != 0L)
 		{
 		a.time.length=LSIZE2;
+		a.time.flags=0;
 		a.time.type=V_ASN1_INTEGER;
 		a.time.data=ibuf3;
 		ASN1_INTEGER_set(&(a.time),in->time);
@@ -211,6 +214,7 @@ int i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
 	if (in->timeout != 0L)
 		{
 		a.timeout.length=LSIZE2;
+		a.timeout.flags=0;
 		a.timeout.type=V_ASN1_INTEGER;
 		a.timeout.data=ibuf4;
 		ASN1_INTEGER_set(&(a.timeout),in->timeout);
@@ -219,6 +223,7 @@ int i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
 	if (in->verify_result != X509_V_OK)
 		{
 		a.verify_result.length=LSIZE2;
+		a.verify_result.flags=0;
 		a.verify_result.type=V_ASN1_INTEGER;
 		a.verify_result.data=ibuf5;
 		ASN1_INTEGER_set(&a.verify_result,in->verify_result);
@@ -240,6 +245,7 @@ int i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
 	if (in->tlsext_tick_lifetime_hint > 0)
 		{
 		a.tlsext_tick_lifetime.length=LSIZE2;
+		a.tlsext_tick_lifetime.flags=0;
 		a.tlsext_tick_lifetime.type=V_ASN1_INTEGER;
 		a.tlsext_tick_lifetime.data=ibuf6;
 		ASN1_INTEGER_set(&a.tlsext_tick_lifetime,in->tlsext_tick_lifetime_hint);
@@ -718,6 +718,7 @@ void ssl_sess_cert_free(SESS_CERT *sc)
 #ifndef OPENSSL_NO_ECDH
 	if (sc->peer_ecdh_tmp != NULL)
 		EC_KEY_free(sc->peer_ecdh_tmp);
+	EVP_PKEY_free(sc->peer_pkey_tmp);
 #endif
 
 	OPENSSL_free(sc);
@@ -112,6 +112,7 @@ static ERR_STRING_DATA SSL_str_functs[]=
 {ERR_FUNC(SSL_F_SSL23_WRITE),	"ssl23_write"},
 {ERR_FUNC(SSL_F_SSL3_ACCEPT),	"ssl3_accept"},
 {ERR_FUNC(SSL_F_SSL3_ADD_CERT_TO_BUF),	"SSL3_ADD_CERT_TO_BUF"},
+{ERR_FUNC(SSL_F_SSL3_ALLOC_WRITE_BUFFER),	"ssl3_alloc_write_buffer"},
 {ERR_FUNC(SSL_F_SSL3_CALLBACK_CTRL),	"ssl3_callback_ctrl"},
 {ERR_FUNC(SSL_F_SSL3_CHANGE_CIPHER_STATE),	"ssl3_change_cipher_state"},
 {ERR_FUNC(SSL_F_SSL3_CHECK_CERT_AND_ALGORITHM),	"ssl3_check_cert_and_algorithm"},
@@ -139,6 +140,7 @@ static ERR_STRING_DATA SSL_str_functs[]=
 {ERR_FUNC(SSL_F_SSL3_GET_SERVER_CERTIFICATE),	"ssl3_get_server_certificate"},
 {ERR_FUNC(SSL_F_SSL3_GET_SERVER_DONE),	"ssl3_get_server_done"},
 {ERR_FUNC(SSL_F_SSL3_GET_SERVER_HELLO),	"ssl3_get_server_hello"},
+{ERR_FUNC(SSL_F_SSL3_GROW_READ_BUFFER),	"ssl3_grow_read_buffer"},
 {ERR_FUNC(SSL_F_SSL3_HANDSHAKE_MAC),	"ssl3_handshake_mac"},
 {ERR_FUNC(SSL_F_SSL3_NEW_SESSION_TICKET),	"SSL3_NEW_SESSION_TICKET"},
 {ERR_FUNC(SSL_F_SSL3_OUTPUT_CERT_CHAIN),	"ssl3_output_cert_chain"},
@@ -233,6 +235,7 @@ static ERR_STRING_DATA SSL_str_functs[]=
 {ERR_FUNC(SSL_F_SSL_SESSION_NEW),	"SSL_SESSION_new"},
 {ERR_FUNC(SSL_F_SSL_SESSION_PRINT_FP),	"SSL_SESSION_print_fp"},
 {ERR_FUNC(SSL_F_SSL_SESSION_SET1_ID_CONTEXT),	"SSL_SESSION_set1_id_context"},
+{ERR_FUNC(SSL_F_SSL_SESS_CACHE_SET_SHARDS),	"ssl_sess_cache_set_shards"},
 {ERR_FUNC(SSL_F_SSL_SESS_CERT_NEW),	"ssl_sess_cert_new"},
 {ERR_FUNC(SSL_F_SSL_SET_CERT),	"SSL_SET_CERT"},
 {ERR_FUNC(SSL_F_SSL_SET_CIPHER_LIST),	"SSL_set_cipher_list"},
@@ -262,6 +265,7 @@ static ERR_STRING_DATA SSL_str_functs[]=
 {ERR_FUNC(SSL_F_SSL_USE_RSAPRIVATEKEY_FILE),	"SSL_use_RSAPrivateKey_file"},
 {ERR_FUNC(SSL_F_SSL_VERIFY_CERT_CHAIN),	"ssl_verify_cert_chain"},
 {ERR_FUNC(SSL_F_SSL_WRITE),	"SSL_write"},
+{ERR_FUNC(SSL_F_SSL_WRITEV),	"SSL_writev"},
 {ERR_FUNC(SSL_F_TLS12_CHECK_PEER_SIGALG),	"tls12_check_peer_sigalg"},
 {ERR_FUNC(SSL_F_TLS1_CERT_VERIFY_MAC),	"tls1_cert_verify_mac"},
 {ERR_FUNC(SSL_F_TLS1_CHANGE_CIPHER_STATE),	"tls1_change_cipher_state"},
@@ -146,8 +146,10 @@
 #  include <assert.h>
 #endif
 #include <stdio.h>
+#include <limits.h>
 #include "ssl_locl.h"
 #include "kssl_lcl.h"
+#include "cryptlib.h"
 #include <openssl/objects.h>
 #include <openssl/lhash.h>
 #include <openssl/x509v3.h>
@@ -474,7 +476,7 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
 	 * find if there's a session in the hash table that would conflict with
 	 * any new session built out of this id/id_len and the ssl_version in
 	 * use by this SSL. */
-	SSL_SESSION r, *p;
+	SSL_SESSION r;
 
 	if(id_len > sizeof r.session_id)
 		return 0;
@@ -483,10 +485,7 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
 	r.session_id_length = id_len;
 	memcpy(r.session_id, id, id_len);
 
-	CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-	p = lh_SSL_SESSION_retrieve(ssl->ctx->sessions, &r);
-	CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
-	return (p != NULL);
+	return ssl_sess_cache_has_session(ssl->ctx, &r);
 	}
 
 int SSL_CTX_set_purpose(SSL_CTX *s, int purpose)
@@ -617,6 +616,7 @@ void SSL_free(SSL *s)
 	if (s->client_CA != NULL)
 		sk_X509_NAME_pop_free(s->client_CA,X509_NAME_free);
 
+	ssl3_release_writev_buffer(s);
 	if (s->method != NULL) s->method->ssl_free(s);
 
 	if (s->ctx) SSL_CTX_free(s->ctx);
@@ -1034,6 +1034,117 @@ int SSL_write(SSL *s,const void *buf,int num)
 	return(s->method->ssl_write(s,buf,num));
 	}
 
+int SSL_writev(SSL *s, const SSL_IOVEC *iov, int iovcnt)
+	{
+	const unsigned char *p;
+	unsigned int frag;
+	size_t off=0,left,len,n;
+	int i=0,j,ret,tot=0;
+
+	if (s->handshake_func == 0)
+		{
+		SSLerr(SSL_F_SSL_WRITEV, SSL_R_UNINITIALIZED);
+		return -1;
+		}
+
+	if (s->shutdown & SSL_SENT_SHUTDOWN)
+		{
+		s->rwstate=SSL_NOTHING;
+		SSLerr(SSL_F_SSL_WRITEV,SSL_R_PROTOCOL_IS_SHUTDOWN);
+		return(-1);
+		}
+
+	if (iovcnt < 0)
+		{
+		SSLerr(SSL_F_SSL_WRITEV,SSL_R_BAD_LENGTH);
+		return(-1);
+		}
+
+	/* How the data is cut into SSL_write() calls only depends on the
+	 * data not yet written, so a retry with the remaining buffers
+	 * repeats the call that did not complete. */
+	frag=s->max_send_fragment;
+	while (i < iovcnt && tot < INT_MAX)
+		{
+		left=iov[i].len-off;
+		if (left == 0)
+			{
+			i++;
+			off=0;
+			continue;
+			}
+
+		if (left >= frag)
+			{
+			/* Whole records straight from the caller's buffer, long
+			 * runs of them are sealed several at a time */
+			len=left-left%frag;
+			if (len > (size_t)(INT_MAX-tot))
+				len=(INT_MAX-tot)-(INT_MAX-tot)%frag;
+			if (len == 0)
+				break;
+			p=(const unsigned char *)iov[i].base+off;
+			}
+		else
+			{
+			/* Gather the short remainder and what follows into one
+			 * record */
+			if (ssl3_get_writev_buffer(s) == NULL)
+				{
+				SSLerr(SSL_F_SSL_WRITEV,ERR_R_MALLOC_FAILURE);
+				return tot ? tot : -1;
+				}
+			len=0;
+			for (j=i,n=off; j < iovcnt && len < frag; j++,n=0)
+				{
+				left=iov[j].len-n;
+				if (left > frag-len)
+					left=frag-len;
+				memcpy(s->writev_buf+len,
+					(const unsigned char *)iov[j].base+n,left);
+				len+=left;
+				}
+			if (len > (size_t)(INT_MAX-tot))
+				break;
+			p=s->writev_buf;
+			}
+
+		ret=SSL_write(s,p,(int)len);
+		if (ret <= 0)
+			{
+			/* The retry must pass the same data from the same
+			 * buffer, so writev_buf is kept. Unless some data was
+			 * written before, return the result of SSL_write()
+			 * for SSL_get_error(): the data written is otherwise
+			 * reported and the error occurs again on the retry. */
+			if (tot == 0)
+				return ret;
+			return tot;
+			}
+		tot+=ret;
+
+		/* Step over what was written */
+		for (n=ret; n > 0; )
+			{
+			left=iov[i].len-off;
+			if (n < left)
+				{
+				off+=n;
+				break;
+				}
+			n-=left;
+			i++;
+			off=0;
+			}
+
+		if ((size_t)ret < len)	/* partial write */
+			break;
+		}
+	if (s->mode & (SSL_MODE_RELEASE_BUFFERS|SSL_MODE_SMALL_BUFFERS))
+		ssl3_release_writev_buffer(s);
+	return tot;
+	}
+
 int SSL_shutdown(SSL *s)
 	{
 	/* Note that this function behaves differently from what one might
@@ -1136,6 +1247,18 @@ long SSL_ctrl(SSL *s,int cmd,long larg,void *parg)
 			}
 		else
 			return ssl_put_cipher_by_char(s,NULL,NULL);
+	case SSL_CTRL_GET_BUFFER_MEMORY:
+		l=0;
+		if (s->s3 != NULL)
+			{
+			if (s->s3->rbuf.buf != NULL)
+				l+=s->s3->rbuf.len;
+			if (s->s3->wbuf.buf != NULL)
+				l+=s->s3->wbuf.len;
+			}
+		if (s->writev_buf != NULL)
+			l+=SSL3_RT_MAX_PLAIN_LENGTH;
+		return(l);
 	default:
 		return(s->method->ssl_ctrl(s,cmd,larg,parg));
 		}
@@ -1162,6 +1285,7 @@ LHASH_OF(SSL_SESSION) *SSL_CTX_sessions(SSL_CTX *ctx)
 long SSL_CTX_ctrl(SSL_CTX *ctx,int cmd,long larg,void *parg)
 	{
 	long l;
+	SSL_SESS_CACHE_STATS st;
 	/* For some cases with ctx == NULL perform syntax checks */
 	if (ctx == NULL)
 		{
@@ -1211,9 +1335,32 @@ long SSL_CTX_ctrl(SSL_CTX *ctx,int cmd,long larg,void *parg)
 		return(l);
 	case SSL_CTRL_GET_SESS_CACHE_MODE:
 		return(ctx->session_cache_mode);
+	case SSL_CTRL_SET_SESS_CACHE_SHARDS:
+		if (larg <= 0)
+			return 0;
+		return(ssl_sess_cache_set_shards(ctx, (unsigned int)larg));
+	case SSL_CTRL_GET_SESS_CACHE_SHARDS:
+		return(ctx->sess_shard_count);
+	case SSL_CTRL_GET_BUFFER_MEMORY:
+		return(ctx->buffer_mem);
+	case SSL_CTRL_GET_BUFFER_COUNT:
+		return(ctx->buffer_count);
+#ifndef OPENSSL_NO_EC
+	case SSL_CTRL_SET_EC_PRECOMPUTE:
+		if (larg < 0 || larg > INT_MAX)
+			return 0;
+		ctx->ec_precompute = (int)larg;
+#if !defined(OPENSSL_NO_EC) && !defined(OPENSSL_NO_ECDSA)
+		if (ctx->cert != NULL)
+			ssl_cert_set_ec_precompute(ctx->cert, ctx->ec_precompute);
+#endif
+		return 1;
+	case SSL_CTRL_GET_EC_PRECOMPUTE:
+		return(ctx->ec_precompute);
+#endif
 
 	case SSL_CTRL_SESS_NUMBER:
-		return(lh_SSL_SESSION_num_items(ctx->sessions));
+		return(ssl_sess_cache_num_items(ctx));
 	case SSL_CTRL_SESS_CONNECT:
 		return(ctx->stats.sess_connect);
 	case SSL_CTRL_SESS_CONNECT_GOOD:
@@ -1227,15 +1374,20 @@ long SSL_CTX_ctrl(SSL_CTX *ctx,int cmd,long larg,void *parg)
 	case SSL_CTRL_SESS_ACCEPT_RENEGOTIATE:
 		return(ctx->stats.sess_accept_renegotiate);
 	case SSL_CTRL_SESS_HIT:
-		return(ctx->stats.sess_hit);
+		ssl_sess_cache_get_stats(ctx, &st);
+		return(ctx->stats.sess_hit + st.sess_hit);
 	case SSL_CTRL_SESS_CB_HIT:
-		return(ctx->stats.sess_cb_hit);
+		ssl_sess_cache_get_stats(ctx, &st);
+		return(ctx->stats.sess_cb_hit + st.sess_cb_hit);
 	case SSL_CTRL_SESS_MISSES:
-		return(ctx->stats.sess_miss);
+		ssl_sess_cache_get_stats(ctx, &st);
+		return(ctx->stats.sess_miss + st.sess_miss);
 	case SSL_CTRL_SESS_TIMEOUTS:
-		return(ctx->stats.sess_timeout);
+		ssl_sess_cache_get_stats(ctx, &st);
+		return(ctx->stats.sess_timeout + st.sess_timeout);
 	case SSL_CTRL_SESS_CACHE_FULL:
-		return(ctx->stats.sess_cache_full);
+		ssl_sess_cache_get_stats(ctx, &st);
+		return(ctx->stats.sess_cache_full + st.sess_cache_full);
 	case SSL_CTRL_OPTIONS:
 		return(ctx->options|=larg);
 	case SSL_CTRL_CLEAR_OPTIONS:
@@ -1840,39 +1992,6 @@ int SSL_export_keying_material(SSL *s, unsigned char *out, size_t olen,
 							   use_context);
 	}
 
-static unsigned long ssl_session_hash(const SSL_SESSION *a)
-	{
-	unsigned long l;
-
-	l=(unsigned long)
-		((unsigned int) a->session_id[0]     )|
-		((unsigned int) a->session_id[1]<< 8L)|
-		((unsigned long)a->session_id[2]<<16L)|
-		((unsigned long)a->session_id[3]<<24L);
-	return(l);
-	}
-
-/* NB: If this function (or indeed the hash function which uses a sort of
- * coarser function than this one) is changed, ensure
- * SSL_CTX_has_matching_session_id() is checked accordingly. It relies on being
- * able to construct an SSL_SESSION that will collide with any existing session
- * with a matching session ID. */
-static int ssl_session_cmp(const SSL_SESSION *a,const SSL_SESSION *b)
-	{
-	if (a->ssl_version != b->ssl_version)
-		return(1);
-	if (a->session_id_length != b->session_id_length)
-		return(1);
-	return(memcmp(a->session_id,b->session_id,a->session_id_length));
-	}
-
-/* These wrapper functions should remain rather than redeclaring
- * SSL_SESSION_hash and SSL_SESSION_cmp for void* types and casting each
- * variable. The reason is that the functions aren't static, they're exposed via
- * ssl.h. */
-static IMPLEMENT_LHASH_HASH_FN(ssl_session, SSL_SESSION)
-static IMPLEMENT_LHASH_COMP_FN(ssl_session, SSL_SESSION)
-
 SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 	{
 	SSL_CTX *ret=NULL;
@@ -1905,8 +2024,6 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 	ret->cert_store=NULL;
 	ret->session_cache_mode=SSL_SESS_CACHE_SERVER;
 	ret->session_cache_size=SSL_SESSION_CACHE_MAX_SIZE_DEFAULT;
-	ret->session_cache_head=NULL;
-	ret->session_cache_tail=NULL;
 
 	/* We take the system default */
 	ret->session_timeout=meth->get_timeout();
@@ -1950,8 +2067,7 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 	ret->app_gen_cookie_cb=0;
 	ret->app_verify_cookie_cb=0;
 
-	ret->sessions=lh_SSL_SESSION_new();
-	if (ret->sessions == NULL) goto err;
+	if (!ssl_sess_cache_set_shards(ret, 1)) goto err;
 	ret->cert_store=X509_STORE_new();
 	if (ret->cert_store == NULL) goto err;
 
@@ -2022,18 +2138,14 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 	ret->rbuf_freelist = OPENSSL_malloc(sizeof(SSL3_BUF_FREELIST));
 	if (!ret->rbuf_freelist)
 		goto err;
-	ret->rbuf_freelist->chunklen = 0;
-	ret->rbuf_freelist->len = 0;
-	ret->rbuf_freelist->head = NULL;
+	memset(ret->rbuf_freelist, 0, sizeof(SSL3_BUF_FREELIST));
 	ret->wbuf_freelist = OPENSSL_malloc(sizeof(SSL3_BUF_FREELIST));
 	if (!ret->wbuf_freelist)
 		{
 		OPENSSL_free(ret->rbuf_freelist);
 		goto err;
 		}
-	ret->wbuf_freelist->chunklen = 0;
-	ret->wbuf_freelist->len = 0;
-	ret->wbuf_freelist->head = NULL;
+	memset(ret->wbuf_freelist, 0, sizeof(SSL3_BUF_FREELIST));
 #endif
 #ifndef OPENSSL_NO_ENGINE
 	ret->client_cert_engine = NULL;
@@ -2077,11 +2189,20 @@ static void SSL_COMP_free(SSL_COMP *comp)
 static void
 ssl_buf_freelist_free(SSL3_BUF_FREELIST *list)
 	{
-	SSL3_BUF_FREELIST_ENTRY *ent, *next;
-	for (ent = list->head; ent; ent = next)
+	SSL3_BUF_SLOTS *slots;
+	unsigned int j;
+	int i;
+
+	for (i = 0; i < SSL3_BUF_CLASSES; i++)
 		{
-		next = ent->next;
-		OPENSSL_free(ent);
+		if ((slots = list->slots[i]) == NULL)
+			continue;
+		for (j = 0; j < slots->max; j++)
+			{
+			if (slots->buf[j] != NULL)
+				OPENSSL_free(slots->buf[j]);
+			}
+		OPENSSL_free(slots);
 		}
 	OPENSSL_free(list);
 	}
@@ -2118,13 +2239,11 @@ void SSL_CTX_free(SSL_CTX *a)
 	 * free ex_data, then finally free the cache.
 	 * (See ticket [openssl.org #212].)
 	 */
-	if (a->sessions != NULL)
-		SSL_CTX_flush_sessions(a,0);
+	SSL_CTX_flush_sessions(a,0);
 
 	CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL_CTX, a, &a->ex_data);
 
-	if (a->sessions != NULL)
-		lh_SSL_SESSION_free(a->sessions);
+	ssl_sess_cache_free(a);
 
 	if (a->cert_store != NULL)
 		X509_STORE_free(a->cert_store);
@@ -2166,6 +2285,9 @@ void SSL_CTX_free(SSL_CTX *a)
 	if (a->rbuf_freelist)
 		ssl_buf_freelist_free(a->rbuf_freelist);
 #endif
+#ifndef OPENSSL_NO_ECDH
+	ssl_ecdh_queue_free(a);
+#endif
 #ifndef OPENSSL_NO_TLSEXT
 # ifndef OPENSSL_NO_EC
 	if (a->tlsext_ecpointformatlist)
@@ -3188,7 +3310,10 @@ SSL_CTX *SSL_set_SSL_CTX(SSL *ssl, SSL_CTX* ctx)
 		}
 	CRYPTO_add(&ctx->references,1,CRYPTO_LOCK_SSL_CTX);
 	if (ssl->ctx != NULL)
+		{
+		ssl3_move_buffers(ssl, ctx);
 		SSL_CTX_free(ssl->ctx); /* decrement reference count */
+		}
 	ssl->ctx = ctx;
 	return(ssl->ctx);
 	}
@@ -3352,6 +3477,24 @@ void SSL_set_tmp_dh_callback(SSL *ssl,DH *(*dh)(SSL *ssl,int is_export,
 	}
 #endif
 
+#if !defined(OPENSSL_NO_EC) && !defined(OPENSSL_NO_ECDSA)
+/* Gives the ECDSA keys of c a queue of n signing values, or removes it if
+ * n is 0. Done when the key or the setting changes rather than on each
+ * handshake, as the key is shared by all connections. */
+void ssl_cert_set_ec_precompute(CERT *c, int n)
+	{
+	EVP_PKEY *pkey;
+	int i;
+
+	for (i = 0; i < SSL_PKEY_NUM; i++)
+		{
+		pkey = c->pkeys[i].privatekey;
+		if (pkey != NULL && pkey->type == EVP_PKEY_EC)
+			ECDSA_set_precompute(pkey->pkey.ec, n);
+		}
+	}
+#endif
+
 #ifndef OPENSSL_NO_ECDH
 void SSL_CTX_set_tmp_ecdh_callback(SSL_CTX *ctx,EC_KEY *(*ecdh)(SSL *ssl,int is_export,
                                                                 int keylength))
@@ -3364,6 +3507,209 @@ void SSL_set_tmp_ecdh_callback(SSL *ssl,EC_KEY *(*ecdh)(SSL *ssl,int is_export,
 	{
 	SSL_callback_ctrl(ssl,SSL_CTRL_SET_TMP_ECDH_CB,(void (*)(void))ecdh);
 	}
+
+/* The queues of ctx are created once per curve and kept until ctx is
+ * freed. With compare-and-swap a key is taken from or put into a slot of
+ * its queue without a lock, otherwise CRYPTO_LOCK_SSL_CTX is held. The
+ * first key taken after a fork() empties the queue instead, as parent and
+ * child must not use the same keys.
+ */
+#if defined(CRYPTO_ATOMIC_CAS) && defined(CRYPTO_ATOMIC_LOAD_PTR)
+# define ECDH_QUEUE_LOCKFREE
+#endif
+
+static SSL_ECDH_QUEUE *ssl_ecdh_queue_find(SSL_CTX *ctx, int nid, int n,
+							int generation)
+	{
+	SSL_ECDH_QUEUE *q;
+
+#ifdef ECDH_QUEUE_LOCKFREE
+	for (q = CRYPTO_ATOMIC_LOAD_PTR(&ctx->ecdh_queue); q != NULL;
+							q = q->next)
+		if (q->nid == nid)
+			return q;
+#endif
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
+	for (q = ctx->ecdh_queue; q != NULL; q = q->next)
+		if (q->nid == nid)
+			break;
+	if (q == NULL &&
+	    (q = OPENSSL_malloc(sizeof(SSL_ECDH_QUEUE))) != NULL)
+		{
+		q->keys = OPENSSL_malloc(n * sizeof(EC_KEY *));
+		if (q->keys == NULL)
+			{
+			OPENSSL_free(q);
+			q = NULL;
+			}
+		else
+			{
+			memset(q->keys, 0, n * sizeof(EC_KEY *));
+			q->nid = nid;
+			q->max = n;
+			q->generation = generation;
+			q->next = ctx->ecdh_queue;
+#ifdef ECDH_QUEUE_LOCKFREE
+			CRYPTO_ATOMIC_STORE_PTR(&ctx->ecdh_queue, q);
+#else
+			ctx->ecdh_queue = q;
+#endif
+			}
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+	return q;
+	}
+
+static EC_KEY *ssl_ecdh_queue_pop(SSL_ECDH_QUEUE *q, int generation)
+	{
+	EC_KEY *key = NULL;
+	int i, old;
+
+#ifdef ECDH_QUEUE_LOCKFREE
+	if ((old = CRYPTO_ATOMIC_LOAD_INT(&q->generation)) != generation)
+		{
+		/* Only the child's own keys are pushed from now on, so the
+		 * generation is updated once the parent's are gone */
+		for (i = 0; i < q->max; i++)
+			{
+			key = CRYPTO_ATOMIC_LOAD_PTR(&q->keys[i]);
+			if (key != NULL &&
+			    CRYPTO_ATOMIC_CAS(&q->keys[i], key, NULL))
+				EC_KEY_free(key);
+			}
+		CRYPTO_ATOMIC_CAS(&q->generation, old, generation);
+		return NULL;
+		}
+	for (i = 0; i < q->max; i++)
+		{
+		key = CRYPTO_ATOMIC_LOAD_PTR(&q->keys[i]);
+		if (key != NULL && CRYPTO_ATOMIC_CAS(&q->keys[i], key, NULL))
+			return key;
+		}
+	return NULL;
+#else
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
+	if ((old = q->generation) != generation)
+		{
+		for (i = 0; i < q->max; i++)
+			{
+			if (q->keys[i] != NULL)
+				EC_KEY_free(q->keys[i]);
+			q->keys[i] = NULL;
+			}
+		q->generation = generation;
+		}
+	for (i = 0; i < q->max && key == NULL; i++)
+		{
+		key = q->keys[i];
+		q->keys[i] = NULL;
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+	return key;
+#endif
+	}
+
+/* Puts key into an empty slot of q, returns 0 if there is none */
+static int ssl_ecdh_queue_push(SSL_ECDH_QUEUE *q, EC_KEY *key)
+	{
+	int i, ok = 0;
+
+#ifdef ECDH_QUEUE_LOCKFREE
+	for (i = 0; i < q->max && !ok; i++)
+		ok = CRYPTO_ATOMIC_CAS(&q->keys[i], NULL, key);
+#else
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
+	for (i = 0; i < q->max && !ok; i++)
+		{
+		if (q->keys[i] == NULL)
+			{
+			q->keys[i] = key;
+			ok = 1;
+			}
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+#endif
+	return ok;
+	}
+
+/* Generates a new key for ecdh, taking it from the queue of keys of its
+ * curve in ctx if ctx->ec_precompute is set. An empty queue is refilled
+ * with EC_KEY_generate_key_batch(): keys that no longer fit because
+ * another thread got there first are freed.
+ */
+int ssl_generate_ecdh_key(SSL_CTX *ctx, EC_KEY *ecdh)
+	{
+	SSL_ECDH_QUEUE *q;
+	const EC_GROUP *group = EC_KEY_get0_group(ecdh);
+	EC_KEY *key = NULL, **keys = NULL;
+	int i, nid, n = ctx->ec_precompute, ok = 0, generation;
+
+	if (n <= 0 || group == NULL ||
+	    (nid = EC_GROUP_get_curve_name(group)) == NID_undef)
+		return EC_KEY_generate_key(ecdh);
+
+	ERR_set_mark();
+	generation = CRYPTO_fork_generation();
+	if ((q = ssl_ecdh_queue_find(ctx, nid, n, generation)) != NULL)
+		key = ssl_ecdh_queue_pop(q, generation);
+
+	if (key == NULL)
+		{
+		keys = OPENSSL_malloc(n * sizeof(EC_KEY *));
+		if (keys == NULL)
+			goto err;
+		memset(keys, 0, n * sizeof(EC_KEY *));
+		for (i = 0; i < n; i++)
+			if ((keys[i] = EC_KEY_new_by_curve_name(nid)) == NULL)
+				goto err;
+		if (!EC_KEY_generate_key_batch(keys, n))
+			goto err;
+		key = keys[0];
+		keys[0] = NULL;
+
+		for (i = 1; q != NULL && i < n; i++)
+			{
+			if (!ssl_ecdh_queue_push(q, keys[i]))
+				break;
+			keys[i] = NULL;
+			}
+		}
+
+	ok = EC_KEY_set_private_key(ecdh, EC_KEY_get0_private_key(key)) &&
+		EC_KEY_set_public_key(ecdh, EC_KEY_get0_public_key(key));
+
+err:
+	if (keys != NULL)
+		{
+		for (i = 0; i < n; i++)
+			if (keys[i] != NULL)
+				EC_KEY_free(keys[i]);
+		OPENSSL_free(keys);
+		}
+	if (key != NULL)
+		EC_KEY_free(key);
+	ERR_pop_to_mark();
+	if (!ok)
+		return EC_KEY_generate_key(ecdh);
+	return 1;
+	}
+
+void ssl_ecdh_queue_free(SSL_CTX *ctx)
+	{
+	SSL_ECDH_QUEUE *q, *next;
+	int i;
+
+	for (q = ctx->ecdh_queue; q != NULL; q = next)
+		{
+		next = q->next;
+		for (i = 0; i < q->max; i++)
+			if (q->keys[i] != NULL)
+				EC_KEY_free(q->keys[i]);
+		OPENSSL_free(q->keys);
+		OPENSSL_free(q);
+		}
+	ctx->ecdh_queue = NULL;
+	}
 #endif
 
 #ifndef OPENSSL_NO_PSK
@@ -331,6 +331,7 @@
 #define SSL_SEED		0x00000800L
 #define SSL_AES128GCM		0x00001000L
 #define SSL_AES256GCM		0x00002000L
+#define SSL_CHACHA20POLY1305	0x00004000L
 
 #define SSL_AES        		(SSL_AES128|SSL_AES256|SSL_AES128GCM|SSL_AES256GCM)
 #define SSL_CAMELLIA		(SSL_CAMELLIA128|SSL_CAMELLIA256)
@@ -462,6 +463,10 @@
 		((SSL_IS_DTLS(s) && s->client_version <= DTLS1_2_VERSION) || \
 		(!SSL_IS_DTLS(s) && s->client_version >= TLS1_2_VERSION))
 
+/* Allocate record buffers for each record, see SSL_MODE_SMALL_BUFFERS */
+#define SSL_USE_SMALL_BUFFERS(s) \
+		(((s)->mode & SSL_MODE_SMALL_BUFFERS) && !SSL_IS_DTLS(s))
+
 #ifdef TLSEXT_TYPE_encrypt_then_mac
 #define SSL_USE_ETM(s) (s->s3->flags & TLS1_FLAGS_ENCRYPT_THEN_MAC)
 #else
@@ -690,10 +695,36 @@ typedef struct sess_cert_st
 #endif
 #ifndef OPENSSL_NO_ECDH
 	EC_KEY *peer_ecdh_tmp;
+	EVP_PKEY *peer_pkey_tmp; /* X25519 */
 #endif
 
 	int references; /* actually always 1 at the moment */
 	} SESS_CERT;
+
+/* Statistics kept per session cache shard, SSL_CTX_ctrl() adds them up
+ * together with the corresponding SSL_CTX stats fields. */
+typedef struct ssl_sess_cache_stats_st
+	{
+	int sess_miss;
+	int sess_timeout;
+	int sess_cache_full;
+	int sess_hit;
+	int sess_cb_hit;
+	} SSL_SESS_CACHE_STATS;
+
+/* One partition of the internal session cache. Sessions are assigned to a
+ * shard by their session ID, and everything in a shard (lhash, LRU list,
+ * statistics) is protected by the shard's lock. */
+typedef struct ssl_sess_shard_st
+	{
+	SSL_CTX *ctx;
+	LHASH_OF(SSL_SESSION) *sessions;
+	/* Sessions ordered by expiry time, the one expiring last at the head */
+	SSL_SESSION *session_cache_head;
+	SSL_SESSION *session_cache_tail;
+	int lock;
+	SSL_SESS_CACHE_STATS stats;
+	} SSL_SESS_SHARD;
 /* Structure containing decoded values of signature algorithms extension */
 struct tls_sigalgs_st
 	{
@@ -788,11 +819,24 @@ typedef struct ssl3_comp_st
 #endif
 
 #ifndef OPENSSL_NO_BUF_FREELISTS
+/* Unused record buffers are kept in size classes of SSL3_BUF_CLASS_SIZE
+ * bytes; class i holds buffers of (i+1)*SSL3_BUF_CLASS_SIZE bytes. Larger
+ * buffers, such as those for multi-block writes, are not kept. */
+#define SSL3_BUF_CLASS_SIZE	1024
+#define SSL3_BUF_CLASSES	64
+
+/* The free-lists of a context keep the buffers of each class in slots,
+ * allocated when the class is first used with as many entries as
+ * freelist_max_len had then. */
+typedef struct ssl3_buf_slots_st
+	{
+	unsigned int max;
+	void *buf[1];	/* max entries */
+	} SSL3_BUF_SLOTS;
+
 typedef struct ssl3_buf_freelist_st
 	{
-	size_t chunklen;
-	unsigned int len;
-	struct ssl3_buf_freelist_entry_st *head;
+	SSL3_BUF_SLOTS *slots[SSL3_BUF_CLASSES];
 	} SSL3_BUF_FREELIST;
 
 typedef struct ssl3_buf_freelist_entry_st
@@ -801,6 +845,21 @@ typedef struct ssl3_buf_freelist_entry_st
 	} SSL3_BUF_FREELIST_ENTRY;
 #endif
 
+#ifndef OPENSSL_NO_ECDH
+/* Ephemeral ECDH keys of one curve generated in advance, see
+ * SSL_CTX_set_ec_precompute(). Each of the max slots holds a key or NULL,
+ * and is updated with compare-and-swap where available. The keys were
+ * generated in the process with CRYPTO_fork_generation() generation. */
+typedef struct ssl_ecdh_queue_st
+	{
+	int nid;
+	int max;
+	int generation;
+	EC_KEY **keys;
+	struct ssl_ecdh_queue_st *next;
+	} SSL_ECDH_QUEUE;
+#endif
+
 extern SSL3_ENC_METHOD ssl3_undef_enc_method;
 OPENSSL_EXTERN const SSL_CIPHER ssl3_ciphers[];
 
@@ -987,6 +1046,18 @@ void ssl_sess_cert_free(SESS_CERT *sc);
 int ssl_set_peer_cert_type(SESS_CERT *c, int type);
 int ssl_get_new_session(SSL *s, int session);
 int ssl_get_prev_session(SSL *s, unsigned char *session,int len, const unsigned char *limit);
+int ssl_sess_cache_set_shards(SSL_CTX *ctx, unsigned int num);
+void ssl_sess_cache_free(SSL_CTX *ctx);
+int ssl_sess_cache_has_session(SSL_CTX *ctx, SSL_SESSION *key);
+unsigned long ssl_sess_cache_num_items(SSL_CTX *ctx);
+void ssl_sess_cache_get_stats(SSL_CTX *ctx, SSL_SESS_CACHE_STATS *st);
+#ifndef OPENSSL_NO_ECDH
+int ssl_generate_ecdh_key(SSL_CTX *ctx, EC_KEY *ecdh);
+void ssl_ecdh_queue_free(SSL_CTX *ctx);
+#endif
+#if !defined(OPENSSL_NO_EC) && !defined(OPENSSL_NO_ECDSA)
+void ssl_cert_set_ec_precompute(CERT *c, int n);
+#endif
 int ssl_cipher_id_cmp(const SSL_CIPHER *a,const SSL_CIPHER *b);
 DECLARE_OBJ_BSEARCH_GLOBAL_CMP_FN(SSL_CIPHER, SSL_CIPHER,
 				  ssl_cipher_id);
@@ -1076,8 +1147,14 @@ SSL_CIPHER *ssl3_choose_cipher(SSL *ssl,STACK_OF(SSL_CIPHER) *clnt,
 int	ssl3_setup_buffers(SSL *s);
 int	ssl3_setup_read_buffer(SSL *s);
 int	ssl3_setup_write_buffer(SSL *s);
+int	ssl3_grow_read_buffer(SSL *s, size_t len);
+int	ssl3_alloc_write_buffer(SSL *s, size_t len);
+int	ssl3_fit_write_buffer(SSL *s, unsigned int len);
 int	ssl3_release_read_buffer(SSL *s);
 int	ssl3_release_write_buffer(SSL *s);
+void	ssl3_move_buffers(SSL *s, SSL_CTX *ctx);
+unsigned char *ssl3_get_writev_buffer(SSL *s);
+void	ssl3_release_writev_buffer(SSL *s);
 int	ssl3_digest_cached_records(SSL *s);
 int	ssl3_new(SSL *s);
 void	ssl3_free(SSL *s);
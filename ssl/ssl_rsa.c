@@ -656,7 +656,13 @@ int SSL_CTX_use_PrivateKey(SSL_CTX *ctx, EVP_PKEY *pkey)
 		SSLerr(SSL_F_SSL_CTX_USE_PRIVATEKEY,ERR_R_MALLOC_FAILURE);
 		return(0);
 		}
-	return(ssl_set_pkey(ctx->cert,pkey));
+	if (!ssl_set_pkey(ctx->cert,pkey))
+		return(0);
+#if !defined(OPENSSL_NO_EC) && !defined(OPENSSL_NO_ECDSA)
+	if (ctx->ec_precompute > 0)
+		ssl_cert_set_ec_precompute(ctx->cert, ctx->ec_precompute);
+#endif
+	return(1);
 	}
 
 #ifndef OPENSSL_NO_STDIO
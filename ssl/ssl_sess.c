@@ -143,10 +143,192 @@
 #endif
 #include "ssl_locl.h"
 
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s);
-static void SSL_SESSION_list_add(SSL_CTX *ctx,SSL_SESSION *s);
+static void SSL_SESSION_list_remove(SSL_SESS_SHARD *sh, SSL_SESSION *s);
+static void SSL_SESSION_list_add(SSL_SESS_SHARD *sh, SSL_SESSION *s);
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck);
 
+static long ssl_session_expiry(const SSL_SESSION *s)
+	{
+	return s->time + s->timeout;
+	}
+
+static unsigned long ssl_session_hash(const SSL_SESSION *a)
+	{
+	unsigned long l;
+
+	l=(unsigned long)
+		((unsigned int) a->session_id[0]     )|
+		((unsigned int) a->session_id[1]<< 8L)|
+		((unsigned long)a->session_id[2]<<16L)|
+		((unsigned long)a->session_id[3]<<24L);
+	return(l);
+	}
+
+/* NB: If this function (or indeed the hash function which uses a sort of
+ * coarser function than this one) is changed, ensure
+ * SSL_CTX_has_matching_session_id() is checked accordingly. It relies on being
+ * able to construct an SSL_SESSION that will collide with any existing session
+ * with a matching session ID. */
+static int ssl_session_cmp(const SSL_SESSION *a,const SSL_SESSION *b)
+	{
+	if (a->ssl_version != b->ssl_version)
+		return(1);
+	if (a->session_id_length != b->session_id_length)
+		return(1);
+	return(memcmp(a->session_id,b->session_id,a->session_id_length));
+	}
+
+/* These wrapper functions should remain rather than redeclaring
+ * SSL_SESSION_hash and SSL_SESSION_cmp for void* types and casting each
+ * variable. The reason is that the functions aren't static, they're exposed via
+ * ssl.h. */
+static IMPLEMENT_LHASH_HASH_FN(ssl_session, SSL_SESSION)
+static IMPLEMENT_LHASH_COMP_FN(ssl_session, SSL_SESSION)
+
+/* Select the cache shard responsible for a session ID. The lhash inside each
+ * shard hashes the leading bytes of the ID, so the shard is chosen from the
+ * trailing byte to keep both distributions independent of each other. */
+static SSL_SESS_SHARD *ssl_sess_shard_by_id(SSL_CTX *ctx,
+	const unsigned char *id, unsigned int len)
+	{
+	unsigned int i = 0;
+
+	if (ctx->sess_shard_count > 1 && len > 0)
+		i = id[len - 1] & (ctx->sess_shard_count - 1);
+	return &ctx->sess_shards[i];
+	}
+
+static SSL_SESS_SHARD *ssl_sess_shard(SSL_CTX *ctx, const SSL_SESSION *s)
+	{
+	return ssl_sess_shard_by_id(ctx, s->session_id, s->session_id_length);
+	}
+
+/* (Re)build the internal session cache with |num| shards, |num| must be a
+ * power of two no larger than SSL_SESS_CACHE_MAX_SHARDS. Sessions already
+ * cached are moved over to their new shard. A single shard is protected by
+ * CRYPTO_LOCK_SSL_CTX, exactly like the traditional unsharded cache, so that
+ * applications walking SSL_CTX_sessions() keep working. This must not be
+ * called while other threads are using the SSL_CTX. */
+int ssl_sess_cache_set_shards(SSL_CTX *ctx, unsigned int num)
+	{
+	SSL_SESS_SHARD *sh, *old;
+	SSL_SESSION *s;
+	unsigned int i, old_num;
+
+	if (num == 0 || num > SSL_SESS_CACHE_MAX_SHARDS || (num & (num - 1)))
+		return 0;
+	sh = OPENSSL_malloc(num * sizeof(SSL_SESS_SHARD));
+	if (sh == NULL)
+		{
+		SSLerr(SSL_F_SSL_SESS_CACHE_SET_SHARDS, ERR_R_MALLOC_FAILURE);
+		return 0;
+		}
+	memset(sh, 0, num * sizeof(SSL_SESS_SHARD));
+	for (i = 0; i < num; i++)
+		{
+		if ((sh[i].sessions = lh_SSL_SESSION_new()) == NULL)
+			{
+			while (i-- > 0)
+				lh_SSL_SESSION_free(sh[i].sessions);
+			OPENSSL_free(sh);
+			SSLerr(SSL_F_SSL_SESS_CACHE_SET_SHARDS,
+				ERR_R_MALLOC_FAILURE);
+			return 0;
+			}
+		sh[i].ctx = ctx;
+		if (num == 1)
+			sh[i].lock = CRYPTO_LOCK_SSL_CTX;
+		else
+			sh[i].lock = CRYPTO_LOCK_SSL_SESS_SHARD +
+				(i % CRYPTO_SSL_SESS_SHARD_LOCKS);
+		}
+
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
+	old = ctx->sess_shards;
+	old_num = ctx->sess_shard_count;
+	ctx->sess_shards = sh;
+	ctx->sess_shard_count = num;
+	ctx->sessions = num == 1 ? sh[0].sessions : NULL;
+
+	for (i = 0; i < old_num; i++)
+		{
+		/* Move the sessions that expire first first, so that each of
+		 * them is inserted at the head of its new list. */
+		while ((s = old[i].session_cache_tail) != NULL)
+			{
+			SSL_SESS_SHARD *to = ssl_sess_shard(ctx, s);
+
+			SSL_SESSION_list_remove(&old[i], s);
+			(void)lh_SSL_SESSION_insert(to->sessions, s);
+			SSL_SESSION_list_add(to, s);
+			}
+		ctx->stats.sess_miss += old[i].stats.sess_miss;
+		ctx->stats.sess_timeout += old[i].stats.sess_timeout;
+		ctx->stats.sess_cache_full += old[i].stats.sess_cache_full;
+		ctx->stats.sess_hit += old[i].stats.sess_hit;
+		ctx->stats.sess_cb_hit += old[i].stats.sess_cb_hit;
+		lh_SSL_SESSION_free(old[i].sessions);
+		}
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+
+	if (old != NULL)
+		OPENSSL_free(old);
+	return 1;
+	}
+
+/* Frees the (already flushed) session cache of an SSL_CTX */
+void ssl_sess_cache_free(SSL_CTX *ctx)
+	{
+	unsigned int i;
+
+	if (ctx->sess_shards == NULL)
+		return;
+	for (i = 0; i < ctx->sess_shard_count; i++)
+		lh_SSL_SESSION_free(ctx->sess_shards[i].sessions);
+	OPENSSL_free(ctx->sess_shards);
+	ctx->sess_shards = NULL;
+	ctx->sess_shard_count = 0;
+	ctx->sessions = NULL;
+	}
+
+int ssl_sess_cache_has_session(SSL_CTX *ctx, SSL_SESSION *key)
+	{
+	SSL_SESS_SHARD *sh = ssl_sess_shard(ctx, key);
+	SSL_SESSION *p;
+
+	CRYPTO_r_lock(sh->lock);
+	p = lh_SSL_SESSION_retrieve(sh->sessions, key);
+	CRYPTO_r_unlock(sh->lock);
+	return (p != NULL);
+	}
+
+unsigned long ssl_sess_cache_num_items(SSL_CTX *ctx)
+	{
+	unsigned long n = 0;
+	unsigned int i;
+
+	for (i = 0; i < ctx->sess_shard_count; i++)
+		n += lh_SSL_SESSION_num_items(ctx->sess_shards[i].sessions);
+	return n;
+	}
+
+void ssl_sess_cache_get_stats(SSL_CTX *ctx, SSL_SESS_CACHE_STATS *st)
+	{
+	unsigned int i;
+
+	memset(st, 0, sizeof(*st));
+	for (i = 0; i < ctx->sess_shard_count; i++)
+		{
+		SSL_SESS_CACHE_STATS *p = &ctx->sess_shards[i].stats;
+
+		st->sess_miss += p->sess_miss;
+		st->sess_timeout += p->sess_timeout;
+		st->sess_cache_full += p->sess_cache_full;
+		st->sess_hit += p->sess_hit;
+		st->sess_cb_hit += p->sess_cb_hit;
+		}
+	}
+
 SSL_SESSION *SSL_get_session(const SSL *ssl)
 /* aka SSL_get0_session; gets 0 objects, just returns a copy of the pointer */
 	{
@@ -157,14 +339,14 @@ SSL_SESSION *SSL_get1_session(SSL *ssl)
 /* variant of SSL_get_session: caller really gets something */
 	{
 	SSL_SESSION *sess;
-	/* Need to lock this all up rather than just use CRYPTO_add so that
-	 * somebody doesn't free ssl->session between when we check it's
-	 * non-null and when we up the reference count. */
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
+	/* ssl->session is only replaced by calls on ssl itself, which must
+	 * not be made at the same time as this one, so only the reference
+	 * count needs updating atomically. It is not changed under
+	 * CRYPTO_LOCK_SSL_SESSION directly since CRYPTO_add() may not take
+	 * that lock. */
 	sess = ssl->session;
 	if(sess)
-		sess->references++;
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
+		CRYPTO_add(&sess->references,1,CRYPTO_LOCK_SSL_SESSION);
 	return(sess);
 	}
 
@@ -203,6 +385,7 @@ SSL_SESSION *SSL_SESSION_new(void)
 	ss->time=(unsigned long)time(NULL);
 	ss->prev=NULL;
 	ss->next=NULL;
+	ss->owner=NULL;
 	ss->compress_meth=0;
 #ifndef OPENSSL_NO_TLSEXT
 	ss->tlsext_hostname = NULL; 
@@ -450,6 +633,7 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 	/* This is used only by servers. */
 
 	SSL_SESSION *ret=NULL;
+	SSL_SESS_SHARD *sh;
 	int fatal = 0;
 	int try_session_cache = 1;
 #ifndef OPENSSL_NO_TLSEXT
@@ -462,6 +646,8 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 	if (len == 0)
 		try_session_cache = 0;
 
+	sh = ssl_sess_shard_by_id(s->session_ctx, session_id, len);
+
 #ifndef OPENSSL_NO_TLSEXT
 	r = tls1_process_ticket(s, session_id, len, limit, &ret); /* sets s->tlsext_ticket_expected */
 	switch (r)
@@ -491,16 +677,16 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 		if (len == 0)
 			return 0;
 		memcpy(data.session_id,session_id,len);
-		CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-		ret=lh_SSL_SESSION_retrieve(s->session_ctx->sessions,&data);
+		CRYPTO_r_lock(sh->lock);
+		ret=lh_SSL_SESSION_retrieve(sh->sessions,&data);
 		if (ret != NULL)
 			{
 			/* don't allow other threads to steal it: */
 			CRYPTO_add(&ret->references,1,CRYPTO_LOCK_SSL_SESSION);
 			}
-		CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
+		CRYPTO_r_unlock(sh->lock);
 		if (ret == NULL)
-			s->session_ctx->stats.sess_miss++;
+			sh->stats.sess_miss++;
 		}
 
 	if (try_session_cache &&
@@ -511,7 +697,7 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 	
 		if ((ret=s->session_ctx->get_session_cb(s,session_id,len,&copy)))
 			{
-			s->session_ctx->stats.sess_cb_hit++;
+			sh->stats.sess_cb_hit++;
 
 			/* Increment reference count now if the session callback
 			 * asks us to do so (note that if the session structures
@@ -578,7 +764,7 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 
 	if (ret->timeout < (long)(time(NULL) - ret->time)) /* timeout */
 		{
-		s->session_ctx->stats.sess_timeout++;
+		sh->stats.sess_timeout++;
 		if (try_session_cache)
 			{
 			/* session was from the cache, so remove it */
@@ -587,7 +773,7 @@ int ssl_get_prev_session(SSL *s, unsigned char *session_id, int len,
 		goto err;
 		}
 
-	s->session_ctx->stats.sess_hit++;
+	sh->stats.sess_hit++;
 
 	if (s->session != NULL)
 		SSL_SESSION_free(s->session);
@@ -618,6 +804,8 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 	{
 	int ret=0;
 	SSL_SESSION *s;
+	SSL_SESS_SHARD *sh = ssl_sess_shard(ctx, c);
+	unsigned long max;
 
 	/* add just 1 reference count for the SSL_CTX's session cache
 	 * even though it has two ways of access: each session is in a
@@ -625,16 +813,16 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 	CRYPTO_add(&c->references,1,CRYPTO_LOCK_SSL_SESSION);
 	/* if session c is in already in cache, we take back the increment later */
 
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	s=lh_SSL_SESSION_insert(ctx->sessions,c);
+	CRYPTO_w_lock(sh->lock);
+	s=lh_SSL_SESSION_insert(sh->sessions,c);
 	
 	/* s != NULL iff we already had a session with the given PID.
 	 * In this case, s == c should hold (then we did not really modify
-	 * ctx->sessions), or we're in trouble. */
+	 * sh->sessions), or we're in trouble. */
 	if (s != NULL && s != c)
 		{
 		/* We *are* in trouble ... */
-		SSL_SESSION_list_remove(ctx,s);
+		SSL_SESSION_list_remove(sh,s);
 		SSL_SESSION_free(s);
 		/* ... so pretend the other session did not exist in cache
 		 * (we cannot handle two SSL_SESSION structures with identical
@@ -646,7 +834,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 
  	/* Put at the head of the queue unless it is already in the cache */
 	if (s == NULL)
-		SSL_SESSION_list_add(ctx,c);
+		SSL_SESSION_list_add(sh,c);
 
 	if (s != NULL)
 		{
@@ -658,24 +846,27 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 		}
 	else
 		{
-		/* new cache entry -- remove old ones if cache has become too large */
+		/* new cache entry -- remove old ones if cache has become too large;
+		 * the size limit is split evenly between the shards */
 		
 		ret=1;
 
-		if (SSL_CTX_sess_get_cache_size(ctx) > 0)
+		max = SSL_CTX_sess_get_cache_size(ctx);
+		if (max > 0)
 			{
-			while (SSL_CTX_sess_number(ctx) >
-				SSL_CTX_sess_get_cache_size(ctx))
+			max = (max + ctx->sess_shard_count - 1) /
+				ctx->sess_shard_count;
+			while (lh_SSL_SESSION_num_items(sh->sessions) > max)
 				{
 				if (!remove_session_lock(ctx,
-					ctx->session_cache_tail, 0))
+					sh->session_cache_tail, 0))
 					break;
 				else
-					ctx->stats.sess_cache_full++;
+					sh->stats.sess_cache_full++;
 				}
 			}
 		}
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+	CRYPTO_w_unlock(sh->lock);
 	return(ret);
 	}
 
@@ -687,19 +878,21 @@ int SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck)
 	{
 	SSL_SESSION *r;
+	SSL_SESS_SHARD *sh;
 	int ret=0;
 
 	if ((c != NULL) && (c->session_id_length != 0))
 		{
-		if(lck) CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-		if ((r = lh_SSL_SESSION_retrieve(ctx->sessions,c)) == c)
+		sh = ssl_sess_shard(ctx, c);
+		if(lck) CRYPTO_w_lock(sh->lock);
+		if ((r = lh_SSL_SESSION_retrieve(sh->sessions,c)) == c)
 			{
 			ret=1;
-			r=lh_SSL_SESSION_delete(ctx->sessions,c);
-			SSL_SESSION_list_remove(ctx,c);
+			r=lh_SSL_SESSION_delete(sh->sessions,c);
+			SSL_SESSION_list_remove(sh,c);
 			}
 
-		if(lck) CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+		if(lck) CRYPTO_w_unlock(sh->lock);
 
 		if (ret)
 			{
@@ -831,10 +1024,61 @@ int SSL_set_session(SSL *s, SSL_SESSION *session)
 	return(ret);
 	}
 
+/* A session held in an internal cache has to be moved to its new position
+ * in the expiry ordered list when its time or timeout changes. */
+static SSL_CTX *ssl_session_owner(SSL_SESSION *s)
+	{
+	SSL_CTX *owner;
+
+	CRYPTO_r_lock(CRYPTO_LOCK_SSL_SESSION);
+	owner=s->owner;
+	CRYPTO_r_unlock(CRYPTO_LOCK_SSL_SESSION);
+	return owner;
+	}
+
+/* The time and timeout of a session outside any cache are changed under
+ * CRYPTO_LOCK_SSL_SESSION, which SSL_SESSION_list_add() takes to read them
+ * when it adds the session to a cache. Those of a cached session are changed
+ * under its shard lock. */
+static void ssl_session_requeue(SSL_SESSION *s, long time, long timeout)
+	{
+	SSL_CTX *owner;
+	SSL_SESS_SHARD *sh;
+
+	for (;;)
+		{
+		CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
+		owner=s->owner;
+		if (owner == NULL)
+			{
+			s->time=time;
+			s->timeout=timeout;
+			}
+		CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
+		if (owner == NULL)
+			return;
+
+		/* The shards of the owner are fixed while it is in use, but
+		 * the session may have left the cache before its shard is
+		 * locked, in which case start again */
+		sh = ssl_sess_shard(owner, s);
+		CRYPTO_w_lock(sh->lock);
+		if (ssl_session_owner(s) == owner)
+			{
+			s->time=time;
+			s->timeout=timeout;
+			SSL_SESSION_list_add(sh, s);
+			CRYPTO_w_unlock(sh->lock);
+			return;
+			}
+		CRYPTO_w_unlock(sh->lock);
+		}
+	}
+
 long SSL_SESSION_set_timeout(SSL_SESSION *s, long t)
 	{
 	if (s == NULL) return(0);
-	s->timeout=t;
+	ssl_session_requeue(s, s->time, t);
 	return(1);
 	}
 
@@ -853,7 +1097,7 @@ long SSL_SESSION_get_time(const SSL_SESSION *s)
 long SSL_SESSION_set_time(SSL_SESSION *s, long t)
 	{
 	if (s == NULL) return(0);
-	s->time=t;
+	ssl_session_requeue(s, t, s->timeout);
 	return(t);
 	}
 
@@ -946,48 +1190,39 @@ int SSL_set_session_ticket_ext(SSL *s, void *ext_data, int ext_len)
 	}
 #endif /* OPENSSL_NO_TLSEXT */
 
-typedef struct timeout_param_st
+/* Since the list of each shard is sorted by expiry time, with the session
+ * expiring first at the tail, flushing stops at the first session that is
+ * still valid. The work done is thus proportional to the number of expired
+ * sessions rather than to the size of the cache. */
+void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
 	{
-	SSL_CTX *ctx;
-	long time;
-	LHASH_OF(SSL_SESSION) *cache;
-	} TIMEOUT_PARAM;
+	unsigned int n;
+	SSL_SESS_SHARD *sh;
+	SSL_SESSION *c;
 
-static void timeout_doall_arg(SSL_SESSION *s, TIMEOUT_PARAM *p)
-	{
-	if ((p->time == 0) || (p->time > (s->time+s->timeout))) /* timeout */
+	/* Each shard is flushed under its own lock, so lookups in the other
+	 * shards can proceed in the meantime. */
+	for (n = 0; n < s->sess_shard_count; n++)
 		{
-		/* The reason we don't call SSL_CTX_remove_session() is to
-		 * save on locking overhead */
-		(void)lh_SSL_SESSION_delete(p->cache,s);
-		SSL_SESSION_list_remove(p->ctx,s);
-		s->not_resumable=1;
-		if (p->ctx->remove_session_cb != NULL)
-			p->ctx->remove_session_cb(p->ctx,s);
-		SSL_SESSION_free(s);
+		sh=&s->sess_shards[n];
+		CRYPTO_w_lock(sh->lock);
+		while ((c = sh->session_cache_tail) != NULL)
+			{
+			if ((t != 0) && (t <= ssl_session_expiry(c)))
+				break;
+			/* The reason we don't call SSL_CTX_remove_session() is
+			 * to save on locking overhead */
+			(void)lh_SSL_SESSION_delete(sh->sessions,c);
+			SSL_SESSION_list_remove(sh,c);
+			c->not_resumable=1;
+			if (s->remove_session_cb != NULL)
+				s->remove_session_cb(s,c);
+			SSL_SESSION_free(c);
+			}
+		CRYPTO_w_unlock(sh->lock);
 		}
 	}
 
-static IMPLEMENT_LHASH_DOALL_ARG_FN(timeout, SSL_SESSION, TIMEOUT_PARAM)
-
-void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
-	{
-	unsigned long i;
-	TIMEOUT_PARAM tp;
-
-	tp.ctx=s;
-	tp.cache=s->sessions;
-	if (tp.cache == NULL) return;
-	tp.time=t;
-	CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-	i=CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load;
-	CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load=0;
-	lh_SSL_SESSION_doall_arg(tp.cache, LHASH_DOALL_ARG_FN(timeout),
-				 TIMEOUT_PARAM, &tp);
-	CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load=i;
-	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
-	}
-
 int ssl_clear_bad_session(SSL *s)
 	{
 	if (	(s->session != NULL) &&
@@ -1001,30 +1236,30 @@ int ssl_clear_bad_session(SSL *s)
 		return(0);
 	}
 
-/* locked by SSL_CTX in the calling function */
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
+/* locked by the shard lock in the calling function */
+static void SSL_SESSION_list_remove(SSL_SESS_SHARD *sh, SSL_SESSION *s)
 	{
 	if ((s->next == NULL) || (s->prev == NULL)) return;
 
-	if (s->next == (SSL_SESSION *)&(ctx->session_cache_tail))
+	if (s->next == (SSL_SESSION *)&(sh->session_cache_tail))
 		{ /* last element in list */
-		if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head))
+		if (s->prev == (SSL_SESSION *)&(sh->session_cache_head))
 			{ /* only one element in list */
-			ctx->session_cache_head=NULL;
-			ctx->session_cache_tail=NULL;
+			sh->session_cache_head=NULL;
+			sh->session_cache_tail=NULL;
 			}
 		else
 			{
-			ctx->session_cache_tail=s->prev;
-			s->prev->next=(SSL_SESSION *)&(ctx->session_cache_tail);
+			sh->session_cache_tail=s->prev;
+			s->prev->next=(SSL_SESSION *)&(sh->session_cache_tail);
 			}
 		}
 	else
 		{
-		if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head))
+		if (s->prev == (SSL_SESSION *)&(sh->session_cache_head))
 			{ /* first element in list */
-			ctx->session_cache_head=s->next;
-			s->next->prev=(SSL_SESSION *)&(ctx->session_cache_head);
+			sh->session_cache_head=s->next;
+			s->next->prev=(SSL_SESSION *)&(sh->session_cache_head);
 			}
 		else
 			{ /* middle of list */
@@ -1033,26 +1268,59 @@ static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
 			}
 		}
 	s->prev=s->next=NULL;
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
+	s->owner=NULL;
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
 	}
 
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s)
+/* The list is ordered by expiry time, latest at the head. New sessions
+ * usually expire last and go to the head. Sessions given a shorter timeout
+ * than the rest gather near the tail, so the insertion point of any other
+ * session is searched for from there. */
+static void SSL_SESSION_list_add(SSL_SESS_SHARD *sh, SSL_SESSION *s)
 	{
+	SSL_SESSION *prev;
+	long expiry;
+
 	if ((s->next != NULL) && (s->prev != NULL))
-		SSL_SESSION_list_remove(ctx,s);
+		SSL_SESSION_list_remove(sh,s);
 
-	if (ctx->session_cache_head == NULL)
+	/* Taking the session into the cache fixes its time and timeout */
+	CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
+	expiry=ssl_session_expiry(s);
+	s->owner=sh->ctx;
+	CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
+	if (sh->session_cache_head == NULL)
 		{
-		ctx->session_cache_head=s;
-		ctx->session_cache_tail=s;
-		s->prev=(SSL_SESSION *)&(ctx->session_cache_head);
-		s->next=(SSL_SESSION *)&(ctx->session_cache_tail);
+		sh->session_cache_head=s;
+		sh->session_cache_tail=s;
+		s->prev=(SSL_SESSION *)&(sh->session_cache_head);
+		s->next=(SSL_SESSION *)&(sh->session_cache_tail);
 		}
-	else
-		{
-		s->next=ctx->session_cache_head;
+	else if (expiry >= ssl_session_expiry(sh->session_cache_head))
+		{ /* usual case, put us first */
+		s->next=sh->session_cache_head;
 		s->next->prev=s;
-		s->prev=(SSL_SESSION *)&(ctx->session_cache_head);
-		ctx->session_cache_head=s;
+		s->prev=(SSL_SESSION *)&(sh->session_cache_head);
+		sh->session_cache_head=s;
+		}
+	else if (expiry < ssl_session_expiry(sh->session_cache_tail))
+		{ /* we expire before everything else, put us last */
+		s->prev=sh->session_cache_tail;
+		s->prev->next=s;
+		s->next=(SSL_SESSION *)&(sh->session_cache_tail);
+		sh->session_cache_tail=s;
+		}
+	else
+		{ /* somewhere in the middle, insert after the last session
+		   * that expires later than us */
+		prev=sh->session_cache_tail->prev;
+		while (ssl_session_expiry(prev) <= expiry)
+			prev=prev->prev;
+		s->prev=prev;
+		s->next=prev->next;
+		prev->next->prev=s;
+		prev->next=s;
 		}
 	}
 
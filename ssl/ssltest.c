@@ -729,6 +729,7 @@ static int custom_ext_3_srv_add_cb(SSL *s, unsigned int ext_type,
 static char *cipher=NULL;
 static int verbose=0;
 static int debug=0;
+static int use_writev=0;
 #if 0
 /* Not used yet. */
 #ifdef FIONBIO
@@ -756,8 +757,12 @@ static void sv_usage(void)
 	fprintf(stderr," -v            - more output\n");
 	fprintf(stderr," -d            - debug output\n");
 	fprintf(stderr," -reuse        - use session-id reuse\n");
+	fprintf(stderr," -sess_shards <val> - split the server session cache into <val> shards\n");
 	fprintf(stderr," -num <val>    - number of connections to perform\n");
 	fprintf(stderr," -bytes <val>  - number of bytes to swap between client/server\n");
+	fprintf(stderr," -writev       - server writes with SSL_writev()\n");
+	fprintf(stderr," -small_buffers - allocate record buffers for each record\n");
+	fprintf(stderr," -verify_cache <val> - cache up to <val> verified chains\n");
 #ifndef OPENSSL_NO_DH
 	fprintf(stderr," -dhe1024      - use 1024 bit key (safe prime) for DHE\n");
 	fprintf(stderr," -dhe1024dsa   - use 1024 bit key (with 160-bit subprime) for DHE\n");
@@ -792,9 +797,11 @@ static void sv_usage(void)
 	fprintf(stderr," -zlib         - use zlib compression\n");
 	fprintf(stderr," -rle          - use rle compression\n");
 #ifndef OPENSSL_NO_ECDH
+	fprintf(stderr," -ec_precompute <val> - generate ephemeral ECDH keys <val> at a time\n");
 	fprintf(stderr," -named_curve arg  - Elliptic curve name to use for ephemeral ECDH keys.\n" \
 	               "                 Use \"openssl ecparam -list_curves\" for all names\n"  \
-	               "                 (default is sect163r2).\n");
+	               "                 (default is sect163r2, \"auto\" picks a\n" \
+	               "                 shared curve, preferring X25519).\n");
 #endif
 	fprintf(stderr," -test_cipherlist - Verifies the order of the ssl cipher lists.\n"
 		       "                    When this option is requested, the cipherlist\n"
@@ -989,12 +996,16 @@ int main(int argc, char *argv[])
 	char *client_key=NULL;
 #ifndef OPENSSL_NO_ECDH
 	char *named_curve = NULL;
+	int ec_precompute = 0;
 #endif
 	SSL_CTX *s_ctx=NULL;
 	SSL_CTX *c_ctx=NULL;
 	const SSL_METHOD *meth=NULL;
 	SSL *c_ssl,*s_ssl;
 	int number=1,reuse=0;
+	int sess_shards=0;
+	int small_buffers=0;
+	long verify_cache=0;
 	long bytes=256L;
 #ifndef OPENSSL_NO_DH
 	DH *dh;
@@ -1113,6 +1124,20 @@ int main(int argc, char *argv[])
 			debug=1;
 		else if	(strcmp(*argv,"-reuse") == 0)
 			reuse=1;
+		else if	(strcmp(*argv,"-sess_shards") == 0)
+			{
+			if (--argc < 1) goto bad;
+			sess_shards=atoi(*(++argv));
+			}
+		else if	(strcmp(*argv,"-writev") == 0)
+			use_writev=1;
+		else if	(strcmp(*argv,"-small_buffers") == 0)
+			small_buffers=1;
+		else if	(strcmp(*argv,"-verify_cache") == 0)
+			{
+			if (--argc < 1) goto bad;
+			verify_cache=atol(*(++argv));
+			}
 		else if	(strcmp(*argv,"-dhe1024") == 0)
 			{
 #ifndef OPENSSL_NO_DH
@@ -1257,6 +1282,11 @@ int main(int argc, char *argv[])
 			comp = COMP_RLE;
 			}
 #endif
+		else if	(strcmp(*argv,"-ec_precompute") == 0)
+			{
+			if (--argc < 1) goto bad;
+			ec_precompute = atoi(*(++argv));
+			}
 		else if	(strcmp(*argv,"-named_curve") == 0)
 			{
 			if (--argc < 1) goto bad;
@@ -1514,6 +1544,24 @@ bad:
 	SSL_CTX_set_security_level(c_ctx, 0);
 	SSL_CTX_set_security_level(s_ctx, 0);
 
+	if (sess_shards)
+		{
+		/* Make sure resumption goes through the session cache */
+		SSL_CTX_set_options(s_ctx, SSL_OP_NO_TICKET);
+		if (!SSL_CTX_set_session_cache_shards(s_ctx, sess_shards))
+			{
+			BIO_printf(bio_err, "Can't use %d session cache shards\n",
+				sess_shards);
+			goto end;
+			}
+		}
+
+	if (small_buffers)
+		{
+		SSL_CTX_set_mode(c_ctx, SSL_MODE_SMALL_BUFFERS);
+		SSL_CTX_set_mode(s_ctx, SSL_MODE_SMALL_BUFFERS);
+		}
+
 	if (cipher != NULL)
 		{
 		SSL_CTX_set_cipher_list(c_ctx,cipher);
@@ -1574,7 +1622,9 @@ bad:
 		{
 		int nid;
 
-		if (named_curve != NULL)
+		if (named_curve != NULL && strcmp(named_curve, "auto") == 0)
+			nid = NID_undef;
+		else if (named_curve != NULL)
 			{
 			nid = OBJ_sn2nid(named_curve);
 			if (nid == 0)
@@ -1590,16 +1640,23 @@ bad:
 			nid = NID_sect163r2;
 #endif
 
-		ecdh = EC_KEY_new_by_curve_name(nid);
-		if (ecdh == NULL)
+		if (nid == NID_undef)
+			SSL_CTX_set_ecdh_auto(s_ctx, 1);
+		else
 			{
-			BIO_printf(bio_err, "unable to create curve\n");
-			goto end;
-			}
+			ecdh = EC_KEY_new_by_curve_name(nid);
+			if (ecdh == NULL)
+				{
+				BIO_printf(bio_err, "unable to create curve\n");
+				goto end;
+				}
 
-		SSL_CTX_set_tmp_ecdh(s_ctx, ecdh);
+			SSL_CTX_set_tmp_ecdh(s_ctx, ecdh);
+			EC_KEY_free(ecdh);
+			}
 		SSL_CTX_set_options(s_ctx, SSL_OP_SINGLE_ECDH_USE);
-		EC_KEY_free(ecdh);
+		if (ec_precompute)
+			SSL_CTX_set_ec_precompute(s_ctx, ec_precompute);
 		}
 #else
 	(void)no_ecdhe;
@@ -1646,6 +1703,16 @@ bad:
 		/* goto end; */
 		}
 
+	if (verify_cache &&
+		(!X509_STORE_set_verify_cache_size(SSL_CTX_get_cert_store(s_ctx),
+				verify_cache) ||
+		!X509_STORE_set_verify_cache_size(SSL_CTX_get_cert_store(c_ctx),
+				verify_cache)))
+		{
+		ERR_print_errors(bio_err);
+		goto end;
+		}
+
 	if (client_auth)
 		{
 		BIO_printf(bio_err,"client authentication\n");
@@ -1834,6 +1901,14 @@ bad:
 			ret=doit(s_ssl,c_ssl,bytes);
 		}
 
+	if (sess_shards && reuse && ret == 0
+		&& SSL_CTX_sess_hits(s_ctx) != number - 1)
+		{
+		BIO_printf(bio_err, "Only %ld of %d handshakes resumed\n",
+			SSL_CTX_sess_hits(s_ctx), number - 1);
+		ret=1;
+		}
+
 	if (!verbose)
 		{
 		print_details(c_ssl, "");
@@ -1863,6 +1938,14 @@ bad:
 	SSL_free(s_ssl);
 	SSL_free(c_ssl);
 
+	if (SSL_CTX_get_buffer_count(s_ctx) || SSL_CTX_get_buffer_memory(s_ctx)
+		|| SSL_CTX_get_buffer_count(c_ctx)
+		|| SSL_CTX_get_buffer_memory(c_ctx))
+		{
+		BIO_printf(bio_err, "Record buffers not accounted for\n");
+		ret=1;
+		}
+
 end:
 	if (s_ctx != NULL) SSL_CTX_free(s_ctx);
 	if (c_ctx != NULL) SSL_CTX_free(c_ctx);
@@ -1884,6 +1967,7 @@ end:
 	CRYPTO_cleanup_all_ex_data();
 	ERR_free_strings();
 	ERR_remove_thread_state(NULL);
+	SSL_free_thread_buffers();
 	EVP_cleanup();
 	CRYPTO_mem_leaks(bio_err);
 	if (bio_err != NULL) BIO_free(bio_err);
@@ -2299,6 +2383,37 @@ end:
 #define C_DONE	1
 #define S_DONE	2
 
+/* Writes buf with SSL_writev() split into three pieces and sets the retry
+ * flags of the SSL BIO b as BIO_write() would have done. */
+static int writev_split(BIO *b, SSL *s, const char *buf, int len)
+	{
+	SSL_IOVEC iov[3];
+	int ret;
+
+	iov[0].base = buf;
+	iov[0].len = len/8;
+	iov[1].base = buf+iov[0].len;
+	iov[1].len = len/2;
+	iov[2].base = buf+iov[0].len+iov[1].len;
+	iov[2].len = len-iov[0].len-iov[1].len;
+
+	BIO_clear_retry_flags(b);
+	ret = SSL_writev(s,iov,3);
+	if (ret <= 0)
+		{
+		switch (SSL_get_error(s,ret))
+			{
+		case SSL_ERROR_WANT_WRITE:
+			BIO_set_retry_write(b);
+			break;
+		case SSL_ERROR_WANT_READ:
+			BIO_set_retry_read(b);
+			break;
+			}
+		}
+	return ret;
+	}
+
 int doit(SSL *s_ssl, SSL *c_ssl, long count)
 	{
 	char *cbuf=NULL,*sbuf=NULL;
@@ -2534,7 +2649,10 @@ int doit(SSL *s_ssl, SSL *c_ssl, long count)
 				{
 				j = (sw_num > bufsiz) ?
 					(int)bufsiz : (int)sw_num;
-				i=BIO_write(s_bio,sbuf,j);
+				if (use_writev)
+					i=writev_split(s_bio,s_ssl,sbuf,j);
+				else
+					i=BIO_write(s_bio,sbuf,j);
 				if (i < 0)
 					{
 					s_r=0;
@@ -2598,6 +2716,14 @@ int doit(SSL *s_ssl, SSL *c_ssl, long count)
 		ret = 1;
 		goto err;
 		}
+	if ((SSL_get_mode(s_ssl) & SSL_MODE_SMALL_BUFFERS) &&
+		SSL_get_buffer_memory(s_ssl) + SSL_get_buffer_memory(c_ssl))
+		{
+		fprintf(stderr, "Idle connections hold %ld bytes of record buffers\n",
+			SSL_get_buffer_memory(s_ssl) + SSL_get_buffer_memory(c_ssl));
+		ret = 1;
+		goto err;
+		}
 	ret=0;
 err:
 	/* We have to set the BIO's to NULL otherwise they will be
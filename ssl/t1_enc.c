@@ -805,6 +805,27 @@ int tls1_enc(SSL *s, int send)
 			buf[10]=(unsigned char)(s->version);
 			buf[11]=rec->length>>8;
 			buf[12]=rec->length&0xff;
+
+			if (EVP_CIPHER_flags(ds->cipher)&EVP_CIPH_FLAG_TLS1_AEAD_RECORD)
+				{
+				EVP_CTRL_AEAD_TLS1_RECORD_PARAM param;
+
+				/* Nonce, AAD, payload and tag in one call */
+				param.out=rec->data;
+				param.inp=rec->input;
+				param.len=l;
+				param.aad=buf;
+				if (EVP_CIPHER_CTX_ctrl(ds,EVP_CTRL_AEAD_TLS1_RECORD,
+							0,&param) <= 0)
+					return -1;
+				if (EVP_CIPHER_mode(enc) == EVP_CIPH_GCM_MODE && !send)
+					{
+					rec->data += EVP_GCM_TLS_EXPLICIT_IV_LEN;
+					rec->input += EVP_GCM_TLS_EXPLICIT_IV_LEN;
+					}
+				rec->length=param.len;
+				return 1;
+				}
 			pad=EVP_CIPHER_CTX_ctrl(ds,EVP_CTRL_AEAD_TLS1_AAD,13,buf);
 			if (send)
 				{
@@ -262,6 +262,7 @@ static const tls_curve_info nid_list[] =
 		{NID_brainpoolP256r1, 128, TLS_CURVE_PRIME}, /* brainpoolP256r1 (26) */	
 		{NID_brainpoolP384r1, 192, TLS_CURVE_PRIME}, /* brainpoolP384r1 (27) */	
 		{NID_brainpoolP512r1, 256, TLS_CURVE_PRIME},/* brainpool512r1 (28) */	
+		{NID_X25519, 128, TLS_CURVE_PRIME},/* X25519 (29) */
 	};
 
 
@@ -274,6 +275,7 @@ static const unsigned char ecformats_default[] =
 
 static const unsigned char eccurves_default[] =
 	{
+		0,29, /* X25519 (29) */
 		0,14, /* sect571r1 (14) */ 
 		0,13, /* sect571k1 (13) */ 
 		0,25, /* secp521r1 (25) */	
@@ -380,6 +382,8 @@ int tls1_ec_nid2curve_id(int nid)
 		return 27;
 	case NID_brainpoolP512r1:  /* brainpool512r1 (28) */
 		return 28;
+	case NID_X25519:  /* X25519 (29) */
+		return 29;
 	default:
 		return 0;
 		}
@@ -606,7 +610,7 @@ int tls1_set_curves(unsigned char **pext, size_t *pextlen,
 	return 1;
 	}
 
-#define MAX_CURVELIST	28
+#define MAX_CURVELIST	29
 
 typedef struct
 	{
@@ -65,6 +65,7 @@ my %mf_import = (
 	WP_ASM_OBJ     => \$mf_wp_asm,
 	CMLL_ENC       => \$mf_cm_asm,
 	MODES_ASM_OBJ  => \$mf_modes_asm,
+	POLY1305_ASM_OBJ => \$mf_poly1305_asm,
         ENGINES_ASM_OBJ=> \$mf_engines_asm,
 	PERLASM_SCHEME => \$mf_perlasm_scheme,
 	FIPSCANISTERONLY  => \$mf_fipscanisteronly,
@@ -135,6 +136,7 @@ and [options] can be one of
 	no-ripemd
 	no-rc2 no-rc4 no-rc5 no-idea no-des     - Skip this symetric cipher
 	no-bf no-cast no-aes no-camellia no-seed
+	no-chacha no-poly1305
 	no-rsa no-dsa no-dh			- Skip this public key cipher
 	no-ssl3					- Skip this version of SSL
 	just-ssl				- remove all non-ssl keys/digest
@@ -275,6 +277,8 @@ $cflags.=" -DOPENSSL_NO_IDEA" if $no_idea;
 $cflags.=" -DOPENSSL_NO_AES"  if $no_aes;
 $cflags.=" -DOPENSSL_NO_CAMELLIA"  if $no_camellia;
 $cflags.=" -DOPENSSL_NO_SEED" if $no_seed;
+$cflags.=" -DOPENSSL_NO_CHACHA" if $no_chacha;
+$cflags.=" -DOPENSSL_NO_POLY1305" if $no_poly1305;
 $cflags.=" -DOPENSSL_NO_RC2"  if $no_rc2;
 $cflags.=" -DOPENSSL_NO_RC4"  if $no_rc4;
 $cflags.=" -DOPENSSL_NO_RC5"  if $no_rc5;
@@ -911,6 +915,7 @@ if ($orig_platform eq 'copy') {
 	$lib_obj{CRYPTO} .= fix_asm($mf_rc4_asm, 'crypto/rc4');
 	$lib_obj{CRYPTO} .= fix_asm($mf_modes_asm, 'crypto/modes');
 	$lib_obj{CRYPTO} .= fix_asm($mf_ec_asm, 'crypto/ec');
+	$lib_obj{CRYPTO} .= fix_asm($mf_poly1305_asm, 'crypto/poly1305');
 }
 
 foreach (values %lib_nam)
@@ -1062,6 +1067,8 @@ sub var_add
 	return("") if $no_aes  && $dir =~ /\/aes/;
 	return("") if $no_camellia  && $dir =~ /\/camellia/;
 	return("") if $no_seed && $dir =~ /\/seed/;
+	return("") if $no_chacha && $dir =~ /\/chacha/;
+	return("") if $no_poly1305 && $dir =~ /\/poly1305/;
 	return("") if $no_rc2  && $dir =~ /\/rc2/;
 	return("") if $no_rc4  && $dir =~ /\/rc4/;
 	return("") if $no_rc5  && $dir =~ /\/rc5/;
@@ -1403,6 +1410,8 @@ sub read_options
 		"no-aes" => \$no_aes,
 		"no-camellia" => \$no_camellia,
 		"no-seed" => \$no_seed,
+		"no-chacha" => \$no_chacha,
+		"no-poly1305" => \$no_poly1305,
 		"no-des" => \$no_des,
 		"no-bf" => \$no_bf,
 		"no-cast" => \$no_cast,
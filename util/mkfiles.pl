@@ -26,6 +26,8 @@ my @dirs = (
 "crypto/aes",
 "crypto/camellia",
 "crypto/seed",
+"crypto/chacha",
+"crypto/poly1305",
 "crypto/modes",
 "crypto/cmac",
 "crypto/bn",